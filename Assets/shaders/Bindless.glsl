@@ -0,0 +1,11 @@
+//Bindless texture table (VulkanBindlessTextures), indices come from per-draw or per-material data
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 3, binding = 0) uniform sampler BindlessSamplers[];
+layout(set = 3, binding = 1) uniform texture2D BindlessTextures[];
+
+//nonuniformEXT: indices may differ between invocations of a draw (e.g. once draws are merged into indirect ones)
+vec4 SampleBindless(uint TextureIndex, uint SamplerIndex, vec2 UV)
+{
+    return texture(sampler2D(BindlessTextures[nonuniformEXT(TextureIndex)], BindlessSamplers[nonuniformEXT(SamplerIndex)]), UV);
+}
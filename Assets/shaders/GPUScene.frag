@@ -0,0 +1,23 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+
+//Fragment shader for objects drawn by VulkanGPUScene, the texture comes from the bindless table (set 3)
+
+#define __FRAGMENT__
+#include "VertexToFragment.glsl"
+
+#include "Bindless.glsl"
+
+//Written by GPUScene.vert from the object's TextureIndex and SamplerIndex
+layout(location = 2) flat in uint fragTextureIndex;
+layout(location = 3) flat in uint fragSamplerIndex;
+
+layout(location = 0) out vec4 outColor;
+layout(location = 1) out vec4 outSecondary;
+
+void main() {
+    vec4 Albedo = SampleBindless(fragTextureIndex, fragSamplerIndex, fragTexCoord);
+    outColor = Albedo;
+    outSecondary = Albedo.bgra;
+}
@@ -0,0 +1,29 @@
+//Data of VulkanGPUScene, must match GPUObject and GPUMesh in VulkanGPUScene.h
+
+struct GPUObject
+{
+    mat4 Model;
+    uint Mesh;
+    uint CommandIndex; //Where BuildDrawCommands writes this object's draw, grouped by pipeline
+    uint TextureIndex; //Bindless texture and sampler (see Bindless.glsl)
+    uint SamplerIndex;
+};
+
+struct GPUMesh
+{
+    vec4 BoundingSphere; //Object space center, radius in w
+    uint FirstIndex;
+    uint IndexCount;
+    int VertexOffset;
+    uint Padding;
+};
+
+//VkDrawIndexedIndirectCommand
+struct DrawIndexedCommand
+{
+    uint IndexCount;
+    uint InstanceCount;
+    uint FirstIndex;
+    int VertexOffset;
+    uint FirstInstance;
+};
@@ -0,0 +1,34 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+
+//Vertex shader for objects drawn by VulkanGPUScene, the model matrix comes from the object buffer
+
+//MVP (view and projection, set 0)
+#include "MVP.glsl"
+
+//Vertex Input Definition
+#include "VertexInput.glsl"
+
+//Data to pass to Fragment Shader
+#define __VERTEX__
+#include "VertexToFragment.glsl"
+
+#include "GPUScene.glsl"
+
+layout(set = 2, binding = 0, std430) readonly buffer ObjectBuffer
+{
+    GPUObject Items[];
+} Objects;
+
+//Bindless texture of the object for GPUScene.frag, the same for every vertex of an instance
+layout(location = 2) flat out uint fragTextureIndex;
+layout(location = 3) flat out uint fragSamplerIndex;
+
+void main() {
+    gl_Position = MVP.proj * MVP.view * Objects.Items[gl_InstanceIndex].Model * vec4(inPosition, 1.0);
+    fragColor = inColor;
+    fragTexCoord = inTexCoord;
+    fragTextureIndex = Objects.Items[gl_InstanceIndex].TextureIndex;
+    fragSamplerIndex = Objects.Items[gl_InstanceIndex].SamplerIndex;
+}
@@ -8,7 +8,7 @@
 layout(location = 0) out vec4 outColor;
 layout(location = 1) out vec4 outSecondary;
 
-layout(binding = 1) uniform sampler2D texSampler;
+layout(set = 1, binding = 0) uniform sampler2D texSampler;
 
 void main() {
     outColor = texture(texSampler, fragTexCoord);
@@ -0,0 +1,105 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <cmath>
+#include <algorithm>
+
+#include "Renderer/Jobs/JobSystem.h"
+
+//Micro-benchmark for the job system
+//Measures the cost of scheduling and running an empty job, and how a CPU-bound ParallelFor scales with worker count
+//Usage: ScalpelJobBenchmark [MaxWorkers]
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double SecondsSince(Clock::time_point Start)
+{
+	return std::chrono::duration<double>(Clock::now() - Start).count();
+}
+
+static void EmptyJob(void*) {}
+
+//Keeps the work from being optimized out without any shared writes between batches
+static volatile float Sink;
+
+static void BusyWork(uint32_t Begin, uint32_t End)
+{
+	float Accumulator = 0.0f;
+	for (uint32_t i = Begin; i < End; ++i)
+	{
+		float Value = static_cast<float>(i);
+		for (uint32_t j = 0; j < 64; ++j)
+		{
+			Value = std::sqrt(Value * 1.0001f + 1.0f);
+		}
+		Accumulator += Value;
+	}
+	Sink = Accumulator;
+}
+
+int main(int argc, char* argv[])
+{
+	const uint32_t HardwareThreads = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+	const uint32_t MaxThreads = (argc > 1) ? static_cast<uint32_t>(std::atoi(argv[1])) : HardwareThreads;
+
+	const uint32_t JobCount = 1 << 20;
+	const uint32_t WorkCount = 1 << 22;
+
+	printf("%-8s %14s %14s %14s %10s %10s\n", "Threads", "Raw ns/job", "Lambda ns/job", "ParallelFor ms", "Speedup", "Efficiency");
+
+	double SingleThreadTime = 0.0;
+	for (uint32_t ThreadCount = 1; ; ThreadCount = std::min(ThreadCount * 2, MaxThreads))
+	{
+		//The thread calling Wait helps, so ThreadCount threads means ThreadCount - 1 workers
+		JobSystem Jobs(ThreadCount - 1);
+
+		//Scheduling overhead: empty jobs through the function pointer path
+		Clock::time_point Start = Clock::now();
+		{
+			JobCounter Counter;
+			for (uint32_t i = 0; i < JobCount; ++i)
+			{
+				Jobs.Schedule(&EmptyJob, nullptr, &Counter);
+			}
+			Jobs.Wait(Counter);
+		}
+		const double RawTime = SecondsSince(Start);
+
+		//Same through the lambda path, which adds a heap allocation per job
+		std::atomic<uint32_t> LambdaRuns{0};
+		Start = Clock::now();
+		{
+			JobCounter Counter;
+			for (uint32_t i = 0; i < JobCount; ++i)
+			{
+				Jobs.Schedule([&LambdaRuns]() { LambdaRuns.fetch_add(1, std::memory_order_relaxed); }, &Counter);
+			}
+			Jobs.Wait(Counter);
+		}
+		const double LambdaTime = SecondsSince(Start);
+
+		//Scaling: CPU-bound loop split into batches
+		Start = Clock::now();
+		Jobs.ParallelFor(WorkCount, 4096, &BusyWork);
+		const double ParallelTime = SecondsSince(Start);
+
+		if (ThreadCount == 1)
+		{
+			SingleThreadTime = ParallelTime;
+		}
+		const double Speedup = SingleThreadTime / ParallelTime;
+
+		printf("%-8u %14.1f %14.1f %14.2f %9.2fx %9.0f%%\n", ThreadCount,
+			RawTime * 1e9 / JobCount, LambdaTime * 1e9 / JobCount, ParallelTime * 1e3, Speedup, Speedup / ThreadCount * 100.0);
+
+		if (ThreadCount >= MaxThreads)
+		{
+			break;
+		}
+	}
+
+	return 0;
+}
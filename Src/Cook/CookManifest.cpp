@@ -0,0 +1,180 @@
+#include "CookManifest.h"
+#include "Cookers.h"
+
+#include "Renderer/Core/Hash.h"
+
+#include <json/json.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	bool GetFileStats(const std::string& Path, int64_t& OutSize, int64_t& OutModifiedTime)
+	{
+		std::error_code ErrorCode;
+		const uintmax_t Size = fs::file_size(Path, ErrorCode);
+		if (ErrorCode)
+		{
+			return false;
+		}
+
+		const fs::file_time_type ModifiedTime = fs::last_write_time(Path, ErrorCode);
+		if (ErrorCode)
+		{
+			return false;
+		}
+
+		OutSize = static_cast<int64_t>(Size);
+		OutModifiedTime = static_cast<int64_t>(ModifiedTime.time_since_epoch().count());
+		return true;
+	}
+}
+
+CookInput CookManifest::Snapshot(const std::string& Path)
+{
+	CookInput Input = { Path, -1, 0, 0 };
+
+	std::vector<uint8_t> Data;
+	if (GetFileStats(Path, Input.Size, Input.ModifiedTime) && ReadFileBytes(Path, Data))
+	{
+		Input.Hash = HashBytes(Data.data(), Data.size());
+	}
+	else
+	{
+		Input.Size = -1;
+	}
+	return Input;
+}
+
+bool CookManifest::IsUpToDate(const std::string& RelativePath, const Cooker& AssetCooker, const std::string& OutputDir) const
+{
+	auto FoundEntry = Entries.find(RelativePath);
+	if (FoundEntry == Entries.end())
+	{
+		return false;
+	}
+
+	const CookManifestEntry& Entry = FoundEntry->second;
+	if (Entry.Cooker != AssetCooker.Name || Entry.CookerVersion != AssetCooker.Version || Entry.Inputs.empty())
+	{
+		return false;
+	}
+
+	for (const std::string& Output : Entry.Outputs)
+	{
+		std::error_code ErrorCode;
+		if (!fs::exists(OutputDir + "/" + Output, ErrorCode))
+		{
+			return false;
+		}
+	}
+
+	for (const CookInput& Input : Entry.Inputs)
+	{
+		int64_t Size, ModifiedTime;
+		if (!GetFileStats(Input.Path, Size, ModifiedTime))
+		{
+			//Still missing is fine (e.g. an optional base pipeline), appearing or disappearing is not
+			if (Input.Size != -1)
+			{
+				return false;
+			}
+			continue;
+		}
+
+		if (Input.Size == -1 || Size != Input.Size)
+		{
+			return false;
+		}
+
+		if (ModifiedTime != Input.ModifiedTime && Snapshot(Input.Path).Hash != Input.Hash)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool CookManifest::Load(const std::string& Filename)
+{
+	Entries.clear();
+
+	std::vector<uint8_t> Text;
+	if (!ReadFileBytes(Filename, Text))
+	{
+		return false;
+	}
+
+	try
+	{
+		const nlohmann::json Manifest = nlohmann::json::parse(Text.begin(), Text.end());
+		if (Manifest.value("version", 0u) != Version)
+		{
+			return false;
+		}
+
+		for (auto It = Manifest["assets"].begin(); It != Manifest["assets"].end(); ++It)
+		{
+			const nlohmann::json& Asset = It.value();
+
+			CookManifestEntry Entry;
+			Entry.Cooker = Asset["cooker"].get<std::string>();
+			Entry.CookerVersion = Asset["cooker_version"].get<uint32_t>();
+			Entry.Outputs = Asset["outputs"].get<std::vector<std::string>>();
+
+			for (const nlohmann::json& Input : Asset["inputs"])
+			{
+				Entry.Inputs.push_back(CookInput{ Input["path"].get<std::string>(), Input["size"].get<int64_t>(), Input["time"].get<int64_t>(), Input["hash"].get<uint64_t>() });
+			}
+
+			Entries.emplace(It.key(), std::move(Entry));
+		}
+	}
+	catch (const std::exception& Exception)
+	{
+		std::cout << "Ignoring invalid cook manifest " << Filename << ": " << Exception.what() << std::endl;
+		Entries.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool CookManifest::Save(const std::string& Filename) const
+{
+	nlohmann::json Manifest;
+	Manifest["version"] = Version;
+	Manifest["assets"] = nlohmann::json::object();
+
+	for (const auto& Element : Entries)
+	{
+		const CookManifestEntry& Entry = Element.second;
+
+		nlohmann::json Asset;
+		Asset["cooker"] = Entry.Cooker;
+		Asset["cooker_version"] = Entry.CookerVersion;
+		Asset["outputs"] = Entry.Outputs;
+		Asset["inputs"] = nlohmann::json::array();
+
+		for (const CookInput& Input : Entry.Inputs)
+		{
+			Asset["inputs"].push_back({ { "path", Input.Path }, { "size", Input.Size }, { "time", Input.ModifiedTime }, { "hash", Input.Hash } });
+		}
+
+		Manifest["assets"][Element.first] = std::move(Asset);
+	}
+
+	std::ofstream File(Filename, std::ios::binary | std::ios::trunc);
+	if (!File.is_open())
+	{
+		return false;
+	}
+
+	File << Manifest.dump(1, '\t');
+	return File.good();
+}
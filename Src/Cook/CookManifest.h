@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+
+struct Cooker;
+
+//State of one input file when its asset was last cooked
+struct CookInput
+{
+	std::string Path;
+	int64_t Size;          //-1 if the file didn't exist
+	int64_t ModifiedTime;
+	uint64_t Hash;         //HashBytes of the contents
+};
+
+struct CookManifestEntry
+{
+	std::string Cooker;
+	uint32_t CookerVersion = 0;
+	std::vector<CookInput> Inputs;      //Source file first, then its dependencies
+	std::vector<std::string> Outputs;   //Relative to the output directory
+};
+
+//Remembers what every asset was cooked from so unchanged assets are skipped on the next run
+class CookManifest
+{
+public:
+
+	static const uint32_t Version = 1;
+
+	//A missing or outdated manifest just means everything gets cooked
+	bool Load(const std::string& Filename);
+	bool Save(const std::string& Filename) const;
+
+	//True if RelativePath was cooked by this cooker version, its outputs exist and no input changed.
+	//Inputs whose size and timestamp match are trusted, otherwise their contents are re-hashed
+	//so touching a file without changing it doesn't trigger a rebuild
+	bool IsUpToDate(const std::string& RelativePath, const Cooker& AssetCooker, const std::string& OutputDir) const;
+
+	static CookInput Snapshot(const std::string& Path);
+
+	std::map<std::string, CookManifestEntry> Entries;
+};
@@ -0,0 +1,97 @@
+#include "Cookers.h"
+
+#include <algorithm>
+#include <fstream>
+#include <cctype>
+
+namespace
+{
+	std::string GetLowerExtension(const std::string& Filename)
+	{
+		const size_t Slash = Filename.find_last_of("/\\");
+		const size_t Dot = Filename.rfind('.');
+		if (Dot == std::string::npos || (Slash != std::string::npos && Dot < Slash))
+		{
+			return std::string();
+		}
+
+		std::string Extension = Filename.substr(Dot + 1);
+		std::transform(Extension.begin(), Extension.end(), Extension.begin(), [](unsigned char c) { return (char) std::tolower(c); });
+		return Extension;
+	}
+
+	//First component of a path relative to the asset directory, empty for files directly in it
+	std::string GetLowerFirstDirectory(const std::string& RelativePath)
+	{
+		const size_t Slash = RelativePath.find_first_of("/\\");
+		if (Slash == std::string::npos)
+		{
+			return std::string();
+		}
+
+		std::string Directory = RelativePath.substr(0, Slash);
+		std::transform(Directory.begin(), Directory.end(), Directory.begin(), [](unsigned char c) { return (char) std::tolower(c); });
+		return Directory;
+	}
+
+	const Cooker MeshCooker     = { "mesh",     1, CookMesh };
+	const Cooker TextureCooker  = { "texture",  1, CookTexture };
+	const Cooker ShaderCooker   = { "shader",   3, CookShader };
+	const Cooker PipelineCooker = { "pipeline", 2, CookPipeline };
+}
+
+const Cooker* FindCooker(const std::string& RelativePath)
+{
+	const std::string Extension = GetLowerExtension(RelativePath);
+
+	if (Extension == "obj" || Extension == "gltf")
+	{
+		return &MeshCooker;
+	}
+	if (Extension == "png" || Extension == "jpg" || Extension == "jpeg" || Extension == "tga")
+	{
+		return &TextureCooker;
+	}
+	//.glsl files are only ever included, they get cooked as dependencies of the stages using them
+	if (Extension == "vert" || Extension == "frag" || Extension == "comp" || Extension == "geom" || Extension == "tesc" || Extension == "tese")
+	{
+		return &ShaderCooker;
+	}
+	//Only JSON in the top level pipelines directory describes pipelines, not any path that happens to contain the word
+	if (Extension == "json" && GetLowerFirstDirectory(RelativePath) == "pipelines")
+	{
+		return &PipelineCooker;
+	}
+	return nullptr;
+}
+
+bool ReadFileBytes(const std::string& Filename, std::vector<uint8_t>& OutData)
+{
+	std::ifstream File(Filename, std::ios::ate | std::ios::binary);
+	if (!File.is_open())
+	{
+		return false;
+	}
+
+	OutData.resize(static_cast<size_t>(File.tellg()));
+	File.seekg(0);
+	File.read(reinterpret_cast<char*>(OutData.data()), OutData.size());
+	return File.good() || OutData.empty();
+}
+
+std::string ReplaceExtension(const std::string& Path, const std::string& NewExtension)
+{
+	const size_t Slash = Path.find_last_of("/\\");
+	const size_t Dot = Path.rfind('.');
+	if (Dot == std::string::npos || (Slash != std::string::npos && Dot < Slash))
+	{
+		return Path + NewExtension;
+	}
+	return Path.substr(0, Dot) + NewExtension;
+}
+
+std::string GetDirectory(const std::string& Path)
+{
+	const size_t Slash = Path.find_last_of("/\\");
+	return (Slash == std::string::npos) ? std::string(".") : Path.substr(0, Slash);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//A file produced by a cooker, Path is relative to the output directory / archive root
+struct CookedOutput
+{
+	std::string Path;
+	std::vector<uint8_t> Data;
+};
+
+//Converts one source asset into runtime-ready outputs. Dependencies receives every file the result was
+//built from besides the source itself (shader includes, glTF buffers, base pipelines) so the manifest can
+//rebuild the asset when any of them changes. Returns false and fills Error on failure
+typedef bool (*CookFunction)(const std::string& SourceFile, const std::string& RelativePath,
+							 std::vector<CookedOutput>& Outputs, std::vector<std::string>& Dependencies, std::string& Error);
+
+struct Cooker
+{
+	const char* Name;
+	//Bumping a cooker's version invalidates everything it produced
+	uint32_t Version;
+	CookFunction Cook;
+};
+
+//Returns null for files that aren't cooked on their own (GLSL includes, .bin buffers, .mtl, ...).
+//RelativePath is relative to the asset directory, pipelines are the JSON files under pipelines/
+const Cooker* FindCooker(const std::string& RelativePath);
+
+//MeshCooker.cpp: OBJ and glTF into CookedMesh
+bool CookMesh(const std::string& SourceFile, const std::string& RelativePath,
+			  std::vector<CookedOutput>& Outputs, std::vector<std::string>& Dependencies, std::string& Error);
+
+//TextureCooker.cpp: PNG/JPG/TGA into KTX2 with a full mip chain
+bool CookTexture(const std::string& SourceFile, const std::string& RelativePath,
+				 std::vector<CookedOutput>& Outputs, std::vector<std::string>& Dependencies, std::string& Error);
+
+//ShaderCooker.cpp: GLSL into SPIR-V plus its serialized ShaderReflection
+bool CookShader(const std::string& SourceFile, const std::string& RelativePath,
+				std::vector<CookedOutput>& Outputs, std::vector<std::string>& Dependencies, std::string& Error);
+
+//PipelineCooker.cpp: pipeline JSON with its base pipelines merged in, stored as CBOR
+bool CookPipeline(const std::string& SourceFile, const std::string& RelativePath,
+				  std::vector<CookedOutput>& Outputs, std::vector<std::string>& Dependencies, std::string& Error);
+
+//Shared helpers
+bool ReadFileBytes(const std::string& Filename, std::vector<uint8_t>& OutData);
+std::string ReplaceExtension(const std::string& Path, const std::string& NewExtension);
+std::string GetDirectory(const std::string& Path);
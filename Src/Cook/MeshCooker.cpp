@@ -0,0 +1,489 @@
+#include "Cookers.h"
+
+#include "Renderer/Core/CookedMesh.h"
+#include "Renderer/Core/Hash.h"
+
+#include <json/json.hpp>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tinyobj/tiny_obj_loader.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+	//Must match the layout of Vertex in VulkanBuffer.h
+	struct CookVertex
+	{
+		float Pos[3];
+		float Color[3];
+		float TexCoord[2];
+	};
+
+	static_assert(sizeof(CookVertex) == 32, "CookVertex must match the renderer's Vertex struct");
+
+	//Unindexed triangle soup in, unique vertices + indices out
+	void DeduplicateVertices(const std::vector<CookVertex>& Corners, std::vector<CookVertex>& OutVertices, std::vector<uint32_t>& OutIndices)
+	{
+		std::unordered_multimap<uint64_t, uint32_t> VertexLookup;
+		VertexLookup.reserve(Corners.size());
+
+		OutVertices.clear();
+		OutIndices.clear();
+		OutIndices.reserve(Corners.size());
+
+		for (const CookVertex& Corner : Corners)
+		{
+			const uint64_t Hash = HashBytes(&Corner, sizeof(CookVertex));
+
+			uint32_t Index = std::numeric_limits<uint32_t>::max();
+			auto Range = VertexLookup.equal_range(Hash);
+			for (auto It = Range.first; It != Range.second; ++It)
+			{
+				if (memcmp(&OutVertices[It->second], &Corner, sizeof(CookVertex)) == 0)
+				{
+					Index = It->second;
+					break;
+				}
+			}
+
+			if (Index == std::numeric_limits<uint32_t>::max())
+			{
+				Index = static_cast<uint32_t>(OutVertices.size());
+				OutVertices.push_back(Corner);
+				VertexLookup.emplace(Hash, Index);
+			}
+
+			OutIndices.push_back(Index);
+		}
+	}
+
+	const int VertexCacheSize = 32;
+
+	//Tom Forsyth's "Linear-Speed Vertex Cache Optimisation" scoring
+	float GetVertexScore(int CachePosition, uint32_t RemainingTriangles)
+	{
+		if (RemainingTriangles == 0)
+		{
+			return -1.0f;
+		}
+
+		float Score = 0.0f;
+		if (CachePosition >= 0)
+		{
+			//The last triangle's vertices get a fixed score so we don't just strip along them
+			Score = (CachePosition < 3) ? 0.75f : powf(1.0f - (CachePosition - 3) / float(VertexCacheSize - 3), 1.5f);
+		}
+
+		//Favour vertices with few triangles left so they can leave the cache for good
+		return Score + 2.0f * powf(float(RemainingTriangles), -0.5f);
+	}
+
+	//Reorders triangles so consecutive triangles share vertices in the post-transform cache
+	void OptimizeVertexCache(std::vector<uint32_t>& Indices, uint32_t VertexCount)
+	{
+		const size_t TriangleCount = Indices.size() / 3;
+
+		//Triangles using each vertex, packed: vertex V owns Adjacency[Offsets[V], Offsets[V] + Remaining[V])
+		std::vector<uint32_t> Remaining(VertexCount, 0);
+		for (uint32_t Index : Indices)
+		{
+			Remaining[Index]++;
+		}
+
+		std::vector<uint32_t> Offsets(VertexCount + 1, 0);
+		for (uint32_t V = 0; V < VertexCount; ++V)
+		{
+			Offsets[V + 1] = Offsets[V] + Remaining[V];
+		}
+
+		std::vector<uint32_t> Adjacency(Indices.size());
+		{
+			std::vector<uint32_t> Cursor(Offsets.begin(), Offsets.end() - 1);
+			for (size_t i = 0; i < Indices.size(); ++i)
+			{
+				Adjacency[Cursor[Indices[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+
+		std::vector<int> CachePosition(VertexCount, -1);
+		std::vector<float> VertexScore(VertexCount);
+		for (uint32_t V = 0; V < VertexCount; ++V)
+		{
+			VertexScore[V] = GetVertexScore(-1, Remaining[V]);
+		}
+
+		std::vector<bool> bEmitted(TriangleCount, false);
+		std::vector<uint32_t> Cache, NewCache;
+		std::vector<uint32_t> Output;
+		Output.reserve(Indices.size());
+
+		size_t ScanCursor = 0;
+		int64_t BestTriangle = -1;
+
+		while (Output.size() < Indices.size())
+		{
+			//Nothing in the cache can be used, start from the next unused triangle
+			if (BestTriangle < 0)
+			{
+				while (bEmitted[ScanCursor])
+				{
+					++ScanCursor;
+				}
+				BestTriangle = static_cast<int64_t>(ScanCursor);
+			}
+
+			const uint32_t* Corners = &Indices[BestTriangle * 3];
+			bEmitted[BestTriangle] = true;
+
+			NewCache.clear();
+			for (int Corner = 0; Corner < 3; ++Corner)
+			{
+				const uint32_t V = Corners[Corner];
+				Output.push_back(V);
+				NewCache.push_back(V);
+
+				//Remove the triangle from this vertex's adjacency
+				uint32_t* Begin = &Adjacency[Offsets[V]];
+				uint32_t* End = Begin + Remaining[V];
+				uint32_t* Found = std::find(Begin, End, static_cast<uint32_t>(BestTriangle));
+				if (Found != End)
+				{
+					*Found = *(End - 1);
+					Remaining[V]--;
+				}
+			}
+
+			//Emitted corners move to the front of the LRU cache
+			for (uint32_t V : Cache)
+			{
+				if (V != Corners[0] && V != Corners[1] && V != Corners[2])
+				{
+					NewCache.push_back(V);
+				}
+			}
+
+			for (size_t i = 0; i < NewCache.size(); ++i)
+			{
+				const uint32_t V = NewCache[i];
+				CachePosition[V] = (i < VertexCacheSize) ? static_cast<int>(i) : -1;
+				VertexScore[V] = GetVertexScore(CachePosition[V], Remaining[V]);
+			}
+
+			if (NewCache.size() > VertexCacheSize)
+			{
+				NewCache.resize(VertexCacheSize);
+			}
+			Cache.swap(NewCache);
+
+			//Next triangle is the best one touching the cache
+			BestTriangle = -1;
+			float BestScore = -1.0f;
+			for (uint32_t V : Cache)
+			{
+				for (uint32_t i = 0; i < Remaining[V]; ++i)
+				{
+					const uint32_t Triangle = Adjacency[Offsets[V] + i];
+					const float Score = VertexScore[Indices[Triangle * 3 + 0]] + VertexScore[Indices[Triangle * 3 + 1]] + VertexScore[Indices[Triangle * 3 + 2]];
+					if (Score > BestScore)
+					{
+						BestScore = Score;
+						BestTriangle = Triangle;
+					}
+				}
+			}
+		}
+
+		Indices.swap(Output);
+	}
+
+	//Reorders vertices by first use so vertex fetches walk memory linearly
+	void OptimizeVertexFetch(std::vector<CookVertex>& Vertices, std::vector<uint32_t>& Indices)
+	{
+		std::vector<uint32_t> Remap(Vertices.size(), std::numeric_limits<uint32_t>::max());
+		std::vector<CookVertex> Reordered;
+		Reordered.reserve(Vertices.size());
+
+		for (uint32_t& Index : Indices)
+		{
+			if (Remap[Index] == std::numeric_limits<uint32_t>::max())
+			{
+				Remap[Index] = static_cast<uint32_t>(Reordered.size());
+				Reordered.push_back(Vertices[Index]);
+			}
+			Index = Remap[Index];
+		}
+
+		Vertices.swap(Reordered);
+	}
+
+	bool LoadObjCorners(const std::string& SourceFile, std::vector<CookVertex>& OutCorners, std::string& Error)
+	{
+		tinyobj::attrib_t Attrib;
+		std::vector<tinyobj::shape_t> Shapes;
+		std::vector<tinyobj::material_t> Materials;
+
+		if (!tinyobj::LoadObj(&Attrib, &Shapes, &Materials, &Error, SourceFile.c_str(), (GetDirectory(SourceFile) + "/").c_str()))
+		{
+			return false;
+		}
+
+		for (const auto& Shape : Shapes)
+		{
+			for (const auto& Index : Shape.mesh.indices)
+			{
+				CookVertex Corner = {};
+				Corner.Pos[0] = Attrib.vertices[3 * Index.vertex_index + 0];
+				Corner.Pos[1] = Attrib.vertices[3 * Index.vertex_index + 1];
+				Corner.Pos[2] = Attrib.vertices[3 * Index.vertex_index + 2];
+
+				//Same convention as LoadModel: OBJ texture space has V pointing up
+				if (Index.texcoord_index >= 0)
+				{
+					Corner.TexCoord[0] = Attrib.texcoords[2 * Index.texcoord_index + 0];
+					Corner.TexCoord[1] = 1.0f - Attrib.texcoords[2 * Index.texcoord_index + 1];
+				}
+
+				Corner.Color[0] = Corner.Color[1] = Corner.Color[2] = 1.0f;
+				OutCorners.push_back(Corner);
+			}
+		}
+
+		Error.clear();
+		return true;
+	}
+
+	//Minimal glTF 2.0 reader: external .bin buffers, triangle list primitives, POSITION/TEXCOORD_0/COLOR_0 as floats
+	//NOTE: Node transforms aren't applied, every primitive of every mesh is merged in its local space
+	struct GLTFReader
+	{
+		nlohmann::json Document;
+		std::vector<std::vector<uint8_t>> Buffers;
+
+		//Returns a pointer to element 0 and the stride of the accessor's data, or null if it can't be read
+		const uint8_t* GetAccessorData(size_t AccessorIndex, uint32_t ExpectedComponentType, uint32_t& OutCount, uint32_t& OutStride, uint32_t& OutComponents) const
+		{
+			static const std::unordered_map<std::string, uint32_t> ComponentsPerType = {
+				{ "SCALAR", 1 }, { "VEC2", 2 }, { "VEC3", 3 }, { "VEC4", 4 }
+			};
+
+			const nlohmann::json& Accessor = Document["accessors"].at(AccessorIndex);
+			const uint32_t ComponentType = Accessor["componentType"].get<uint32_t>();
+			if ((ExpectedComponentType != 0 && ComponentType != ExpectedComponentType) || Accessor.count("bufferView") == 0)
+			{
+				return nullptr;
+			}
+
+			auto FoundType = ComponentsPerType.find(Accessor["type"].get<std::string>());
+			if (FoundType == ComponentsPerType.end())
+			{
+				return nullptr;
+			}
+
+			const uint32_t ComponentSize = (ComponentType == 5121) ? 1 : (ComponentType == 5123) ? 2 : 4;
+			const nlohmann::json& View = Document["bufferViews"].at(Accessor["bufferView"].get<size_t>());
+			const size_t BufferIndex = View["buffer"].get<size_t>();
+			const uint64_t Offset = View.value("byteOffset", uint64_t(0)) + Accessor.value("byteOffset", uint64_t(0));
+
+			OutCount = Accessor["count"].get<uint32_t>();
+			OutComponents = FoundType->second;
+			OutStride = View.value("byteStride", ComponentSize * OutComponents);
+
+			if (BufferIndex >= Buffers.size() || OutCount == 0
+				|| Offset + uint64_t(OutCount - 1) * OutStride + ComponentSize * OutComponents > Buffers[BufferIndex].size())
+			{
+				return nullptr;
+			}
+
+			return Buffers[BufferIndex].data() + Offset;
+		}
+	};
+
+	bool LoadGLTFCorners(const std::string& SourceFile, std::vector<CookVertex>& OutCorners, std::vector<std::string>& Dependencies, std::string& Error)
+	{
+		std::vector<uint8_t> Text;
+		if (!ReadFileBytes(SourceFile, Text))
+		{
+			Error = "failed to open file";
+			return false;
+		}
+
+		GLTFReader Reader;
+		Reader.Document = nlohmann::json::parse(Text.begin(), Text.end());
+
+		for (const nlohmann::json& Buffer : Reader.Document["buffers"])
+		{
+			const std::string Uri = Buffer.value("uri", std::string());
+			if (Uri.empty() || Uri.compare(0, 5, "data:") == 0)
+			{
+				Error = "only external buffers are supported";
+				return false;
+			}
+
+			const std::string BufferFile = GetDirectory(SourceFile) + "/" + Uri;
+			Dependencies.push_back(BufferFile);
+
+			Reader.Buffers.emplace_back();
+			if (!ReadFileBytes(BufferFile, Reader.Buffers.back()))
+			{
+				Error = "failed to open buffer " + BufferFile;
+				return false;
+			}
+		}
+
+		for (const nlohmann::json& Mesh : Reader.Document["meshes"])
+		{
+			for (const nlohmann::json& Primitive : Mesh["primitives"])
+			{
+				//Only triangle lists
+				if (Primitive.value("mode", 4) != 4)
+				{
+					continue;
+				}
+
+				const nlohmann::json& Attributes = Primitive["attributes"];
+
+				uint32_t VertexCount = 0, PosStride = 0, PosComponents = 0;
+				const uint8_t* Positions = Reader.GetAccessorData(Attributes["POSITION"].get<size_t>(), 5126, VertexCount, PosStride, PosComponents);
+				if (!Positions || PosComponents != 3)
+				{
+					Error = "POSITION must be a float VEC3";
+					return false;
+				}
+
+				uint32_t Count = 0, UVStride = 0, UVComponents = 0;
+				const uint8_t* TexCoords = Attributes.count("TEXCOORD_0") ? Reader.GetAccessorData(Attributes["TEXCOORD_0"].get<size_t>(), 5126, Count, UVStride, UVComponents) : nullptr;
+				if (TexCoords && (Count != VertexCount || UVComponents != 2))
+				{
+					TexCoords = nullptr;
+				}
+
+				uint32_t ColorStride = 0, ColorComponents = 0;
+				const uint8_t* Colors = Attributes.count("COLOR_0") ? Reader.GetAccessorData(Attributes["COLOR_0"].get<size_t>(), 5126, Count, ColorStride, ColorComponents) : nullptr;
+				if (Colors && (Count != VertexCount || ColorComponents < 3))
+				{
+					Colors = nullptr;
+				}
+
+				std::vector<CookVertex> PrimitiveVertices(VertexCount);
+				for (uint32_t i = 0; i < VertexCount; ++i)
+				{
+					CookVertex& Vertex = PrimitiveVertices[i];
+					memcpy(Vertex.Pos, Positions + i * PosStride, sizeof(Vertex.Pos));
+
+					if (TexCoords)
+					{
+						memcpy(Vertex.TexCoord, TexCoords + i * UVStride, sizeof(Vertex.TexCoord));
+					}
+
+					if (Colors)
+					{
+						memcpy(Vertex.Color, Colors + i * ColorStride, sizeof(Vertex.Color));
+					}
+					else
+					{
+						Vertex.Color[0] = Vertex.Color[1] = Vertex.Color[2] = 1.0f;
+					}
+				}
+
+				if (Primitive.count("indices") == 0)
+				{
+					OutCorners.insert(OutCorners.end(), PrimitiveVertices.begin(), PrimitiveVertices.end());
+					continue;
+				}
+
+				uint32_t IndexCount = 0, IndexStride = 0, IndexComponents = 0;
+				const size_t IndexAccessor = Primitive["indices"].get<size_t>();
+				const uint32_t IndexType = Reader.Document["accessors"].at(IndexAccessor)["componentType"].get<uint32_t>();
+				const uint8_t* Indices = Reader.GetAccessorData(IndexAccessor, 0, IndexCount, IndexStride, IndexComponents);
+				if (!Indices)
+				{
+					Error = "unreadable index accessor";
+					return false;
+				}
+
+				for (uint32_t i = 0; i < IndexCount; ++i)
+				{
+					const uint8_t* IndexData = Indices + i * IndexStride;
+					uint32_t Index = 0;
+					if (IndexType == 5121)      { Index = *IndexData; }
+					else if (IndexType == 5123) { uint16_t Value; memcpy(&Value, IndexData, 2); Index = Value; }
+					else                        { memcpy(&Index, IndexData, 4); }
+
+					if (Index >= VertexCount)
+					{
+						Error = "index out of range";
+						return false;
+					}
+					OutCorners.push_back(PrimitiveVertices[Index]);
+				}
+			}
+		}
+
+		return true;
+	}
+}
+
+bool CookMesh(const std::string& SourceFile, const std::string& RelativePath,
+			  std::vector<CookedOutput>& Outputs, std::vector<std::string>& Dependencies, std::string& Error)
+{
+	const bool bGLTF = SourceFile.size() >= 5 && SourceFile.compare(SourceFile.size() - 5, 5, ".gltf") == 0;
+
+	//Corners are expanded first and re-indexed below, so OBJ and glTF index data end up identical in shape
+	std::vector<CookVertex> Corners;
+	const bool bLoaded = bGLTF ? LoadGLTFCorners(SourceFile, Corners, Dependencies, Error) : LoadObjCorners(SourceFile, Corners, Error);
+	if (!bLoaded)
+	{
+		return false;
+	}
+
+	if (Corners.empty() || Corners.size() % 3 != 0)
+	{
+		Error = "mesh has no triangles";
+		return false;
+	}
+
+	std::vector<CookVertex> Vertices;
+	std::vector<uint32_t> Indices;
+	DeduplicateVertices(Corners, Vertices, Indices);
+	OptimizeVertexCache(Indices, static_cast<uint32_t>(Vertices.size()));
+	OptimizeVertexFetch(Vertices, Indices);
+
+	CookedMeshHeader Header = {};
+	memcpy(Header.Magic, "SMSH", 4);
+	Header.Version = CookedMeshVersion;
+	Header.VertexStride = sizeof(CookVertex);
+	Header.VertexCount = static_cast<uint32_t>(Vertices.size());
+	Header.IndexCount = static_cast<uint32_t>(Indices.size());
+
+	for (int Axis = 0; Axis < 3; ++Axis)
+	{
+		Header.BoundsMin[Axis] = std::numeric_limits<float>::max();
+		Header.BoundsMax[Axis] = -std::numeric_limits<float>::max();
+	}
+	for (const CookVertex& Vertex : Vertices)
+	{
+		for (int Axis = 0; Axis < 3; ++Axis)
+		{
+			Header.BoundsMin[Axis] = std::min(Header.BoundsMin[Axis], Vertex.Pos[Axis]);
+			Header.BoundsMax[Axis] = std::max(Header.BoundsMax[Axis], Vertex.Pos[Axis]);
+		}
+	}
+
+	CookedOutput Output;
+	Output.Path = ReplaceExtension(RelativePath, ".smesh");
+
+	const size_t VertexBytes = Vertices.size() * sizeof(CookVertex);
+	const size_t IndexBytes = Indices.size() * sizeof(uint32_t);
+	Output.Data.resize(sizeof(CookedMeshHeader) + VertexBytes + IndexBytes);
+	memcpy(Output.Data.data(), &Header, sizeof(CookedMeshHeader));
+	memcpy(Output.Data.data() + sizeof(CookedMeshHeader), Vertices.data(), VertexBytes);
+	memcpy(Output.Data.data() + sizeof(CookedMeshHeader) + VertexBytes, Indices.data(), IndexBytes);
+
+	Outputs.push_back(std::move(Output));
+	return true;
+}
@@ -0,0 +1,43 @@
+#include "Cookers.h"
+
+#include "Renderer/Core/PipelineDescription.h"
+
+bool CookPipeline(const std::string& SourceFile, const std::string& RelativePath,
+				  std::vector<CookedOutput>& Outputs, std::vector<std::string>& Dependencies, std::string& Error)
+{
+	//SourceFile = <AssetDir>/<RelativePath>
+	const std::string AssetDir = SourceFile.substr(0, SourceFile.size() - RelativePath.size());
+
+	auto ReadAsset = [&](const std::string& Name, std::vector<uint8_t>& OutData)
+	{
+		return ReadFileBytes(AssetDir + Name, OutData);
+	};
+
+	//Flatten the base_pipeline chain so the runtime reads a single description
+	nlohmann::json Pipeline;
+	std::vector<std::string> Bases;
+	const bool bLoaded = LoadPipelineDescription(RelativePath, ReadAsset, Pipeline, Bases, Error);
+
+	//Tracked even when missing, the pipeline is re-cooked once the base shows up
+	for (const std::string& Base : Bases)
+	{
+		Dependencies.push_back(AssetDir + Base);
+	}
+
+	if (!bLoaded)
+	{
+		return false;
+	}
+
+	//The runtime derives the pipeline from its base when both are loaded together
+	if (Pipeline.count("derived_from"))
+	{
+		Pipeline["derived_from"] = ReplaceExtension(Pipeline["derived_from"].get<std::string>(), ".pipeline");
+	}
+
+	CookedOutput Output;
+	Output.Path = ReplaceExtension(RelativePath, ".pipeline");
+	Output.Data = nlohmann::json::to_cbor(Pipeline);
+	Outputs.push_back(std::move(Output));
+	return true;
+}
@@ -0,0 +1,42 @@
+#include "Cookers.h"
+
+#include "Renderer/GLSL/ShaderCompiler.hpp"
+#include "Renderer/GLSL/ShaderReflection.h"
+
+#include <cstring>
+
+bool CookShader(const std::string& SourceFile, const std::string& RelativePath,
+				std::vector<CookedOutput>& Outputs, std::vector<std::string>& Dependencies, std::string& Error)
+{
+	//Gathered before compiling so a broken include still gets tracked and retried when it's fixed
+	std::set<std::string> Includes;
+	GetShaderIncludes(SourceFile, Includes);
+	Dependencies.insert(Dependencies.end(), Includes.begin(), Includes.end());
+
+	const std::vector<unsigned int> SpirV = CompileGLSL(SourceFile);
+	if (SpirV.empty())
+	{
+		Error = "compilation failed";
+		return false;
+	}
+
+	ShaderReflection Reflection;
+	if (!Reflection.Reflect(SpirV))
+	{
+		Error = "SPIR-V reflection failed";
+		return false;
+	}
+
+	CookedOutput SpirVOutput;
+	SpirVOutput.Path = RelativePath + ".spv";
+	SpirVOutput.Data.resize(SpirV.size() * sizeof(unsigned int));
+	memcpy(SpirVOutput.Data.data(), SpirV.data(), SpirVOutput.Data.size());
+	Outputs.push_back(std::move(SpirVOutput));
+
+	CookedOutput ReflectionOutput;
+	ReflectionOutput.Path = RelativePath + ".refl";
+	Reflection.Serialize(ReflectionOutput.Data);
+	Outputs.push_back(std::move(ReflectionOutput));
+
+	return true;
+}
@@ -0,0 +1,177 @@
+#include "Cookers.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const uint8_t KTX2Identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+	//VK_FORMAT_R8G8B8A8_UNORM, matches what VulkanImage::LoadImageFromFile creates
+	const uint32_t FormatR8G8B8A8Unorm = 37;
+
+	//Same on-disk layout as the one read by KTX2File
+	struct KTX2Header
+	{
+		uint8_t  Identifier[12];
+		uint32_t VkFormat;
+		uint32_t TypeSize;
+		uint32_t PixelWidth;
+		uint32_t PixelHeight;
+		uint32_t PixelDepth;
+		uint32_t LayerCount;
+		uint32_t FaceCount;
+		uint32_t LevelCount;
+		uint32_t SupercompressionScheme;
+
+		uint32_t DfdByteOffset;
+		uint32_t DfdByteLength;
+		uint32_t KvdByteOffset;
+		uint32_t KvdByteLength;
+		uint64_t SgdByteOffset;
+		uint64_t SgdByteLength;
+	};
+
+	struct KTX2LevelIndex
+	{
+		uint64_t ByteOffset;
+		uint64_t ByteLength;
+		uint64_t UncompressedByteLength;
+	};
+
+	static_assert(sizeof(KTX2Header) == 80, "KTX2Header must match the on-disk layout");
+
+	struct MipLevel
+	{
+		uint32_t Width;
+		uint32_t Height;
+		std::vector<uint8_t> Pixels;
+	};
+
+	//2x2 box filter, odd edges reuse the last row/column
+	MipLevel Downsample(const MipLevel& Source)
+	{
+		MipLevel Result;
+		Result.Width = std::max(Source.Width / 2, 1u);
+		Result.Height = std::max(Source.Height / 2, 1u);
+		Result.Pixels.resize(size_t(Result.Width) * Result.Height * 4);
+
+		for (uint32_t y = 0; y < Result.Height; ++y)
+		{
+			const uint32_t y0 = std::min(y * 2, Source.Height - 1);
+			const uint32_t y1 = std::min(y * 2 + 1, Source.Height - 1);
+
+			for (uint32_t x = 0; x < Result.Width; ++x)
+			{
+				const uint32_t x0 = std::min(x * 2, Source.Width - 1);
+				const uint32_t x1 = std::min(x * 2 + 1, Source.Width - 1);
+
+				for (uint32_t Channel = 0; Channel < 4; ++Channel)
+				{
+					const uint32_t Sum = Source.Pixels[(size_t(y0) * Source.Width + x0) * 4 + Channel]
+									   + Source.Pixels[(size_t(y0) * Source.Width + x1) * 4 + Channel]
+									   + Source.Pixels[(size_t(y1) * Source.Width + x0) * 4 + Channel]
+									   + Source.Pixels[(size_t(y1) * Source.Width + x1) * 4 + Channel];
+					Result.Pixels[(size_t(y) * Result.Width + x) * 4 + Channel] = static_cast<uint8_t>((Sum + 2) / 4);
+				}
+			}
+		}
+
+		return Result;
+	}
+
+	//Basic data format descriptor for 8 bit RGBA, required by the spec even though KTX2File only reads vkFormat
+	void WriteRGBA8DataFormatDescriptor(std::vector<uint32_t>& OutWords)
+	{
+		const uint32_t SampleCount = 4;
+		const uint32_t BlockSize = 24 + 16 * SampleCount;
+
+		OutWords.push_back(4 + BlockSize);   //dfdTotalSize
+		OutWords.push_back(0);               //vendorId = Khronos, descriptorType = basic
+		OutWords.push_back(2 | (BlockSize << 16)); //versionNumber = 1.3, descriptorBlockSize
+		OutWords.push_back(1 | (1 << 8) | (1 << 16)); //colorModel = RGBSDA, primaries = BT709, transfer = linear
+		OutWords.push_back(0);               //texelBlockDimensions (1x1x1x1)
+		OutWords.push_back(4);               //bytesPlane0
+		OutWords.push_back(0);               //bytesPlane4-7
+
+		const uint32_t ChannelIds[SampleCount] = { 0, 1, 2, 15 }; //R, G, B, A
+		for (uint32_t Sample = 0; Sample < SampleCount; ++Sample)
+		{
+			OutWords.push_back((Sample * 8) | (7 << 16) | (ChannelIds[Sample] << 24)); //bitOffset, bitLength - 1, channelType
+			OutWords.push_back(0);   //samplePosition
+			OutWords.push_back(0);   //sampleLower
+			OutWords.push_back(255); //sampleUpper
+		}
+	}
+}
+
+bool CookTexture(const std::string& SourceFile, const std::string& RelativePath,
+				 std::vector<CookedOutput>& Outputs, std::vector<std::string>& Dependencies, std::string& Error)
+{
+	int Width, Height, Channels;
+	stbi_uc* PixelData = stbi_load(SourceFile.c_str(), &Width, &Height, &Channels, STBI_rgb_alpha);
+	if (!PixelData)
+	{
+		Error = stbi_failure_reason() ? stbi_failure_reason() : "failed to load image data";
+		return false;
+	}
+
+	std::vector<MipLevel> Levels(1);
+	Levels[0].Width = static_cast<uint32_t>(Width);
+	Levels[0].Height = static_cast<uint32_t>(Height);
+	Levels[0].Pixels.assign(PixelData, PixelData + size_t(Width) * Height * 4);
+	stbi_image_free(PixelData);
+
+	while (Levels.back().Width > 1 || Levels.back().Height > 1)
+	{
+		Levels.push_back(Downsample(Levels.back()));
+	}
+
+	std::vector<uint32_t> DataFormatDescriptor;
+	WriteRGBA8DataFormatDescriptor(DataFormatDescriptor);
+
+	const uint32_t LevelCount = static_cast<uint32_t>(Levels.size());
+	const size_t LevelIndexOffset = sizeof(KTX2Header);
+	const size_t DfdOffset = LevelIndexOffset + LevelCount * sizeof(KTX2LevelIndex);
+	const size_t DfdSize = DataFormatDescriptor.size() * sizeof(uint32_t);
+
+	KTX2Header Header = {};
+	memcpy(Header.Identifier, KTX2Identifier, sizeof(KTX2Identifier));
+	Header.VkFormat = FormatR8G8B8A8Unorm;
+	Header.TypeSize = 1;
+	Header.PixelWidth = Levels[0].Width;
+	Header.PixelHeight = Levels[0].Height;
+	Header.FaceCount = 1;
+	Header.LevelCount = LevelCount;
+	Header.DfdByteOffset = static_cast<uint32_t>(DfdOffset);
+	Header.DfdByteLength = static_cast<uint32_t>(DfdSize);
+
+	//Levels are stored smallest first, each aligned to lcm(texel size, 4) = 4 bytes, which RGBA8 sizes always are
+	std::vector<KTX2LevelIndex> LevelIndex(LevelCount);
+	size_t Offset = DfdOffset + DfdSize;
+	Offset = (Offset + 3) & ~size_t(3);
+	for (uint32_t Level = LevelCount; Level-- > 0;)
+	{
+		LevelIndex[Level].ByteOffset = Offset;
+		LevelIndex[Level].ByteLength = Levels[Level].Pixels.size();
+		LevelIndex[Level].UncompressedByteLength = Levels[Level].Pixels.size();
+		Offset += Levels[Level].Pixels.size();
+	}
+
+	CookedOutput Output;
+	Output.Path = ReplaceExtension(RelativePath, ".ktx2");
+	Output.Data.resize(Offset, 0);
+
+	memcpy(Output.Data.data(), &Header, sizeof(KTX2Header));
+	memcpy(Output.Data.data() + LevelIndexOffset, LevelIndex.data(), LevelCount * sizeof(KTX2LevelIndex));
+	memcpy(Output.Data.data() + DfdOffset, DataFormatDescriptor.data(), DfdSize);
+	for (uint32_t Level = 0; Level < LevelCount; ++Level)
+	{
+		memcpy(Output.Data.data() + LevelIndex[Level].ByteOffset, Levels[Level].Pixels.data(), Levels[Level].Pixels.size());
+	}
+
+	Outputs.push_back(std::move(Output));
+	return true;
+}
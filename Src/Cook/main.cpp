@@ -0,0 +1,256 @@
+//ScalpelCook: converts Assets/ into runtime-ready files and packs them into one archive
+//
+//  ScalpelCook [AssetDir] [OutputDir] [-j Threads] [--force]
+//
+//Meshes become deduplicated, cache-optimized binary meshes, textures become KTX2 with a full mip chain,
+//shaders become SPIR-V plus serialized reflection and pipeline JSON is flattened into CBOR.
+//Only assets whose inputs changed since the last run (see CookManifest) are cooked again.
+
+#include "Cookers.h"
+#include "CookManifest.h"
+
+#include "Renderer/IO/AssetArchive.h"
+#include "Renderer/Jobs/JobSystem.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <chrono>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	struct CookJob
+	{
+		std::string SourceFile;
+		std::string RelativePath;
+		const Cooker* AssetCooker;
+
+		//Results, written by the worker that ran this job
+		bool bSkipped = false;
+		bool bSucceeded = false;
+		CookManifestEntry Entry;
+	};
+
+	bool WriteOutput(const std::string& OutputDir, const CookedOutput& Output)
+	{
+		const fs::path OutputPath = fs::path(OutputDir) / Output.Path;
+
+		std::error_code ErrorCode;
+		fs::create_directories(OutputPath.parent_path(), ErrorCode);
+
+		std::ofstream File(OutputPath, std::ios::binary | std::ios::trunc);
+		File.write(reinterpret_cast<const char*>(Output.Data.data()), Output.Data.size());
+		return File.good();
+	}
+
+	void RunJob(CookJob& Job, const CookManifest& Manifest, const std::string& OutputDir, bool bForce, std::mutex& LogMutex)
+	{
+		if (!bForce && Manifest.IsUpToDate(Job.RelativePath, *Job.AssetCooker, OutputDir))
+		{
+			Job.bSkipped = true;
+			Job.bSucceeded = true;
+			return;
+		}
+
+		//Snapshotted before cooking so an edit made mid-cook still shows up as a change on the next run
+		const CookInput SourceInput = CookManifest::Snapshot(Job.SourceFile);
+
+		std::vector<CookedOutput> Outputs;
+		std::vector<std::string> Dependencies;
+		std::string Error;
+
+		bool bCooked = false;
+		try
+		{
+			bCooked = Job.AssetCooker->Cook(Job.SourceFile, Job.RelativePath, Outputs, Dependencies, Error);
+		}
+		catch (const std::exception& Exception)
+		{
+			Error = Exception.what();
+		}
+
+		for (const CookedOutput& Output : Outputs)
+		{
+			if (bCooked && !WriteOutput(OutputDir, Output))
+			{
+				Error = "failed to write " + Output.Path;
+				bCooked = false;
+			}
+		}
+
+		if (!bCooked)
+		{
+			std::lock_guard<std::mutex> Lock(LogMutex);
+			std::cout << "FAILED " << Job.RelativePath << ": " << Error << std::endl;
+			return;
+		}
+
+		Job.Entry.Cooker = Job.AssetCooker->Name;
+		Job.Entry.CookerVersion = Job.AssetCooker->Version;
+		Job.Entry.Inputs.push_back(SourceInput);
+		for (const std::string& Dependency : Dependencies)
+		{
+			Job.Entry.Inputs.push_back(CookManifest::Snapshot(Dependency));
+		}
+		for (const CookedOutput& Output : Outputs)
+		{
+			Job.Entry.Outputs.push_back(Output.Path);
+		}
+
+		Job.bSucceeded = true;
+
+		std::lock_guard<std::mutex> Lock(LogMutex);
+		std::cout << "Cooked " << Job.RelativePath << std::endl;
+	}
+
+	bool WriteArchive(const CookManifest& Manifest, const std::string& OutputDir, const std::string& ArchiveFile)
+	{
+		AssetArchiveWriter Writer;
+
+		for (const auto& Element : Manifest.Entries)
+		{
+			for (const std::string& Output : Element.second.Outputs)
+			{
+				std::vector<uint8_t> Data;
+				if (!ReadFileBytes(OutputDir + "/" + Output, Data))
+				{
+					std::cout << "Missing cooked file: " << Output << std::endl;
+					return false;
+				}
+				Writer.AddFile(Output, Data, true);
+			}
+		}
+
+		return Writer.Write(ArchiveFile);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string AssetDir = ASSET_DIR;
+	std::string OutputDir = COOKED_ASSET_DIR;
+	uint32_t ThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	bool bForce = false;
+
+	std::vector<std::string> Positional;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string Arg = argv[i];
+		if (Arg == "--force")
+		{
+			bForce = true;
+		}
+		else if (Arg == "-j" && i + 1 < argc)
+		{
+			ThreadCount = std::max(std::stoi(argv[++i]), 1);
+		}
+		else
+		{
+			Positional.push_back(Arg);
+		}
+	}
+
+	if (Positional.size() > 0) { AssetDir = Positional[0]; }
+	if (Positional.size() > 1) { OutputDir = Positional[1]; }
+
+	std::error_code ErrorCode;
+	fs::create_directories(OutputDir, ErrorCode);
+
+	const std::string ManifestFile = OutputDir + "/CookManifest.json";
+	const std::string ArchiveFile = OutputDir + "/Assets.pak";
+
+	const auto StartTime = std::chrono::steady_clock::now();
+
+	//Gather every source file we know how to cook
+	std::vector<CookJob> Jobs;
+	for (const fs::directory_entry& DirectoryEntry : fs::recursive_directory_iterator(AssetDir, ErrorCode))
+	{
+		if (!DirectoryEntry.is_regular_file())
+		{
+			continue;
+		}
+
+		const std::string RelativePath = AssetArchive::NormalizePath(fs::relative(DirectoryEntry.path(), AssetDir).generic_string());
+		const Cooker* AssetCooker = FindCooker(RelativePath);
+		if (!AssetCooker)
+		{
+			continue;
+		}
+
+		CookJob Job;
+		Job.SourceFile = DirectoryEntry.path().generic_string();
+		Job.RelativePath = RelativePath;
+		Job.AssetCooker = AssetCooker;
+		Jobs.push_back(std::move(Job));
+	}
+
+	if (ErrorCode)
+	{
+		std::cout << "Failed to scan " << AssetDir << ": " << ErrorCode.message() << std::endl;
+		return 1;
+	}
+
+	CookManifest Manifest;
+	Manifest.Load(ManifestFile);
+
+	//Assets are independent of each other, one job per asset lets idle workers steal the big ones
+	std::mutex LogMutex;
+	{
+		JobSystem CookJobs(ThreadCount - 1);
+		CookJobs.ParallelFor(static_cast<uint32_t>(Jobs.size()), 1, [&](uint32_t Begin, uint32_t End)
+		{
+			for (uint32_t JobIndex = Begin; JobIndex < End; ++JobIndex)
+			{
+				RunJob(Jobs[JobIndex], Manifest, OutputDir, bForce, LogMutex);
+			}
+		});
+	}
+
+	//Rebuild the manifest from this run, which also drops assets that were deleted from AssetDir
+	CookManifest NewManifest;
+	size_t CookedCount = 0, SkippedCount = 0, FailedCount = 0;
+	for (CookJob& Job : Jobs)
+	{
+		if (!Job.bSucceeded)
+		{
+			FailedCount++;
+		}
+		else if (Job.bSkipped)
+		{
+			SkippedCount++;
+			NewManifest.Entries.emplace(Job.RelativePath, Manifest.Entries[Job.RelativePath]);
+		}
+		else
+		{
+			CookedCount++;
+			NewManifest.Entries.emplace(Job.RelativePath, std::move(Job.Entry));
+		}
+	}
+
+	const bool bManifestChanged = CookedCount > 0 || NewManifest.Entries.size() != Manifest.Entries.size();
+	if (bManifestChanged || !fs::exists(ArchiveFile, ErrorCode))
+	{
+		if (!WriteArchive(NewManifest, OutputDir, ArchiveFile))
+		{
+			std::cout << "Failed to write " << ArchiveFile << std::endl;
+			return 1;
+		}
+	}
+
+	if (!NewManifest.Save(ManifestFile))
+	{
+		std::cout << "Failed to write " << ManifestFile << std::endl;
+		return 1;
+	}
+
+	const auto ElapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - StartTime).count();
+	std::cout << "Cooked " << CookedCount << ", up to date " << SkippedCount << ", failed " << FailedCount
+			  << " (" << ElapsedMs << " ms, " << ThreadCount << " threads) -> " << ArchiveFile << std::endl;
+
+	return FailedCount > 0 ? 1 : 0;
+}
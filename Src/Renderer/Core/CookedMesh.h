@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+//Binary mesh produced by ScalpelCook
+//
+//Layout: [CookedMeshHeader][VertexCount * VertexStride bytes of vertices][IndexCount uint32 indices]
+//Vertices are deduplicated and ordered for the post-transform cache, so the data is uploaded as-is
+
+struct CookedMeshHeader
+{
+	char     Magic[4];        //"SMSH"
+	uint32_t Version;
+	uint32_t VertexStride;    //Must match the renderer's Vertex struct
+	uint32_t VertexCount;
+	uint32_t IndexCount;
+	uint32_t Reserved;
+	float    BoundsMin[3];
+	float    BoundsMax[3];
+};
+
+static_assert(sizeof(CookedMeshHeader) == 48, "CookedMeshHeader must match the on-disk layout");
+
+const uint32_t CookedMeshVersion = 1;
+
+//Validates the header and sizes, OutVertices/OutIndices point into Data
+inline bool ParseCookedMesh(const uint8_t* Data, size_t Size, CookedMeshHeader& OutHeader, const uint8_t*& OutVertices, const uint32_t*& OutIndices)
+{
+	if (Size < sizeof(CookedMeshHeader))
+	{
+		return false;
+	}
+
+	memcpy(&OutHeader, Data, sizeof(CookedMeshHeader));
+	if (memcmp(OutHeader.Magic, "SMSH", 4) != 0 || OutHeader.Version != CookedMeshVersion)
+	{
+		return false;
+	}
+
+	const uint64_t VertexBytes = uint64_t(OutHeader.VertexCount) * OutHeader.VertexStride;
+	const uint64_t IndexBytes = uint64_t(OutHeader.IndexCount) * sizeof(uint32_t);
+	if (sizeof(CookedMeshHeader) + VertexBytes + IndexBytes > Size)
+	{
+		return false;
+	}
+
+	OutVertices = Data + sizeof(CookedMeshHeader);
+	OutIndices = reinterpret_cast<const uint32_t*>(OutVertices + VertexBytes);
+	return true;
+}
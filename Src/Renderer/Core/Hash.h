@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+//64 bit FNV-1a, stable across runs and platforms so hashes can be stored on disk
+inline uint64_t HashBytes(const void* Data, size_t Size, uint64_t Seed = 14695981039346656037ull)
+{
+	const uint8_t* Bytes = static_cast<const uint8_t*>(Data);
+	uint64_t Hash = Seed;
+	for (size_t i = 0; i < Size; ++i)
+	{
+		Hash ^= Bytes[i];
+		Hash *= 1099511628211ull;
+	}
+	return Hash;
+}
+
+inline uint64_t HashString(const std::string& String)
+{
+	return HashBytes(String.data(), String.size());
+}
+
+//Folds Value into Hash, order dependent
+inline void HashCombine(uint64_t& Hash, uint64_t Value)
+{
+	Hash ^= Value + 0x9e3779b97f4a7c15ull + (Hash << 6) + (Hash >> 2);
+}
+
+//Hashes the raw bytes of a trivially copyable value (structs must be zero-initialized so padding is stable)
+template<typename T>
+inline void HashCombinePod(uint64_t& Hash, const T& Value)
+{
+	HashCombine(Hash, HashBytes(&Value, sizeof(T)));
+}
+
+//Cache key kept as the bytes that get hashed, so caches can compare keys in full on a hit and a 64 bit collision
+//can't hand out the wrong object. Use with Hasher as the key of an unordered_map
+class HashKey
+{
+public:
+
+	//Raw bytes of a trivially copyable value (structs must be zero-initialized so padding is stable)
+	template<typename T>
+	void Add(const T& Value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "keys hold raw bytes");
+		AddBytes(&Value, sizeof(T));
+	}
+
+	void AddBytes(const void* Data, size_t Size)
+	{
+		const uint8_t* Begin = static_cast<const uint8_t*>(Data);
+		Bytes.insert(Bytes.end(), Begin, Begin + Size);
+	}
+
+	//Length prefixed, consecutive strings can't run into each other
+	void AddString(const char* String)
+	{
+		const uint64_t Length = strlen(String);
+		Add(Length);
+		AddBytes(String, static_cast<size_t>(Length));
+	}
+
+	uint64_t GetHash() const { return HashBytes(Bytes.data(), Bytes.size()); }
+	const std::vector<uint8_t>& GetBytes() const { return Bytes; }
+
+	bool operator==(const HashKey& Other) const { return Bytes == Other.Bytes; }
+	bool operator!=(const HashKey& Other) const { return Bytes != Other.Bytes; }
+
+	struct Hasher
+	{
+		size_t operator()(const HashKey& Key) const { return static_cast<size_t>(Key.GetHash()); }
+	};
+
+protected:
+
+	std::vector<uint8_t> Bytes;
+};
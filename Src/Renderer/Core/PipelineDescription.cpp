@@ -0,0 +1,99 @@
+#include "PipelineDescription.h"
+
+#include <set>
+#include <iostream>
+
+namespace
+{
+	bool ParseDescription(const std::string& Name, const std::vector<uint8_t>& Data, nlohmann::json& OutJson, std::string& Error)
+	{
+		const bool bCooked = Name.size() >= 9 && Name.compare(Name.size() - 9, 9, ".pipeline") == 0;
+
+		try
+		{
+			OutJson = bCooked ? nlohmann::json::from_cbor(Data) : nlohmann::json::parse(Data.begin(), Data.end());
+		}
+		catch (const std::exception& Exception)
+		{
+			Error = Name + ": " + Exception.what();
+			return false;
+		}
+
+		if (!OutJson.is_object() || !OutJson["pipeline"].is_object())
+		{
+			Error = Name + ": missing \"pipeline\" object";
+			return false;
+		}
+		return true;
+	}
+
+	bool ReadDescription(const std::string& Name, const AssetReadFunction& ReadAsset, nlohmann::json& OutJson, std::string& Error)
+	{
+		std::vector<uint8_t> Data;
+		if (!ReadAsset(Name, Data))
+		{
+			Error = "failed to open " + Name;
+			return false;
+		}
+		return ParseDescription(Name, Data, OutJson, Error);
+	}
+}
+
+std::string ResolveBasePipeline(const std::string& Name, const std::string& BasePath)
+{
+	const std::string AssetPrefix = "Assets/";
+	if (BasePath.compare(0, AssetPrefix.size(), AssetPrefix) == 0)
+	{
+		return BasePath.substr(AssetPrefix.size());
+	}
+
+	const size_t Slash = Name.find_last_of("/\\");
+	return (Slash == std::string::npos) ? BasePath : Name.substr(0, Slash) + "/" + BasePath;
+}
+
+bool LoadPipelineDescription(const std::string& Name, const AssetReadFunction& ReadAsset, nlohmann::json& OutDescription,
+							 std::vector<std::string>& OutBases, std::string& Error)
+{
+	if (!ReadDescription(Name, ReadAsset, OutDescription, Error))
+	{
+		return false;
+	}
+
+	std::set<std::string> Visited = { Name };
+	std::string CurrentName = Name;
+
+	while (OutDescription["pipeline"].count("base_pipeline"))
+	{
+		const std::string BaseName = ResolveBasePipeline(CurrentName, OutDescription["pipeline"]["base_pipeline"].get<std::string>());
+		OutDescription["pipeline"].erase("base_pipeline");
+
+		if (!Visited.insert(BaseName).second)
+		{
+			Error = "base_pipeline cycle through " + BaseName;
+			return false;
+		}
+
+		OutBases.push_back(BaseName);
+
+		nlohmann::json Base;
+		std::string BaseError;
+		if (!ReadDescription(BaseName, ReadAsset, Base, BaseError))
+		{
+			std::cout << "Warning: " << Name << ": " << BaseError << ", loading without it" << std::endl;
+			break;
+		}
+
+		if (CurrentName == Name)
+		{
+			OutDescription["derived_from"] = BaseName;
+		}
+
+		//Only the pipeline object is inherited
+		Base.erase("derived_from");
+		Base.merge_patch(OutDescription);
+		OutDescription = std::move(Base);
+		CurrentName = BaseName;
+	}
+
+	return true;
+}
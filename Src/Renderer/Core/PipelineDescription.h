@@ -0,0 +1,26 @@
+#pragma once
+
+#include <json/json.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <functional>
+
+//Pipeline descriptions: {"pipeline": {...}} as JSON (Assets/pipelines/*.json) or as CBOR once cooked (.pipeline)
+//
+//A description may name a base_pipeline, relative to the repository root ("Assets/pipelines/...") or to
+//itself, whose values it overrides. Descriptions are addressed by asset name ("pipelines/Test.json"),
+//relative to the asset directory or cooked archive root.
+
+//Reads an asset by name, returns false if it doesn't exist
+typedef std::function<bool(const std::string& Name, std::vector<uint8_t>& OutData)> AssetReadFunction;
+
+//Asset name of the base_pipeline BasePath referenced from the description Name
+std::string ResolveBasePipeline(const std::string& Name, const std::string& BasePath);
+
+//Loads Name and merges its base_pipeline chain into it (derived values win). OutBases receives every base
+//name in the chain, nearest first, including a missing one (the chain stops there with a warning).
+//The nearest base that loaded is kept as "derived_from", cooked descriptions carry it over from the cooker
+bool LoadPipelineDescription(const std::string& Name, const AssetReadFunction& ReadAsset, nlohmann::json& OutDescription,
+							 std::vector<std::string>& OutBases, std::string& Error);
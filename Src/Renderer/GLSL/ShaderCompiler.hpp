@@ -1,3 +1,5 @@
+#pragma once
+
 #include <glslang/public/ShaderLang.h>
 #include <SPIRV/GlslangToSpv.h>
 #include <StandAlone/DirStackFileIncluder.h>
@@ -6,21 +8,25 @@
 #include <fstream>
 #include <string>
 #include <vector>
+#include <set>
+#include <mutex>
+
+//NOTE: Functions are inline so this header can be shared by the renderer and the application
 
-std::string GetFilePath(const std::string& str)
+inline std::string GetFilePath(const std::string& str)
 {
 	size_t found = str.find_last_of("/\\");
 	return str.substr(0,found);
 	//size_t FileName = str.substr(found+1);
 }
 
-std::string GetSuffix(const std::string& name)
+inline std::string GetSuffix(const std::string& name)
 {
     const size_t pos = name.rfind('.');
     return (pos == std::string::npos) ? "" : name.substr(name.rfind('.') + 1);
 }
 
-EShLanguage GetShaderStage(const std::string& stage)
+inline EShLanguage GetShaderStage(const std::string& stage)
 {
     if (stage == "vert") {
         return EShLangVertex;
@@ -137,18 +143,43 @@ const TBuiltInResource DefaultTBuiltInResource = {
     }
 };
 
-static bool glslangInitialized = false;
+//Collects every file pulled in through #include "..." (recursively), used to track shader dependencies
+inline void GetShaderIncludes(const std::string& filename, std::set<std::string>& OutIncludes)
+{
+	std::ifstream file(filename);
+	std::string Line;
+
+	while (std::getline(file, Line))
+	{
+		const size_t IncludePos = Line.find("#include");
+		if (IncludePos == std::string::npos)
+		{
+			continue;
+		}
+
+		const size_t OpenQuote = Line.find('"', IncludePos);
+		const size_t CloseQuote = (OpenQuote != std::string::npos) ? Line.find('"', OpenQuote + 1) : std::string::npos;
+		if (CloseQuote == std::string::npos)
+		{
+			continue;
+		}
 
-//TODO: Multithread, manage SpirV that doesn't need recompiling (only recompile when dirty)
-const std::vector<unsigned int> CompileGLSL(const std::string& filename)
+		std::string IncludePath = GetFilePath(filename) + "/" + Line.substr(OpenQuote + 1, CloseQuote - OpenQuote - 1);
+		if (OutIncludes.insert(IncludePath).second)
+		{
+			GetShaderIncludes(IncludePath, OutIncludes);
+		}
+	}
+}
+
+//Defines ("NAME" or "NAME=VALUE") are prepended to the source, see ShaderVariantCache for compiling permutations
+//Returns empty SpirV if the shader fails to compile
+inline const std::vector<unsigned int> CompileGLSL(const std::string& filename, const std::vector<std::string>& Defines = std::vector<std::string>())
 {
-    //TODO: Handle initialization / finalization once
+    //TODO: Handle finalization
     // from source: "ShInitialize() should be called exactly once per process, not per thread."
-	if (!glslangInitialized)
-    {
-        glslang::InitializeProcess();
-        glslangInitialized = true;
-    }
+	static std::once_flag glslangInitialized;
+	std::call_once(glslangInitialized, [] { glslang::InitializeProcess(); });
 
 	//Load GLSL into a string
 	std::ifstream file(filename);
@@ -168,6 +199,15 @@ const std::vector<unsigned int> CompileGLSL(const std::string& filename)
 	glslang::TShader Shader(ShaderType);
 	Shader.setStrings(&InputCString, 1);
 
+	//"NAME" is defined as 1 so both #ifdef and #if work
+	std::string Preamble;
+	for (const std::string& Define : Defines)
+	{
+		const size_t Equals = Define.find('=');
+		Preamble += "#define " + ((Equals == std::string::npos) ? Define + " 1" : Define.substr(0, Equals) + " " + Define.substr(Equals + 1)) + "\n";
+	}
+	Shader.setPreamble(Preamble.c_str());
+
 	//Set up Vulkan/SpirV Environment
 	int ClientInputSemanticsVersion = 100; // maps to, say, #define VULKAN 100
 	glslang::EShTargetClientVersion VulkanClientVersion = glslang::EShTargetVulkan_1_0;  // would map to, say, Vulkan 1.0
@@ -196,18 +236,22 @@ const std::vector<unsigned int> CompileGLSL(const std::string& filename)
 		std::cout << "GLSL Preprocessing Failed for: " << filename << std::endl;
 		std::cout << Shader.getInfoLog() << std::endl;
 		std::cout << Shader.getInfoDebugLog() << std::endl;
+		return std::vector<unsigned int>();
 	}
 
 	//std::cout << PreprocessedGLSL << std::endl;
 
+	//Defines are already expanded
 	const char* PreprocessedCStr = PreprocessedGLSL.c_str();
 	Shader.setStrings(&PreprocessedCStr, 1);
+	Shader.setPreamble("");
 
 	if (!Shader.parse(&Resources, 100, false, messages))
 	{
 		std::cout << "GLSL Parsing Failed for: " << filename << std::endl;
 		std::cout << Shader.getInfoLog() << std::endl;
 		std::cout << Shader.getInfoDebugLog() << std::endl;
+		return std::vector<unsigned int>();
 	}
 
 	glslang::TProgram Program;
@@ -218,6 +262,7 @@ const std::vector<unsigned int> CompileGLSL(const std::string& filename)
 		std::cout << "GLSL Linking Failed for: " << filename << std::endl;
 		std::cout << Shader.getInfoLog() << std::endl;
 		std::cout << Shader.getInfoDebugLog() << std::endl;
+		return std::vector<unsigned int>();
 	}
 
 	// if (!Program.mapIO())
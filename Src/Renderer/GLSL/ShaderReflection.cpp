@@ -0,0 +1,570 @@
+#include "ShaderReflection.h"
+#include "../Vulkan/spirv_reflect.h"
+#include "../Core/Hash.h"
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <cstring>
+
+namespace
+{
+	const char ReflectionMagic[4] = { 'S', 'R', 'F', 'L' };
+
+	void WriteU32(std::vector<uint8_t>& Out, uint32_t Value)
+	{
+		const uint8_t* Bytes = reinterpret_cast<const uint8_t*>(&Value);
+		Out.insert(Out.end(), Bytes, Bytes + sizeof(uint32_t));
+	}
+
+	void WriteString(std::vector<uint8_t>& Out, const std::string& Value)
+	{
+		WriteU32(Out, static_cast<uint32_t>(Value.size()));
+		Out.insert(Out.end(), Value.begin(), Value.end());
+	}
+
+	//Bounds checked cursor over a serialized blob
+	struct BlobReader
+	{
+		const uint8_t* Data;
+		size_t Size;
+		size_t Offset;
+		bool bValid;
+
+		uint32_t ReadU32()
+		{
+			uint32_t Value = 0;
+			if (Offset + sizeof(uint32_t) > Size)
+			{
+				bValid = false;
+				return Value;
+			}
+			memcpy(&Value, Data + Offset, sizeof(uint32_t));
+			Offset += sizeof(uint32_t);
+			return Value;
+		}
+
+		std::string ReadString()
+		{
+			const uint32_t Length = ReadU32();
+			if (!bValid || Offset + Length > Size)
+			{
+				bValid = false;
+				return std::string();
+			}
+			std::string Value(reinterpret_cast<const char*>(Data + Offset), Length);
+			Offset += Length;
+			return Value;
+		}
+
+		//Guards count-prefixed arrays against garbage counts before anything is allocated
+		bool CanRead(uint32_t Count, size_t MinElementSize) const
+		{
+			return bValid && uint64_t(Count) * MinElementSize <= Size - Offset;
+		}
+	};
+
+	//SPIR-V opcodes and decorations needed to find specialization constants and the workgroup size
+	const uint32_t SpirVMagic = 0x07230203;
+	const uint32_t OpName = 5;
+	const uint32_t OpExecutionMode = 16;
+	const uint32_t OpTypeBool = 20;
+	const uint32_t OpTypeInt = 21;
+	const uint32_t OpTypeFloat = 22;
+	const uint32_t OpConstant = 43;
+	const uint32_t OpConstantComposite = 44;
+	const uint32_t OpSpecConstantTrue = 48;
+	const uint32_t OpSpecConstantFalse = 49;
+	const uint32_t OpSpecConstant = 50;
+	const uint32_t OpSpecConstantComposite = 51;
+	const uint32_t OpDecorate = 71;
+	const uint32_t DecorationSpecId = 1;
+	const uint32_t DecorationBuiltIn = 11;
+	const uint32_t BuiltInWorkgroupSize = 25;
+	const uint32_t ExecutionModeLocalSize = 17;
+	const uint32_t ExecutionModeLocalSizeId = 38;
+
+	struct SpirVScalarType
+	{
+		ShaderConstantType Type;
+		uint32_t Width;
+	};
+
+	//Function local so it can be used during static initialization
+	struct ReflectionCache
+	{
+		std::mutex Mutex;
+		std::unordered_map<uint64_t, std::shared_ptr<const ShaderReflection>> Reflections;
+	};
+
+	ReflectionCache& GetReflectionCache()
+	{
+		static ReflectionCache Cache;
+		return Cache;
+	}
+}
+
+void ShaderSpecializationConstant::Encode(const SpecializationValue& Value, void* Out) const
+{
+	switch (Type)
+	{
+		case ShaderConstantType::Bool:
+		{
+			const uint32_t Bool = (Value.Type == ShaderConstantType::Float) ? (Value.Float != 0.0) : (Value.UInt != 0);
+			memcpy(Out, &Bool, sizeof(Bool));
+			break;
+		}
+		case ShaderConstantType::Int:
+		case ShaderConstantType::UInt:
+		{
+			//Two's complement, the low 32 bits are the same value for 32 bit constants
+			const uint64_t Bits = Value.AsUInt();
+			const uint32_t Bits32 = static_cast<uint32_t>(Bits);
+			(Size == 8) ? memcpy(Out, &Bits, 8) : memcpy(Out, &Bits32, 4);
+			break;
+		}
+		case ShaderConstantType::Float:
+		{
+			const double Double = Value.AsFloat();
+			const float Float = static_cast<float>(Double);
+			(Size == 8) ? memcpy(Out, &Double, 8) : memcpy(Out, &Float, 4);
+			break;
+		}
+	}
+}
+
+bool ShaderReflection::ReflectSpecializationConstants(const std::vector<unsigned int>& SpirV, std::vector<ShaderSpecializationConstant>& OutConstants)
+{
+	OutConstants.clear();
+	if (SpirV.size() < 5 || SpirV[0] != SpirVMagic)
+	{
+		return false;
+	}
+
+	std::map<uint32_t, std::string> Names;
+	std::map<uint32_t, uint32_t> SpecIds;
+	std::map<uint32_t, SpirVScalarType> Types;
+	std::vector<std::pair<uint32_t, ShaderSpecializationConstant>> Constants; //By result id
+
+	//Instructions: word count in the high 16 bits of the first word, opcode in the low 16
+	for (size_t Offset = 5; Offset < SpirV.size();)
+	{
+		const uint32_t WordCount = SpirV[Offset] >> 16;
+		const uint32_t Opcode = SpirV[Offset] & 0xffff;
+		if (WordCount == 0 || Offset + WordCount > SpirV.size())
+		{
+			return false;
+		}
+		const unsigned int* Operands = &SpirV[Offset + 1];
+
+		if (Opcode == OpName && WordCount > 2)
+		{
+			//Nul terminated, padded to a word
+			const char* Name = reinterpret_cast<const char*>(&Operands[1]);
+			Names[Operands[0]] = std::string(Name, strnlen(Name, (WordCount - 2) * sizeof(uint32_t)));
+		}
+		else if (Opcode == OpDecorate && WordCount > 3 && Operands[1] == DecorationSpecId)
+		{
+			SpecIds[Operands[0]] = Operands[2];
+		}
+		else if (Opcode == OpTypeBool && WordCount > 1)
+		{
+			Types[Operands[0]] = SpirVScalarType{ ShaderConstantType::Bool, 32 };
+		}
+		else if (Opcode == OpTypeInt && WordCount > 3)
+		{
+			Types[Operands[0]] = SpirVScalarType{ Operands[2] ? ShaderConstantType::Int : ShaderConstantType::UInt, Operands[1] };
+		}
+		else if (Opcode == OpTypeFloat && WordCount > 2)
+		{
+			Types[Operands[0]] = SpirVScalarType{ ShaderConstantType::Float, Operands[1] };
+		}
+		else if ((Opcode == OpSpecConstantTrue || Opcode == OpSpecConstantFalse || Opcode == OpSpecConstant) && WordCount > 2)
+		{
+			auto Type = Types.find(Operands[0]);
+			if (Type != Types.end())
+			{
+				ShaderSpecializationConstant Constant;
+				Constant.ConstantID = 0;
+				Constant.Type = Type->second.Type;
+				Constant.Size = (Type->second.Width > 32) ? 8 : 4;
+				Constant.DefaultValue = (Opcode == OpSpecConstantTrue) ? 1 : 0;
+				if (Opcode == OpSpecConstant)
+				{
+					//Literal words, low order first
+					for (uint32_t Word = 0; Word + 3 < WordCount && Word < 2; ++Word)
+					{
+						Constant.DefaultValue |= uint64_t(Operands[2 + Word]) << (32 * Word);
+					}
+				}
+				Constants.push_back(std::make_pair(Operands[1], Constant));
+			}
+		}
+
+		Offset += WordCount;
+	}
+
+	//Spec constants without a SpecId are only used to build up other constants
+	for (auto& IdAndConstant : Constants)
+	{
+		auto SpecId = SpecIds.find(IdAndConstant.first);
+		if (SpecId == SpecIds.end())
+		{
+			continue;
+		}
+
+		ShaderSpecializationConstant& Constant = IdAndConstant.second;
+		Constant.ConstantID = SpecId->second;
+		auto Name = Names.find(IdAndConstant.first);
+		Constant.Name = (Name != Names.end()) ? Name->second : "";
+		OutConstants.push_back(Constant);
+	}
+
+	std::sort(OutConstants.begin(), OutConstants.end(), [](const ShaderSpecializationConstant& a, const ShaderSpecializationConstant& b)
+	{
+		return a.ConstantID < b.ConstantID;
+	});
+	return true;
+}
+
+bool ShaderReflection::Reflect(const std::vector<unsigned int>& SpirV)
+{
+	SpvReflectShaderModule Module;
+	if (spvReflectCreateShaderModule(SpirV.size() * sizeof(unsigned int), SpirV.data(), &Module) != SPV_REFLECT_RESULT_SUCCESS)
+	{
+		return false;
+	}
+
+	Stage = static_cast<uint32_t>(Module.vulkan_shader_stage);
+	EntryPoint = Module.entry_point_name ? Module.entry_point_name : "main";
+
+	//Vertex inputs only matter for the vertex stage, built-ins (gl_VertexIndex...) aren't fed by vertex buffers
+	VertexInputs.clear();
+	if (Module.vulkan_shader_stage == VK_SHADER_STAGE_VERTEX_BIT)
+	{
+		for (uint32_t i = 0; i < Module.input_variable_count; ++i)
+		{
+			const SpvReflectInterfaceVariable& Input = Module.input_variables[i];
+			if (Input.decoration_flags & SPV_REFLECT_DECORATION_BUILT_IN)
+			{
+				continue;
+			}
+
+			ShaderVertexInput VertexInput;
+			VertexInput.Location = Input.location;
+			VertexInput.Format = static_cast<uint32_t>(Input.format);
+			VertexInputs.push_back(VertexInput);
+		}
+
+		std::sort(VertexInputs.begin(), VertexInputs.end(), [](const ShaderVertexInput& a, const ShaderVertexInput& b)
+		{
+			return a.Location < b.Location;
+		});
+	}
+
+	DescriptorBindings.clear();
+	for (uint32_t i = 0; i < Module.descriptor_binding_count; ++i)
+	{
+		const SpvReflectDescriptorBinding& ReflectedBinding = Module.descriptor_bindings[i];
+
+		ShaderDescriptorBinding Binding;
+		Binding.Set = ReflectedBinding.set;
+		Binding.Binding = ReflectedBinding.binding;
+		Binding.DescriptorType = static_cast<uint32_t>(ReflectedBinding.descriptor_type);
+		Binding.Count = 1;
+		for (uint32_t Dim = 0; Dim < ReflectedBinding.array.dims_count; ++Dim)
+		{
+			Binding.Count *= ReflectedBinding.array.dims[Dim];
+		}
+		Binding.Name = ReflectedBinding.name ? ReflectedBinding.name : "";
+		DescriptorBindings.push_back(Binding);
+	}
+
+	std::sort(DescriptorBindings.begin(), DescriptorBindings.end(), [](const ShaderDescriptorBinding& a, const ShaderDescriptorBinding& b)
+	{
+		return (a.Set != b.Set) ? a.Set < b.Set : a.Binding < b.Binding;
+	});
+
+	PushConstantRanges.clear();
+	for (uint32_t i = 0; i < Module.push_constant_block_count; ++i)
+	{
+		const SpvReflectBlockVariable& Block = Module.push_constant_blocks[i];
+
+		ShaderPushConstantRange Range;
+		Range.Offset = Block.offset;
+		Range.Size = Block.size;
+		PushConstantRanges.push_back(Range);
+	}
+
+	spvReflectDestroyShaderModule(&Module);
+
+	return ReflectSpecializationConstants(SpirV, SpecializationConstants) && ReflectWorkgroupSize(SpirV, WorkgroupSize, WorkgroupSizeConstantIDs);
+}
+
+bool ShaderReflection::ReflectWorkgroupSize(const std::vector<unsigned int>& SpirV, uint32_t OutSize[3], uint32_t OutConstantIDs[3])
+{
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		OutSize[i] = 1;
+		OutConstantIDs[i] = NoConstantID;
+	}
+	if (SpirV.size() < 5 || SpirV[0] != SpirVMagic)
+	{
+		return false;
+	}
+
+	std::map<uint32_t, uint32_t> SpecIds;
+	std::map<uint32_t, uint32_t> ScalarValues;                  //OpConstant/OpSpecConstant by result id, low word
+	std::map<uint32_t, std::vector<uint32_t>> Composites;       //Constituent ids by result id
+	uint32_t LocalSizeIds[3] = { 0, 0, 0 };
+	uint32_t WorkgroupSizeId = 0;
+
+	for (size_t Offset = 5; Offset < SpirV.size();)
+	{
+		const uint32_t WordCount = SpirV[Offset] >> 16;
+		const uint32_t Opcode = SpirV[Offset] & 0xffff;
+		if (WordCount == 0 || Offset + WordCount > SpirV.size())
+		{
+			return false;
+		}
+		const unsigned int* Operands = &SpirV[Offset + 1];
+
+		if (Opcode == OpExecutionMode && WordCount > 5 && Operands[1] == ExecutionModeLocalSize)
+		{
+			OutSize[0] = Operands[2];
+			OutSize[1] = Operands[3];
+			OutSize[2] = Operands[4];
+		}
+		else if (Opcode == OpExecutionMode && WordCount > 5 && Operands[1] == ExecutionModeLocalSizeId)
+		{
+			LocalSizeIds[0] = Operands[2];
+			LocalSizeIds[1] = Operands[3];
+			LocalSizeIds[2] = Operands[4];
+		}
+		else if (Opcode == OpDecorate && WordCount > 3 && Operands[1] == DecorationSpecId)
+		{
+			SpecIds[Operands[0]] = Operands[2];
+		}
+		else if (Opcode == OpDecorate && WordCount > 3 && Operands[1] == DecorationBuiltIn && Operands[2] == BuiltInWorkgroupSize)
+		{
+			WorkgroupSizeId = Operands[0];
+		}
+		else if ((Opcode == OpConstant || Opcode == OpSpecConstant) && WordCount > 3)
+		{
+			ScalarValues[Operands[1]] = Operands[2];
+		}
+		else if ((Opcode == OpConstantComposite || Opcode == OpSpecConstantComposite) && WordCount > 3)
+		{
+			Composites[Operands[1]] = std::vector<uint32_t>(Operands + 2, Operands + WordCount - 1);
+		}
+
+		Offset += WordCount;
+	}
+
+	//Takes precedence over the execution mode: the gl_WorkGroupSize built-in (what local_size_x_id produces),
+	//then LocalSizeId
+	uint32_t ComponentIds[3] = { LocalSizeIds[0], LocalSizeIds[1], LocalSizeIds[2] };
+	auto WorkgroupSizeComposite = Composites.find(WorkgroupSizeId);
+	if (WorkgroupSizeId != 0 && WorkgroupSizeComposite != Composites.end() && WorkgroupSizeComposite->second.size() == 3)
+	{
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			ComponentIds[i] = WorkgroupSizeComposite->second[i];
+		}
+	}
+
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		auto Value = ScalarValues.find(ComponentIds[i]);
+		if (ComponentIds[i] == 0 || Value == ScalarValues.end())
+		{
+			continue;
+		}
+
+		OutSize[i] = Value->second;
+		auto SpecId = SpecIds.find(ComponentIds[i]);
+		if (SpecId != SpecIds.end())
+		{
+			OutConstantIDs[i] = SpecId->second;
+		}
+	}
+	return true;
+}
+
+std::shared_ptr<const ShaderReflection> ShaderReflection::Get(const std::vector<unsigned int>& SpirV)
+{
+	ReflectionCache& Cache = GetReflectionCache();
+	const uint64_t Hash = HashBytes(SpirV.data(), SpirV.size() * sizeof(unsigned int));
+	{
+		std::lock_guard<std::mutex> Lock(Cache.Mutex);
+		auto Found = Cache.Reflections.find(Hash);
+		if (Found != Cache.Reflections.end())
+		{
+			return Found->second;
+		}
+	}
+
+	std::shared_ptr<ShaderReflection> Reflection = std::make_shared<ShaderReflection>();
+	if (!Reflection->Reflect(SpirV))
+	{
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> Lock(Cache.Mutex);
+	Cache.Reflections[Hash] = Reflection;
+	return Reflection;
+}
+
+bool ShaderReflection::AddCooked(const std::vector<unsigned int>& SpirV, const uint8_t* Data, size_t Size)
+{
+	std::shared_ptr<ShaderReflection> Reflection = std::make_shared<ShaderReflection>();
+	if (!Reflection->Deserialize(Data, Size))
+	{
+		return false;
+	}
+
+	ReflectionCache& Cache = GetReflectionCache();
+	std::lock_guard<std::mutex> Lock(Cache.Mutex);
+	Cache.Reflections[HashBytes(SpirV.data(), SpirV.size() * sizeof(unsigned int))] = Reflection;
+	return true;
+}
+
+void ShaderReflection::Serialize(std::vector<uint8_t>& OutData) const
+{
+	OutData.clear();
+	OutData.insert(OutData.end(), ReflectionMagic, ReflectionMagic + sizeof(ReflectionMagic));
+	WriteU32(OutData, Version);
+	WriteU32(OutData, Stage);
+	WriteString(OutData, EntryPoint);
+
+	WriteU32(OutData, static_cast<uint32_t>(VertexInputs.size()));
+	for (const ShaderVertexInput& Input : VertexInputs)
+	{
+		WriteU32(OutData, Input.Location);
+		WriteU32(OutData, Input.Format);
+	}
+
+	WriteU32(OutData, static_cast<uint32_t>(DescriptorBindings.size()));
+	for (const ShaderDescriptorBinding& Binding : DescriptorBindings)
+	{
+		WriteU32(OutData, Binding.Set);
+		WriteU32(OutData, Binding.Binding);
+		WriteU32(OutData, Binding.DescriptorType);
+		WriteU32(OutData, Binding.Count);
+		WriteString(OutData, Binding.Name);
+	}
+
+	WriteU32(OutData, static_cast<uint32_t>(PushConstantRanges.size()));
+	for (const ShaderPushConstantRange& Range : PushConstantRanges)
+	{
+		WriteU32(OutData, Range.Offset);
+		WriteU32(OutData, Range.Size);
+	}
+
+	WriteU32(OutData, static_cast<uint32_t>(SpecializationConstants.size()));
+	for (const ShaderSpecializationConstant& Constant : SpecializationConstants)
+	{
+		WriteU32(OutData, Constant.ConstantID);
+		WriteU32(OutData, static_cast<uint32_t>(Constant.Type));
+		WriteU32(OutData, Constant.Size);
+		WriteU32(OutData, static_cast<uint32_t>(Constant.DefaultValue));
+		WriteU32(OutData, static_cast<uint32_t>(Constant.DefaultValue >> 32));
+		WriteString(OutData, Constant.Name);
+	}
+
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		WriteU32(OutData, WorkgroupSize[i]);
+		WriteU32(OutData, WorkgroupSizeConstantIDs[i]);
+	}
+}
+
+bool ShaderReflection::Deserialize(const uint8_t* Data, size_t Size)
+{
+	if (Size < sizeof(ReflectionMagic) || memcmp(Data, ReflectionMagic, sizeof(ReflectionMagic)) != 0)
+	{
+		return false;
+	}
+
+	BlobReader Reader = { Data, Size, sizeof(ReflectionMagic), true };
+	if (Reader.ReadU32() != Version)
+	{
+		return false;
+	}
+
+	Stage = Reader.ReadU32();
+	EntryPoint = Reader.ReadString();
+
+	const uint32_t VertexInputCount = Reader.ReadU32();
+	if (!Reader.CanRead(VertexInputCount, 2 * sizeof(uint32_t)))
+	{
+		return false;
+	}
+	VertexInputs.resize(VertexInputCount);
+	for (ShaderVertexInput& Input : VertexInputs)
+	{
+		Input.Location = Reader.ReadU32();
+		Input.Format = Reader.ReadU32();
+	}
+
+	const uint32_t BindingCount = Reader.ReadU32();
+	if (!Reader.CanRead(BindingCount, 5 * sizeof(uint32_t)))
+	{
+		return false;
+	}
+	DescriptorBindings.resize(BindingCount);
+	for (ShaderDescriptorBinding& Binding : DescriptorBindings)
+	{
+		Binding.Set = Reader.ReadU32();
+		Binding.Binding = Reader.ReadU32();
+		Binding.DescriptorType = Reader.ReadU32();
+		Binding.Count = Reader.ReadU32();
+		Binding.Name = Reader.ReadString();
+	}
+
+	const uint32_t RangeCount = Reader.ReadU32();
+	if (!Reader.CanRead(RangeCount, 2 * sizeof(uint32_t)))
+	{
+		return false;
+	}
+	PushConstantRanges.resize(RangeCount);
+	for (ShaderPushConstantRange& Range : PushConstantRanges)
+	{
+		Range.Offset = Reader.ReadU32();
+		Range.Size = Reader.ReadU32();
+	}
+
+	const uint32_t ConstantCount = Reader.ReadU32();
+	if (!Reader.CanRead(ConstantCount, 6 * sizeof(uint32_t)))
+	{
+		return false;
+	}
+	SpecializationConstants.resize(ConstantCount);
+	for (ShaderSpecializationConstant& Constant : SpecializationConstants)
+	{
+		Constant.ConstantID = Reader.ReadU32();
+		Constant.Type = static_cast<ShaderConstantType>(Reader.ReadU32());
+		Constant.Size = Reader.ReadU32();
+		Constant.DefaultValue = Reader.ReadU32();
+		Constant.DefaultValue |= uint64_t(Reader.ReadU32()) << 32;
+		Constant.Name = Reader.ReadString();
+
+		//Setup sizes the specialization data by these and Encode writes 4 or 8 bytes, a stale or corrupt blob
+		//must not get that far
+		const bool bKnownType = Constant.Type == ShaderConstantType::Bool || Constant.Type == ShaderConstantType::Int
+			|| Constant.Type == ShaderConstantType::UInt || Constant.Type == ShaderConstantType::Float;
+		if (!bKnownType || (Constant.Size != 4 && Constant.Size != 8) || (Constant.Type == ShaderConstantType::Bool && Constant.Size != 4))
+		{
+			return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		WorkgroupSize[i] = Reader.ReadU32();
+		WorkgroupSizeConstantIDs[i] = Reader.ReadU32();
+	}
+
+	return Reader.bValid;
+}
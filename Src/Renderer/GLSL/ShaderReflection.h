@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <memory>
+
+//Plain copy of the SPIR-V reflection data the renderer needs to build pipeline layouts and vertex input.
+//The cook tool serializes this next to each compiled shader so the runtime never has to reflect SPIR-V
+//NOTE: Enum values (formats, descriptor types, stages) are stored as their raw Vk values
+
+struct ShaderVertexInput
+{
+	uint32_t Location;
+	uint32_t Format;          //VkFormat
+};
+
+struct ShaderDescriptorBinding
+{
+	uint32_t Set;
+	uint32_t Binding;
+	uint32_t DescriptorType;  //VkDescriptorType
+	uint32_t Count;
+	std::string Name;
+};
+
+struct ShaderPushConstantRange
+{
+	uint32_t Offset;
+	uint32_t Size;
+};
+
+enum class ShaderConstantType : uint32_t
+{
+	Bool,
+	Int,
+	UInt,
+	Float
+};
+
+//Value given for a specialization constant, in the type it was given in. Integers keep all 64 bits, the
+//conversion to the type the shader declares happens in ShaderSpecializationConstant::Encode
+struct SpecializationValue
+{
+	ShaderConstantType Type = ShaderConstantType::Int;
+	union
+	{
+		int64_t Int;
+		uint64_t UInt;
+		double Float;
+	};
+
+	SpecializationValue() : Int(0) {}
+	SpecializationValue(bool Value) : Type(ShaderConstantType::Bool), UInt(Value ? 1 : 0) {}
+	SpecializationValue(int32_t Value) : Type(ShaderConstantType::Int), Int(Value) {}
+	SpecializationValue(int64_t Value) : Type(ShaderConstantType::Int), Int(Value) {}
+	SpecializationValue(uint32_t Value) : Type(ShaderConstantType::UInt), UInt(Value) {}
+	SpecializationValue(uint64_t Value) : Type(ShaderConstantType::UInt), UInt(Value) {}
+	SpecializationValue(float Value) : Type(ShaderConstantType::Float), Float(Value) {}
+	SpecializationValue(double Value) : Type(ShaderConstantType::Float), Float(Value) {}
+
+	//Floats are truncated, negative ints wrap like a C cast
+	uint64_t AsUInt() const { return (Type == ShaderConstantType::Float) ? static_cast<uint64_t>(static_cast<int64_t>(Float)) : UInt; }
+	double AsFloat() const
+	{
+		return (Type == ShaderConstantType::Float) ? Float : (Type == ShaderConstantType::Int) ? static_cast<double>(Int) : static_cast<double>(UInt);
+	}
+};
+
+//layout(constant_id = ConstantID) const <Type> Name = <DefaultValue>;
+struct ShaderSpecializationConstant
+{
+	uint32_t ConstantID;
+	ShaderConstantType Type;
+	uint32_t Size;            //Bytes in VkSpecializationInfo data: 4 (bools are VkBool32) or 8
+	uint64_t DefaultValue;    //Raw bits, as in the SPIR-V
+	std::string Name;         //Empty if the module was stripped of debug names
+
+	//Writes Value converted to Type into Out (Size bytes)
+	void Encode(const SpecializationValue& Value, void* Out) const;
+};
+
+class ShaderReflection
+{
+public:
+
+	static const uint32_t Version = 3;
+
+	//WorkgroupSizeConstantIDs entry of a component that can't be specialized
+	static const uint32_t NoConstantID = 0xffffffff;
+
+	//Fills this from a SPIR-V module, returns false if the module can't be reflected
+	bool Reflect(const std::vector<unsigned int>& SpirV);
+
+	//Scans the module for OpSpecConstant* decorated with a SpecId, sorted by ConstantID. Returns false on a
+	//malformed module
+	static bool ReflectSpecializationConstants(const std::vector<unsigned int>& SpirV, std::vector<ShaderSpecializationConstant>& OutConstants);
+
+	//Compute: the local_size_x/y/z of the module's entry point (1, 1, 1 for other stages), plus the constant ids
+	//of components declared with local_size_x_id... Returns false on a malformed module
+	static bool ReflectWorkgroupSize(const std::vector<unsigned int>& SpirV, uint32_t OutSize[3], uint32_t OutConstantIDs[3]);
+
+	//Process wide cache keyed by a hash of the SpirV: pipelines rebuilt for a resize or built from the same shaders
+	//reuse it. Reflects on a miss, returns null if that fails
+	static std::shared_ptr<const ShaderReflection> Get(const std::vector<unsigned int>& SpirV);
+
+	//Seeds the cache with the .refl blob cooked next to SpirV, so it's never parsed at runtime. False if the
+	//blob doesn't deserialize (e.g. from an older cooker)
+	static bool AddCooked(const std::vector<unsigned int>& SpirV, const uint8_t* Data, size_t Size);
+
+	void Serialize(std::vector<uint8_t>& OutData) const;
+	//Returns false on a bad magic, version mismatch or truncated data
+	bool Deserialize(const uint8_t* Data, size_t Size);
+
+	uint32_t Stage = 0;       //VkShaderStageFlagBits
+	std::string EntryPoint;
+
+	//Sorted by location
+	std::vector<ShaderVertexInput> VertexInputs;
+	//Sorted by set, then binding
+	std::vector<ShaderDescriptorBinding> DescriptorBindings;
+	std::vector<ShaderPushConstantRange> PushConstantRanges;
+	std::vector<ShaderSpecializationConstant> SpecializationConstants;
+
+	//Default workgroup size, components with a constant id take the specialized value instead
+	uint32_t WorkgroupSize[3] = { 1, 1, 1 };
+	uint32_t WorkgroupSizeConstantIDs[3] = { NoConstantID, NoConstantID, NoConstantID };
+};
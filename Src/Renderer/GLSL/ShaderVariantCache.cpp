@@ -0,0 +1,268 @@
+#include "ShaderVariantCache.h"
+#include "ShaderCompiler.hpp"
+#include "../Core/Hash.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+	//Bump when compile options change, invalidates every variant on disk
+	const uint32_t VariantFileVersion = 2;
+	const char VariantMagic[4] = { 'S', 'V', 'A', 'R' };
+
+	//Magic, version, source hash and the size of the permutation key that follows
+	const size_t VariantHeaderSize = sizeof(VariantMagic) + sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint32_t);
+
+	std::string ReadText(const std::string& Filename)
+	{
+		std::ifstream File(Filename, std::ios::binary);
+		return std::string((std::istreambuf_iterator<char>(File)), std::istreambuf_iterator<char>());
+	}
+
+	//The source and everything it includes, a variant on disk is stale once any of them changes
+	uint64_t HashShaderSources(const std::string& Filename)
+	{
+		std::set<std::string> Includes;
+		GetShaderIncludes(Filename, Includes);
+
+		uint64_t Hash = HashString(ReadText(Filename));
+		for (const std::string& Include : Includes)
+		{
+			HashCombine(Hash, HashString(Include));
+			HashCombine(Hash, HashString(ReadText(Include)));
+		}
+		return Hash;
+	}
+
+	std::string HashToFilename(uint64_t Hash)
+	{
+		std::ostringstream Name;
+		Name << std::hex << std::setw(16) << std::setfill('0') << Hash << ".spv";
+		return Name.str();
+	}
+}
+
+ShaderVariantCache::ShaderVariantCache(const std::string& InCacheDirectory)
+	: CacheDirectory(InCacheDirectory)
+{
+	std::error_code Error;
+	std::filesystem::create_directories(CacheDirectory, Error);
+}
+
+ShaderVariantCache::~ShaderVariantCache()
+{
+	//Compile jobs write into the variants, their errors don't matter anymore
+	for (auto& Entry : Variants)
+	{
+		try
+		{
+			JobSystem::Get()->Wait(Entry.second->Counter);
+		}
+		catch (const std::exception&)
+		{
+		}
+	}
+}
+
+HashKey ShaderVariantCache::GetPermutationKey(const std::string& Filename, std::vector<std::string> Keywords)
+{
+	std::sort(Keywords.begin(), Keywords.end());
+	Keywords.erase(std::unique(Keywords.begin(), Keywords.end()), Keywords.end());
+
+	HashKey Key;
+	Key.AddString(Filename.c_str());
+	for (const std::string& Keyword : Keywords)
+	{
+		Key.AddString(Keyword.c_str());
+	}
+	return Key;
+}
+
+uint64_t ShaderVariantCache::GetPermutationHash(const std::string& Filename, const std::vector<std::string>& Keywords)
+{
+	return GetPermutationKey(Filename, Keywords).GetHash();
+}
+
+const std::vector<unsigned int>* ShaderVariantCache::RequestVariant(const std::string& Filename, const std::vector<std::string>& Keywords)
+{
+	Variant& Requested = FindOrSchedule(Filename, Keywords);
+	return Requested.bReady.load(std::memory_order_acquire) ? &Requested.SpirV : nullptr;
+}
+
+const std::vector<unsigned int>& ShaderVariantCache::GetVariant(const std::string& Filename, const std::vector<std::string>& Keywords)
+{
+	Variant& Requested = FindOrSchedule(Filename, Keywords);
+	JobSystem::Get()->Wait(Requested.Counter);
+	return Requested.SpirV;
+}
+
+ShaderVariantCache::Variant& ShaderVariantCache::FindOrSchedule(const std::string& Filename, const std::vector<std::string>& Keywords)
+{
+	HashKey Key = GetPermutationKey(Filename, Keywords);
+
+	std::lock_guard<std::mutex> Lock(Mutex);
+
+	std::unique_ptr<Variant>& Found = Variants[Key];
+	if (Found)
+	{
+		++Found->Usage.Requests;
+		return *Found;
+	}
+
+	Found.reset(new Variant());
+	Found->Usage.Filename = Filename;
+	Found->Usage.Keywords = Keywords;
+	std::sort(Found->Usage.Keywords.begin(), Found->Usage.Keywords.end());
+	Found->Usage.Keywords.erase(std::unique(Found->Usage.Keywords.begin(), Found->Usage.Keywords.end()), Found->Usage.Keywords.end());
+	Found->Usage.PermutationHash = Key.GetHash();
+	Found->Key = std::move(Key);
+	Found->Usage.Requests = 1;
+
+	Variant* Pending = Found.get();
+	JobSystem::Get()->Schedule([this, Pending]()
+	{
+		LoadOrCompile(*Pending);
+	}, &Pending->Counter);
+
+	return *Pending;
+}
+
+void ShaderVariantCache::LoadOrCompile(Variant& Pending)
+{
+	const std::string CachedFile = CacheDirectory + "/" + HashToFilename(Pending.Usage.PermutationHash);
+	const uint64_t SourceHash = HashShaderSources(Pending.Usage.Filename);
+
+	const std::vector<uint8_t>& KeyBytes = Pending.Key.GetBytes();
+	const uint32_t KeySize = static_cast<uint32_t>(KeyBytes.size());
+
+	//Header: magic, version, source hash, permutation key (filename and keywords), then the SpirV words.
+	//A file of another permutation whose hash collides with this one's is recompiled over, not used
+	std::ifstream File(CachedFile, std::ios::binary | std::ios::ate);
+	if (File.is_open())
+	{
+		std::vector<char> Data(static_cast<size_t>(File.tellg()));
+		File.seekg(0);
+		File.read(Data.data(), Data.size());
+
+		uint32_t Version = 0;
+		uint64_t StoredSourceHash = 0;
+		uint32_t StoredKeySize = 0;
+		if (Data.size() > VariantHeaderSize && memcmp(Data.data(), VariantMagic, sizeof(VariantMagic)) == 0)
+		{
+			memcpy(&Version, Data.data() + sizeof(VariantMagic), sizeof(Version));
+			memcpy(&StoredSourceHash, Data.data() + sizeof(VariantMagic) + sizeof(Version), sizeof(StoredSourceHash));
+			memcpy(&StoredKeySize, Data.data() + sizeof(VariantMagic) + sizeof(Version) + sizeof(StoredSourceHash), sizeof(StoredKeySize));
+		}
+
+		const size_t SpirVOffset = VariantHeaderSize + KeySize;
+		if (Version == VariantFileVersion && StoredSourceHash == SourceHash && StoredKeySize == KeySize && Data.size() > SpirVOffset
+			&& memcmp(Data.data() + VariantHeaderSize, KeyBytes.data(), KeySize) == 0)
+		{
+			Pending.SpirV.resize((Data.size() - SpirVOffset) / sizeof(unsigned int));
+			memcpy(Pending.SpirV.data(), Data.data() + SpirVOffset, Pending.SpirV.size() * sizeof(unsigned int));
+			Pending.Usage.bLoadedFromDisk = true;
+			Pending.bReady.store(true, std::memory_order_release);
+			return;
+		}
+	}
+	File.close();
+
+	const auto StartTime = std::chrono::steady_clock::now();
+	try
+	{
+		Pending.SpirV = CompileGLSL(Pending.Usage.Filename, Pending.Usage.Keywords);
+	}
+	catch (const std::exception&)
+	{
+		//Missing source, reported by CompileGLSL
+		Pending.SpirV.clear();
+	}
+	Pending.Usage.CompileMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - StartTime).count();
+
+	if (!Pending.SpirV.empty())
+	{
+		//Written to a temporary first, a crash mid-write must not leave a truncated variant behind
+		const std::string TempFile = CachedFile + ".tmp";
+		std::ofstream Out(TempFile, std::ios::binary | std::ios::trunc);
+		if (Out.is_open())
+		{
+			Out.write(VariantMagic, sizeof(VariantMagic));
+			Out.write(reinterpret_cast<const char*>(&VariantFileVersion), sizeof(VariantFileVersion));
+			Out.write(reinterpret_cast<const char*>(&SourceHash), sizeof(SourceHash));
+			Out.write(reinterpret_cast<const char*>(&KeySize), sizeof(KeySize));
+			Out.write(reinterpret_cast<const char*>(KeyBytes.data()), KeySize);
+			Out.write(reinterpret_cast<const char*>(Pending.SpirV.data()), Pending.SpirV.size() * sizeof(unsigned int));
+			Out.close();
+
+			std::error_code Error;
+			std::filesystem::rename(TempFile, CachedFile, Error);
+		}
+	}
+
+	Pending.bReady.store(true, std::memory_order_release);
+}
+
+std::vector<ShaderVariantCache::VariantUsage> ShaderVariantCache::GetUsage() const
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+
+	std::vector<VariantUsage> Usage;
+	for (const auto& Entry : Variants)
+	{
+		const Variant& Requested = *Entry.second;
+
+		VariantUsage EntryUsage;
+		EntryUsage.Filename = Requested.Usage.Filename;
+		EntryUsage.Keywords = Requested.Usage.Keywords;
+		EntryUsage.PermutationHash = Requested.Usage.PermutationHash;
+		EntryUsage.Requests = Requested.Usage.Requests;
+
+		//Load and compile results are written by the job, only read them once it's done
+		if (Requested.bReady.load(std::memory_order_acquire))
+		{
+			EntryUsage.bLoadedFromDisk = Requested.Usage.bLoadedFromDisk;
+			EntryUsage.CompileMilliseconds = Requested.Usage.CompileMilliseconds;
+		}
+		Usage.push_back(EntryUsage);
+	}
+	return Usage;
+}
+
+void ShaderVariantCache::PrintUsage() const
+{
+	std::vector<VariantUsage> Usage = GetUsage();
+	std::sort(Usage.begin(), Usage.end(), [](const VariantUsage& A, const VariantUsage& B)
+	{
+		return (A.Filename != B.Filename) ? A.Filename < B.Filename : A.Requests > B.Requests;
+	});
+
+	std::cout << "Shader variants: " << Usage.size() << " used" << std::endl;
+	for (size_t i = 0; i < Usage.size(); ++i)
+	{
+		if (i == 0 || Usage[i].Filename != Usage[i - 1].Filename)
+		{
+			const size_t Count = std::count_if(Usage.begin(), Usage.end(), [&](const VariantUsage& Other) { return Other.Filename == Usage[i].Filename; });
+			std::cout << "  " << Usage[i].Filename << ": " << Count << " variant(s)" << std::endl;
+		}
+
+		std::cout << "    " << std::setw(6) << Usage[i].Requests << " requests  ";
+		if (Usage[i].bLoadedFromDisk)
+		{
+			std::cout << "   from disk  ";
+		}
+		else
+		{
+			std::cout << std::fixed << std::setprecision(1) << std::setw(9) << Usage[i].CompileMilliseconds << " ms  ";
+		}
+		for (const std::string& Keyword : Usage[i].Keywords)
+		{
+			std::cout << Keyword << " ";
+		}
+		std::cout << std::endl;
+	}
+}
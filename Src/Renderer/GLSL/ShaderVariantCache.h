@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+#include "../Jobs/JobSystem.h"
+#include "../Core/Hash.h"
+
+//Shader permutations: one GLSL source compiled with different sets of #define keywords
+//
+//  ShaderVariantCache Variants(CacheDirectory);
+//  if (const std::vector<unsigned int>* SpirV = Variants.RequestVariant(ShaderFile, {"USE_FOG", "LIGHT_COUNT=4"}))
+//
+//Variants are compiled lazily: the first request schedules a job system job and returns null until it's done.
+//Compiled variants are written to CacheDirectory and reused by later runs as long as the source (and everything
+//it includes) is unchanged. Request counts show which permutations are actually used, so unused ones can be pruned.
+class ShaderVariantCache
+{
+public:
+
+	ShaderVariantCache(const std::string& CacheDirectory);
+	~ShaderVariantCache();
+
+	ShaderVariantCache(const ShaderVariantCache&) = delete;
+	ShaderVariantCache& operator=(const ShaderVariantCache&) = delete;
+
+	//Identifies a permutation independent of keyword order, stable across runs and platforms. Variants are looked up
+	//by the whole key (and it's stored in variant files), the hash only names the file
+	static HashKey GetPermutationKey(const std::string& Filename, std::vector<std::string> Keywords);
+	static uint64_t GetPermutationHash(const std::string& Filename, const std::vector<std::string>& Keywords);
+
+	//Returns the variant's SpirV (empty if it failed to compile) once ready, null while it's being compiled
+	const std::vector<unsigned int>* RequestVariant(const std::string& Filename, const std::vector<std::string>& Keywords);
+
+	//Same, but waits for the variant, for shaders needed before the first frame
+	const std::vector<unsigned int>& GetVariant(const std::string& Filename, const std::vector<std::string>& Keywords);
+
+	struct VariantUsage
+	{
+		std::string Filename;
+		std::vector<std::string> Keywords; //Sorted
+		uint64_t PermutationHash = 0;
+		uint32_t Requests = 0;
+		bool bLoadedFromDisk = false;
+		double CompileMilliseconds = 0.0;
+	};
+
+	//Every variant requested this run
+	std::vector<VariantUsage> GetUsage() const;
+
+	//Prints the variants used per source file, most requested first
+	void PrintUsage() const;
+
+protected:
+
+	struct Variant
+	{
+		VariantUsage Usage;
+		HashKey Key;
+		std::vector<unsigned int> SpirV;
+		std::atomic<bool> bReady{false};
+		JobCounter Counter;
+	};
+
+	Variant& FindOrSchedule(const std::string& Filename, const std::vector<std::string>& Keywords);
+
+	//Job: loads the variant from disk or compiles (and stores) it
+	void LoadOrCompile(Variant& Pending);
+
+	std::string CacheDirectory;
+
+	//Guards Variants and the request counts
+	mutable std::mutex Mutex;
+	std::unordered_map<HashKey, std::unique_ptr<Variant>, HashKey::Hasher> Variants;
+};
@@ -0,0 +1,266 @@
+#include "AssetArchive.h"
+#include "Compression.h"
+#include "../Core/Hash.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+
+static_assert(sizeof(AssetArchiveHeader) == 48, "AssetArchiveHeader must match the on-disk layout");
+static_assert(sizeof(AssetArchiveEntry) == 48, "AssetArchiveEntry must match the on-disk layout");
+
+static uint32_t GetBucket(uint64_t PathHash, uint32_t BucketBits)
+{
+	return static_cast<uint32_t>(PathHash >> (64 - BucketBits));
+}
+
+//Offset + Size <= Total, written so corrupt 64 bit values can't wrap around
+static bool FitsIn(uint64_t Offset, uint64_t Size, uint64_t Total)
+{
+	return Size <= Total && Offset <= Total - Size;
+}
+
+std::string AssetArchive::NormalizePath(const std::string& Path)
+{
+	std::string Normalized = Path;
+	std::replace(Normalized.begin(), Normalized.end(), '\\', '/');
+
+	size_t Start = 0;
+	while (Normalized.compare(Start, 2, "./") == 0)
+	{
+		Start += 2;
+	}
+	return Normalized.substr(Start);
+}
+
+bool AssetArchive::Open(const std::string& Filename)
+{
+	if (!File.Open(Filename) || File.GetSize() < sizeof(AssetArchiveHeader))
+	{
+		File.Close();
+		return false;
+	}
+
+	memcpy(&Header, File.GetData(), sizeof(AssetArchiveHeader));
+
+	const uint64_t FileSize = File.GetSize();
+	const uint64_t BucketCount = (uint64_t(1) << Header.BucketBits) + 1;
+	bool bValid = memcmp(Header.Magic, "SCPK", 4) == 0
+		&& Header.Version == Version
+		&& Header.BucketBits >= 1 && Header.BucketBits <= 24
+		&& FitsIn(Header.EntriesOffset, uint64_t(Header.EntryCount) * sizeof(AssetArchiveEntry), FileSize)
+		&& FitsIn(Header.BucketsOffset, BucketCount * sizeof(uint32_t), FileSize)
+		&& FitsIn(Header.PathsOffset, Header.PathsSize, FileSize);
+
+	if (bValid)
+	{
+		Entries = reinterpret_cast<const AssetArchiveEntry*>(File.GetData() + Header.EntriesOffset);
+		Buckets = reinterpret_cast<const uint32_t*>(File.GetData() + Header.BucketsOffset);
+		Paths = reinterpret_cast<const char*>(File.GetData() + Header.PathsOffset);
+
+		//Find walks Entries[Buckets[i], Buckets[i + 1]), so the table has to be ascending and end within the entries
+		for (uint64_t i = 0; i + 1 < BucketCount && bValid; ++i)
+		{
+			bValid = Buckets[i] <= Buckets[i + 1];
+		}
+		bValid = bValid && Buckets[BucketCount - 1] <= Header.EntryCount;
+
+		//Paths have to be terminated inside the path table, data has to lie inside the file
+		for (uint32_t i = 0; i < Header.EntryCount && bValid; ++i)
+		{
+			const AssetArchiveEntry& Entry = Entries[i];
+			bValid = Entry.PathOffset < Header.PathsSize
+				&& memchr(Paths + Entry.PathOffset, '\0', static_cast<size_t>(Header.PathsSize - Entry.PathOffset)) != nullptr
+				&& FitsIn(Entry.DataOffset, Entry.StoredSize, FileSize);
+		}
+	}
+
+	if (!bValid)
+	{
+		std::cout << "Invalid asset archive: " << Filename << std::endl;
+		Entries = nullptr;
+		Buckets = nullptr;
+		Paths = nullptr;
+		File.Close();
+		return false;
+	}
+
+	return true;
+}
+
+const AssetArchiveEntry* AssetArchive::Find(const std::string& Path) const
+{
+	if (!IsOpen())
+	{
+		return nullptr;
+	}
+
+	const std::string Normalized = NormalizePath(Path);
+	const uint64_t PathHash = HashString(Normalized);
+	const uint32_t Bucket = GetBucket(PathHash, Header.BucketBits);
+
+	for (uint32_t i = Buckets[Bucket]; i < Buckets[Bucket + 1]; ++i)
+	{
+		//Compare the stored path too, in case of a hash collision
+		if (Entries[i].PathHash == PathHash && Normalized == GetEntryPath(Entries[i]))
+		{
+			return &Entries[i];
+		}
+	}
+
+	return nullptr;
+}
+
+bool AssetArchive::Read(const AssetArchiveEntry& Entry, std::vector<uint8_t>& OutData, bool bVerifyHash) const
+{
+	if (!FitsIn(Entry.DataOffset, Entry.StoredSize, File.GetSize()))
+	{
+		return false;
+	}
+
+	OutData.resize(static_cast<size_t>(Entry.Size));
+
+	if (Entry.Flags & AssetEntryCompressed)
+	{
+		if (!DecompressBlock(GetStoredData(Entry), static_cast<size_t>(Entry.StoredSize), OutData.data(), OutData.size()))
+		{
+			std::cout << "Failed to decompress archive entry: " << GetEntryPath(Entry) << std::endl;
+			return false;
+		}
+	}
+	else if (Entry.Size > 0)
+	{
+		memcpy(OutData.data(), GetStoredData(Entry), OutData.size());
+	}
+
+	if (bVerifyHash && HashBytes(OutData.data(), OutData.size()) != Entry.ContentHash)
+	{
+		std::cout << "Archive entry failed content hash check: " << GetEntryPath(Entry) << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool AssetArchive::Read(const std::string& Path, std::vector<uint8_t>& OutData, bool bVerifyHash) const
+{
+	const AssetArchiveEntry* Entry = Find(Path);
+	return Entry != nullptr && Read(*Entry, OutData, bVerifyHash);
+}
+
+void AssetArchiveWriter::AddFile(const std::string& Path, const std::vector<uint8_t>& Data, bool bCompress)
+{
+	PendingEntry Entry;
+	Entry.Path = AssetArchive::NormalizePath(Path);
+	Entry.PathHash = HashString(Entry.Path);
+	Entry.ContentHash = HashBytes(Data.data(), Data.size());
+	Entry.Size = Data.size();
+	Entry.Flags = 0;
+
+	if (bCompress && !Data.empty())
+	{
+		CompressBlock(Data.data(), Data.size(), Entry.StoredData);
+		if (Entry.StoredData.size() <= Data.size() - Data.size() / 8)
+		{
+			Entry.Flags |= AssetEntryCompressed;
+		}
+	}
+
+	if (!(Entry.Flags & AssetEntryCompressed))
+	{
+		Entry.StoredData = Data;
+	}
+
+	PendingEntries.push_back(std::move(Entry));
+}
+
+bool AssetArchiveWriter::Write(const std::string& Filename)
+{
+	std::sort(std::begin(PendingEntries), std::end(PendingEntries),
+	[](const PendingEntry& a, const PendingEntry& b)
+	{
+		return a.PathHash < b.PathHash;
+	});
+
+	//Roughly one entry per bucket
+	uint32_t BucketBits = 1;
+	while (BucketBits < 24 && (size_t(1) << BucketBits) < PendingEntries.size())
+	{
+		++BucketBits;
+	}
+
+	AssetArchiveHeader Header = {};
+	memcpy(Header.Magic, "SCPK", 4);
+	Header.Version = AssetArchive::Version;
+	Header.EntryCount = static_cast<uint32_t>(PendingEntries.size());
+	Header.BucketBits = BucketBits;
+
+	//Bucket table: first entry index of each bucket, plus an end marker
+	const size_t BucketCount = (size_t(1) << BucketBits);
+	std::vector<uint32_t> Buckets(BucketCount + 1, 0);
+	for (const PendingEntry& Entry : PendingEntries)
+	{
+		++Buckets[GetBucket(Entry.PathHash, BucketBits) + 1];
+	}
+	for (size_t i = 1; i <= BucketCount; ++i)
+	{
+		Buckets[i] += Buckets[i - 1];
+	}
+
+	std::string PathTable;
+	std::vector<AssetArchiveEntry> Entries(PendingEntries.size());
+	for (size_t i = 0; i < PendingEntries.size(); ++i)
+	{
+		Entries[i] = {};
+		Entries[i].PathHash = PendingEntries[i].PathHash;
+		Entries[i].StoredSize = PendingEntries[i].StoredData.size();
+		Entries[i].Size = PendingEntries[i].Size;
+		Entries[i].ContentHash = PendingEntries[i].ContentHash;
+		Entries[i].PathOffset = static_cast<uint32_t>(PathTable.size());
+		Entries[i].Flags = PendingEntries[i].Flags;
+
+		PathTable += PendingEntries[i].Path;
+		PathTable.push_back('\0');
+	}
+
+	auto Align = [](uint64_t Offset, uint64_t Alignment) { return (Offset + Alignment - 1) / Alignment * Alignment; };
+
+	Header.EntriesOffset = sizeof(AssetArchiveHeader);
+	Header.BucketsOffset = Header.EntriesOffset + Entries.size() * sizeof(AssetArchiveEntry);
+	Header.PathsOffset = Header.BucketsOffset + Buckets.size() * sizeof(uint32_t);
+	Header.PathsSize = PathTable.size();
+
+	uint64_t DataOffset = Align(Header.PathsOffset + Header.PathsSize, AssetArchive::DataAlignment);
+	for (AssetArchiveEntry& Entry : Entries)
+	{
+		Entry.DataOffset = DataOffset;
+		DataOffset = Align(DataOffset + Entry.StoredSize, AssetArchive::DataAlignment);
+	}
+
+	std::ofstream Out(Filename, std::ios::binary | std::ios::trunc);
+	if (!Out.is_open())
+	{
+		std::cout << "Failed to write asset archive: " << Filename << std::endl;
+		return false;
+	}
+
+	Out.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+	Out.write(reinterpret_cast<const char*>(Entries.data()), Entries.size() * sizeof(AssetArchiveEntry));
+	Out.write(reinterpret_cast<const char*>(Buckets.data()), Buckets.size() * sizeof(uint32_t));
+	Out.write(PathTable.data(), PathTable.size());
+
+	const std::vector<char> Padding(AssetArchive::DataAlignment, 0);
+	for (size_t i = 0; i < Entries.size(); ++i)
+	{
+		const uint64_t Position = static_cast<uint64_t>(Out.tellp());
+		Out.write(Padding.data(), Entries[i].DataOffset - Position);
+		Out.write(reinterpret_cast<const char*>(PendingEntries[i].StoredData.data()), PendingEntries[i].StoredData.size());
+	}
+
+	//Pad the tail so the last entry's page is complete
+	const uint64_t Position = static_cast<uint64_t>(Out.tellp());
+	Out.write(Padding.data(), Align(Position, AssetArchive::DataAlignment) - Position);
+
+	return Out.good();
+}
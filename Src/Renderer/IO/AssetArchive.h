@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+//Single-file asset archive, read at runtime through one memory mapping
+//
+//Layout: [Header][Entries sorted by PathHash][Bucket table][Path strings][Page-aligned entry data...]
+//Lookup hashes the path, the top bits of the hash select a bucket in the table and the bucket
+//holds ~1 entry on average, so finding an entry is O(1) without touching any other file
+
+enum EAssetEntryFlags : uint32_t
+{
+	AssetEntryCompressed = 1 << 0,
+};
+
+struct AssetArchiveHeader
+{
+	char     Magic[4];       //"SCPK"
+	uint32_t Version;
+	uint32_t EntryCount;
+	uint32_t BucketBits;     //Bucket table has (1 << BucketBits) + 1 entries
+	uint64_t EntriesOffset;
+	uint64_t BucketsOffset;
+	uint64_t PathsOffset;
+	uint64_t PathsSize;
+};
+
+struct AssetArchiveEntry
+{
+	uint64_t PathHash;
+	uint64_t DataOffset;     //Page aligned
+	uint64_t StoredSize;     //Size in the archive (compressed size if AssetEntryCompressed is set)
+	uint64_t Size;           //Uncompressed size
+	uint64_t ContentHash;    //HashBytes of the uncompressed data
+	uint32_t PathOffset;     //Into the path string table, null terminated
+	uint32_t Flags;
+};
+
+class AssetArchive
+{
+public:
+
+	static const uint32_t Version = 1;
+	static const uint64_t DataAlignment = 4096;
+
+	//Returns false if the file is missing or isn't a valid archive
+	bool Open(const std::string& Filename);
+	bool IsOpen() const { return File.IsOpen(); }
+
+	//Paths are archive relative with '/' separators (e.g. "shaders/shader.vert")
+	const AssetArchiveEntry* Find(const std::string& Path) const;
+
+	//Zero-copy view of an entry as stored, only usable directly for uncompressed entries
+	const uint8_t* GetStoredData(const AssetArchiveEntry& Entry) const { return File.GetData() + Entry.DataOffset; }
+
+	//Copies (and decompresses if needed) an entry, optionally verifying its content hash
+	bool Read(const AssetArchiveEntry& Entry, std::vector<uint8_t>& OutData, bool bVerifyHash = false) const;
+	bool Read(const std::string& Path, std::vector<uint8_t>& OutData, bool bVerifyHash = false) const;
+
+	uint32_t GetEntryCount() const { return Header.EntryCount; }
+	const AssetArchiveEntry& GetEntry(uint32_t Index) const { return Entries[Index]; }
+	const char* GetEntryPath(const AssetArchiveEntry& Entry) const { return Paths + Entry.PathOffset; }
+
+	static std::string NormalizePath(const std::string& Path);
+
+protected:
+
+	MappedFile File;
+	AssetArchiveHeader Header = {};
+
+	const AssetArchiveEntry* Entries = nullptr;
+	const uint32_t* Buckets = nullptr;
+	const char* Paths = nullptr;
+};
+
+//Builds an archive, used by the cook tool
+class AssetArchiveWriter
+{
+public:
+
+	//Entries that don't shrink by at least 1/8th are stored uncompressed
+	void AddFile(const std::string& Path, const std::vector<uint8_t>& Data, bool bCompress);
+
+	bool Write(const std::string& Filename);
+
+protected:
+
+	struct PendingEntry
+	{
+		std::string Path;
+		uint64_t PathHash;
+		uint64_t ContentHash;
+		uint64_t Size;
+		uint32_t Flags;
+		std::vector<uint8_t> StoredData;
+	};
+
+	std::vector<PendingEntry> PendingEntries;
+};
@@ -0,0 +1,150 @@
+#include "AssetHotReloader.h"
+
+#include "../GLSL/ShaderCompiler.hpp"
+#include "../Jobs/JobSystem.h"
+
+#include <iostream>
+
+AssetHotReloader::AssetHotReloader(const std::string& AssetDirectory) : Watcher(NormalizePath(AssetDirectory))
+{
+
+}
+
+void AssetHotReloader::WatchShader(const std::string& Filename, ShaderCallback OnRecompiled)
+{
+	WatchedShader Shader;
+	Shader.Filename = NormalizePath(Filename);
+	Shader.OnRecompiled = OnRecompiled;
+	UpdateShaderDependencies(Shader);
+
+	Shaders.push_back(std::move(Shader));
+}
+
+void AssetHotReloader::WatchFile(const std::string& Filename, FileCallback OnChanged)
+{
+	FileCallbacks.emplace(NormalizePath(Filename), OnChanged);
+}
+
+void AssetHotReloader::UpdateShaderDependencies(WatchedShader& Shader)
+{
+	std::set<std::string> Includes;
+	GetShaderIncludes(Shader.Filename, Includes);
+
+	Shader.Dependencies.clear();
+	Shader.Dependencies.insert(Shader.Filename);
+	for (const std::string& Include : Includes)
+	{
+		Shader.Dependencies.insert(NormalizePath(Include));
+	}
+}
+
+bool AssetHotReloader::Poll()
+{
+	std::vector<std::string> ChangedFiles = Watcher.Poll();
+	if (ChangedFiles.empty())
+	{
+		return false;
+	}
+
+	bool bReloaded = false;
+
+	std::set<std::string> ChangedSet;
+	for (const std::string& ChangedFile : ChangedFiles)
+	{
+		ChangedSet.insert(NormalizePath(ChangedFile));
+	}
+
+	std::vector<WatchedShader*> DirtyShaders;
+	for (WatchedShader& Shader : Shaders)
+	{
+		bool bDirty = false;
+		for (const std::string& Dependency : Shader.Dependencies)
+		{
+			bDirty |= ChangedSet.count(Dependency) > 0;
+		}
+
+		if (bDirty)
+		{
+			std::cout << "Hot Reload: recompiling " << Shader.Filename << std::endl;
+			DirtyShaders.push_back(&Shader);
+		}
+	}
+
+	//Saving a shared include can dirty many shaders at once, compile them in parallel
+	std::vector<std::vector<unsigned int>> SpirV(DirtyShaders.size());
+	JobSystem::Get()->ParallelFor(static_cast<uint32_t>(DirtyShaders.size()), 1, [&](uint32_t Begin, uint32_t End)
+	{
+		for (uint32_t i = Begin; i < End; ++i)
+		{
+			try
+			{
+				SpirV[i] = CompileGLSL(DirtyShaders[i]->Filename);
+			}
+			catch (const std::exception&)
+			{
+				//Editors can delete and rewrite a file on save, reported by CompileGLSL and retried on the next change
+				SpirV[i].clear();
+			}
+		}
+	});
+
+	for (size_t i = 0; i < DirtyShaders.size(); ++i)
+	{
+		UpdateShaderDependencies(*DirtyShaders[i]);
+
+		//Keep running with the old shader until the error is fixed
+		if (!SpirV[i].empty())
+		{
+			DirtyShaders[i]->OnRecompiled(SpirV[i]);
+			bReloaded = true;
+		}
+	}
+
+	for (const std::string& ChangedFile : ChangedSet)
+	{
+		auto Range = FileCallbacks.equal_range(ChangedFile);
+		for (auto It = Range.first; It != Range.second; ++It)
+		{
+			std::cout << "Hot Reload: reloading " << ChangedFile << std::endl;
+			It->second();
+			bReloaded = true;
+		}
+	}
+
+	return bReloaded;
+}
+
+std::string AssetHotReloader::NormalizePath(const std::string& Path)
+{
+	//Collapses separators, "." and ".." so include paths and watcher paths compare equal
+	std::vector<std::string> Parts;
+	size_t Start = 0;
+
+	while (Start <= Path.size())
+	{
+		size_t End = Path.find_first_of("/\\", Start);
+		if (End == std::string::npos)
+		{
+			End = Path.size();
+		}
+
+		std::string Part = Path.substr(Start, End - Start);
+		if (Part == ".." && !Parts.empty() && Parts.back() != ".." && !Parts.back().empty())
+		{
+			Parts.pop_back();
+		}
+		else if (Part != "." && (!Part.empty() || Parts.empty()))
+		{
+			Parts.push_back(Part);
+		}
+
+		Start = End + 1;
+	}
+
+	std::string Normalized;
+	for (size_t i = 0; i < Parts.size(); ++i)
+	{
+		Normalized += (i > 0 ? "/" : "") + Parts[i];
+	}
+	return Normalized;
+}
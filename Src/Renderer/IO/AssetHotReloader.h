@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <functional>
+
+#include "FileWatcher.h"
+
+//Reloads assets of a running instance when their files change on disk
+//Shaders are recompiled through CompileGLSL (including when any file they #include changes),
+//other assets get a callback that re-uploads them. Call Poll once per frame from the render thread.
+class AssetHotReloader
+{
+public:
+
+	typedef std::function<void(const std::vector<unsigned int>& SpirV)> ShaderCallback;
+	typedef std::function<void()> FileCallback;
+
+	AssetHotReloader(const std::string& AssetDirectory);
+
+	//OnRecompiled receives the new SpirV, it isn't called if compilation fails
+	void WatchShader(const std::string& Filename, ShaderCallback OnRecompiled);
+
+	//For textures, meshes etc: OnChanged should load the new object and release the one it replaces
+	//to the VulkanContext's deletion queue
+	void WatchFile(const std::string& Filename, FileCallback OnChanged);
+
+	//Returns true if anything was reloaded, command buffers referencing old objects must then be re-recorded
+	bool Poll();
+
+protected:
+
+	struct WatchedShader
+	{
+		std::string Filename;
+		ShaderCallback OnRecompiled;
+		std::set<std::string> Dependencies; //The shader itself and everything it includes
+	};
+
+	void UpdateShaderDependencies(WatchedShader& Shader);
+
+	static std::string NormalizePath(const std::string& Path);
+
+	FileWatcher Watcher;
+
+	std::vector<WatchedShader> Shaders;
+	std::multimap<std::string, FileCallback> FileCallbacks;
+};
@@ -0,0 +1,636 @@
+#include "AsyncFileReader.h"
+
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <new>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#ifdef __linux__
+#if __has_include(<linux/io_uring.h>)
+#define SCALPEL_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#endif
+#endif
+
+AlignedBuffer::AlignedBuffer(size_t InSize, size_t Alignment)
+{
+	const size_t AllocationSize = std::max<size_t>(InSize, 1);
+#ifdef _WIN32
+	Data = static_cast<uint8_t*>(_aligned_malloc(AllocationSize, Alignment));
+#else
+	void* Allocation = nullptr;
+	Data = (posix_memalign(&Allocation, Alignment, AllocationSize) == 0) ? static_cast<uint8_t*>(Allocation) : nullptr;
+#endif
+	if (!Data)
+	{
+		throw std::bad_alloc();
+	}
+	Size = InSize;
+}
+
+AlignedBuffer::~AlignedBuffer()
+{
+#ifdef _WIN32
+	_aligned_free(Data);
+#else
+	free(Data);
+#endif
+}
+
+AlignedBuffer::AlignedBuffer(AlignedBuffer&& Other)
+{
+	*this = std::move(Other);
+}
+
+AlignedBuffer& AlignedBuffer::operator=(AlignedBuffer&& Other)
+{
+	if (this != &Other)
+	{
+		std::swap(Data, Other.Data);
+		std::swap(Size, Other.Size);
+	}
+	return *this;
+}
+
+namespace
+{
+#ifdef _WIN32
+	typedef HANDLE FileHandle;
+	const FileHandle InvalidFileHandle = INVALID_HANDLE_VALUE;
+
+	//FILE_FLAG_NO_BUFFERING is the Win32 equivalent of O_DIRECT, with the same alignment rules
+	FileHandle OpenForRead(const std::string& Filename, bool& bOutDirect)
+	{
+		bOutDirect = true;
+		HANDLE File = CreateFileA(Filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, nullptr);
+		if (File == INVALID_HANDLE_VALUE)
+		{
+			bOutDirect = false;
+			File = CreateFileA(Filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		}
+		return File;
+	}
+
+	int64_t GetFileSizeOf(FileHandle File)
+	{
+		LARGE_INTEGER Size;
+		return GetFileSizeEx(File, &Size) ? Size.QuadPart : -1;
+	}
+
+	int64_t ReadAt(FileHandle File, uint8_t* Destination, uint64_t Size, uint64_t Offset)
+	{
+		OVERLAPPED Overlapped = {};
+		Overlapped.Offset = static_cast<DWORD>(Offset);
+		Overlapped.OffsetHigh = static_cast<DWORD>(Offset >> 32);
+
+		DWORD BytesRead = 0;
+		const DWORD ChunkSize = static_cast<DWORD>(std::min<uint64_t>(Size, 1u << 30));
+		if (!ReadFile(File, Destination, ChunkSize, &BytesRead, &Overlapped))
+		{
+			return (GetLastError() == ERROR_HANDLE_EOF) ? 0 : -1;
+		}
+		return BytesRead;
+	}
+
+	void CloseFile(FileHandle File)
+	{
+		CloseHandle(File);
+	}
+#else
+	typedef int FileHandle;
+	const FileHandle InvalidFileHandle = -1;
+
+	FileHandle OpenForRead(const std::string& Filename, bool& bOutDirect)
+	{
+		int Flags = O_RDONLY | O_CLOEXEC;
+#ifdef O_DIRECT
+		//Some file systems (tmpfs, some network/overlay mounts) reject O_DIRECT, those get buffered reads
+		bOutDirect = true;
+		int File = open(Filename.c_str(), Flags | O_DIRECT);
+		if (File >= 0 || errno != EINVAL)
+		{
+			return File;
+		}
+#endif
+		bOutDirect = false;
+		return open(Filename.c_str(), Flags);
+	}
+
+	int64_t GetFileSizeOf(FileHandle File)
+	{
+		struct stat FileStat;
+		return (fstat(File, &FileStat) == 0) ? static_cast<int64_t>(FileStat.st_size) : -1;
+	}
+
+	int64_t ReadAt(FileHandle File, uint8_t* Destination, uint64_t Size, uint64_t Offset)
+	{
+		ssize_t Result;
+		do
+		{
+			Result = pread(File, Destination, static_cast<size_t>(std::min<uint64_t>(Size, 1u << 30)), static_cast<off_t>(Offset));
+		} while (Result < 0 && errno == EINTR);
+		return Result;
+	}
+
+	void CloseFile(FileHandle File)
+	{
+		close(File);
+	}
+#endif
+}
+
+struct AsyncFileReader::ReadRequest
+{
+	std::string Filename;
+	uint64_t Offset;
+	uint64_t Size;
+	ReadCallback OnComplete;
+
+	FileHandle File = InvalidFileHandle;
+	bool bDirect = false;
+	bool bFailed = false;
+
+	//The read actually issued: [AlignedOffset, AlignedOffset + AlignedSize) into Buffer
+	uint64_t AlignedOffset = 0;
+	uint64_t AlignedSize = 0;
+	uint64_t BytesRead = 0;
+	AlignedBuffer Buffer;
+
+#ifdef SCALPEL_IO_URING
+	iovec Vector;
+#endif
+
+	~ReadRequest()
+	{
+		if (File != InvalidFileHandle)
+		{
+			CloseFile(File);
+		}
+	}
+};
+
+#ifdef SCALPEL_IO_URING
+
+//Raw io_uring setup, no liburing dependency. See io_uring_setup(2) for the ring layout
+struct AsyncFileReader::IoUring
+{
+	int Fd = -1;
+
+	void* SqRing = MAP_FAILED;
+	size_t SqRingSize = 0;
+	void* CqRing = MAP_FAILED;
+	size_t CqRingSize = 0;
+	io_uring_sqe* Sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+	size_t SqesSize = 0;
+
+	std::atomic<uint32_t>* SqHead;
+	std::atomic<uint32_t>* SqTail;
+	uint32_t SqMask;
+	uint32_t* SqArray;
+
+	std::atomic<uint32_t>* CqHead;
+	std::atomic<uint32_t>* CqTail;
+	uint32_t CqMask;
+	io_uring_cqe* Cqes;
+
+	//SQEs written since the last io_uring_enter
+	uint32_t UnsubmittedCount = 0;
+
+	static int Setup(uint32_t Entries, io_uring_params* Params) { return (int) syscall(__NR_io_uring_setup, Entries, Params); }
+	int Enter(uint32_t ToSubmit, uint32_t MinComplete, uint32_t Flags) { return (int) syscall(__NR_io_uring_enter, Fd, ToSubmit, MinComplete, Flags, nullptr, 0); }
+
+	bool Init(uint32_t Entries)
+	{
+		io_uring_params Params;
+		memset(&Params, 0, sizeof(Params));
+
+		Fd = Setup(Entries, &Params);
+		if (Fd < 0)
+		{
+			return false;
+		}
+
+		SqRingSize = Params.sq_off.array + Params.sq_entries * sizeof(uint32_t);
+		CqRingSize = Params.cq_off.cqes + Params.cq_entries * sizeof(io_uring_cqe);
+
+		//Since 5.4 both rings live in one mapping
+		const bool bSingleMmap = (Params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (bSingleMmap)
+		{
+			SqRingSize = CqRingSize = std::max(SqRingSize, CqRingSize);
+		}
+
+		SqRing = mmap(nullptr, SqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_SQ_RING);
+		if (SqRing == MAP_FAILED)
+		{
+			return false;
+		}
+
+		CqRing = bSingleMmap ? SqRing : mmap(nullptr, CqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_CQ_RING);
+		if (CqRing == MAP_FAILED)
+		{
+			return false;
+		}
+
+		SqesSize = Params.sq_entries * sizeof(io_uring_sqe);
+		Sqes = static_cast<io_uring_sqe*>(mmap(nullptr, SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_SQES));
+		if (Sqes == MAP_FAILED)
+		{
+			return false;
+		}
+
+		uint8_t* Sq = static_cast<uint8_t*>(SqRing);
+		SqHead = reinterpret_cast<std::atomic<uint32_t>*>(Sq + Params.sq_off.head);
+		SqTail = reinterpret_cast<std::atomic<uint32_t>*>(Sq + Params.sq_off.tail);
+		SqMask = *reinterpret_cast<uint32_t*>(Sq + Params.sq_off.ring_mask);
+		SqArray = reinterpret_cast<uint32_t*>(Sq + Params.sq_off.array);
+
+		uint8_t* Cq = static_cast<uint8_t*>(CqRing);
+		CqHead = reinterpret_cast<std::atomic<uint32_t>*>(Cq + Params.cq_off.head);
+		CqTail = reinterpret_cast<std::atomic<uint32_t>*>(Cq + Params.cq_off.tail);
+		CqMask = *reinterpret_cast<uint32_t*>(Cq + Params.cq_off.ring_mask);
+		Cqes = reinterpret_cast<io_uring_cqe*>(Cq + Params.cq_off.cqes);
+
+		return true;
+	}
+
+	~IoUring()
+	{
+		if (Sqes != MAP_FAILED) { munmap(Sqes, SqesSize); }
+		if (CqRing != MAP_FAILED && CqRing != SqRing) { munmap(CqRing, CqRingSize); }
+		if (SqRing != MAP_FAILED) { munmap(SqRing, SqRingSize); }
+		if (Fd >= 0) { close(Fd); }
+	}
+
+	//We're the only producer, so the tail is ours and only needs a release store for the kernel to see the SQE
+	void PushRead(int File, iovec* Vector, uint64_t Offset, void* UserData)
+	{
+		const uint32_t Tail = SqTail->load(std::memory_order_relaxed);
+		const uint32_t Index = Tail & SqMask;
+
+		//READV (5.1) rather than READ (5.6) to support older kernels
+		io_uring_sqe& Sqe = Sqes[Index];
+		memset(&Sqe, 0, sizeof(Sqe));
+		Sqe.opcode = IORING_OP_READV;
+		Sqe.fd = File;
+		Sqe.addr = reinterpret_cast<uint64_t>(Vector);
+		Sqe.len = 1;
+		Sqe.off = Offset;
+		Sqe.user_data = reinterpret_cast<uint64_t>(UserData);
+
+		SqArray[Index] = Index;
+		SqTail->store(Tail + 1, std::memory_order_release);
+		UnsubmittedCount++;
+	}
+
+	void Flush()
+	{
+		while (UnsubmittedCount > 0)
+		{
+			const int Submitted = Enter(UnsubmittedCount, 0, 0);
+			if (Submitted < 0)
+			{
+				if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+				{
+					continue;
+				}
+				std::cout << "AsyncFileReader: io_uring_enter failed: " << strerror(errno) << std::endl;
+				return;
+			}
+			UnsubmittedCount -= static_cast<uint32_t>(Submitted);
+		}
+	}
+};
+
+#else
+
+struct AsyncFileReader::IoUring
+{
+};
+
+#endif
+
+AsyncFileReader::AsyncFileReader(uint32_t InQueueDepth, uint32_t FallbackThreadCount)
+	: QueueDepth(std::max(InQueueDepth, 1u))
+{
+#ifdef SCALPEL_IO_URING
+	std::unique_ptr<IoUring> NewRing(new IoUring());
+	if (NewRing->Init(QueueDepth))
+	{
+		Ring = std::move(NewRing);
+		return;
+	}
+	std::cout << "AsyncFileReader: io_uring unavailable (" << strerror(errno) << "), using a thread pool" << std::endl;
+#endif
+
+	for (uint32_t i = 0; i < std::max(FallbackThreadCount, 1u); ++i)
+	{
+		FallbackThreads.emplace_back(&AsyncFileReader::FallbackWorker, this);
+	}
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+	QueuedRequests.clear();
+
+	//Buffers of in-flight reads are still being written to, wait for them without running callbacks
+	if (Ring)
+	{
+		std::vector<std::unique_ptr<ReadRequest>> Completed;
+		while (InFlightCount > 0)
+		{
+			ReapRing(Completed, true);
+			Completed.clear();
+		}
+	}
+	else
+	{
+		{
+			std::lock_guard<std::mutex> Lock(FallbackMutex);
+			FallbackQueue.clear();
+			bStopFallbackThreads = true;
+		}
+		FallbackWork.notify_all();
+
+		for (std::thread& Thread : FallbackThreads)
+		{
+			Thread.join();
+		}
+	}
+}
+
+void AsyncFileReader::Read(const std::string& Filename, uint64_t Offset, uint64_t Size, ReadCallback OnComplete)
+{
+	std::unique_ptr<ReadRequest> Request(new ReadRequest());
+	Request->Filename = Filename;
+	Request->Offset = Offset;
+	Request->Size = Size;
+	Request->OnComplete = std::move(OnComplete);
+
+	QueuedRequests.push_back(std::move(Request));
+	PendingCount++;
+}
+
+bool AsyncFileReader::PrepareRequest(ReadRequest& Request)
+{
+	Request.File = OpenForRead(Request.Filename, Request.bDirect);
+	if (Request.File == InvalidFileHandle)
+	{
+		Request.bFailed = true;
+		return false;
+	}
+
+	const int64_t FileSize = GetFileSizeOf(Request.File);
+	if (FileSize < 0 || Request.Offset > uint64_t(FileSize))
+	{
+		Request.bFailed = true;
+		return false;
+	}
+
+	if (Request.Size == 0)
+	{
+		Request.Size = uint64_t(FileSize) - Request.Offset;
+	}
+
+	//Unbuffered reads must start, end and land on aligned boundaries. The buffer is always aligned,
+	//so buffered reads use the same layout and callers never need to care which path was taken
+	Request.AlignedOffset = Request.Offset & ~uint64_t(Alignment - 1);
+	const uint64_t AlignedEnd = (Request.Offset + Request.Size + Alignment - 1) & ~uint64_t(Alignment - 1);
+	Request.AlignedSize = AlignedEnd - Request.AlignedOffset;
+	Request.Buffer = AlignedBuffer(static_cast<size_t>(Request.AlignedSize), Alignment);
+	return true;
+}
+
+bool AsyncFileReader::OnReadCompleted(ReadRequest& Request, int64_t BytesRead)
+{
+	if (BytesRead < 0)
+	{
+		Request.bFailed = true;
+		return true;
+	}
+
+	Request.BytesRead += uint64_t(BytesRead);
+
+	//Done once the requested range is covered, EOF (0 bytes) ends short reads of the file's tail
+	const uint64_t RequiredBytes = (Request.Offset - Request.AlignedOffset) + Request.Size;
+	if (Request.BytesRead >= RequiredBytes)
+	{
+		return true;
+	}
+	if (BytesRead == 0)
+	{
+		Request.bFailed = true;
+		return true;
+	}
+	return false;
+}
+
+void AsyncFileReader::Submit()
+{
+	std::vector<std::unique_ptr<ReadRequest>> Failed;
+
+	while (!QueuedRequests.empty() && InFlightCount < QueueDepth)
+	{
+		std::unique_ptr<ReadRequest> Request = std::move(QueuedRequests.front());
+		QueuedRequests.pop_front();
+
+		//NOTE: open() itself is still synchronous, only the reads are asynchronous
+		if (!PrepareRequest(*Request))
+		{
+			Failed.push_back(std::move(Request));
+			continue;
+		}
+
+		InFlightCount++;
+		if (Ring)
+		{
+			SubmitToRing(Request.release());
+		}
+		else
+		{
+			std::lock_guard<std::mutex> Lock(FallbackMutex);
+			FallbackQueue.push_back(std::move(Request));
+			FallbackWork.notify_one();
+		}
+	}
+
+#ifdef SCALPEL_IO_URING
+	if (Ring)
+	{
+		Ring->Flush();
+	}
+#endif
+
+	Deliver(Failed);
+}
+
+bool AsyncFileReader::SubmitToRing(ReadRequest* Request)
+{
+#ifdef SCALPEL_IO_URING
+	//Continues where a previous short read stopped
+	Request->Vector.iov_base = Request->Buffer.GetData() + Request->BytesRead;
+	Request->Vector.iov_len = static_cast<size_t>(Request->AlignedSize - Request->BytesRead);
+	Ring->PushRead(Request->File, &Request->Vector, Request->AlignedOffset + Request->BytesRead, Request);
+	return true;
+#else
+	return false;
+#endif
+}
+
+void AsyncFileReader::ReapRing(std::vector<std::unique_ptr<ReadRequest>>& OutCompleted, bool bWait)
+{
+#ifdef SCALPEL_IO_URING
+	uint32_t Head = Ring->CqHead->load(std::memory_order_relaxed);
+	if (bWait && Head == Ring->CqTail->load(std::memory_order_acquire))
+	{
+		Ring->Enter(0, 1, IORING_ENTER_GETEVENTS);
+	}
+
+	bool bResubmitted = false;
+	const uint32_t Tail = Ring->CqTail->load(std::memory_order_acquire);
+	for (; Head != Tail; ++Head)
+	{
+		const io_uring_cqe& Cqe = Ring->Cqes[Head & Ring->CqMask];
+		ReadRequest* Request = reinterpret_cast<ReadRequest*>(Cqe.user_data);
+
+		const int64_t Result = (Cqe.res == -EINTR || Cqe.res == -EAGAIN) ? 0 : Cqe.res;
+		if (Cqe.res == -EINTR || Cqe.res == -EAGAIN || !OnReadCompleted(*Request, Result))
+		{
+			//Short read, the CQE slot is released below before the resubmitted read can complete
+			SubmitToRing(Request);
+			bResubmitted = true;
+			continue;
+		}
+
+		InFlightCount--;
+		OutCompleted.emplace_back(Request);
+	}
+	Ring->CqHead->store(Head, std::memory_order_release);
+
+	if (bResubmitted)
+	{
+		Ring->Flush();
+	}
+#endif
+}
+
+void AsyncFileReader::FallbackWorker()
+{
+	for (;;)
+	{
+		std::unique_ptr<ReadRequest> Request;
+		{
+			std::unique_lock<std::mutex> Lock(FallbackMutex);
+			FallbackWork.wait(Lock, [this]() { return bStopFallbackThreads || !FallbackQueue.empty(); });
+			if (FallbackQueue.empty())
+			{
+				return;
+			}
+			Request = std::move(FallbackQueue.front());
+			FallbackQueue.pop_front();
+		}
+
+		while (!OnReadCompleted(*Request, ReadAt(Request->File, Request->Buffer.GetData() + Request->BytesRead,
+			Request->AlignedSize - Request->BytesRead, Request->AlignedOffset + Request->BytesRead)))
+		{
+		}
+
+		std::lock_guard<std::mutex> Lock(FallbackMutex);
+		FallbackCompleted.push_back(std::move(Request));
+		FallbackDone.notify_one();
+	}
+}
+
+void AsyncFileReader::Deliver(std::vector<std::unique_ptr<ReadRequest>>& Completed)
+{
+	for (std::unique_ptr<ReadRequest>& Request : Completed)
+	{
+		AsyncReadResult Result;
+		Result.Filename = std::move(Request->Filename);
+		Result.bSucceeded = !Request->bFailed;
+		if (Result.bSucceeded)
+		{
+			Result.Data = Request->Buffer.GetData() + (Request->Offset - Request->AlignedOffset);
+			Result.Size = static_cast<size_t>(Request->Size);
+		}
+		else
+		{
+			std::cout << "AsyncFileReader: failed to read " << Result.Filename << std::endl;
+		}
+		Result.Buffer = std::move(Request->Buffer);
+
+		PendingCount--;
+		if (Request->OnComplete)
+		{
+			Request->OnComplete(Result);
+		}
+	}
+	Completed.clear();
+}
+
+uint32_t AsyncFileReader::Poll()
+{
+	Submit();
+
+	std::vector<std::unique_ptr<ReadRequest>> Completed;
+	if (Ring)
+	{
+		ReapRing(Completed, false);
+	}
+	else
+	{
+		std::lock_guard<std::mutex> Lock(FallbackMutex);
+		Completed.swap(FallbackCompleted);
+		InFlightCount -= static_cast<uint32_t>(Completed.size());
+	}
+
+	const uint32_t CompletedCount = static_cast<uint32_t>(Completed.size());
+	Deliver(Completed);
+
+	//Completions freed queue slots
+	if (CompletedCount > 0 && !QueuedRequests.empty())
+	{
+		Submit();
+	}
+	return CompletedCount;
+}
+
+void AsyncFileReader::WaitAll()
+{
+	while (PendingCount > 0)
+	{
+		if (Poll() > 0 || InFlightCount == 0)
+		{
+			continue;
+		}
+
+		if (Ring)
+		{
+			std::vector<std::unique_ptr<ReadRequest>> Completed;
+			ReapRing(Completed, true);
+			Deliver(Completed);
+		}
+		else
+		{
+			std::unique_lock<std::mutex> Lock(FallbackMutex);
+			FallbackDone.wait(Lock, [this]() { return !FallbackCompleted.empty(); });
+		}
+	}
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//Heap allocation with a fixed alignment, suitable as an unbuffered (O_DIRECT) read target
+class AlignedBuffer
+{
+public:
+
+	AlignedBuffer() {}
+	AlignedBuffer(size_t InSize, size_t Alignment);
+	~AlignedBuffer();
+
+	AlignedBuffer(AlignedBuffer&& Other);
+	AlignedBuffer& operator=(AlignedBuffer&& Other);
+
+	AlignedBuffer(const AlignedBuffer&) = delete;
+	AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+	uint8_t* GetData() const { return Data; }
+	size_t GetSize() const { return Size; }
+
+protected:
+
+	uint8_t* Data = nullptr;
+	size_t Size = 0;
+};
+
+struct AsyncReadResult
+{
+	std::string Filename;
+	bool bSucceeded = false;
+
+	//Requested bytes, points into Buffer (which may start a little earlier to satisfy alignment)
+	const uint8_t* Data = nullptr;
+	size_t Size = 0;
+
+	//Move this out of the result to keep the data alive past the callback
+	AlignedBuffer Buffer;
+};
+
+//Asynchronous file reads without a thread per outstanding read
+//
+//Linux uses io_uring: reads queued with Read are pushed into the submission ring and handed to the
+//kernel with a single syscall per Submit, and files are opened with O_DIRECT so data lands in the
+//aligned destination buffer without going through the page cache. Elsewhere (or if io_uring is
+//unavailable, e.g. blocked by seccomp) a small pool of threads performs positioned reads instead.
+//
+//Not thread safe: Read, Submit, Poll and WaitAll must be called from one thread, which is also the
+//thread completion callbacks run on. Callbacks are free to queue more reads or hand the data to workers.
+class AsyncFileReader
+{
+public:
+
+	typedef std::function<void(AsyncReadResult& Result)> ReadCallback;
+
+	static const size_t Alignment = 4096;
+
+	//QueueDepth caps the number of reads in flight, FallbackThreadCount is only used without io_uring
+	AsyncFileReader(uint32_t QueueDepth = 64, uint32_t FallbackThreadCount = 4);
+	//Waits for reads already handed to the kernel/workers, queued reads are dropped without callbacks
+	~AsyncFileReader();
+
+	AsyncFileReader(const AsyncFileReader&) = delete;
+	AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+	//Queues a read of Size bytes at Offset (Size 0 reads to the end of the file). Nothing is issued until Submit/Poll
+	void Read(const std::string& Filename, uint64_t Offset, uint64_t Size, ReadCallback OnComplete);
+	void Read(const std::string& Filename, ReadCallback OnComplete) { Read(Filename, 0, 0, OnComplete); }
+
+	//Issues every queued read the queue depth allows, as one batch
+	void Submit();
+
+	//Non-blocking. Submits queued reads, then runs callbacks of completed ones. Returns the number of callbacks run
+	uint32_t Poll();
+
+	//Blocks until every read (including ones queued by callbacks) has completed and been delivered
+	void WaitAll();
+
+	uint32_t GetPendingCount() const { return PendingCount; }
+	bool IsUsingIoUring() const { return Ring != nullptr; }
+
+protected:
+
+	struct ReadRequest;
+	struct IoUring;
+
+	//Opens the file and sizes the aligned read, returns false (with the request failed) if that's not possible
+	bool PrepareRequest(ReadRequest& Request);
+	//Returns true once the request has read everything it needs (or failed)
+	bool OnReadCompleted(ReadRequest& Request, int64_t BytesRead);
+	void Deliver(std::vector<std::unique_ptr<ReadRequest>>& Completed);
+
+	//io_uring path
+	bool SubmitToRing(ReadRequest* Request);
+	void ReapRing(std::vector<std::unique_ptr<ReadRequest>>& OutCompleted, bool bWait);
+
+	//Thread pool path
+	void FallbackWorker();
+
+	uint32_t QueueDepth;
+	uint32_t InFlightCount = 0;
+	uint32_t PendingCount = 0;
+
+	std::deque<std::unique_ptr<ReadRequest>> QueuedRequests;
+
+	std::unique_ptr<IoUring> Ring;
+
+	std::vector<std::thread> FallbackThreads;
+	std::mutex FallbackMutex;
+	std::condition_variable FallbackWork;
+	std::condition_variable FallbackDone;
+	std::deque<std::unique_ptr<ReadRequest>> FallbackQueue;
+	std::vector<std::unique_ptr<ReadRequest>> FallbackCompleted;
+	bool bStopFallbackThreads = false;
+};
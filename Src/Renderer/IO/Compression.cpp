@@ -0,0 +1,169 @@
+#include "Compression.h"
+
+#include <cstring>
+
+namespace
+{
+	const size_t MinMatch = 4;
+	const size_t MaxOffset = 65535;
+	const uint32_t HashBits = 14;
+
+	inline uint32_t Read32(const uint8_t* Ptr)
+	{
+		uint32_t Value;
+		memcpy(&Value, Ptr, sizeof(Value));
+		return Value;
+	}
+
+	inline uint32_t HashSequence(uint32_t Sequence)
+	{
+		return (Sequence * 2654435761u) >> (32 - HashBits);
+	}
+
+	//Lengths >= 15 continue in extra bytes of 255 until a byte < 255
+	void WriteLength(std::vector<uint8_t>& Out, size_t Length)
+	{
+		while (Length >= 255)
+		{
+			Out.push_back(255);
+			Length -= 255;
+		}
+		Out.push_back(static_cast<uint8_t>(Length));
+	}
+
+	void WriteSequence(std::vector<uint8_t>& Out, const uint8_t* Literals, size_t LiteralLength, size_t Offset, size_t MatchLength)
+	{
+		const size_t MatchCode = (MatchLength > 0) ? MatchLength - MinMatch : 0;
+		Out.push_back(static_cast<uint8_t>(((LiteralLength < 15 ? LiteralLength : 15) << 4) | (MatchCode < 15 ? MatchCode : 15)));
+
+		if (LiteralLength >= 15)
+		{
+			WriteLength(Out, LiteralLength - 15);
+		}
+		Out.insert(Out.end(), Literals, Literals + LiteralLength);
+
+		//The final sequence carries literals only
+		if (MatchLength > 0)
+		{
+			Out.push_back(static_cast<uint8_t>(Offset & 0xFF));
+			Out.push_back(static_cast<uint8_t>(Offset >> 8));
+			if (MatchCode >= 15)
+			{
+				WriteLength(Out, MatchCode - 15);
+			}
+		}
+	}
+
+	bool ReadLength(const uint8_t*& In, const uint8_t* End, size_t& Length)
+	{
+		uint8_t Byte;
+		do
+		{
+			if (In >= End)
+			{
+				return false;
+			}
+			Byte = *In++;
+			Length += Byte;
+		} while (Byte == 255);
+		return true;
+	}
+}
+
+void CompressBlock(const uint8_t* Data, size_t Size, std::vector<uint8_t>& OutCompressed)
+{
+	std::vector<uint32_t> HashTable(size_t(1) << HashBits, 0);
+
+	size_t Anchor = 0;
+	size_t Pos = 0;
+
+	while (Size >= MinMatch && Pos <= Size - MinMatch)
+	{
+		const uint32_t Sequence = Read32(Data + Pos);
+		const uint32_t Hash = HashSequence(Sequence);
+		const size_t Candidate = HashTable[Hash];
+		HashTable[Hash] = static_cast<uint32_t>(Pos);
+
+		if (Candidate >= Pos || Pos - Candidate > MaxOffset || Read32(Data + Candidate) != Sequence)
+		{
+			++Pos;
+			continue;
+		}
+
+		size_t MatchLength = MinMatch;
+		while (Pos + MatchLength < Size && Data[Candidate + MatchLength] == Data[Pos + MatchLength])
+		{
+			++MatchLength;
+		}
+
+		WriteSequence(OutCompressed, Data + Anchor, Pos - Anchor, Pos - Candidate, MatchLength);
+
+		Pos += MatchLength;
+		Anchor = Pos;
+	}
+
+	WriteSequence(OutCompressed, Data + Anchor, Size - Anchor, 0, 0);
+}
+
+bool DecompressBlock(const uint8_t* Compressed, size_t CompressedSize, uint8_t* OutData, size_t DecompressedSize)
+{
+	const uint8_t* In = Compressed;
+	const uint8_t* InEnd = Compressed + CompressedSize;
+	size_t OutPos = 0;
+
+	while (In < InEnd)
+	{
+		const uint8_t Token = *In++;
+
+		size_t LiteralLength = Token >> 4;
+		if (LiteralLength == 15 && !ReadLength(In, InEnd, LiteralLength))
+		{
+			return false;
+		}
+
+		if (LiteralLength > size_t(InEnd - In) || LiteralLength > DecompressedSize - OutPos)
+		{
+			return false;
+		}
+
+		memcpy(OutData + OutPos, In, LiteralLength);
+		In += LiteralLength;
+		OutPos += LiteralLength;
+
+		//Literal-only final sequence
+		if (In == InEnd)
+		{
+			break;
+		}
+
+		if (InEnd - In < 2)
+		{
+			return false;
+		}
+
+		const size_t Offset = size_t(In[0]) | (size_t(In[1]) << 8);
+		In += 2;
+
+		size_t MatchLength = Token & 0xF;
+		if (MatchLength == 15 && !ReadLength(In, InEnd, MatchLength))
+		{
+			return false;
+		}
+		MatchLength += MinMatch;
+
+		if (Offset == 0 || Offset > OutPos || MatchLength > DecompressedSize - OutPos)
+		{
+			return false;
+		}
+
+		//Byte by byte, matches may overlap their own output
+		const uint8_t* Match = OutData + OutPos - Offset;
+		for (size_t i = 0; i < MatchLength; ++i)
+		{
+			OutData[OutPos + i] = Match[i];
+		}
+		OutPos += MatchLength;
+	}
+
+	return OutPos == DecompressedSize;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+//Small LZ77 block compressor (LZ4-style token stream, 64KB window)
+//Favours decompression speed over ratio, used for cooked asset data
+
+//Appends the compressed form of Data to OutCompressed
+void CompressBlock(const uint8_t* Data, size_t Size, std::vector<uint8_t>& OutCompressed);
+
+//Decompresses exactly DecompressedSize bytes into OutData, returns false on malformed input
+bool DecompressBlock(const uint8_t* Compressed, size_t CompressedSize, uint8_t* OutData, size_t DecompressedSize);
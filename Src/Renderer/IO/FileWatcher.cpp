@@ -0,0 +1,158 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+#ifdef __linux__
+
+FileWatcher::FileWatcher(const std::string& Directory)
+{
+	NotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (NotifyFd < 0)
+	{
+		std::cout << "FileWatcher: inotify_init1 failed: " << strerror(errno) << std::endl;
+		return;
+	}
+
+	AddWatchRecursive(Directory);
+}
+
+FileWatcher::~FileWatcher()
+{
+	if (NotifyFd >= 0)
+	{
+		close(NotifyFd);
+	}
+}
+
+bool FileWatcher::IsSupported() const
+{
+	return NotifyFd >= 0;
+}
+
+void FileWatcher::AddWatchRecursive(const std::string& Directory)
+{
+	//Inotify watches aren't recursive, every subdirectory needs its own
+	const uint32_t Mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+	int WatchDescriptor = inotify_add_watch(NotifyFd, Directory.c_str(), Mask);
+	if (WatchDescriptor < 0)
+	{
+		std::cout << "FileWatcher: failed to watch " << Directory << ": " << strerror(errno) << std::endl;
+		return;
+	}
+	WatchedDirectories[WatchDescriptor] = Directory;
+
+	DIR* Dir = opendir(Directory.c_str());
+	if (Dir == nullptr)
+	{
+		return;
+	}
+
+	while (dirent* Entry = readdir(Dir))
+	{
+		if (strcmp(Entry->d_name, ".") == 0 || strcmp(Entry->d_name, "..") == 0)
+		{
+			continue;
+		}
+
+		std::string Path = Directory + "/" + Entry->d_name;
+
+		struct stat PathStat;
+		if (stat(Path.c_str(), &PathStat) == 0 && S_ISDIR(PathStat.st_mode))
+		{
+			AddWatchRecursive(Path);
+		}
+	}
+
+	closedir(Dir);
+}
+
+std::vector<std::string> FileWatcher::Poll()
+{
+	std::vector<std::string> ChangedFiles;
+	if (NotifyFd < 0)
+	{
+		return ChangedFiles;
+	}
+
+	alignas(inotify_event) char Buffer[4096];
+
+	for (;;)
+	{
+		const ssize_t Length = read(NotifyFd, Buffer, sizeof(Buffer));
+		if (Length <= 0)
+		{
+			break; //EAGAIN: no more events queued
+		}
+
+		for (ssize_t Offset = 0; Offset < Length;)
+		{
+			const inotify_event* Event = reinterpret_cast<const inotify_event*>(Buffer + Offset);
+			Offset += sizeof(inotify_event) + Event->len;
+
+			auto Directory = WatchedDirectories.find(Event->wd);
+			if (Directory == WatchedDirectories.end() || Event->len == 0)
+			{
+				continue;
+			}
+
+			std::string Path = Directory->second + "/" + Event->name;
+
+			if (Event->mask & IN_ISDIR)
+			{
+				if (Event->mask & (IN_CREATE | IN_MOVED_TO))
+				{
+					AddWatchRecursive(Path);
+				}
+			}
+			//Files are reported once fully written (or atomically renamed into place), not on creation
+			else if (Event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+			{
+				ChangedFiles.push_back(Path);
+			}
+		}
+	}
+
+	//Editors may write a file several times in one save
+	std::sort(std::begin(ChangedFiles), std::end(ChangedFiles));
+	ChangedFiles.erase(std::unique(std::begin(ChangedFiles), std::end(ChangedFiles)), std::end(ChangedFiles));
+
+	return ChangedFiles;
+}
+
+#else
+
+FileWatcher::FileWatcher(const std::string& Directory)
+{
+	std::cout << "FileWatcher: file watching is not supported on this platform, " << Directory << " will not be watched" << std::endl;
+}
+
+FileWatcher::~FileWatcher()
+{
+
+}
+
+bool FileWatcher::IsSupported() const
+{
+	return false;
+}
+
+void FileWatcher::AddWatchRecursive(const std::string&)
+{
+
+}
+
+std::vector<std::string> FileWatcher::Poll()
+{
+	return std::vector<std::string>();
+}
+
+#endif
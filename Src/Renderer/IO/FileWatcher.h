@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+
+//Watches a directory tree for files that were written or moved into place
+//Linux only (inotify), on other platforms Poll never reports anything
+class FileWatcher
+{
+public:
+
+	FileWatcher(const std::string& Directory);
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	//Non-blocking. Returns each changed file once, as Directory + relative path
+	std::vector<std::string> Poll();
+
+	bool IsSupported() const;
+
+protected:
+
+	void AddWatchRecursive(const std::string& Directory);
+
+	int NotifyFd = -1;
+
+	//Watch descriptor -> watched directory
+	std::map<int, std::string> WatchedDirectories;
+};
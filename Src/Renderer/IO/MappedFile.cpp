@@ -0,0 +1,166 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& Filename)
+{
+	if (!Open(Filename))
+	{
+		throw std::runtime_error("failed to map file: " + Filename);
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& Other)
+{
+	MoveFrom(Other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& Other)
+{
+	if (this != &Other)
+	{
+		Close();
+		MoveFrom(Other);
+	}
+	return *this;
+}
+
+void MappedFile::MoveFrom(MappedFile& Other)
+{
+	Data = Other.Data;
+	Size = Other.Size;
+	Other.Data = nullptr;
+	Other.Size = 0;
+
+#ifdef _WIN32
+	FileHandle = Other.FileHandle;
+	MappingHandle = Other.MappingHandle;
+	Other.FileHandle = nullptr;
+	Other.MappingHandle = nullptr;
+#endif
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& Filename)
+{
+	Close();
+
+	HANDLE File = CreateFileA(Filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (File == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER FileSize;
+	if (!GetFileSizeEx(File, &FileSize) || FileSize.QuadPart == 0)
+	{
+		CloseHandle(File);
+		return false;
+	}
+
+	HANDLE Mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (Mapping == nullptr)
+	{
+		CloseHandle(File);
+		return false;
+	}
+
+	void* View = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+	if (View == nullptr)
+	{
+		CloseHandle(Mapping);
+		CloseHandle(File);
+		return false;
+	}
+
+	FileHandle = File;
+	MappingHandle = Mapping;
+	Data = static_cast<const uint8_t*>(View);
+	Size = static_cast<size_t>(FileSize.QuadPart);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (Data != nullptr)
+	{
+		UnmapViewOfFile(Data);
+	}
+	if (MappingHandle != nullptr)
+	{
+		CloseHandle(MappingHandle);
+	}
+	if (FileHandle != nullptr)
+	{
+		CloseHandle(FileHandle);
+	}
+
+	Data = nullptr;
+	Size = 0;
+	FileHandle = nullptr;
+	MappingHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& Filename)
+{
+	Close();
+
+	int File = open(Filename.c_str(), O_RDONLY);
+	if (File < 0)
+	{
+		return false;
+	}
+
+	struct stat FileStat;
+	if (fstat(File, &FileStat) != 0 || FileStat.st_size == 0)
+	{
+		close(File);
+		return false;
+	}
+
+	void* View = mmap(nullptr, static_cast<size_t>(FileStat.st_size), PROT_READ, MAP_PRIVATE, File, 0);
+
+	//The mapping keeps its own reference to the file
+	close(File);
+
+	if (View == MAP_FAILED)
+	{
+		return false;
+	}
+
+	Data = static_cast<const uint8_t*>(View);
+	Size = static_cast<size_t>(FileStat.st_size);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (Data != nullptr)
+	{
+		munmap(const_cast<uint8_t*>(Data), Size);
+	}
+
+	Data = nullptr;
+	Size = 0;
+}
+
+#endif
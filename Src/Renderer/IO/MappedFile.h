@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+//Read-only memory mapping of an entire file
+//Pages are faulted in by the OS on first access, so opening a large file is cheap
+class MappedFile
+{
+public:
+
+	MappedFile() {}
+	//Throws if the file can't be opened or mapped
+	MappedFile(const std::string& Filename);
+	~MappedFile();
+
+	MappedFile(MappedFile&& Other);
+	MappedFile& operator=(MappedFile&& Other);
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	//Returns false if the file couldn't be opened or mapped (empty files can't be mapped)
+	bool Open(const std::string& Filename);
+	void Close();
+
+	bool IsOpen() const { return Data != nullptr; }
+	const uint8_t* GetData() const { return Data; }
+	size_t GetSize() const { return Size; }
+
+protected:
+
+	void MoveFrom(MappedFile& Other);
+
+	const uint8_t* Data = nullptr;
+	size_t Size = 0;
+
+#ifdef _WIN32
+	void* FileHandle = nullptr;
+	void* MappingHandle = nullptr;
+#endif
+};
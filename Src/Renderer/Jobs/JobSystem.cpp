@@ -0,0 +1,296 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+	//Which system/queue the current thread works for, non-worker threads use the injection queue
+	thread_local JobSystem* CurrentSystem = nullptr;
+	thread_local uint32_t CurrentQueue = 0;
+	thread_local uint32_t StealSeed = 0;
+
+	//Idle spins before a worker goes to sleep, keeps latency low for bursts of small jobs
+	const uint32_t IdleSpinCount = 64;
+
+	uint32_t NextRandom()
+	{
+		if (StealSeed == 0)
+		{
+			StealSeed = static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1;
+		}
+
+		//xorshift32
+		StealSeed ^= StealSeed << 13;
+		StealSeed ^= StealSeed >> 17;
+		StealSeed ^= StealSeed << 5;
+		return StealSeed;
+	}
+}
+
+void JobSystem::JobQueue::PushBack(const Job& NewJob)
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	if (Count == Ring.size())
+	{
+		//Unwrap into a ring twice the size
+		std::vector<Job> Grown(Ring.size() * 2);
+		for (size_t i = 0; i < Count; ++i)
+		{
+			Grown[i] = Ring[(Front + i) & (Ring.size() - 1)];
+		}
+		Ring.swap(Grown);
+		Front = 0;
+	}
+
+	Ring[(Front + Count) & (Ring.size() - 1)] = NewJob;
+	Count++;
+}
+
+bool JobSystem::JobQueue::PopBack(Job& OutJob)
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	if (Count == 0)
+	{
+		return false;
+	}
+
+	Count--;
+	OutJob = Ring[(Front + Count) & (Ring.size() - 1)];
+	return true;
+}
+
+bool JobSystem::JobQueue::PopFront(Job& OutJob)
+{
+	//Thieves don't wait on a busy queue, they move on to the next victim
+	std::unique_lock<std::mutex> Lock(Mutex, std::try_to_lock);
+	if (!Lock.owns_lock() || Count == 0)
+	{
+		return false;
+	}
+
+	OutJob = Ring[Front];
+	Front = (Front + 1) & (Ring.size() - 1);
+	Count--;
+	return true;
+}
+
+uint32_t JobSystem::GetDefaultWorkerCount()
+{
+	return std::max(std::thread::hardware_concurrency(), 2u) - 1;
+}
+
+JobSystem::JobSystem(uint32_t WorkerCount)
+{
+	for (uint32_t i = 0; i < WorkerCount + 1; ++i)
+	{
+		Queues.emplace_back(new JobQueue());
+	}
+
+	for (uint32_t i = 0; i < WorkerCount; ++i)
+	{
+		Workers.emplace_back(&JobSystem::WorkerMain, this, i + 1);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> Lock(SleepMutex);
+		bShuttingDown = true;
+	}
+	WakeWorkers.notify_all();
+
+	for (std::thread& Worker : Workers)
+	{
+		Worker.join();
+	}
+}
+
+void JobSystem::Schedule(void (*Function)(void* Data), void* Data, JobCounter* Counter)
+{
+	if (Counter)
+	{
+		Counter->Count.fetch_add(1, std::memory_order_relaxed);
+	}
+	Push(Job{ Function, Data, Counter });
+}
+
+void JobSystem::ScheduleAfter(JobCounter& Dependency, void (*Function)(void* Data), void* Data, JobCounter* Counter)
+{
+	if (Counter)
+	{
+		Counter->Count.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	{
+		//A set ReleasingBit means the dependency already reached 0 and its continuations are being handed off
+		std::lock_guard<std::mutex> Lock(Dependency.ContinuationMutex);
+		const uint32_t DependencyCount = Dependency.Count.load(std::memory_order_acquire);
+		if (DependencyCount != 0 && (DependencyCount & JobCounter::ReleasingBit) == 0)
+		{
+			Dependency.Continuations.push_back(Job{ Function, Data, Counter });
+			return;
+		}
+	}
+
+	Push(Job{ Function, Data, Counter });
+}
+
+void JobSystem::Push(const Job& NewJob)
+{
+	const uint32_t QueueIndex = (CurrentSystem == this) ? CurrentQueue : 0;
+	Queues[QueueIndex]->PushBack(NewJob);
+
+	//Paired with the checks in WorkerMain: either the worker sees the job or we see the sleeper
+	QueuedJobCount.fetch_add(1);
+	if (SleepingWorkerCount.load() > 0)
+	{
+		std::lock_guard<std::mutex> Lock(SleepMutex);
+		WakeWorkers.notify_one();
+	}
+}
+
+bool JobSystem::RunOneJob()
+{
+	const uint32_t QueueIndex = (CurrentSystem == this) ? CurrentQueue : 0;
+
+	Job NextJob;
+	bool bFound = Queues[QueueIndex]->PopBack(NextJob);
+
+	//Steal from the front of the other queues, starting at a random victim
+	const uint32_t QueueCount = static_cast<uint32_t>(Queues.size());
+	const uint32_t FirstVictim = NextRandom() % QueueCount;
+	for (uint32_t i = 0; i < QueueCount && !bFound; ++i)
+	{
+		const uint32_t Victim = (FirstVictim + i) % QueueCount;
+		bFound = (Victim != QueueIndex) && Queues[Victim]->PopFront(NextJob);
+	}
+
+	if (!bFound)
+	{
+		return false;
+	}
+
+	QueuedJobCount.fetch_sub(1, std::memory_order_relaxed);
+	Execute(NextJob);
+	return true;
+}
+
+void JobSystem::Execute(const Job& NextJob)
+{
+	JobCounter* Counter = NextJob.Counter;
+
+	//An exception must not unwind the worker, and the counter has to come down either way or Wait never returns
+	try
+	{
+		NextJob.Function(NextJob.Data);
+	}
+	catch (...)
+	{
+		if (Counter)
+		{
+			std::lock_guard<std::mutex> Lock(Counter->ContinuationMutex);
+			if (!Counter->Exception)
+			{
+				Counter->Exception = std::current_exception();
+			}
+		}
+		else
+		{
+			std::cout << "Job without a counter threw, nobody waits on it to rethrow" << std::endl;
+		}
+	}
+
+	if (!Counter)
+	{
+		return;
+	}
+
+	//The last job parks the count on ReleasingBit instead of 0 so Wait can't return
+	//(and the counter go out of scope) until the continuations have been taken
+	uint32_t OldCount = Counter->Count.load(std::memory_order_relaxed);
+	uint32_t NewCount;
+	do
+	{
+		NewCount = (OldCount == 1) ? JobCounter::ReleasingBit : OldCount - 1;
+	} while (!Counter->Count.compare_exchange_weak(OldCount, NewCount, std::memory_order_acq_rel));
+
+	if (OldCount != 1)
+	{
+		return;
+	}
+
+	std::vector<Job> Continuations;
+	{
+		std::lock_guard<std::mutex> Lock(Counter->ContinuationMutex);
+		Continuations.swap(Counter->Continuations);
+	}
+
+	//Last access to Counter, it may be destroyed as soon as this lands
+	Counter->Count.fetch_and(~JobCounter::ReleasingBit, std::memory_order_release);
+
+	for (const Job& Continuation : Continuations)
+	{
+		Push(Continuation);
+	}
+}
+
+void JobSystem::Wait(JobCounter& Counter)
+{
+	while (!Counter.IsDone())
+	{
+		if (!RunOneJob())
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	//Taken out so the counter can be reused, and a second Wait on it doesn't throw again
+	std::exception_ptr Exception;
+	{
+		std::lock_guard<std::mutex> Lock(Counter.ContinuationMutex);
+		Exception.swap(Counter.Exception);
+	}
+
+	if (Exception)
+	{
+		std::rethrow_exception(Exception);
+	}
+}
+
+void JobSystem::WorkerMain(uint32_t QueueIndex)
+{
+	CurrentSystem = this;
+	CurrentQueue = QueueIndex;
+
+	uint32_t IdleSpins = 0;
+	for (;;)
+	{
+		if (RunOneJob())
+		{
+			IdleSpins = 0;
+			continue;
+		}
+
+		if (++IdleSpins < IdleSpinCount)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		SleepingWorkerCount.fetch_add(1);
+		{
+			std::unique_lock<std::mutex> Lock(SleepMutex);
+			WakeWorkers.wait(Lock, [this]() { return bShuttingDown || QueuedJobCount.load() > 0; });
+		}
+		SleepingWorkerCount.fetch_sub(1);
+		IdleSpins = 0;
+
+		std::lock_guard<std::mutex> Lock(SleepMutex);
+		if (bShuttingDown)
+		{
+			return;
+		}
+	}
+}
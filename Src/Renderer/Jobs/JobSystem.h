@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <utility>
+#include <type_traits>
+#include <exception>
+
+class JobSystem;
+
+//Smallest unit of work: a function pointer and its argument, cheap to copy in and out of the deques
+struct Job
+{
+	void (*Function)(void* Data);
+	void* Data;
+	class JobCounter* Counter;
+};
+
+//Counts unfinished jobs. Wait on it with JobSystem::Wait, or use it as the dependency of other jobs
+//A job that throws still counts as finished, the first exception is rethrown by Wait
+class JobCounter
+{
+public:
+
+	JobCounter() {}
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	bool IsDone() const { return Count.load(std::memory_order_acquire) == 0; }
+
+protected:
+
+	friend class JobSystem;
+
+	//Set while the last job hands off continuations, so waiters can't free the counter under it
+	static const uint32_t ReleasingBit = 1u << 31;
+
+	std::atomic<uint32_t> Count{0};
+
+	//Jobs scheduled with ScheduleAfter, released once Count reaches 0
+	std::mutex ContinuationMutex;
+	std::vector<Job> Continuations;
+
+	//First exception thrown by one of the jobs, guarded by ContinuationMutex
+	std::exception_ptr Exception;
+};
+
+//Work-stealing job scheduler
+//
+//Every worker owns a deque: it pushes and pops its own jobs at the back (LIFO, cache friendly),
+//idle workers steal from the front of other deques (FIFO, takes the oldest and usually largest work).
+//Deques are small mutex-protected rings: an uncontended lock costs about what the CAS of a lock-free
+//Chase-Lev deque does and keeps the owner/thief races trivially correct.
+//
+//Waiting never blocks a thread that could do work: Wait runs other jobs until its counter reaches 0,
+//which gives the latency of fiber-style waiting without switching stacks.
+//Threads that aren't workers (main thread, I/O callbacks) share one injection deque.
+class JobSystem
+{
+public:
+
+	//One worker per hardware thread minus one, the waiting thread makes up the difference
+	static uint32_t GetDefaultWorkerCount();
+
+	//WorkerCount 0 is valid: every job then runs on whichever thread calls Wait
+	JobSystem(uint32_t WorkerCount = GetDefaultWorkerCount());
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	static JobSystem* Get()
+	{
+		static JobSystem Instance;
+		return &Instance;
+	}
+
+	//Counter (optional) is incremented now and decremented once the job has run
+	void Schedule(void (*Function)(void* Data), void* Data, JobCounter* Counter);
+
+	//Convenience for lambdas, the callable is moved to the heap and freed after it runs
+	template<typename F>
+	void Schedule(F&& Function, JobCounter* Counter)
+	{
+		typedef typename std::decay<F>::type Callable;
+		Schedule(&RunAndDelete<Callable>, new Callable(std::forward<F>(Function)), Counter);
+	}
+
+	//Job runs once Dependency reaches 0 (immediately if it already has)
+	void ScheduleAfter(JobCounter& Dependency, void (*Function)(void* Data), void* Data, JobCounter* Counter);
+
+	template<typename F>
+	void ScheduleAfter(JobCounter& Dependency, F&& Function, JobCounter* Counter)
+	{
+		typedef typename std::decay<F>::type Callable;
+		ScheduleAfter(Dependency, &RunAndDelete<Callable>, new Callable(std::forward<F>(Function)), Counter);
+	}
+
+	//Runs other jobs until Counter reaches 0, then rethrows the first exception its jobs threw (once)
+	void Wait(JobCounter& Counter);
+
+	//Calls Function(Begin, End) over [0, Count) in batches of BatchSize across all workers and waits for it
+	template<typename F>
+	void ParallelFor(uint32_t Count, uint32_t BatchSize, const F& Function)
+	{
+		struct Batch
+		{
+			const F* Function;
+			uint32_t Begin;
+			uint32_t End;
+		};
+
+		BatchSize = (BatchSize > 0) ? BatchSize : 1;
+		std::vector<Batch> Batches;
+		Batches.reserve((Count + BatchSize - 1) / BatchSize);
+		for (uint32_t Begin = 0; Begin < Count; Begin += BatchSize)
+		{
+			Batches.push_back(Batch{ &Function, Begin, (Count - Begin > BatchSize) ? Begin + BatchSize : Count });
+		}
+
+		JobCounter Counter;
+		for (Batch& Range : Batches)
+		{
+			Schedule([](void* Data)
+			{
+				Batch* Range = static_cast<Batch*>(Data);
+				(*Range->Function)(Range->Begin, Range->End);
+			}, &Range, &Counter);
+		}
+		Wait(Counter);
+	}
+
+	uint32_t GetWorkerCount() const { return static_cast<uint32_t>(Workers.size()); }
+
+protected:
+
+	template<typename Callable>
+	static void RunAndDelete(void* Data)
+	{
+		std::unique_ptr<Callable> Function(static_cast<Callable*>(Data));
+		(*Function)();
+	}
+
+	//Growable ring of jobs, owner works at the back, thieves at the front
+	struct JobQueue
+	{
+		std::mutex Mutex;
+		std::vector<Job> Ring = std::vector<Job>(256);
+		size_t Front = 0;
+		size_t Count = 0;
+
+		void PushBack(const Job& NewJob);
+		bool PopBack(Job& OutJob);
+		bool PopFront(Job& OutJob);
+	};
+
+	void Push(const Job& NewJob);
+	//Pops local work or steals some, runs it and returns true. Returns false if no job was found
+	bool RunOneJob();
+	void Execute(const Job& NextJob);
+	void WorkerMain(uint32_t QueueIndex);
+
+	//Queue 0 is the injection queue for non-worker threads, worker N owns queue N + 1
+	std::vector<std::unique_ptr<JobQueue>> Queues;
+	std::vector<std::thread> Workers;
+
+	//Jobs pushed but not yet popped, lets idle workers sleep instead of spinning
+	std::atomic<uint32_t> QueuedJobCount{0};
+	std::atomic<uint32_t> SleepingWorkerCount{0};
+	std::mutex SleepMutex;
+	std::condition_variable WakeWorkers;
+	bool bShuttingDown = false;
+};
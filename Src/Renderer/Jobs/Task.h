@@ -0,0 +1,305 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <atomic>
+#include <vector>
+
+#include "JobSystem.h"
+
+//Awaitable coroutine result
+//
+//Tasks are lazy: nothing runs until the task is co_awaited (or Start is called on a top level task),
+//and the awaiting coroutine is resumed directly from the final suspend of the task, on whichever
+//thread finished it. Awaiters such as ResumeOn or VulkanAssetLoader::ResumeOnMainThread move a
+//coroutine to the thread it needs to be on.
+template<typename T = void>
+class Task;
+
+namespace TaskDetail
+{
+	struct PromiseBase
+	{
+		std::coroutine_handle<> Continuation;
+		std::exception_ptr Exception;
+
+		//Handle.done() isn't safe to poll from another thread, this is
+		std::atomic<bool> bDone{false};
+
+		struct FinalAwaiter
+		{
+			bool await_ready() noexcept { return false; }
+
+			template<typename Promise>
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> Handle) noexcept
+			{
+				//Without a continuation the owner may destroy the frame as soon as bDone is set
+				std::coroutine_handle<> Continuation = Handle.promise().Continuation;
+				Handle.promise().bDone.store(true, std::memory_order_release);
+				return Continuation ? Continuation : std::noop_coroutine();
+			}
+
+			void await_resume() noexcept {}
+		};
+
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		FinalAwaiter final_suspend() noexcept { return {}; }
+		void unhandled_exception() { Exception = std::current_exception(); }
+	};
+
+	template<typename T>
+	struct Promise : PromiseBase
+	{
+		std::optional<T> Value;
+
+		Task<T> get_return_object();
+
+		template<typename U>
+		void return_value(U&& InValue) { Value.emplace(std::forward<U>(InValue)); }
+
+		T TakeResult()
+		{
+			if (Exception)
+			{
+				std::rethrow_exception(Exception);
+			}
+			return std::move(*Value);
+		}
+	};
+
+	template<>
+	struct Promise<void> : PromiseBase
+	{
+		Task<void> get_return_object();
+
+		void return_void() {}
+
+		void TakeResult()
+		{
+			if (Exception)
+			{
+				std::rethrow_exception(Exception);
+			}
+		}
+	};
+}
+
+template<typename T>
+class Task
+{
+public:
+
+	typedef TaskDetail::Promise<T> promise_type;
+	typedef std::coroutine_handle<promise_type> HandleType;
+
+	Task() {}
+	explicit Task(HandleType InHandle) : Handle(InHandle) {}
+	~Task() { Destroy(); }
+
+	Task(Task&& Other) noexcept : Handle(std::exchange(Other.Handle, nullptr)) {}
+	Task& operator=(Task&& Other) noexcept
+	{
+		if (this != &Other)
+		{
+			Destroy();
+			Handle = std::exchange(Other.Handle, nullptr);
+		}
+		return *this;
+	}
+
+	Task(const Task&) = delete;
+	Task& operator=(const Task&) = delete;
+
+	//Runs a task nothing co_awaits on the calling thread until its first suspension
+	void Start() { Handle.resume(); }
+	bool IsReady() const { return !Handle || Handle.promise().bDone.load(std::memory_order_acquire); }
+
+	//Result of a finished task, rethrows the exception it ended with
+	T GetResult() { return Handle.promise().TakeResult(); }
+
+	struct ReadyAwaiter
+	{
+		HandleType Handle;
+
+		bool await_ready() { return !Handle || Handle.promise().bDone.load(std::memory_order_acquire); }
+
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> Awaiting)
+		{
+			Handle.promise().Continuation = Awaiting;
+			return Handle;
+		}
+
+		void await_resume() {}
+	};
+
+	struct ResultAwaiter : ReadyAwaiter
+	{
+		T await_resume() { return this->Handle.promise().TakeResult(); }
+	};
+
+	ResultAwaiter operator co_await() { return ResultAwaiter{ { Handle } }; }
+
+	//Waits for the task to finish without taking its result (or rethrowing its exception)
+	ReadyAwaiter WhenReady() { return ReadyAwaiter{ Handle }; }
+
+protected:
+
+	void Destroy()
+	{
+		if (Handle)
+		{
+			Handle.destroy();
+			Handle = nullptr;
+		}
+	}
+
+	HandleType Handle;
+};
+
+template<typename T>
+Task<T> TaskDetail::Promise<T>::get_return_object()
+{
+	return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskDetail::Promise<void>::get_return_object()
+{
+	return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+namespace TaskDetail
+{
+	struct WhenAllLatch
+	{
+		std::atomic<size_t> Count{0};
+		std::coroutine_handle<> Awaiting;
+	};
+
+	//Waits for one task of a WhenAll and counts the latch down, the last one resumes the awaiting coroutine
+	struct WhenAllWaiter
+	{
+		struct promise_type
+		{
+			WhenAllLatch* Latch = nullptr;
+
+			struct FinalAwaiter
+			{
+				bool await_ready() noexcept { return false; }
+
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> Handle) noexcept
+				{
+					WhenAllLatch* Latch = Handle.promise().Latch;
+					return (Latch->Count.fetch_sub(1, std::memory_order_acq_rel) == 1) ? Latch->Awaiting : std::noop_coroutine();
+				}
+
+				void await_resume() noexcept {}
+			};
+
+			WhenAllWaiter get_return_object() { return WhenAllWaiter(std::coroutine_handle<promise_type>::from_promise(*this)); }
+			std::suspend_always initial_suspend() noexcept { return {}; }
+			FinalAwaiter final_suspend() noexcept { return {}; }
+			void return_void() {}
+			void unhandled_exception() { std::terminate(); } //WhenReady never throws
+		};
+
+		explicit WhenAllWaiter(std::coroutine_handle<promise_type> InHandle) : Handle(InHandle) {}
+		WhenAllWaiter(WhenAllWaiter&& Other) noexcept : Handle(std::exchange(Other.Handle, nullptr)) {}
+		~WhenAllWaiter()
+		{
+			if (Handle)
+			{
+				Handle.destroy();
+			}
+		}
+
+		std::coroutine_handle<promise_type> Handle;
+	};
+
+	template<typename T>
+	WhenAllWaiter MakeWhenAllWaiter(Task<T>* WaitedTask)
+	{
+		co_await WaitedTask->WhenReady();
+	}
+
+	class WhenAllAwaitable
+	{
+	public:
+
+		explicit WhenAllAwaitable(std::vector<WhenAllWaiter>&& InWaiters) : Waiters(std::move(InWaiters)) {}
+
+		bool await_ready() { return Waiters.empty(); }
+
+		bool await_suspend(std::coroutine_handle<> Awaiting)
+		{
+			//One extra count is held while the tasks start, so a task finishing early can't resume us yet
+			Latch.Count.store(Waiters.size() + 1, std::memory_order_relaxed);
+			Latch.Awaiting = Awaiting;
+
+			for (WhenAllWaiter& Waiter : Waiters)
+			{
+				Waiter.Handle.promise().Latch = &Latch;
+				Waiter.Handle.resume();
+			}
+
+			//If every task already finished, carry on without suspending
+			return Latch.Count.fetch_sub(1, std::memory_order_acq_rel) != 1;
+		}
+
+		void await_resume() {}
+
+	protected:
+
+		std::vector<WhenAllWaiter> Waiters;
+		WhenAllLatch Latch;
+	};
+}
+
+//Runs every task concurrently and resumes once all of them have finished
+//Results (or exceptions) are then taken by co_awaiting each task, which no longer suspends
+template<typename T>
+TaskDetail::WhenAllAwaitable WhenAll(std::vector<Task<T>>& Tasks)
+{
+	std::vector<TaskDetail::WhenAllWaiter> Waiters;
+	Waiters.reserve(Tasks.size());
+	for (Task<T>& WaitedTask : Tasks)
+	{
+		Waiters.push_back(TaskDetail::MakeWhenAllWaiter(&WaitedTask));
+	}
+	return TaskDetail::WhenAllAwaitable(std::move(Waiters));
+}
+
+template<typename... Ts>
+TaskDetail::WhenAllAwaitable WhenAll(Task<Ts>&... Tasks)
+{
+	std::vector<TaskDetail::WhenAllWaiter> Waiters;
+	Waiters.reserve(sizeof...(Tasks));
+	(Waiters.push_back(TaskDetail::MakeWhenAllWaiter(&Tasks)), ...);
+	return TaskDetail::WhenAllAwaitable(std::move(Waiters));
+}
+
+//co_await ResumeOn(*JobSystem::Get()) continues the coroutine as a job on a worker thread
+struct JobSystemAwaiter
+{
+	JobSystem& Jobs;
+
+	bool await_ready() { return false; }
+
+	void await_suspend(std::coroutine_handle<> Handle)
+	{
+		Jobs.Schedule(&ResumeJob, Handle.address(), nullptr);
+	}
+
+	void await_resume() {}
+
+	static void ResumeJob(void* Address)
+	{
+		std::coroutine_handle<>::from_address(Address).resume();
+	}
+};
+
+inline JobSystemAwaiter ResumeOn(JobSystem& Jobs)
+{
+	return JobSystemAwaiter{ Jobs };
+}
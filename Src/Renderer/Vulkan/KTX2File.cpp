@@ -0,0 +1,139 @@
+#include "KTX2File.h"
+
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+	const uint8_t KTX2Identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+	//Fixed-size portion of the file preceding the level index
+	struct KTX2Header
+	{
+		uint8_t  Identifier[12];
+		uint32_t VkFormat;
+		uint32_t TypeSize;
+		uint32_t PixelWidth;
+		uint32_t PixelHeight;
+		uint32_t PixelDepth;
+		uint32_t LayerCount;
+		uint32_t FaceCount;
+		uint32_t LevelCount;
+		uint32_t SupercompressionScheme;
+
+		uint32_t DfdByteOffset;
+		uint32_t DfdByteLength;
+		uint32_t KvdByteOffset;
+		uint32_t KvdByteLength;
+		uint64_t SgdByteOffset;
+		uint64_t SgdByteLength;
+	};
+
+	static_assert(sizeof(KTX2Header) == 80, "KTX2Header must match the on-disk layout");
+	static_assert(sizeof(KTX2Level) == 24, "KTX2Level must match the on-disk layout");
+}
+
+void KTX2File::Open(const std::string& Filename)
+{
+	if (!File.Open(Filename))
+	{
+		throw std::runtime_error("KTX2: failed to open file: " + Filename);
+	}
+
+	Data = File.GetData();
+	Size = File.GetSize();
+	Parse(Filename);
+}
+
+void KTX2File::Open(const uint8_t* InData, size_t InSize, const std::string& DebugName)
+{
+	File.Close();
+	Data = InData;
+	Size = InSize;
+	Parse(DebugName);
+}
+
+void KTX2File::Parse(const std::string& Filename)
+{
+	if (Size < sizeof(KTX2Header))
+	{
+		throw std::runtime_error("KTX2: file too small: " + Filename);
+	}
+
+	KTX2Header Header;
+	memcpy(&Header, Data, sizeof(KTX2Header));
+
+	if (memcmp(Header.Identifier, KTX2Identifier, sizeof(KTX2Identifier)) != 0)
+	{
+		throw std::runtime_error("KTX2: bad identifier: " + Filename);
+	}
+
+	if (Header.SupercompressionScheme != 0)
+	{
+		throw std::runtime_error("KTX2: supercompressed files are not supported: " + Filename);
+	}
+
+	if (Header.PixelDepth > 1)
+	{
+		throw std::runtime_error("KTX2: 3D textures are not supported: " + Filename);
+	}
+
+	if (Header.VkFormat == 0)
+	{
+		throw std::runtime_error("KTX2: VK_FORMAT_UNDEFINED (basis universal) is not supported: " + Filename);
+	}
+
+	if (Header.FaceCount != 1 && Header.FaceCount != 6)
+	{
+		throw std::runtime_error("KTX2: invalid face count: " + Filename);
+	}
+
+	Format = static_cast<vk::Format>(Header.VkFormat);
+	Width = Header.PixelWidth;
+	Height = std::max(Header.PixelHeight, 1u);
+	LayerCount = std::max(Header.LayerCount, 1u);
+	FaceCount = Header.FaceCount;
+
+	//A level count of 0 asks the loader to generate mips, we just upload the base level
+	const uint32_t LevelCount = std::max(Header.LevelCount, 1u);
+
+	const size_t LevelIndexSize = LevelCount * sizeof(KTX2Level);
+	if (Size < sizeof(KTX2Header) + LevelIndexSize)
+	{
+		throw std::runtime_error("KTX2: truncated level index: " + Filename);
+	}
+
+	Levels.resize(LevelCount);
+	memcpy(Levels.data(), Data + sizeof(KTX2Header), LevelIndexSize);
+
+	for (const KTX2Level& Level : Levels)
+	{
+		//Written so crafted 64 bit values can't wrap around
+		if (Level.ByteLength == 0 || Level.ByteLength > Size || Level.ByteOffset > Size - Level.ByteLength)
+		{
+			throw std::runtime_error("KTX2: level data out of bounds: " + Filename);
+		}
+	}
+}
+
+void KTX2File::GetLevelRange(uint32_t BaseLevel, uint64_t& OutBegin, uint64_t& OutEnd) const
+{
+	OutBegin = Levels[BaseLevel].ByteOffset;
+	OutEnd = 0;
+	for (uint32_t Level = BaseLevel; Level < GetLevelCount(); ++Level)
+	{
+		OutBegin = std::min(OutBegin, Levels[Level].ByteOffset);
+		OutEnd = std::max(OutEnd, Levels[Level].ByteOffset + Levels[Level].ByteLength);
+	}
+}
+
+uint64_t KTX2File::GetLevelChainSize(uint32_t BaseLevel) const
+{
+	uint64_t Size = 0;
+	for (uint32_t Level = BaseLevel; Level < GetLevelCount(); ++Level)
+	{
+		Size += Levels[Level].ByteLength;
+	}
+	return Size;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <vector>
+#include <string>
+
+#include "../IO/MappedFile.h"
+
+//Level index entry of a KTX2 container
+struct KTX2Level
+{
+	uint64_t ByteOffset;
+	uint64_t ByteLength;
+	uint64_t UncompressedByteLength;
+};
+
+//Memory-mapped KTX2 texture container (https://github.khronos.org/KTX-Specification/)
+//Level data stays in the mapping and is copied straight into staging memory, no decode step
+class KTX2File
+{
+public:
+
+	//Throws if the file is missing, malformed or uses an unsupported feature (supercompression, 3D textures)
+	void Open(const std::string& Filename);
+	//Parses a container that is already in memory (e.g. an asset archive entry), Data must outlive this object
+	void Open(const uint8_t* InData, size_t InSize, const std::string& DebugName);
+
+	vk::Format GetFormat() const { return Format; }
+	uint32_t GetWidth() const { return Width; }
+	uint32_t GetHeight() const { return Height; }
+	uint32_t GetLevelCount() const { return static_cast<uint32_t>(Levels.size()); }
+	uint32_t GetLayerCount() const { return LayerCount; }
+	uint32_t GetFaceCount() const { return FaceCount; }
+	bool IsCubemap() const { return FaceCount == 6; }
+
+	const KTX2Level& GetLevel(uint32_t Level) const { return Levels[Level]; }
+	const uint8_t* GetLevelData(uint32_t Level) const { return Data + Levels[Level].ByteOffset; }
+
+	//Whole container, either the file mapping or the memory passed to Open
+	const uint8_t* GetData() const { return Data; }
+	size_t GetSize() const { return Size; }
+
+	//File byte range holding levels [BaseLevel, LevelCount). Levels are stored smallest first,
+	//so any mip tail is one contiguous block, already aligned for copyBufferToImage
+	void GetLevelRange(uint32_t BaseLevel, uint64_t& OutBegin, uint64_t& OutEnd) const;
+
+	//Sum of the level sizes in [BaseLevel, LevelCount)
+	uint64_t GetLevelChainSize(uint32_t BaseLevel) const;
+
+protected:
+
+	void Parse(const std::string& DebugName);
+
+	MappedFile File;
+	const uint8_t* Data = nullptr;
+	size_t Size = 0;
+
+	vk::Format Format = vk::Format::eUndefined;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t LayerCount = 1; //Always at least 1, KTX2 stores 0 for non-array textures
+	uint32_t FaceCount = 1;
+
+	//Level 0 is the largest mip
+	std::vector<KTX2Level> Levels;
+};
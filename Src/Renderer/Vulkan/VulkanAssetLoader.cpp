@@ -0,0 +1,302 @@
+#include "VulkanAssetLoader.h"
+
+#include "VulkanContext.h"
+#include "VulkanBuffer.h"
+#include "VulkanCommandBuffer.h"
+#include "VulkanImage.h"
+#include "VulkanRenderItem.hpp"
+#include "KTX2File.h"
+#include "../Core/CookedMesh.h"
+#include "../IO/AssetArchive.h"
+
+#include <stb_image.h>
+
+#include <iostream>
+#include <cstring>
+
+namespace
+{
+	struct StagingBuffer
+	{
+		vk::UniqueBuffer Buffer;
+		vk::UniqueDeviceMemory Memory;
+		uint8_t* MappedMemory = nullptr;
+
+		void Create(vk::DeviceSize Size)
+		{
+			VulkanBufferUtils::CreateBuffer(Size, vk::BufferUsageFlagBits::eTransferSrc,
+				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+				Buffer, Memory);
+			MappedMemory = static_cast<uint8_t*>(VulkanContext::Get()->GetDevice().mapMemory(Memory.get(), 0, Size));
+		}
+
+		void Unmap()
+		{
+			VulkanContext::Get()->GetDevice().unmapMemory(Memory.get());
+			MappedMemory = nullptr;
+		}
+	};
+
+	bool IsKTX2File(const std::string& Filename)
+	{
+		const size_t Pos = Filename.rfind('.');
+		return Pos != std::string::npos && Filename.compare(Pos, std::string::npos, ".ktx2") == 0;
+	}
+}
+
+VulkanAssetLoader::VulkanAssetLoader()
+{
+
+}
+
+void VulkanAssetLoader::ReadAwaiter::await_suspend(std::coroutine_handle<> Handle)
+{
+	const AssetArchiveEntry* Entry = Loader->Archive ? Loader->Archive->Find(Filename) : nullptr;
+	if (Entry)
+	{
+		JobSystem::Get()->Schedule([this, Entry, Handle]()
+		{
+			Loader->ReadFromArchive(*Entry, Result);
+			Handle.resume();
+		}, nullptr);
+		return;
+	}
+
+	std::lock_guard<std::mutex> Lock(Loader->Mutex);
+	Loader->QueuedReads.push_back(QueuedRead{ this, Handle });
+}
+
+void VulkanAssetLoader::MainThreadAwaiter::await_suspend(std::coroutine_handle<> Handle)
+{
+	std::lock_guard<std::mutex> Lock(Loader->Mutex);
+	Loader->MainThreadQueue.push_back(Handle);
+}
+
+void VulkanAssetLoader::FenceAwaiter::await_suspend(std::coroutine_handle<> Handle)
+{
+	std::lock_guard<std::mutex> Lock(Loader->Mutex);
+	Loader->QueuedFences.push_back(PendingFence{ Fence, Handle });
+}
+
+void VulkanAssetLoader::Update()
+{
+	std::vector<QueuedRead> Reads;
+	std::vector<std::coroutine_handle<>> Resumes;
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		Reads.swap(QueuedReads);
+		Resumes.swap(MainThreadQueue);
+		PendingFences.insert(PendingFences.end(), QueuedFences.begin(), QueuedFences.end());
+		QueuedFences.clear();
+	}
+
+	//Anything a resumed coroutine queues goes through the mutex and is picked up next Update
+	for (std::coroutine_handle<> Handle : Resumes)
+	{
+		Handle.resume();
+	}
+
+	for (QueuedRead& Read : Reads)
+	{
+		Reader.Read(Read.Awaiter->Filename, [Read](AsyncReadResult& Result)
+		{
+			Read.Awaiter->Result = std::move(Result);
+			Read.Handle.resume();
+		});
+	}
+	Reader.Poll();
+
+	vk::Device Device = VulkanContext::Get()->GetDevice();
+	std::vector<std::coroutine_handle<>> Signaled;
+	for (auto It = PendingFences.begin(); It != PendingFences.end();)
+	{
+		if (Device.getFenceStatus(It->Fence) == vk::Result::eSuccess)
+		{
+			Signaled.push_back(It->Handle);
+			It = PendingFences.erase(It);
+		}
+		else
+		{
+			++It;
+		}
+	}
+
+	for (std::coroutine_handle<> Handle : Signaled)
+	{
+		Handle.resume();
+	}
+}
+
+void VulkanAssetLoader::ReadFromArchive(const AssetArchiveEntry& Entry, AsyncReadResult& Result) const
+{
+	Result.Filename = Archive->GetEntryPath(Entry);
+
+	if (!(Entry.Flags & AssetEntryCompressed))
+	{
+		Result.Data = Archive->GetStoredData(Entry);
+		Result.Size = static_cast<size_t>(Entry.Size);
+		Result.bSucceeded = true;
+		return;
+	}
+
+	std::vector<uint8_t> Data;
+	if (!Archive->Read(Entry, Data))
+	{
+		return;
+	}
+
+	Result.Buffer = AlignedBuffer(Data.size(), AsyncFileReader::Alignment);
+	memcpy(Result.Buffer.GetData(), Data.data(), Data.size());
+	Result.Data = Result.Buffer.GetData();
+	Result.Size = Data.size();
+	Result.bSucceeded = true;
+}
+
+Task<void> VulkanAssetLoader::SubmitUpload(VulkanCommandBuffer& CommandBuffer)
+{
+	vk::Device Device = VulkanContext::Get()->GetDevice();
+
+	CommandBuffer.End();
+	vk::UniqueFence Fence = Device.createFenceUnique(vk::FenceCreateInfo());
+	CommandBuffer.Submit(Fence.get());
+
+	co_await WaitForFence(Fence.get());
+
+	vk::CommandBuffer CommandBufferHandle = CommandBuffer.GetHandle();
+	Device.freeCommandBuffers(VulkanContext::Get()->GetCommandPool(), 1, &CommandBufferHandle);
+}
+
+Task<std::unique_ptr<VulkanImage>> VulkanAssetLoader::LoadTexture(std::string Filename)
+{
+	AsyncReadResult File = co_await ReadFile(Filename);
+	if (!File.bSucceeded)
+	{
+		std::cout << "Failed to read texture: " << Filename << std::endl;
+		throw std::runtime_error("failed to read texture image: " + Filename);
+	}
+
+	//Decode straight into staging on a worker
+	co_await ResumeOn(*JobSystem::Get());
+
+	const bool bKTX2 = IsKTX2File(Filename);
+	StagingBuffer Staging;
+	KTX2File KTX2;
+	int Width = 0, Height = 0;
+
+	if (bKTX2)
+	{
+		KTX2.Open(File.Data, File.Size, Filename);
+
+		vk::FormatProperties FormatProperties = VulkanContext::Get()->GetPhysicalDevice().getFormatProperties(KTX2.GetFormat());
+		if (!(FormatProperties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage))
+		{
+			std::cout << "Unsupported KTX2 format: " << vk::to_string(KTX2.GetFormat()) << std::endl;
+			throw std::runtime_error("KTX2 format not supported by device: " + Filename);
+		}
+
+		uint64_t RangeBegin, RangeEnd;
+		KTX2.GetLevelRange(0, RangeBegin, RangeEnd);
+
+		Staging.Create(RangeEnd - RangeBegin);
+		memcpy(Staging.MappedMemory, KTX2.GetData() + RangeBegin, static_cast<size_t>(RangeEnd - RangeBegin));
+		Staging.Unmap();
+	}
+	else
+	{
+		int Channels;
+		stbi_uc* Pixels = stbi_load_from_memory(File.Data, static_cast<int>(File.Size), &Width, &Height, &Channels, STBI_rgb_alpha);
+		if (!Pixels)
+		{
+			throw std::runtime_error("failed to load texture image: " + Filename);
+		}
+
+		const size_t ImageSize = size_t(Width) * Height * 4;
+		Staging.Create(ImageSize);
+		memcpy(Staging.MappedMemory, Pixels, ImageSize);
+		Staging.Unmap();
+		stbi_image_free(Pixels);
+	}
+
+	//The command pool and queue are only used from the main thread
+	co_await ResumeOnMainThread();
+
+	std::unique_ptr<VulkanImage> Image(new VulkanImage());
+
+	VulkanCommandBuffer CommandBuffer;
+	CommandBuffer.Begin(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+
+	if (bKTX2)
+	{
+		Image->CreateFromKTX2(CommandBuffer, KTX2, 0, Staging.Buffer.get());
+	}
+	else
+	{
+		Image->CreateImage(Width, Height, vk::Format::eR8G8B8A8Unorm, vk::ImageTiling::eOptimal,
+			vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+		vk::BufferImageCopy CopyRegion;
+		CopyRegion.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+		CopyRegion.imageSubresource.mipLevel = 0;
+		CopyRegion.imageSubresource.baseArrayLayer = 0;
+		CopyRegion.imageSubresource.layerCount = 1;
+		CopyRegion.imageOffset = {0,0,0};
+		CopyRegion.imageExtent = {static_cast<uint32_t>(Width), static_cast<uint32_t>(Height), 1};
+
+		Image->TransitionImageLayout(CommandBuffer, vk::ImageLayout::eTransferDstOptimal);
+		Image->CopyBufferToImage(CommandBuffer, Staging.Buffer.get(), std::vector<vk::BufferImageCopy>{CopyRegion});
+		Image->TransitionImageLayout(CommandBuffer, vk::ImageLayout::eShaderReadOnlyOptimal);
+	}
+
+	//Staging stays alive in this frame until the upload has executed
+	co_await SubmitUpload(CommandBuffer);
+
+	co_return std::move(Image);
+}
+
+Task<std::unique_ptr<VulkanRenderItem>> VulkanAssetLoader::LoadMesh(std::string Filename)
+{
+	AsyncReadResult File = co_await ReadFile(Filename);
+	if (!File.bSucceeded)
+	{
+		std::cout << "Failed to read mesh: " << Filename << std::endl;
+		throw std::runtime_error("failed to read mesh: " + Filename);
+	}
+
+	co_await ResumeOn(*JobSystem::Get());
+
+	CookedMeshHeader Header;
+	const uint8_t* VertexData;
+	const uint32_t* IndexData;
+
+	if (!ParseCookedMesh(File.Data, File.Size, Header, VertexData, IndexData) || Header.VertexStride != sizeof(Vertex))
+	{
+		throw std::runtime_error("invalid cooked mesh: " + Filename);
+	}
+
+	//Vertices and indices share one staging buffer
+	const vk::DeviceSize VertexSize = vk::DeviceSize(Header.VertexStride) * Header.VertexCount;
+	const vk::DeviceSize IndexSize = vk::DeviceSize(sizeof(uint32_t)) * Header.IndexCount;
+
+	StagingBuffer Staging;
+	Staging.Create(VertexSize + IndexSize);
+	memcpy(Staging.MappedMemory, VertexData, static_cast<size_t>(VertexSize));
+	memcpy(Staging.MappedMemory + VertexSize, IndexData, static_cast<size_t>(IndexSize));
+	Staging.Unmap();
+
+	VulkanBuffer VertexBuffer(VertexSize, EBufferType::VertexBuffer);
+	VulkanBuffer IndexBuffer(IndexSize, EBufferType::IndexBuffer);
+
+	co_await ResumeOnMainThread();
+
+	VulkanCommandBuffer CommandBuffer;
+	CommandBuffer.Begin(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+
+	vk::BufferCopy VertexCopy(0, 0, VertexSize);
+	CommandBuffer().copyBuffer(Staging.Buffer.get(), VertexBuffer.GetHandle(), 1, &VertexCopy);
+	vk::BufferCopy IndexCopy(VertexSize, 0, IndexSize);
+	CommandBuffer().copyBuffer(Staging.Buffer.get(), IndexBuffer.GetHandle(), 1, &IndexCopy);
+
+	co_await SubmitUpload(CommandBuffer);
+
+	co_return std::unique_ptr<VulkanRenderItem>(new VulkanRenderItem(std::move(VertexBuffer), std::move(IndexBuffer), Header.IndexCount));
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <coroutine>
+
+#include "../Jobs/Task.h"
+#include "../IO/AsyncFileReader.h"
+
+class VulkanImage;
+class VulkanRenderItem;
+class VulkanCommandBuffer;
+class AssetArchive;
+struct AssetArchiveEntry;
+
+//Coroutine based asset loading
+//
+//  std::unique_ptr<VulkanImage> Texture = co_await Loader.LoadTexture(Path);
+//
+//A load reads its file asynchronously, decodes and fills staging on a job system worker, records and
+//submits the upload on the main thread and resumes its awaiter once the upload fence signals. No thread
+//blocks along the way, so a scene can start hundreds of loads and WhenAll them.
+//
+//Update has to be called from the main thread (once per frame) to issue reads and resume coroutines
+//waiting on reads, fences or the main thread. Tasks must finish before the loader is destroyed.
+class VulkanAssetLoader
+{
+public:
+
+	VulkanAssetLoader();
+
+	VulkanAssetLoader(const VulkanAssetLoader&) = delete;
+	VulkanAssetLoader& operator=(const VulkanAssetLoader&) = delete;
+
+	//Filenames found in Archive (archive relative, e.g. "textures/test.ktx2") are read from it instead of from disk.
+	//The archive has to stay open until every load has finished
+	void SetArchive(const AssetArchive* InArchive) { Archive = InArchive; }
+
+	//.ktx2 files are uploaded with their mip chain, anything else is decoded through stb_image
+	Task<std::unique_ptr<VulkanImage>> LoadTexture(std::string Filename);
+
+	//Cooked .smesh files (see ScalpelCook), their vertices must match Vertex
+	Task<std::unique_ptr<VulkanRenderItem>> LoadMesh(std::string Filename);
+
+	//Main thread: starts PendingTask and runs Update until it finishes, for loads that must complete before rendering
+	template<typename T>
+	T Wait(Task<T> PendingTask)
+	{
+		PendingTask.Start();
+		while (!PendingTask.IsReady())
+		{
+			Update();
+			std::this_thread::yield();
+		}
+		return PendingTask.GetResult();
+	}
+
+	void Update();
+
+	//co_await ReadFile(Filename) resumes with the whole file (check bSucceeded), on the main thread.
+	//Archive entries are copied out (and decompressed) on a job system worker and resume there
+	struct ReadAwaiter
+	{
+		VulkanAssetLoader* Loader;
+		std::string Filename;
+		AsyncReadResult Result;
+
+		bool await_ready() { return false; }
+		void await_suspend(std::coroutine_handle<> Handle);
+		AsyncReadResult await_resume() { return std::move(Result); }
+	};
+
+	struct MainThreadAwaiter
+	{
+		VulkanAssetLoader* Loader;
+
+		bool await_ready() { return false; }
+		void await_suspend(std::coroutine_handle<> Handle);
+		void await_resume() {}
+	};
+
+	//Resumes on the main thread once Fence signals
+	struct FenceAwaiter
+	{
+		VulkanAssetLoader* Loader;
+		vk::Fence Fence;
+
+		bool await_ready() { return false; }
+		void await_suspend(std::coroutine_handle<> Handle);
+		void await_resume() {}
+	};
+
+	//Awaitable from any thread
+	ReadAwaiter ReadFile(const std::string& Filename) { return ReadAwaiter{ this, Filename, AsyncReadResult() }; }
+	MainThreadAwaiter ResumeOnMainThread() { return MainThreadAwaiter{ this }; }
+	FenceAwaiter WaitForFence(vk::Fence Fence) { return FenceAwaiter{ this, Fence }; }
+
+protected:
+
+	//Uncompressed entries point straight into the archive's mapping, compressed ones are decompressed into Result.Buffer
+	void ReadFromArchive(const AssetArchiveEntry& Entry, AsyncReadResult& Result) const;
+
+	//Main thread: ends and submits an upload, resumes once the GPU has executed it
+	Task<void> SubmitUpload(VulkanCommandBuffer& CommandBuffer);
+
+	struct QueuedRead
+	{
+		ReadAwaiter* Awaiter;
+		std::coroutine_handle<> Handle;
+	};
+
+	struct PendingFence
+	{
+		vk::Fence Fence;
+		std::coroutine_handle<> Handle;
+	};
+
+	const AssetArchive* Archive = nullptr;
+
+	//Main thread only
+	AsyncFileReader Reader;
+	std::vector<PendingFence> PendingFences;
+
+	//Filled by awaiters on any thread, drained by Update
+	std::mutex Mutex;
+	std::vector<QueuedRead> QueuedReads;
+	std::vector<PendingFence> QueuedFences;
+	std::vector<std::coroutine_handle<>> MainThreadQueue;
+};
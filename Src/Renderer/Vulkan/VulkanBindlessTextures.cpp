@@ -0,0 +1,195 @@
+#include "VulkanBindlessTextures.h"
+
+#include "VulkanContext.h"
+#include "VulkanGraphicsPipeline.h"
+
+#include <algorithm>
+#include <iostream>
+#include <cassert>
+
+void VulkanBindlessTextures::Create(uint32_t InMaxTextures, uint32_t InMaxSamplers)
+{
+	assert(!IsEnabled());
+
+	MaxTextures = InMaxTextures;
+	MaxSamplers = InMaxSamplers;
+
+	const vk::ShaderStageFlags Stages = vk::ShaderStageFlagBits::eAllGraphics | vk::ShaderStageFlagBits::eCompute;
+
+	Bindings.resize(2);
+	Bindings[SamplerBinding].binding = SamplerBinding;
+	Bindings[SamplerBinding].descriptorType = vk::DescriptorType::eSampler;
+	Bindings[SamplerBinding].descriptorCount = MaxSamplers;
+	Bindings[SamplerBinding].stageFlags = Stages;
+	Bindings[TextureBinding].binding = TextureBinding;
+	Bindings[TextureBinding].descriptorType = vk::DescriptorType::eSampledImage;
+	Bindings[TextureBinding].descriptorCount = MaxTextures;
+	Bindings[TextureBinding].stageFlags = Stages;
+
+	//Both tables are written while bound and only partially filled, textures (the last binding) are allocated at MaxTextures
+	const vk::DescriptorBindingFlagsEXT TableFlags = vk::DescriptorBindingFlagBitsEXT::eUpdateAfterBind | vk::DescriptorBindingFlagBitsEXT::ePartiallyBound;
+	std::vector<vk::DescriptorBindingFlagsEXT> BindingFlags = { TableFlags, TableFlags | vk::DescriptorBindingFlagBitsEXT::eVariableDescriptorCount };
+
+	DescriptorSetLayout = VulkanContext::Get()->GetLayoutCache().CreateDescriptorSetLayout(Bindings, BindingFlags, vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPoolEXT);
+
+	std::vector<vk::DescriptorPoolSize> PoolSizes =
+	{
+		vk::DescriptorPoolSize(vk::DescriptorType::eSampler, MaxSamplers),
+		vk::DescriptorPoolSize(vk::DescriptorType::eSampledImage, MaxTextures)
+	};
+
+	vk::DescriptorPoolCreateInfo PoolCreateInfo;
+	PoolCreateInfo.poolSizeCount = static_cast<uint32_t>(PoolSizes.size());
+	PoolCreateInfo.pPoolSizes = PoolSizes.data();
+	PoolCreateInfo.maxSets = 1;
+	PoolCreateInfo.flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBindEXT;
+	DescriptorPool = VulkanContext::Get()->GetDevice().createDescriptorPoolUnique(PoolCreateInfo);
+
+	vk::DescriptorSetVariableDescriptorCountAllocateInfoEXT VariableCountInfo;
+	VariableCountInfo.descriptorSetCount = 1;
+	VariableCountInfo.pDescriptorCounts = &MaxTextures;
+
+	vk::DescriptorSetAllocateInfo AllocInfo;
+	AllocInfo.pNext = &VariableCountInfo;
+	AllocInfo.descriptorPool = DescriptorPool.get();
+	AllocInfo.descriptorSetCount = 1;
+	AllocInfo.pSetLayouts = &DescriptorSetLayout;
+	DescriptorSet = VulkanContext::Get()->GetDevice().allocateDescriptorSets(AllocInfo)[0];
+
+	std::cout << "Bindless textures enabled: " << MaxTextures << " textures, " << MaxSamplers << " samplers" << std::endl;
+}
+
+void VulkanBindlessTextures::Destroy()
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+
+	DescriptorSet = vk::DescriptorSet();
+	DescriptorPool.reset();
+	DescriptorSetLayout = vk::DescriptorSetLayout();
+
+	NextTexture = 0;
+	FreeTextures.clear();
+	Samplers.clear();
+}
+
+uint32_t VulkanBindlessTextures::RegisterTexture(vk::ImageView ImageView, vk::ImageLayout ImageLayout)
+{
+	assert(IsEnabled());
+
+	std::lock_guard<std::mutex> Lock(Mutex);
+
+	uint32_t Index;
+	if (!FreeTextures.empty())
+	{
+		Index = FreeTextures.back();
+		FreeTextures.pop_back();
+	}
+	else if (NextTexture < MaxTextures)
+	{
+		Index = NextTexture++;
+	}
+	else
+	{
+		std::cout << "Bindless texture table full (" << MaxTextures << " textures)" << std::endl;
+		return InvalidIndex;
+	}
+
+	WriteTexture(Index, ImageView, ImageLayout);
+	return Index;
+}
+
+void VulkanBindlessTextures::UpdateTexture(uint32_t Index, vk::ImageView ImageView, vk::ImageLayout ImageLayout)
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	assert(Index < NextTexture);
+	WriteTexture(Index, ImageView, ImageLayout);
+}
+
+void VulkanBindlessTextures::ReleaseTexture(uint32_t Index)
+{
+	if (Index == InvalidIndex)
+	{
+		return;
+	}
+
+	//Draws recorded this frame may still sample the slot
+	VulkanContext::Get()->GetDeletionQueue().Defer([this, Index]()
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		FreeTextures.push_back(Index);
+	});
+}
+
+uint32_t VulkanBindlessTextures::RegisterSampler(vk::Sampler Sampler)
+{
+	assert(IsEnabled());
+
+	std::lock_guard<std::mutex> Lock(Mutex);
+
+	auto Found = std::find(Samplers.begin(), Samplers.end(), Sampler);
+	if (Found != Samplers.end())
+	{
+		return static_cast<uint32_t>(Found - Samplers.begin());
+	}
+
+	if (Samplers.size() >= MaxSamplers)
+	{
+		std::cout << "Bindless sampler table full (" << MaxSamplers << " samplers)" << std::endl;
+		return InvalidIndex;
+	}
+
+	const uint32_t Index = static_cast<uint32_t>(Samplers.size());
+	Samplers.push_back(Sampler);
+
+	vk::DescriptorImageInfo ImageInfo;
+	ImageInfo.sampler = Sampler;
+
+	vk::WriteDescriptorSet Write;
+	Write.dstSet = DescriptorSet;
+	Write.dstBinding = SamplerBinding;
+	Write.dstArrayElement = Index;
+	Write.descriptorType = vk::DescriptorType::eSampler;
+	Write.descriptorCount = 1;
+	Write.pImageInfo = &ImageInfo;
+	VulkanContext::Get()->GetDevice().updateDescriptorSets(1, &Write, 0, nullptr);
+
+	return Index;
+}
+
+void VulkanBindlessTextures::ApplyToPipelineBindings(std::vector<std::vector<vk::DescriptorSetLayoutBinding>>& SetBindings, const std::string& DebugName) const
+{
+	if (SetBindings.size() <= DescriptorSetBindless || SetBindings[DescriptorSetBindless].empty())
+	{
+		return;
+	}
+
+	if (!IsEnabled())
+	{
+		std::cout << DebugName << " samples bindless textures, the device doesn't support descriptor indexing" << std::endl;
+		throw std::runtime_error("bindless textures used by " + DebugName + " aren't supported");
+	}
+
+	SetBindings[DescriptorSetBindless] = Bindings;
+}
+
+uint32_t VulkanBindlessTextures::GetTextureCount()
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	return NextTexture - static_cast<uint32_t>(FreeTextures.size());
+}
+
+void VulkanBindlessTextures::WriteTexture(uint32_t Index, vk::ImageView ImageView, vk::ImageLayout ImageLayout)
+{
+	vk::DescriptorImageInfo ImageInfo;
+	ImageInfo.imageView = ImageView;
+	ImageInfo.imageLayout = ImageLayout;
+
+	vk::WriteDescriptorSet Write;
+	Write.dstSet = DescriptorSet;
+	Write.dstBinding = TextureBinding;
+	Write.dstArrayElement = Index;
+	Write.descriptorType = vk::DescriptorType::eSampledImage;
+	Write.descriptorCount = 1;
+	Write.pImageInfo = &ImageInfo;
+	VulkanContext::Get()->GetDevice().updateDescriptorSets(1, &Write, 0, nullptr);
+}
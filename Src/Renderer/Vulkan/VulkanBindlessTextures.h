@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <cstdint>
+
+//One descriptor set holding every registered texture and sampler, indexed from shaders (VK_EXT_descriptor_indexing)
+//
+//  uint32_t Albedo = Context->GetBindlessTextures().RegisterTexture(Image.GetImageView());
+//  uint32_t Linear = Context->GetBindlessTextures().RegisterSampler(Image.GetSampler());
+//  RenderItem.SetPushConstants(glm::uvec2(Albedo, Linear));
+//
+//Shaders include Bindless.glsl, which declares the table as set 3 (DescriptorSetBindless). The recorder binds it once
+//for every pipeline using it, so draws that only differ in textures no longer need their own descriptor sets.
+//
+//Slots are written as soon as a texture is registered (the set is update-after-bind and partially bound), unused
+//slots stay empty and must not be sampled. Released slots are only reused once the frames referencing them completed.
+class VulkanBindlessTextures
+{
+public:
+
+	//Called by VulkanContext::Startup if the device supports descriptor indexing
+	void Create(uint32_t InMaxTextures, uint32_t InMaxSamplers);
+
+	//Device idle, before the layout cache is cleared
+	void Destroy();
+
+	bool IsEnabled() const { return static_cast<bool>(DescriptorPool); }
+
+	//Returns the index shaders pass to SampleBindless, InvalidIndex if the table is full
+	uint32_t RegisterTexture(vk::ImageView ImageView, vk::ImageLayout ImageLayout = vk::ImageLayout::eShaderReadOnlyOptimal);
+
+	//Points an existing slot at a new view (e.g. more mips streamed in), the old one must outlive the current frame
+	void UpdateTexture(uint32_t Index, vk::ImageView ImageView, vk::ImageLayout ImageLayout = vk::ImageLayout::eShaderReadOnlyOptimal);
+
+	//The slot is reused once the current frame has completed
+	void ReleaseTexture(uint32_t Index);
+
+	//Samplers are deduplicated by handle and stay registered until Destroy
+	uint32_t RegisterSampler(vk::Sampler Sampler);
+
+	vk::DescriptorSet GetDescriptorSet() const { return DescriptorSet; }
+	vk::DescriptorSetLayout GetLayout() const { return DescriptorSetLayout; }
+
+	//What pipelines reflecting set 3 are built with, instead of the runtime sized arrays they declare
+	const std::vector<vk::DescriptorSetLayoutBinding>& GetBindings() const { return Bindings; }
+
+	//Replaces the bindings of DescriptorSetBindless in a reflected pipeline's per set bindings (if it uses the set),
+	//throws if bindless isn't enabled
+	void ApplyToPipelineBindings(std::vector<std::vector<vk::DescriptorSetLayoutBinding>>& SetBindings, const std::string& DebugName) const;
+
+	uint32_t GetMaxTextures() const { return MaxTextures; }
+	uint32_t GetTextureCount();
+
+	static const uint32_t SamplerBinding = 0;
+	static const uint32_t TextureBinding = 1;
+	static const uint32_t InvalidIndex = 0xffffffff;
+
+protected:
+
+	void WriteTexture(uint32_t Index, vk::ImageView ImageView, vk::ImageLayout ImageLayout);
+
+	uint32_t MaxTextures = 0;
+	uint32_t MaxSamplers = 0;
+
+	std::vector<vk::DescriptorSetLayoutBinding> Bindings;
+
+	//Owned by the VulkanLayoutCache
+	vk::DescriptorSetLayout DescriptorSetLayout;
+
+	vk::UniqueDescriptorPool DescriptorPool;
+	vk::DescriptorSet DescriptorSet; //Freed with the pool
+
+	//Guards the slot bookkeeping and descriptor writes, textures can be registered from loader threads
+	std::mutex Mutex;
+
+	uint32_t NextTexture = 0;
+	std::vector<uint32_t> FreeTextures;
+	std::vector<vk::Sampler> Samplers;
+};
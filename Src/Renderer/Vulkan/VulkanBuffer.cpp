@@ -2,18 +2,21 @@
 #include "VulkanContext.h"
 #include "VulkanCommandBuffer.h"
 
-VulkanBuffer::VulkanBuffer(void* Data, vk::DeviceSize DataSize, EBufferType BufferType)
+static vk::BufferUsageFlagBits GetBufferUsage(EBufferType BufferType)
 {
-	vk::BufferUsageFlagBits BufferTypeBit;
 	switch (BufferType)
 	{
 		case EBufferType::VertexBuffer:
-		BufferTypeBit = vk::BufferUsageFlagBits::eVertexBuffer;
-		break;
+		return vk::BufferUsageFlagBits::eVertexBuffer;
 		case EBufferType::IndexBuffer:
-		BufferTypeBit = vk::BufferUsageFlagBits::eIndexBuffer;
-		break;
-	} 
+		return vk::BufferUsageFlagBits::eIndexBuffer;
+	}
+	return vk::BufferUsageFlagBits::eVertexBuffer;
+}
+
+VulkanBuffer::VulkanBuffer(void* Data, vk::DeviceSize DataSize, EBufferType BufferType)
+{
+	vk::BufferUsageFlagBits BufferTypeBit = GetBufferUsage(BufferType);
 
 	vk::Device Device = VulkanContext::Get()->GetDevice();
 
@@ -31,6 +34,11 @@ VulkanBuffer::VulkanBuffer(void* Data, vk::DeviceSize DataSize, EBufferType Buff
 	VulkanBufferUtils::CopyBuffer(StagingBuffer, Buffer, DataSize);
 }
 
+VulkanBuffer::VulkanBuffer(vk::DeviceSize DataSize, EBufferType BufferType)
+{
+	VulkanBufferUtils::CreateBuffer(DataSize, vk::BufferUsageFlagBits::eTransferDst | GetBufferUsage(BufferType), vk::MemoryPropertyFlagBits::eDeviceLocal, Buffer, Memory);
+}
+
 void VulkanBufferUtils::CreateBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vk::UniqueBuffer& OutBuffer, vk::UniqueDeviceMemory& OutMemory)
 {
 	vk::Device Device = VulkanContext::Get()->GetDevice();
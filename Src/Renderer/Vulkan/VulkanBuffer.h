@@ -49,6 +49,8 @@ class VulkanBuffer
 {
 public:
 	VulkanBuffer(void* Data, vk::DeviceSize DataSize, EBufferType BufferType);
+	//Creates the device local buffer without filling it, the caller records the upload (see VulkanAssetLoader)
+	VulkanBuffer(vk::DeviceSize DataSize, EBufferType BufferType);
 	const vk::Buffer GetHandle() { return Buffer.get(); }
 
 protected:
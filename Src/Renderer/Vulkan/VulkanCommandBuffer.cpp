@@ -58,4 +58,13 @@ void VulkanCommandBuffer::SubmitWaitIdle()
 	
 	VulkanContext::Get()->GetGraphicsQueue().submit(1, &SubmitInfo, vk::Fence());
 	VulkanContext::Get()->GetGraphicsQueue().waitIdle();
+}
+
+void VulkanCommandBuffer::Submit(vk::Fence Fence)
+{
+	vk::SubmitInfo SubmitInfo;
+	SubmitInfo.commandBufferCount = 1;
+	SubmitInfo.pCommandBuffers = &CommandBuffer;
+	
+	VulkanContext::Get()->GetGraphicsQueue().submit(1, &SubmitInfo, Fence);
 }
\ No newline at end of file
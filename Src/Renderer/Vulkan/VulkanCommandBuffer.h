@@ -16,8 +16,11 @@ public:
 	//Submits and command buffer to the graphics queue and waits
 	void SubmitWaitIdle();
 
+	//Submits the command buffer to the graphics queue without waiting, Fence is signaled on completion
+	void Submit(vk::Fence Fence);
+
 	//Gets internal command buffer object
-	vk::CommandBuffer GetHandle() {return CommandBuffer;}
+	vk::CommandBuffer& GetHandle() {return CommandBuffer;}
 	vk::CommandBuffer operator()() {return CommandBuffer;}
 
 protected:
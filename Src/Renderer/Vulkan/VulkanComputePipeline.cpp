@@ -0,0 +1,223 @@
+#include "VulkanComputePipeline.h"
+#include <string>
+#include <iostream>
+#include <algorithm>
+
+#include "VulkanContext.h"
+#include "../Core/Hash.h"
+
+void VulkanComputePipeline::BuildPipeline(const std::vector<unsigned int>& ComputeSpirV)
+{
+	std::shared_ptr<const ShaderReflection> Reflection = ShaderReflection::Get(ComputeSpirV);
+	if (!Reflection || Reflection->Stage != static_cast<uint32_t>(vk::ShaderStageFlagBits::eCompute))
+	{
+		std::cout << "Failed to reflect compute shader of " << DebugName << std::endl;
+		throw std::runtime_error("failed to reflect compute shader of " + DebugName);
+	}
+
+	const vk::PhysicalDeviceLimits Limits = VulkanContext::Get()->GetPhysicalDevice().getProperties().limits;
+
+	//Descriptor bindings, by the set they're declared in
+	DescriptorBindings.clear();
+	DescriptorBindingsReflection.clear();
+	for (const ShaderDescriptorBinding& ReflectionDescriptorBinding : Reflection->DescriptorBindings)
+	{
+		if (ReflectionDescriptorBinding.Set >= Limits.maxBoundDescriptorSets)
+		{
+			std::cout << DebugName << " uses descriptor set " << ReflectionDescriptorBinding.Set << ", the device supports " << Limits.maxBoundDescriptorSets << std::endl;
+			throw std::runtime_error("descriptor sets of " + DebugName + " exceed maxBoundDescriptorSets");
+		}
+
+		vk::DescriptorSetLayoutBinding DescriptorBinding;
+		DescriptorBinding.binding = ReflectionDescriptorBinding.Binding;
+		DescriptorBinding.descriptorType = (vk::DescriptorType)ReflectionDescriptorBinding.DescriptorType;
+		DescriptorBinding.descriptorCount = ReflectionDescriptorBinding.Count;
+		DescriptorBinding.stageFlags = vk::ShaderStageFlagBits::eCompute;
+
+		if (DescriptorBindings.size() <= ReflectionDescriptorBinding.Set)
+		{
+			DescriptorBindings.resize(ReflectionDescriptorBinding.Set + 1);
+		}
+		DescriptorBindings[ReflectionDescriptorBinding.Set].push_back(DescriptorBinding);
+
+		DescriptorBindingsReflection.emplace(ReflectionDescriptorBinding.Name, ReflectionDescriptorBinding);
+	}
+
+	//Set 3 is the bindless table (see Bindless.glsl), its layout comes from VulkanBindlessTextures
+	VulkanContext::Get()->GetBindlessTextures().ApplyToPipelineBindings(DescriptorBindings, DebugName);
+
+	PushConstantRange = vk::PushConstantRange();
+	uint32_t PushConstantEnd = 0;
+	for (const ShaderPushConstantRange& Range : Reflection->PushConstantRanges)
+	{
+		PushConstantRange.offset = PushConstantRange.stageFlags ? std::min(PushConstantRange.offset, Range.Offset) : Range.Offset;
+		PushConstantRange.stageFlags = vk::ShaderStageFlagBits::eCompute;
+		PushConstantEnd = std::max(PushConstantEnd, Range.Offset + Range.Size);
+	}
+	PushConstantRange.size = PushConstantEnd - PushConstantRange.offset;
+
+	if (PushConstantEnd > Limits.maxPushConstantsSize)
+	{
+		std::cout << DebugName << " uses " << PushConstantEnd << " bytes of push constants, the device supports " << Limits.maxPushConstantsSize << std::endl;
+		throw std::runtime_error("push constants of " + DebugName + " exceed maxPushConstantsSize");
+	}
+
+	//Workgroup size, components declared with local_size_*_id take their specialized value
+	Specialization.Setup(*Reflection, SpecializationConstants, DebugName);
+
+	uint32_t GroupSize[3];
+	for (uint32_t Axis = 0; Axis < 3; ++Axis)
+	{
+		GroupSize[Axis] = Reflection->WorkgroupSize[Axis];
+
+		const uint32_t ConstantID = Reflection->WorkgroupSizeConstantIDs[Axis];
+		if (ConstantID == ShaderReflection::NoConstantID)
+		{
+			continue;
+		}
+
+		for (const ShaderSpecializationConstant& Constant : Reflection->SpecializationConstants)
+		{
+			if (Constant.ConstantID != ConstantID)
+			{
+				continue;
+			}
+
+			auto Value = SpecializationConstants.find(Constant.Name);
+			if (Constant.Name.empty() || Value == SpecializationConstants.end())
+			{
+				Value = SpecializationConstants.find(std::to_string(ConstantID));
+			}
+			if (Value != SpecializationConstants.end())
+			{
+				GroupSize[Axis] = static_cast<uint32_t>(Value->second.AsUInt());
+			}
+		}
+	}
+	WorkgroupSize = vk::Extent3D(GroupSize[0], GroupSize[1], GroupSize[2]);
+
+	if (GroupSize[0] == 0 || GroupSize[1] == 0 || GroupSize[2] == 0
+		|| GroupSize[0] > Limits.maxComputeWorkGroupSize[0] || GroupSize[1] > Limits.maxComputeWorkGroupSize[1] || GroupSize[2] > Limits.maxComputeWorkGroupSize[2]
+		|| uint64_t(GroupSize[0]) * GroupSize[1] * GroupSize[2] > Limits.maxComputeWorkGroupInvocations)
+	{
+		std::cout << DebugName << " has a workgroup size of " << GroupSize[0] << "x" << GroupSize[1] << "x" << GroupSize[2]
+			<< ", the device supports up to " << Limits.maxComputeWorkGroupInvocations << " invocations" << std::endl;
+		throw std::runtime_error("workgroup size of " + DebugName + " exceeds the device limits");
+	}
+
+	//Shared with every pipeline defining the same bindings and push constants (see VulkanLayoutCache)
+	std::vector<vk::PushConstantRange> PushConstantRanges;
+	if (PushConstantRange.size > 0)
+	{
+		PushConstantRanges.push_back(PushConstantRange);
+	}
+
+	VulkanLayoutCache& LayoutCache = VulkanContext::Get()->GetLayoutCache();
+	DescriptorSetLayouts.clear();
+	for (const std::vector<vk::DescriptorSetLayoutBinding>& SetBindings : DescriptorBindings)
+	{
+		DescriptorSetLayouts.push_back(LayoutCache.GetDescriptorSetLayout(SetBindings));
+	}
+	PipelineLayout = LayoutCache.GetPipelineLayout(DescriptorBindings, PushConstantRanges);
+
+	vk::ShaderModuleCreateInfo ModuleCreateInfo;
+	ModuleCreateInfo.codeSize = ComputeSpirV.size() * sizeof(unsigned int);
+	ModuleCreateInfo.pCode = reinterpret_cast<const uint32_t*>(ComputeSpirV.data());
+	vk::ShaderModule Module = VulkanContext::Get()->GetDevice().createShaderModule(ModuleCreateInfo);
+
+	vk::ComputePipelineCreateInfo CreateInfo;
+	CreateInfo.stage.stage = vk::ShaderStageFlagBits::eCompute;
+	CreateInfo.stage.module = Module;
+	CreateInfo.stage.pName = Reflection->EntryPoint.c_str();
+	CreateInfo.stage.pSpecializationInfo = Specialization.MapEntries.empty() ? nullptr : &Specialization.Info;
+	CreateInfo.layout = PipelineLayout;
+
+	const uint64_t LayoutHash = VulkanPipelineCache::HashPipelineLayout(DescriptorBindings, PushConstantRanges);
+	const uint64_t ShaderHash = HashBytes(ComputeSpirV.data(), ComputeSpirV.size() * sizeof(unsigned int));
+	ComputePipeline = VulkanContext::Get()->GetPipelineCache().GetComputePipeline(CreateInfo, ShaderHash, LayoutHash, DebugName);
+
+	//Done with the shader module
+	VulkanContext::Get()->GetDevice().destroyShaderModule(Module);
+}
+
+DescriptorData VulkanComputePipeline::AllocateDescriptorSets(uint32_t NumSets, uint32_t Set)
+{
+	assert(HasDescriptorSet(Set));
+
+	DescriptorData NewDescriptorData;
+	NewDescriptorData.Pool = CreateDescriptorPool(NumSets, Set);
+
+	std::vector<vk::DescriptorSetLayout> SetLayouts(NumSets, DescriptorSetLayouts[Set]);
+
+	vk::DescriptorSetAllocateInfo DescriptorSetAllocInfo;
+	DescriptorSetAllocInfo.descriptorPool = NewDescriptorData.Pool.get();
+	DescriptorSetAllocInfo.descriptorSetCount = NumSets;
+	DescriptorSetAllocInfo.pSetLayouts = SetLayouts.data();
+
+	NewDescriptorData.Sets = VulkanContext::Get()->GetDevice().allocateDescriptorSetsUnique(DescriptorSetAllocInfo);
+
+	return NewDescriptorData;
+}
+
+vk::UniqueDescriptorPool VulkanComputePipeline::CreateDescriptorPool(uint32_t MaxSets, uint32_t Set)
+{
+	std::vector<vk::DescriptorPoolSize> PoolSizes = {};
+	for (auto& DescriptorBinding : GetDescriptorBindings(Set))
+	{
+		vk::DescriptorPoolSize PoolSize;
+		PoolSize.type = DescriptorBinding.descriptorType;
+		PoolSize.descriptorCount = DescriptorBinding.descriptorCount * MaxSets;
+		PoolSizes.push_back(PoolSize);
+	}
+
+	vk::DescriptorPoolCreateInfo PoolCreateInfo;
+	PoolCreateInfo.poolSizeCount = static_cast<uint32_t>(PoolSizes.size());
+	PoolCreateInfo.pPoolSizes = PoolSizes.data();
+	PoolCreateInfo.maxSets = MaxSets;
+	PoolCreateInfo.flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet;
+
+	return VulkanContext::Get()->GetDevice().createDescriptorPoolUnique(PoolCreateInfo);
+}
+
+void VulkanComputePipeline::Bind(VulkanCommandBuffer& CommandBuffer, vk::DescriptorSet DescriptorSet)
+{
+	assert(GetHandle());
+
+	CommandBuffer().bindPipeline(vk::PipelineBindPoint::eCompute, GetHandle());
+	if (DescriptorSet)
+	{
+		BindDescriptorSet(CommandBuffer, 0, DescriptorSet);
+	}
+}
+
+void VulkanComputePipeline::BindDescriptorSet(VulkanCommandBuffer& CommandBuffer, uint32_t Set, vk::DescriptorSet DescriptorSet)
+{
+	assert(HasDescriptorSet(Set));
+	CommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, GetLayout(), Set, 1, &DescriptorSet, 0, nullptr);
+}
+
+const std::vector<vk::DescriptorSetLayoutBinding>& VulkanComputePipeline::GetDescriptorBindings(uint32_t Set) const
+{
+	static const std::vector<vk::DescriptorSetLayoutBinding> NoBindings;
+	return Set < DescriptorBindings.size() ? DescriptorBindings[Set] : NoBindings;
+}
+
+void VulkanComputePipeline::Dispatch(VulkanCommandBuffer& CommandBuffer, uint32_t ThreadsX, uint32_t ThreadsY, uint32_t ThreadsZ)
+{
+	const uint32_t GroupsX = GetGroupCount(ThreadsX, WorkgroupSize.width);
+	const uint32_t GroupsY = GetGroupCount(ThreadsY, WorkgroupSize.height);
+	const uint32_t GroupsZ = GetGroupCount(ThreadsZ, WorkgroupSize.depth);
+	if (GroupsX == 0 || GroupsY == 0 || GroupsZ == 0)
+	{
+		return;
+	}
+
+	CommandBuffer().dispatch(GroupsX, GroupsY, GroupsZ);
+}
+
+void VulkanComputePipeline::DispatchIndirect(VulkanCommandBuffer& CommandBuffer, vk::Buffer Buffer, vk::DeviceSize Offset)
+{
+	//Offset has to be 4 byte aligned, the buffer needs eIndirectBuffer usage
+	assert(Offset % 4 == 0);
+	CommandBuffer().dispatchIndirect(Buffer, Offset);
+}
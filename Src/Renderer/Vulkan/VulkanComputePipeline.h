@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <vector>
+#include <map>
+#include <memory>
+#include <string>
+#include <cassert>
+#include <type_traits>
+
+#include "VulkanGraphicsPipeline.h"
+#include "VulkanCommandBuffer.h"
+#include "VulkanPipelineCache.h"
+#include "../GLSL/ShaderReflection.h"
+
+//Compute pipeline built from a single .comp module
+//
+//  VulkanComputePipeline Culling;
+//  Culling.SpecializationConstants["0"] = 128; //layout(local_size_x_id = 0)
+//  Culling.BuildPipeline(CompileGLSL(ShaderFile));
+//  ...
+//  Culling.Bind(CommandBuffer, DescriptorSet);
+//  Culling.Dispatch(CommandBuffer, ObjectCount);
+//
+//The descriptor set layouts (one per set the shader declares), push constant range and workgroup size come from the (cached) shader reflection. Layouts
+//come from VulkanLayoutCache, the pipeline is shared through VulkanPipelineCache with every other one built from the same SpirV, constants and layout.
+class VulkanComputePipeline
+{
+public:
+
+	void BuildPipeline(const std::vector<unsigned int>& ComputeSpirV);
+
+	vk::Pipeline GetHandle() { return ComputePipeline ? *ComputePipeline : vk::Pipeline(); }
+	vk::PipelineLayout GetLayout() { return PipelineLayout; }
+
+	//Invocations per workgroup, with local_size_*_id constants specialized
+	const vk::Extent3D& GetWorkgroupSize() const { return WorkgroupSize; }
+
+	//Creates a descriptor pool and allocates NumSets descriptor sets with the layout of Set
+	DescriptorData AllocateDescriptorSets(uint32_t NumSets, uint32_t Set = 0);
+	//Create a descriptor pool used to allocate up to MaxSets descriptor sets with the layout of Set
+	vk::UniqueDescriptorPool CreateDescriptorPool(uint32_t MaxSets, uint32_t Set = 0);
+
+	//Sets the shader declares no bindings in still get an (empty) layout, up to the highest one used
+	uint32_t GetDescriptorSetCount() const { return static_cast<uint32_t>(DescriptorSetLayouts.size()); }
+	bool HasDescriptorSet(uint32_t Set) const { return Set < DescriptorBindings.size() && !DescriptorBindings[Set].empty(); }
+
+	//Empty for sets the shader doesn't use
+	const std::vector<vk::DescriptorSetLayoutBinding>& GetDescriptorBindings(uint32_t Set) const;
+	std::map<std::string, ShaderDescriptorBinding>& GetDescriptorReflection() { return DescriptorBindingsReflection; }
+
+	//Size 0 if the shader declares no push constants
+	const vk::PushConstantRange& GetPushConstantRange() const { return PushConstantRange; }
+
+public: //Recording
+
+	//Binds the pipeline, and DescriptorSet (if given) as set 0
+	void Bind(VulkanCommandBuffer& CommandBuffer, vk::DescriptorSet DescriptorSet = nullptr);
+
+	//Binds DescriptorSet as Set, after Bind
+	void BindDescriptorSet(VulkanCommandBuffer& CommandBuffer, uint32_t Set, vk::DescriptorSet DescriptorSet);
+
+	//Writes Data at Offset of the shader's push_constant block
+	template<typename T>
+	void PushConstants(VulkanCommandBuffer& CommandBuffer, const T& Data, uint32_t Offset = 0)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "push constants are copied byte for byte");
+		static_assert(sizeof(T) % 4 == 0, "push constant sizes have to be a multiple of 4");
+		assert(Offset + sizeof(T) <= PushConstantRange.offset + PushConstantRange.size);
+
+		CommandBuffer().pushConstants(GetLayout(), vk::ShaderStageFlagBits::eCompute, Offset, sizeof(T), &Data);
+	}
+
+	//Enough workgroups to cover ThreadsX * ThreadsY * ThreadsZ invocations, the shader has to bounds check the
+	//invocations past the end of the last group
+	void Dispatch(VulkanCommandBuffer& CommandBuffer, uint32_t ThreadsX, uint32_t ThreadsY = 1, uint32_t ThreadsZ = 1);
+
+	//Group counts read from a VkDispatchIndirectCommand in Buffer, e.g. written by an earlier culling pass
+	void DispatchIndirect(VulkanCommandBuffer& CommandBuffer, vk::Buffer Buffer, vk::DeviceSize Offset = 0);
+
+	static uint32_t GetGroupCount(uint32_t Threads, uint32_t GroupSize) { return (Threads + GroupSize - 1) / GroupSize; }
+
+	//Values by name or by constant_id as a string, the local_size_*_id ones also change GetWorkgroupSize
+	std::map<std::string, SpecializationValue> SpecializationConstants;
+
+	//Shown in VulkanPipelineCache::PrintStats
+	std::string DebugName;
+
+protected:
+
+	//Shared with every other pipeline built from identical state (see VulkanPipelineCache)
+	SharedPipeline ComputePipeline;
+
+	//Shared through VulkanLayoutCache
+	std::vector<vk::DescriptorSetLayout> DescriptorSetLayouts;
+	vk::PipelineLayout PipelineLayout;
+
+	//Indexed by set
+	std::vector<std::vector<vk::DescriptorSetLayoutBinding>> DescriptorBindings;
+	std::map<std::string, ShaderDescriptorBinding> DescriptorBindingsReflection;
+	vk::PushConstantRange PushConstantRange;
+
+	ShaderSpecialization Specialization;
+	vk::Extent3D WorkgroupSize = { 1, 1, 1 };
+};
@@ -2,6 +2,9 @@
 #include <vulkan/vulkan.hpp>
 #include <vector>
 #include <set>
+#include <limits>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <GLFW\glfw3.h>
 
@@ -28,12 +31,30 @@ void VulkanContext::Startup(GLFWwindow* window)
 	CreateGLFWSurface(window);
     CreateDeviceAndQueues();
 	CreateCommandPool();
+	CreateFrameFences();
     Swapchain.Build();
+
+    if (bSupportsBindless)
+    {
+        BindlessTextures.Create(std::min(MaxBindlessTextures, BindlessTextureCount), std::min(MaxBindlessSamplers, BindlessSamplerCount));
+    }
 }
 
 void VulkanContext::Shutdown()
 {
     std::cout << "--- BEGIN VULKAN CONTEXT SHUTDOWN ---" << std::endl;
+    Device.waitIdle();
+    PipelineCache.Save();
+    PipelineCache.Clear();
+    RenderPassCache.Clear();
+    DeletionQueue.Flush();
+    BindlessTextures.Destroy();
+    LayoutCache.Clear();
+    for (vk::Fence Fence : FrameFences)
+    {
+        Device.destroyFence(Fence);
+    }
+    FrameFences.clear();
     Swapchain.~VulkanSwapchain(); // Ensure Swapchain's unique resources are destroyed first
 	Device.destroyCommandPool(CommandPool, nullptr);
     Device.destroy(nullptr);
@@ -65,6 +86,14 @@ void VulkanContext::CreateInstance()
     enabledExtensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
 #endif
 
+    //Needed to query descriptor indexing support on a 1.0 instance, bindless textures are off without it
+    std::vector<const char*> Properties2Extension = { VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME };
+    if (CheckExtensionSupport(Properties2Extension))
+    {
+        enabledExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+        bHasPhysicalDeviceProperties2 = true;
+    }
+
     if (CheckExtensionSupport(enabledExtensions))
     {
         createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());;
@@ -281,6 +310,29 @@ void VulkanContext::CreateDeviceAndQueues()
         VK_KHR_SWAPCHAIN_EXTENSION_NAME
     };
 
+    //Optional: update templates write a descriptor set in one call (see VulkanLayoutCache::UpdateDescriptorSet)
+    bSupportsUpdateTemplates = CheckDeviceExtensionSupport(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+    if (bSupportsUpdateTemplates)
+    {
+        deviceExtensions.push_back(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+    }
+
+    //Optional: descriptor indexing for VulkanBindlessTextures, chained into the create info if supported
+    vk::PhysicalDeviceDescriptorIndexingFeaturesEXT IndexingFeatures;
+    bSupportsBindless = CheckBindlessSupport();
+    if (bSupportsBindless)
+    {
+        deviceExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+        deviceExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+
+        IndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        IndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        IndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+        IndexingFeatures.descriptorBindingVariableDescriptorCount = VK_TRUE;
+        IndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+        DeviceCreateInfo.pNext = &IndexingFeatures;
+    }
+
     DeviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
     DeviceCreateInfo.enabledExtensionCount = static_cast<uint32_t> (deviceExtensions.size());
     
@@ -288,7 +340,14 @@ void VulkanContext::CreateDeviceAndQueues()
     //TODO: There is a duplicate of this struct when checking phys devices, should be shared
     vk::PhysicalDeviceFeatures DeviceFeatures = {};
     DeviceFeatures.samplerAnisotropy = VK_TRUE;
-    DeviceCreateInfo.pEnabledFeatures = &DeviceFeatures;
+
+    //Optional: GPU built draws (VulkanGPUScene) issue one multi-draw-indirect per pipeline and index objects by instance
+    const vk::PhysicalDeviceFeatures SupportedFeatures = PhysicalDevice.getFeatures();
+    DeviceFeatures.multiDrawIndirect = SupportedFeatures.multiDrawIndirect;
+    DeviceFeatures.drawIndirectFirstInstance = SupportedFeatures.drawIndirectFirstInstance;
+    EnabledFeatures = DeviceFeatures;
+
+    DeviceCreateInfo.pEnabledFeatures = &EnabledFeatures;
 
     Device = PhysicalDevice.createDevice(DeviceCreateInfo, nullptr);
 
@@ -296,6 +355,63 @@ void VulkanContext::CreateDeviceAndQueues()
 	PresentQueue = Device.getQueue(PresentQueueIndex, 0);
 }
 
+bool VulkanContext::CheckDeviceExtensionSupport(const char* ExtensionName)
+{
+	std::vector<vk::ExtensionProperties> DeviceExtensions = PhysicalDevice.enumerateDeviceExtensionProperties();
+	return std::find_if(DeviceExtensions.begin(), DeviceExtensions.end(), [&](const vk::ExtensionProperties& Extension)
+	{
+		return strcmp(Extension.extensionName, ExtensionName) == 0;
+	}) != DeviceExtensions.end();
+}
+
+bool VulkanContext::CheckBindlessSupport()
+{
+	if (!bHasPhysicalDeviceProperties2)
+	{
+		return false;
+	}
+
+	if (!CheckDeviceExtensionSupport(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) || !CheckDeviceExtensionSupport(VK_KHR_MAINTENANCE3_EXTENSION_NAME))
+	{
+		std::cout << "VK_EXT_descriptor_indexing not supported, bindless textures disabled" << std::endl;
+		return false;
+	}
+
+	auto GetFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR) vkGetInstanceProcAddr((VkInstance)Instance, "vkGetPhysicalDeviceFeatures2KHR");
+	auto GetProperties2 = (PFN_vkGetPhysicalDeviceProperties2KHR) vkGetInstanceProcAddr((VkInstance)Instance, "vkGetPhysicalDeviceProperties2KHR");
+	if (GetFeatures2 == nullptr || GetProperties2 == nullptr)
+	{
+		return false;
+	}
+
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT IndexingFeatures = {};
+	IndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	VkPhysicalDeviceFeatures2KHR Features2 = {};
+	Features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+	Features2.pNext = &IndexingFeatures;
+	GetFeatures2((VkPhysicalDevice)PhysicalDevice, &Features2);
+
+	//Textures indexed with nonuniformEXT from per-draw data, table updated while bound, unused slots left empty
+	if (!IndexingFeatures.shaderSampledImageArrayNonUniformIndexing || !IndexingFeatures.descriptorBindingSampledImageUpdateAfterBind
+		|| !IndexingFeatures.descriptorBindingPartiallyBound || !IndexingFeatures.descriptorBindingVariableDescriptorCount
+		|| !IndexingFeatures.runtimeDescriptorArray)
+	{
+		std::cout << "Descriptor indexing features missing, bindless textures disabled" << std::endl;
+		return false;
+	}
+
+	VkPhysicalDeviceDescriptorIndexingPropertiesEXT IndexingProperties = {};
+	IndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+	VkPhysicalDeviceProperties2KHR Properties2 = {};
+	Properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+	Properties2.pNext = &IndexingProperties;
+	GetProperties2((VkPhysicalDevice)PhysicalDevice, &Properties2);
+
+	MaxBindlessTextures = std::min(IndexingProperties.maxDescriptorSetUpdateAfterBindSampledImages, IndexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages);
+	MaxBindlessSamplers = std::min(IndexingProperties.maxDescriptorSetUpdateAfterBindSamplers, IndexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers);
+	return true;
+}
+
 void VulkanContext::CreateCommandPool()
 {
 	vk::CommandPoolCreateInfo CreateInfo;
@@ -305,6 +421,41 @@ void VulkanContext::CreateCommandPool()
 	CommandPool = Device.createCommandPool(CreateInfo);
 }
 
+void VulkanContext::CreateFrameFences()
+{
+	//Created signaled so the first BeginFrame on each slot doesn't wait
+	vk::FenceCreateInfo CreateInfo;
+	CreateInfo.flags = vk::FenceCreateFlagBits::eSignaled;
+
+	for (uint32_t i = 0; i < MaxFramesInFlight; ++i)
+	{
+		FrameFences.push_back(Device.createFence(CreateInfo));
+	}
+}
+
+void VulkanContext::BeginFrame()
+{
+	++FrameIndex;
+
+	vk::Fence& Fence = FrameFences[FrameIndex % MaxFramesInFlight];
+	Device.waitForFences(1, &Fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+
+	//Anything released from here on may be referenced by this frame's commands
+	DeletionQueue.SetCurrentFrame(FrameIndex);
+
+	if (FrameIndex >= MaxFramesInFlight)
+	{
+		DeletionQueue.Collect(FrameIndex - MaxFramesInFlight);
+	}
+}
+
+vk::Fence VulkanContext::ResetFrameFence()
+{
+	vk::Fence& Fence = FrameFences[FrameIndex % MaxFramesInFlight];
+	Device.resetFences(1, &Fence);
+	return Fence;
+}
+
 void VulkanContext::CreateGLFWSurface(GLFWwindow* window)
 {
     VkSurfaceKHR tmp;
@@ -2,6 +2,11 @@
 
 #include <vulkan/vulkan.hpp>
 #include "VulkanSwapchain.h"
+#include "VulkanDeletionQueue.h"
+#include "VulkanRenderPassCache.h"
+#include "VulkanPipelineCache.h"
+#include "VulkanLayoutCache.h"
+#include "VulkanBindlessTextures.h"
 
 //Vulkan Renderer Singleton Class
 //Manages long-persisting vulkan data structures
@@ -32,6 +37,15 @@ public:
 	const int GetGraphicsQueueIndex() {return GraphicsQueueIndex;}
 	const int GetPresentQueueIndex()  {return PresentQueueIndex; }
 
+	//Features the device was created with, the optional ones are only on if supported
+	const vk::PhysicalDeviceFeatures& GetEnabledFeatures() const { return EnabledFeatures; }
+
+	//VK_EXT_descriptor_indexing with the features VulkanBindlessTextures needs
+	bool SupportsBindless() const { return bSupportsBindless; }
+
+	//VK_KHR_descriptor_update_template
+	bool SupportsUpdateTemplates() const { return bSupportsUpdateTemplates; }
+
 	//Creates a command pool from which to create command buffers
 	void CreateCommandPool();
 	vk::CommandPool GetCommandPool() {return CommandPool;}
@@ -43,6 +57,38 @@ public:
 	//Swapchain Getter
 	VulkanSwapchain& GetSwapchain() { return Swapchain; }
 
+	//Frames the CPU may record ahead of the GPU
+	//Kept at 1 for now: the main loop updates a single uniform buffer in place and re-records its command buffers
+	static const uint32_t MaxFramesInFlight = 1;
+
+	//Call at the start of every rendered frame: waits until the frame that last used this frame's slot
+	//has completed and destroys whatever was released before it
+	void BeginFrame();
+
+	//Resets and returns the fence to pass to this frame's queue submit
+	vk::Fence ResetFrameFence();
+
+	uint64_t GetFrameIndex() { return FrameIndex; }
+
+	//GPU objects that may still be in use are released here instead of being destroyed in place
+	VulkanDeletionQueue& GetDeletionQueue() { return DeletionQueue; }
+
+	//Render passes and framebuffers shared by every VulkanRenderPass
+	VulkanRenderPassCache& GetRenderPassCache() { return RenderPassCache; }
+
+	//Deduplicated graphics and compute pipelines, backed by a driver pipeline cache saved on Shutdown
+	VulkanPipelineCache& GetPipelineCache() { return PipelineCache; }
+
+	//Descriptor set and pipeline layouts shared by every pipeline that defines them identically
+	VulkanLayoutCache& GetLayoutCache() { return LayoutCache; }
+
+	//Texture table bound as set 3 (DescriptorSetBindless), only created if SupportsBindless
+	VulkanBindlessTextures& GetBindlessTextures() { return BindlessTextures; }
+
+	//Size of the bindless table, clamped to the device limits
+	static const uint32_t BindlessTextureCount = 16384;
+	static const uint32_t BindlessSamplerCount = 64;
+
 	static VulkanContext *Get()
     {
         if (!SingletonPtr)
@@ -68,6 +114,7 @@ protected:
 
     vk::PhysicalDevice PhysicalDevice;
     vk::Device Device;
+    vk::PhysicalDeviceFeatures EnabledFeatures;
 
     vk::Queue GraphicsQueue;
 	int GraphicsQueueIndex = -1;
@@ -81,5 +128,32 @@ protected:
 
 	VulkanSwapchain Swapchain;
 
+	void CreateFrameFences();
+
+	//Signaled once the last frame submitted in each slot has completed
+	std::vector<vk::Fence> FrameFences;
+	uint64_t FrameIndex = 0;
+
+	VulkanDeletionQueue DeletionQueue;
+
+	VulkanRenderPassCache RenderPassCache;
+
+	VulkanPipelineCache PipelineCache;
+
+	VulkanLayoutCache LayoutCache;
+
+	bool CheckDeviceExtensionSupport(const char* ExtensionName);
+
+	//Fills in MaxBindless*, the instance and physical device have to exist
+	bool CheckBindlessSupport();
+
+	bool bHasPhysicalDeviceProperties2 = false;
+	bool bSupportsBindless = false;
+	bool bSupportsUpdateTemplates = false;
+	uint32_t MaxBindlessTextures = 0;
+	uint32_t MaxBindlessSamplers = 0;
+
+	VulkanBindlessTextures BindlessTextures;
+
 	static VulkanContext* SingletonPtr;
 };
\ No newline at end of file
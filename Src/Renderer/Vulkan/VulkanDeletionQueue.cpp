@@ -0,0 +1,62 @@
+#include "VulkanDeletionQueue.h"
+
+#include <algorithm>
+
+VulkanDeletionQueue::~VulkanDeletionQueue()
+{
+	Flush();
+}
+
+void VulkanDeletionQueue::Push(Entry* NewEntry)
+{
+	NewEntry->Frame = CurrentFrame.load(std::memory_order_relaxed);
+	NewEntry->Next = Head.load(std::memory_order_relaxed);
+	while (!Head.compare_exchange_weak(NewEntry->Next, NewEntry, std::memory_order_release, std::memory_order_relaxed))
+	{
+	}
+}
+
+void VulkanDeletionQueue::DrainReleased()
+{
+	Entry* Released = Head.exchange(nullptr, std::memory_order_acquire);
+
+	//The stack is newest first, reverse it so objects are destroyed in the order they were released
+	const size_t FirstNew = Pending.size();
+	for (; Released; Released = Released->Next)
+	{
+		Pending.push_back(Released);
+	}
+	std::reverse(Pending.begin() + FirstNew, Pending.end());
+}
+
+void VulkanDeletionQueue::Collect(uint64_t CompletedFrame)
+{
+	DrainReleased();
+
+	size_t Count = 0;
+	while (Count < Pending.size() && Pending[Count]->Frame <= CompletedFrame)
+	{
+		++Count;
+	}
+
+	//Destructors may release more objects, those land on Head and wait for the next Collect
+	for (size_t i = 0; i < Count; ++i)
+	{
+		delete Pending[i];
+	}
+	Pending.erase(Pending.begin(), Pending.begin() + Count);
+}
+
+void VulkanDeletionQueue::Flush()
+{
+	DrainReleased();
+	while (!Pending.empty())
+	{
+		for (Entry* PendingEntry : Pending)
+		{
+			delete PendingEntry;
+		}
+		Pending.clear();
+		DrainReleased();
+	}
+}
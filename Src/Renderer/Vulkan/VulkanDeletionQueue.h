@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+
+//Defers destruction of GPU objects until the frames that may still reference them have completed
+//
+//  Context->GetDeletionQueue().Release(std::move(OldImage));
+//
+//Release and Defer are lock-free and can be called from any thread. Objects are tagged with the frame
+//that was being recorded when they were released and destroyed by Collect on the main thread, once
+//VulkanContext::BeginFrame has seen that frame's fence signal.
+class VulkanDeletionQueue
+{
+public:
+
+	VulkanDeletionQueue() {}
+	~VulkanDeletionQueue();
+
+	VulkanDeletionQueue(const VulkanDeletionQueue&) = delete;
+	VulkanDeletionQueue& operator=(const VulkanDeletionQueue&) = delete;
+
+	//Takes ownership of Object (pass it with std::move): unique handles, VulkanImage, VulkanBuffer...
+	template<typename T>
+	void Release(T&& Object)
+	{
+		Push(new ObjectEntry<typename std::decay<T>::type>(std::forward<T>(Object)));
+	}
+
+	//Calls Function in place of destroying an object, for handles that aren't owned by a unique wrapper
+	template<typename F>
+	void Defer(F&& Function)
+	{
+		Push(new FunctionEntry<typename std::decay<F>::type>(std::forward<F>(Function)));
+	}
+
+	//Main thread: destroys everything released up to and including CompletedFrame, in release order
+	void Collect(uint64_t CompletedFrame);
+
+	//Main thread, device idle: destroys everything regardless of frame
+	void Flush();
+
+	//Set by VulkanContext::BeginFrame
+	void SetCurrentFrame(uint64_t Frame) { CurrentFrame.store(Frame, std::memory_order_relaxed); }
+
+protected:
+
+	struct Entry
+	{
+		virtual ~Entry() {}
+
+		uint64_t Frame = 0;
+		Entry* Next = nullptr;
+	};
+
+	template<typename T>
+	struct ObjectEntry : Entry
+	{
+		explicit ObjectEntry(T&& InObject) : Object(std::move(InObject)) {}
+		T Object;
+	};
+
+	template<typename F>
+	struct FunctionEntry : Entry
+	{
+		explicit FunctionEntry(F&& InFunction) : Function(std::move(InFunction)) {}
+		~FunctionEntry() { Function(); }
+		F Function;
+	};
+
+	void Push(Entry* NewEntry);
+
+	//Moves everything released so far onto Pending
+	void DrainReleased();
+
+	std::atomic<uint64_t> CurrentFrame{0};
+
+	//Treiber stack, newest first
+	std::atomic<Entry*> Head{nullptr};
+
+	//Main thread only, oldest first (frames never decrease along it)
+	std::vector<Entry*> Pending;
+};
@@ -0,0 +1,298 @@
+#include "VulkanGPUScene.h"
+
+#include "VulkanContext.h"
+
+#include <algorithm>
+#include <limits>
+#include <iostream>
+#include <cstring>
+#include <cassert>
+
+void VulkanGPUScene::Create(const std::vector<unsigned int>& BuildCommandsSpirV, uint32_t InMaxObjects)
+{
+	if (!VulkanContext::Get()->GetEnabledFeatures().drawIndirectFirstInstance)
+	{
+		std::cout << "drawIndirectFirstInstance not supported, GPU built draws can't index their objects" << std::endl;
+		throw std::runtime_error("GPU scene needs drawIndirectFirstInstance");
+	}
+
+	MaxObjects = InMaxObjects;
+
+	vk::Device Device = VulkanContext::Get()->GetDevice();
+
+	VulkanBufferUtils::CreateBuffer(MaxObjects * sizeof(GPUObject), vk::BufferUsageFlagBits::eStorageBuffer,
+		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, ObjectBuffer, ObjectMemory);
+	MappedObjects = Device.mapMemory(ObjectMemory.get(), 0, VK_WHOLE_SIZE);
+
+	VulkanBufferUtils::CreateBuffer(MaxObjects * sizeof(vk::DrawIndexedIndirectCommand), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+		vk::MemoryPropertyFlagBits::eDeviceLocal, DrawCommandBuffer, DrawCommandMemory);
+
+	SceneUniform.reset(new VulkanUniform(sizeof(SceneData)));
+	Update(glm::mat4(1.0f));
+
+	BuildCommands.DebugName = "BuildDrawCommands";
+	BuildCommands.BuildPipeline(BuildCommandsSpirV);
+	BuildCommandsDescriptors = BuildCommands.AllocateDescriptorSets(1);
+}
+
+uint32_t VulkanGPUScene::AddMesh(const std::vector<Vertex>& MeshVertices, const std::vector<uint32_t>& MeshIndices)
+{
+	//Bounding sphere around the center of the mesh's bounds, scaled by the object transform when culling
+	glm::vec3 Min(std::numeric_limits<float>::max());
+	glm::vec3 Max(-std::numeric_limits<float>::max());
+	for (const Vertex& MeshVertex : MeshVertices)
+	{
+		Min = glm::min(Min, MeshVertex.pos);
+		Max = glm::max(Max, MeshVertex.pos);
+	}
+
+	const glm::vec3 Center = MeshVertices.empty() ? glm::vec3(0.0f) : (Min + Max) * 0.5f;
+	float Radius = 0.0f;
+	for (const Vertex& MeshVertex : MeshVertices)
+	{
+		Radius = std::max(Radius, glm::length(MeshVertex.pos - Center));
+	}
+
+	GPUMesh Mesh;
+	Mesh.BoundingSphere = glm::vec4(Center, Radius);
+	Mesh.FirstIndex = static_cast<uint32_t>(Indices.size());
+	Mesh.IndexCount = static_cast<uint32_t>(MeshIndices.size());
+	Mesh.VertexOffset = static_cast<int32_t>(Vertices.size());
+	Mesh.Padding = 0;
+	Meshes.push_back(Mesh);
+
+	Vertices.insert(Vertices.end(), MeshVertices.begin(), MeshVertices.end());
+	Indices.insert(Indices.end(), MeshIndices.begin(), MeshIndices.end());
+
+	return static_cast<uint32_t>(Meshes.size() - 1);
+}
+
+void VulkanGPUScene::UploadGeometry()
+{
+	assert(!Meshes.empty());
+
+	VulkanDeletionQueue& DeletionQueue = VulkanContext::Get()->GetDeletionQueue();
+	DeletionQueue.Release(std::move(VertexBuffer));
+	DeletionQueue.Release(std::move(IndexBuffer));
+	DeletionQueue.Release(std::move(MeshBuffer));
+	DeletionQueue.Release(std::move(MeshMemory));
+
+	VertexBuffer.reset(new VulkanBuffer(Vertices.data(), Vertices.size() * sizeof(Vertex), EBufferType::VertexBuffer));
+	IndexBuffer.reset(new VulkanBuffer(Indices.data(), Indices.size() * sizeof(uint32_t), EBufferType::IndexBuffer));
+
+	const vk::DeviceSize MeshBufferSize = Meshes.size() * sizeof(GPUMesh);
+	VulkanBufferUtils::CreateBuffer(MeshBufferSize, vk::BufferUsageFlagBits::eStorageBuffer,
+		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, MeshBuffer, MeshMemory);
+
+	vk::Device Device = VulkanContext::Get()->GetDevice();
+	void* MappedMeshes = Device.mapMemory(MeshMemory.get(), 0, MeshBufferSize);
+	memcpy(MappedMeshes, Meshes.data(), (size_t) MeshBufferSize);
+	Device.unmapMemory(MeshMemory.get());
+
+	//Binding 2 now points at the new mesh buffer, command buffers using the old set have to be re-recorded
+	vk::DescriptorBufferInfo BufferInfos[] =
+	{
+		SceneUniform->GetDescriptorInfo(),
+		vk::DescriptorBufferInfo(ObjectBuffer.get(), 0, VK_WHOLE_SIZE),
+		vk::DescriptorBufferInfo(MeshBuffer.get(), 0, VK_WHOLE_SIZE),
+		vk::DescriptorBufferInfo(DrawCommandBuffer.get(), 0, VK_WHOLE_SIZE)
+	};
+
+	std::vector<vk::WriteDescriptorSet> DescriptorWrites;
+	for (uint32_t Binding = 0; Binding < 4; ++Binding)
+	{
+		vk::WriteDescriptorSet Write;
+		Write.dstSet = BuildCommandsDescriptors.Sets[0].get();
+		Write.dstBinding = Binding;
+		Write.descriptorType = Binding == 0 ? vk::DescriptorType::eUniformBuffer : vk::DescriptorType::eStorageBuffer;
+		Write.descriptorCount = 1;
+		Write.pBufferInfo = &BufferInfos[Binding];
+		DescriptorWrites.push_back(Write);
+	}
+	Device.updateDescriptorSets(DescriptorWrites, 0);
+
+	bDirty = true;
+}
+
+uint32_t VulkanGPUScene::AddObject(uint32_t Mesh, VulkanGraphicsPipeline* Pipeline, const glm::mat4& Transform, uint32_t TextureIndex, uint32_t SamplerIndex)
+{
+	assert(Mesh < Meshes.size() && Pipeline != nullptr);
+
+	if (Objects.size() >= MaxObjects)
+	{
+		std::cout << "GPU scene full (" << MaxObjects << " objects)" << std::endl;
+		return InvalidObject;
+	}
+
+	const uint32_t Object = static_cast<uint32_t>(Objects.size());
+	Objects.push_back(Pipeline);
+
+	GPUObject& Data = GetMappedObjects()[Object];
+	Data.Model = Transform;
+	Data.Mesh = Mesh;
+	Data.CommandIndex = Object; //Regrouped by AssignCommands before the next draw
+	Data.TextureIndex = TextureIndex;
+	Data.SamplerIndex = SamplerIndex;
+
+	bDirty = true;
+	return Object;
+}
+
+uint32_t VulkanGPUScene::RemoveObject(uint32_t Object)
+{
+	assert(Object < Objects.size());
+
+	const uint32_t Last = static_cast<uint32_t>(Objects.size() - 1);
+	Objects[Object] = Objects[Last];
+	GetMappedObjects()[Object] = GetMappedObjects()[Last];
+	Objects.pop_back();
+
+	bDirty = true;
+	return Last;
+}
+
+void VulkanGPUScene::SetTransform(uint32_t Object, const glm::mat4& Transform)
+{
+	assert(Object < Objects.size());
+	GetMappedObjects()[Object].Model = Transform;
+}
+
+void VulkanGPUScene::SetTextures(uint32_t Object, uint32_t TextureIndex, uint32_t SamplerIndex)
+{
+	assert(Object < Objects.size());
+	GetMappedObjects()[Object].TextureIndex = TextureIndex;
+	GetMappedObjects()[Object].SamplerIndex = SamplerIndex;
+}
+
+void VulkanGPUScene::Update(const glm::mat4& ViewProjection)
+{
+	//Gribb/Hartmann: planes from the rows of the (column major) view projection matrix. The near plane assumes
+	//glm::perspective's [-1,1] depth (GLM_FORCE_DEPTH_ZERO_TO_ONE isn't defined), which for [0,1] projections
+	//only makes culling a little conservative
+	auto Row = [&](int Index) { return glm::vec4(ViewProjection[0][Index], ViewProjection[1][Index], ViewProjection[2][Index], ViewProjection[3][Index]); };
+
+	SceneData Data;
+	Data.FrustumPlanes[0] = Row(3) + Row(0);
+	Data.FrustumPlanes[1] = Row(3) - Row(0);
+	Data.FrustumPlanes[2] = Row(3) + Row(1);
+	Data.FrustumPlanes[3] = Row(3) - Row(1);
+	Data.FrustumPlanes[4] = Row(3) + Row(2);
+	Data.FrustumPlanes[5] = Row(3) - Row(2);
+	for (glm::vec4& Plane : Data.FrustumPlanes)
+	{
+		const float Length = glm::length(glm::vec3(Plane));
+		Plane = Length > 0.0f ? Plane / Length : Plane;
+	}
+
+	//Only changes with a re-record, which is also what changes the dispatch size
+	Data.ObjectCount = static_cast<uint32_t>(Objects.size());
+	Data.Padding[0] = Data.Padding[1] = Data.Padding[2] = 0;
+
+	SceneUniform->UpdateUniformData(&Data, sizeof(SceneData));
+}
+
+void VulkanGPUScene::ReleaseDescriptors()
+{
+	VulkanContext::Get()->GetDeletionQueue().Release(std::move(ObjectDescriptors));
+	ObjectDescriptors.clear();
+}
+
+void VulkanGPUScene::RecordBuildCommands(VulkanCommandBuffer& CommandBuffer)
+{
+	if (Objects.empty() || !VertexBuffer)
+	{
+		return;
+	}
+
+	BuildCommands.Bind(CommandBuffer, BuildCommandsDescriptors.Sets[0].get());
+	BuildCommands.Dispatch(CommandBuffer, static_cast<uint32_t>(Objects.size()));
+
+	//Draw commands are read as indirect arguments by the render pass that follows
+	vk::BufferMemoryBarrier Barrier;
+	Barrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+	Barrier.dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead;
+	Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	Barrier.buffer = DrawCommandBuffer.get();
+	Barrier.offset = 0;
+	Barrier.size = VK_WHOLE_SIZE;
+
+	CommandBuffer().pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect,
+		vk::DependencyFlags(), 0, nullptr, 1, &Barrier, 0, nullptr);
+}
+
+const std::vector<VulkanGPUScene::DrawBucket>& VulkanGPUScene::GetBuckets()
+{
+	if (bDirty)
+	{
+		AssignCommands();
+		bDirty = false;
+	}
+	return Buckets;
+}
+
+void VulkanGPUScene::AssignCommands()
+{
+	//Object order is kept (it's the instance index), only command slots are grouped by pipeline
+	std::vector<uint32_t> Order(Objects.size());
+	for (uint32_t i = 0; i < Order.size(); ++i)
+	{
+		Order[i] = i;
+	}
+	std::stable_sort(Order.begin(), Order.end(), [&](uint32_t A, uint32_t B) { return Objects[A] < Objects[B]; });
+
+	Buckets.clear();
+	for (uint32_t Command = 0; Command < Order.size(); ++Command)
+	{
+		VulkanGraphicsPipeline* Pipeline = Objects[Order[Command]];
+		if (Buckets.empty() || Buckets.back().Pipeline != Pipeline)
+		{
+			DrawBucket Bucket;
+			Bucket.Pipeline = Pipeline;
+			Bucket.FirstCommand = Command;
+			Buckets.push_back(Bucket);
+		}
+		++Buckets.back().CommandCount;
+
+		GetMappedObjects()[Order[Command]].CommandIndex = Command;
+	}
+}
+
+void VulkanGPUScene::AddDrawCommands(VulkanCommandBuffer& CommandBuffer, const DrawBucket& Bucket, VulkanGraphicsPipeline* BoundPipeline, DescriptorBindState& BindState)
+{
+	assert(BoundPipeline != nullptr && BoundPipeline->HasDescriptorSet(DescriptorSetObject));
+	if (!VertexBuffer || Bucket.CommandCount == 0)
+	{
+		return;
+	}
+
+	//[1] Object buffer, allocated against the layout of the pipeline actually bound
+	auto FoundDescriptors = ObjectDescriptors.find(BoundPipeline);
+	if (FoundDescriptors == ObjectDescriptors.end())
+	{
+		FoundDescriptors = ObjectDescriptors.emplace(BoundPipeline, BoundPipeline->AllocateDescriptorSets(1, DescriptorSetObject)).first;
+		BoundPipeline->WriteDescriptorSet(FoundDescriptors->second.Sets[0].get(), DescriptorSetObject, {}, { { "Objects", vk::DescriptorBufferInfo(ObjectBuffer.get(), 0, VK_WHOLE_SIZE) } });
+	}
+	BindState.Bind(CommandBuffer, DescriptorSetObject, FoundDescriptors->second.Sets[0].get());
+
+	//[2] Shared geometry
+	vk::Buffer VertexBuffers[] = { VertexBuffer->GetHandle() };
+	vk::DeviceSize Offsets[] = { 0 };
+	CommandBuffer().bindVertexBuffers(0, 1, VertexBuffers, Offsets);
+	CommandBuffer().bindIndexBuffer(IndexBuffer->GetHandle(), 0, vk::IndexType::eUint32);
+
+	//[3] Every command of the bucket, culled ones have no instances
+	const uint32_t Stride = sizeof(vk::DrawIndexedIndirectCommand);
+	const vk::DeviceSize Offset = Bucket.FirstCommand * Stride;
+	if (VulkanContext::Get()->GetEnabledFeatures().multiDrawIndirect)
+	{
+		CommandBuffer().drawIndexedIndirect(DrawCommandBuffer.get(), Offset, Bucket.CommandCount, Stride);
+	}
+	else
+	{
+		for (uint32_t Command = 0; Command < Bucket.CommandCount; ++Command)
+		{
+			CommandBuffer().drawIndexedIndirect(DrawCommandBuffer.get(), Offset + Command * Stride, 1, Stride);
+		}
+	}
+}
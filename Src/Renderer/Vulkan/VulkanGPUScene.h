@@ -0,0 +1,162 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <map>
+#include <memory>
+
+#include "VulkanBuffer.h"
+#include "VulkanUniform.h"
+#include "VulkanCommandBuffer.h"
+#include "VulkanComputePipeline.h"
+#include "VulkanGraphicsPipeline.h"
+#include "VulkanRenderItem.hpp"
+
+//Per-object data read by BuildDrawCommands.comp and the vertex shader (GPUScene.glsl), std430
+struct GPUObject
+{
+	glm::mat4 Model;
+	uint32_t Mesh;
+	uint32_t CommandIndex;
+	uint32_t TextureIndex;
+	uint32_t SamplerIndex;
+};
+
+struct GPUMesh
+{
+	glm::vec4 BoundingSphere;
+	uint32_t FirstIndex;
+	uint32_t IndexCount;
+	int32_t VertexOffset;
+	uint32_t Padding;
+};
+
+//Objects drawn with GPU built draw commands
+//
+//  Scene.Create(CompileGLSL("shaders/BuildDrawCommands.comp"), 10000);
+//  uint32_t Torus = Scene.AddMesh(TorusVertices, TorusIndices);
+//  Scene.UploadGeometry();
+//  uint32_t Object = Scene.AddObject(Torus, &Pipeline, Transform);
+//  RenderPass.BuildCommandBuffer(Items, FrameDescriptorSet, &Scene);
+//  ...
+//  Scene.RecordBuildCommands(PrimaryCommandBuffer); //Before the render pass
+//  ...
+//  Scene.SetTransform(Object, NewTransform);         //Every frame, after VulkanContext::BeginFrame
+//  Scene.Update(Projection * View);
+//
+//Geometry lives in one shared vertex and index buffer, objects in a storage buffer. A compute pass writes one
+//VkDrawIndexedIndirectCommand per object (culled objects get no instances), grouped by pipeline, and the render pass
+//issues a single multi-draw-indirect per pipeline. Recording cost doesn't depend on the object count, and moving
+//objects doesn't need a re-record: only adding or removing them does (see IsDirty).
+//
+//Pipelines have to use GPUScene.vert's interface: the object buffer as "Objects" in set 2 (DescriptorSetObject),
+//indexed by gl_InstanceIndex. Textures come from the bindless table (TextureIndex, SamplerIndex), which
+//GPUScene.frag samples.
+class VulkanGPUScene
+{
+public:
+
+	//Needs the drawIndirectFirstInstance feature, multiDrawIndirect is optional (one indirect draw per object without it)
+	void Create(const std::vector<unsigned int>& BuildCommandsSpirV, uint32_t InMaxObjects);
+
+	//Appended to the shared geometry, returns the mesh index. Takes effect with the next UploadGeometry
+	uint32_t AddMesh(const std::vector<Vertex>& Vertices, const std::vector<uint32_t>& Indices);
+
+	//Replaces the shared vertex and index buffers (the old ones go through the deletion queue)
+	void UploadGeometry();
+
+	//Returns the object index, InvalidObject if the scene is full. Command buffers have to be re-recorded
+	uint32_t AddObject(uint32_t Mesh, VulkanGraphicsPipeline* Pipeline, const glm::mat4& Transform, uint32_t TextureIndex = 0, uint32_t SamplerIndex = 0);
+
+	//Swaps the last object into Object's place, returns the index it had (now Object) so callers can update handles
+	uint32_t RemoveObject(uint32_t Object);
+
+	//Written straight into the object buffer, no re-record needed
+	void SetTransform(uint32_t Object, const glm::mat4& Transform);
+	void SetTextures(uint32_t Object, uint32_t TextureIndex, uint32_t SamplerIndex);
+
+	//Once per frame: frustum planes for culling
+	void Update(const glm::mat4& ViewProjection);
+
+	//Objects were added or removed since the command buffers were last recorded
+	bool IsDirty() const { return bDirty; }
+
+	uint32_t GetObjectCount() const { return static_cast<uint32_t>(Objects.size()); }
+
+	//Object sets were allocated against the layouts of the pipelines at the time, call after rebuilding them
+	void ReleaseDescriptors();
+
+public: //Recording
+
+	//Compute pass generating this frame's draw commands, recorded into the primary command buffer ahead of the render pass
+	void RecordBuildCommands(VulkanCommandBuffer& CommandBuffer);
+
+	//Objects sharing a pipeline, their commands are contiguous
+	struct DrawBucket
+	{
+		VulkanGraphicsPipeline* Pipeline = nullptr;
+		uint32_t FirstCommand = 0;
+		uint32_t CommandCount = 0;
+	};
+
+	//Pipelines in command order, regroups objects first if they changed
+	const std::vector<DrawBucket>& GetBuckets();
+
+	//Binds the shared geometry and the object set, then draws every command of Bucket.
+	//BoundPipeline is the pipeline actually bound for it (Bucket.Pipeline or its fallback)
+	void AddDrawCommands(VulkanCommandBuffer& CommandBuffer, const DrawBucket& Bucket, VulkanGraphicsPipeline* BoundPipeline, DescriptorBindState& BindState);
+
+	static const uint32_t InvalidObject = 0xffffffff;
+
+protected:
+
+	//Sorts objects by pipeline into Buckets and writes each one's command index
+	void AssignCommands();
+
+	GPUObject* GetMappedObjects() { return static_cast<GPUObject*>(MappedObjects); }
+
+	uint32_t MaxObjects = 0;
+
+	VulkanComputePipeline BuildCommands;
+	DescriptorData BuildCommandsDescriptors;
+
+	//Frustum planes and object count
+	struct SceneData
+	{
+		glm::vec4 FrustumPlanes[6];
+		uint32_t ObjectCount;
+		uint32_t Padding[3];
+	};
+	std::unique_ptr<VulkanUniform> SceneUniform;
+
+	//Host visible and persistently mapped, written in place between BeginFrame and submit
+	vk::UniqueBuffer ObjectBuffer;
+	vk::UniqueDeviceMemory ObjectMemory;
+	void* MappedObjects = nullptr;
+
+	//Written once per UploadGeometry
+	vk::UniqueBuffer MeshBuffer;
+	vk::UniqueDeviceMemory MeshMemory;
+
+	//Written by BuildDrawCommands.comp, read by drawIndexedIndirect
+	vk::UniqueBuffer DrawCommandBuffer;
+	vk::UniqueDeviceMemory DrawCommandMemory;
+
+	//Shared geometry, rebuilt by UploadGeometry
+	std::vector<Vertex> Vertices;
+	std::vector<uint32_t> Indices;
+	std::vector<GPUMesh> Meshes;
+	std::unique_ptr<VulkanBuffer> VertexBuffer;
+	std::unique_ptr<VulkanBuffer> IndexBuffer;
+
+	//CPU copy of which pipeline draws each object, parallel to the object buffer
+	std::vector<VulkanGraphicsPipeline*> Objects;
+
+	std::vector<DrawBucket> Buckets;
+	bool bDirty = false;
+
+	//Object set (set 2) per pipeline, allocated when it's first drawn
+	std::map<VulkanGraphicsPipeline*, DescriptorData> ObjectDescriptors;
+};
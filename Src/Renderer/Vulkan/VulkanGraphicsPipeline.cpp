@@ -3,10 +3,81 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <cassert>
 
 #include "VulkanContext.h"
 #include "VulkanRenderPass.h"
-#include "spirv_reflect.h"
+#include "VulkanPipelineCache.h"
+#include "../Core/Hash.h"
+#include "../GLSL/ShaderReflection.h"
+#include "spirv_reflect.h" //spv_reflect::FormatSize
+
+void ShaderSpecialization::Setup(const ShaderReflection& Reflection, const std::map<std::string, SpecializationValue>& Values, const std::string& DebugName)
+{
+	MapEntries.clear();
+	Data.clear();
+	Info = vk::SpecializationInfo();
+	if (Values.empty())
+	{
+		return;
+	}
+
+	const std::vector<ShaderSpecializationConstant>& Constants = Reflection.SpecializationConstants;
+
+	//Vulkan rejects two map entries for the same constant_id
+	struct GivenValue
+	{
+		const ShaderSpecializationConstant* Constant;
+		const SpecializationValue* Value;
+		bool bByName;
+	};
+	std::map<uint32_t, GivenValue> ValuesByID;
+
+	for (const auto& NameAndValue : Values)
+	{
+		auto Constant = std::find_if(Constants.begin(), Constants.end(), [&](const ShaderSpecializationConstant& Candidate)
+		{
+			return Candidate.Name == NameAndValue.first || std::to_string(Candidate.ConstantID) == NameAndValue.first;
+		});
+
+		if (Constant == Constants.end())
+		{
+			std::cout << "Warning: " << DebugName << " has no specialization constant " << NameAndValue.first << std::endl;
+			continue;
+		}
+
+		const bool bByName = !Constant->Name.empty() && Constant->Name == NameAndValue.first;
+		auto Found = ValuesByID.find(Constant->ConstantID);
+		if (Found != ValuesByID.end())
+		{
+			std::cout << "Warning: " << DebugName << " sets specialization constant " << Constant->ConstantID << " by name and by id, using the named value" << std::endl;
+			if (!bByName)
+			{
+				continue;
+			}
+		}
+		ValuesByID[Constant->ConstantID] = GivenValue{ &*Constant, &NameAndValue.second, bByName };
+	}
+
+	for (const auto& IDAndValue : ValuesByID)
+	{
+		const ShaderSpecializationConstant& Constant = *IDAndValue.second.Constant;
+
+		vk::SpecializationMapEntry Entry;
+		Entry.constantID = Constant.ConstantID;
+		Entry.offset = static_cast<uint32_t>(Data.size());
+		Entry.size = Constant.Size;
+		MapEntries.push_back(Entry);
+
+		Data.resize(Data.size() + Constant.Size);
+		Constant.Encode(*IDAndValue.second.Value, Data.data() + Entry.offset);
+	}
+
+	Info.mapEntryCount = static_cast<uint32_t>(MapEntries.size());
+	Info.pMapEntries = MapEntries.data();
+	Info.dataSize = Data.size();
+	Info.pData = Data.data();
+}
 
 VulkanGraphicsPipeline::VulkanGraphicsPipeline()
 {
@@ -22,15 +93,125 @@ VulkanGraphicsPipeline::VulkanGraphicsPipeline()
 										| vk::ColorComponentFlagBits::eA;
 
 	DepthStencil.depthCompareOp = vk::CompareOp::eLess;
+
+	DynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
 }
 
 VulkanGraphicsPipeline::~VulkanGraphicsPipeline()
 {
-	
+	if (!bBuiltAsync)
+	{
+		return;
+	}
+
+	//The compile job writes into this pipeline. A failed build can only be reported here, destructors don't throw
+	try
+	{
+		JobSystem::Get()->Wait(CompileCounter);
+	}
+	catch (const std::exception& Exception)
+	{
+		std::cout << "Async build of " << DebugName << " failed: " << Exception.what() << std::endl;
+	}
 }
 
 void VulkanGraphicsPipeline::BuildPipeline(VulkanRenderPass& RenderPass, const std::vector<unsigned int>& VertexSpirV, const std::vector<unsigned int>& FragmentSpirV)
+{
+	BeginBuild(RenderPass, VertexSpirV, FragmentSpirV);
+	BuildPipelines({ this });
+}
+
+void VulkanGraphicsPipeline::BuildPipelineAsync(VulkanRenderPass& RenderPass, const std::vector<unsigned int>& VertexSpirV, const std::vector<unsigned int>& FragmentSpirV)
+{
+	BeginBuild(RenderPass, VertexSpirV, FragmentSpirV);
+
+	CompileError.clear();
+	bCompiling.store(true, std::memory_order_release);
+	bCompilePending = true;
+	bBuiltAsync = true;
+
+	JobSystem::Get()->Schedule([this]()
+	{
+		//bCompiling is always cleared, a failed compile (e.g. a hot reloaded shader) would hide this pipeline for good
+		try
+		{
+			BuildPipelines({ this });
+		}
+		catch (const std::exception& Exception)
+		{
+			CompileError = Exception.what();
+
+			for (vk::ShaderModule Module : ShaderModules)
+			{
+				VulkanContext::Get()->GetDevice().destroyShaderModule(Module);
+			}
+			ShaderModules.clear();
+
+			//The previous pipeline stays in use, unless the new shaders changed the layout descriptor sets get allocated against
+			if (GraphicsPipelineLayout != PipelineLayout)
+			{
+				GraphicsPipeline.reset();
+			}
+			std::cout << "Async build of " << DebugName << " failed" << (GraphicsPipeline ? ", keeping the previous pipeline: " : ": ") << CompileError << std::endl;
+		}
+		bCompiling.store(false, std::memory_order_release);
+	}, &CompileCounter);
+}
+
+bool VulkanGraphicsPipeline::PollCompiled()
+{
+	if (!bCompilePending || !IsReady())
+	{
+		return false;
+	}
+
+	bCompilePending = false;
+	return true;
+}
+
+void VulkanGraphicsPipeline::BuildPipelines(const std::vector<VulkanGraphicsPipeline*>& Pipelines, const std::vector<int32_t>& ParentIndices)
+{
+	std::vector<GraphicsPipelineRequest> Requests;
+	for (size_t i = 0; i < Pipelines.size(); ++i)
+	{
+		VulkanGraphicsPipeline* Pipeline = Pipelines[i];
+
+		GraphicsPipelineRequest Request;
+		Request.CreateInfo = &Pipeline->CreateInfo;
+		Request.ShaderHashes = Pipeline->ShaderHashes;
+		Request.LayoutHash = Pipeline->LayoutHash;
+		Request.RenderPassHash = Pipeline->RenderPassHash;
+		Request.DebugName = Pipeline->DebugName;
+		Request.ParentIndex = ParentIndices.empty() ? -1 : ParentIndices[i];
+		Requests.push_back(std::move(Request));
+	}
+
+	//Misses are created with a single createGraphicsPipelines call
+	std::vector<SharedPipeline> Created = VulkanContext::Get()->GetPipelineCache().GetGraphicsPipelines(Requests);
+
+	for (size_t i = 0; i < Pipelines.size(); ++i)
+	{
+		VulkanGraphicsPipeline* Pipeline = Pipelines[i];
+		Pipeline->GraphicsPipeline = std::move(Created[i]);
+		Pipeline->GraphicsPipelineLayout = Pipeline->PipelineLayout;
+
+		//Done with shader modules
+		for (vk::ShaderModule Module : Pipeline->ShaderModules)
+		{
+			VulkanContext::Get()->GetDevice().destroyShaderModule(Module);
+		}
+		Pipeline->ShaderModules.clear();
+	}
+}
+
+void VulkanGraphicsPipeline::BeginBuild(VulkanRenderPass& RenderPass, const std::vector<unsigned int>& VertexSpirV, const std::vector<unsigned int>& FragmentSpirV)
 {	
+	//An async build still compiling uses the state about to be overwritten
+	if (bBuiltAsync)
+	{
+		JobSystem::Get()->Wait(CompileCounter);
+	}
+
 	//Set Width/Height from RenderPass
 	Viewport.width  = (float) RenderPass.GetExtent().width;
 	Viewport.height = (float) RenderPass.GetExtent().height;
@@ -39,14 +220,13 @@ void VulkanGraphicsPipeline::BuildPipeline(VulkanRenderPass& RenderPass, const s
 
 	//Note: Currently Color Blending is effectively disabled when multiple attachments are present
 	ColorBlending.attachmentCount = RenderPass.GetColorAttachmentCount();
-	std::vector<vk::PipelineColorBlendAttachmentState> BlendStates;
 	BlendStates.resize(ColorBlending.attachmentCount);
 	std::fill(BlendStates.begin(), BlendStates.end(), ColorBlendAttachment);
 	ColorBlending.pAttachments = BlendStates.data();
 
 	//TODO: Add additional shader stages
 
-	vk::GraphicsPipelineCreateInfo CreateInfo;
+	CreateInfo = vk::GraphicsPipelineCreateInfo();
 	
 	vk::ShaderModule VertModule = CreateShaderModule(VertexSpirV);
 	vk::PipelineShaderStageCreateInfo VertStageCreateInfo;
@@ -54,35 +234,30 @@ void VulkanGraphicsPipeline::BuildPipeline(VulkanRenderPass& RenderPass, const s
 	VertStageCreateInfo.module = VertModule;
 	VertStageCreateInfo.pName = "main";
 
-	//Use SpirV_Reflect to build up our vertex input information
-	SpvReflectShaderModule VertexShaderReflection;
-	SPV_REFLECT_ASSERT(spvReflectCreateShaderModule(VertexSpirV.size() * sizeof(unsigned int), VertexSpirV.data(), &VertexShaderReflection));
-
-	uint32_t VertexInputCount = 0;
-	SPV_REFLECT_ASSERT(spvReflectEnumerateInputVariables(&VertexShaderReflection, &VertexInputCount, nullptr));
-
-	if (VertexInputCount > 0)
+	//Reflection is cached per SpirV (or cooked next to it), rebuilds don't parse the modules again
+	std::shared_ptr<const ShaderReflection> VertexReflection = ShaderReflection::Get(VertexSpirV);
+	std::shared_ptr<const ShaderReflection> FragmentReflection = ShaderReflection::Get(FragmentSpirV);
+	if (!VertexReflection || !FragmentReflection)
 	{
-		std::vector<SpvReflectInterfaceVariable*> VertexInputs(VertexInputCount);
-		SPV_REFLECT_ASSERT(spvReflectEnumerateInputVariables(&VertexShaderReflection, &VertexInputCount, VertexInputs.data()));
-
-		//TODO: will need to sort by binding THEN location to handle multiple vertex buffers
-		std::sort(std::begin(VertexInputs), std::end(VertexInputs),
-		[](const SpvReflectInterfaceVariable* a, const SpvReflectInterfaceVariable* b) 
-		{
-			return a->location < b->location; 
-		});
+		std::cout << "Failed to reflect shaders of " << DebugName << std::endl;
+		throw std::runtime_error("failed to reflect shaders of " + DebugName);
+	}
 
+	//Vertex inputs are sorted by location
+	//TODO: will need to sort by binding THEN location to handle multiple vertex buffers
+	VertexAttributeBindings.clear();
+	VertexInputBindings.clear();
+	if (!VertexReflection->VertexInputs.empty())
+	{
 		uint32_t CurrentOffset = 0;
 
 		//Individual elements of our vertices
-		VertexAttributeBindings.clear();
-		for (auto& Input : VertexInputs)
+		for (const ShaderVertexInput& Input : VertexReflection->VertexInputs)
 		{
 			vk::VertexInputAttributeDescription Attribute;
 			Attribute.binding = 0; //TODO: Allow multiple vertex buffer bindings
-			Attribute.location = Input->location;
-			Attribute.format   = (vk::Format)Input->format;
+			Attribute.location = Input.Location;
+			Attribute.format   = (vk::Format)Input.Format;
 			Attribute.offset = CurrentOffset;
 
 			VertexAttributeBindings.push_back(Attribute);
@@ -95,15 +270,14 @@ void VulkanGraphicsPipeline::BuildPipeline(VulkanRenderPass& RenderPass, const s
 		VertexBinding.stride = CurrentOffset;
 		VertexBinding.inputRate = vk::VertexInputRate::eVertex;
 
-		VertexInputBindings.clear();
 		VertexInputBindings.push_back(VertexBinding);
+	}
 
-		VertexInput.vertexBindingDescriptionCount = static_cast<uint32_t>(VertexInputBindings.size());
-		VertexInput.pVertexBindingDescriptions = VertexInputBindings.data();
+	VertexInput.vertexBindingDescriptionCount = static_cast<uint32_t>(VertexInputBindings.size());
+	VertexInput.pVertexBindingDescriptions = VertexInputBindings.data();
 
-		VertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(VertexAttributeBindings.size());
-		VertexInput.pVertexAttributeDescriptions = VertexAttributeBindings.data();
-	}
+	VertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(VertexAttributeBindings.size());
+	VertexInput.pVertexAttributeDescriptions = VertexAttributeBindings.data();
 
 	vk::ShaderModule FragModule = CreateShaderModule(FragmentSpirV);
 	vk::PipelineShaderStageCreateInfo FragStageCreateInfo;
@@ -111,81 +285,128 @@ void VulkanGraphicsPipeline::BuildPipeline(VulkanRenderPass& RenderPass, const s
 	FragStageCreateInfo.module = FragModule;
 	FragStageCreateInfo.pName = "main";
 
-	SpvReflectShaderModule FragmentShaderReflection;
-	SPV_REFLECT_ASSERT(spvReflectCreateShaderModule(FragmentSpirV.size() * sizeof(unsigned int), FragmentSpirV.data(), &FragmentShaderReflection));
+	//Looked up by stage so values survive rebuilds (hot reload, render pass changes)
+	Specializations.resize(2);
+	Specializations[0].Setup(*VertexReflection, SpecializationConstants[vk::ShaderStageFlagBits::eVertex], DebugName);
+	Specializations[1].Setup(*FragmentReflection, SpecializationConstants[vk::ShaderStageFlagBits::eFragment], DebugName);
+	VertStageCreateInfo.pSpecializationInfo = Specializations[0].MapEntries.empty() ? nullptr : &Specializations[0].Info;
+	FragStageCreateInfo.pSpecializationInfo = Specializations[1].MapEntries.empty() ? nullptr : &Specializations[1].Info;
 
-	vk::PipelineShaderStageCreateInfo ShaderStages[] = {VertStageCreateInfo, FragStageCreateInfo};
+	ShaderStages = {VertStageCreateInfo, FragStageCreateInfo};
+	ShaderModules = {VertModule, FragModule};
 
 	//Actually hook up Shader Stages
-	CreateInfo.stageCount = 2;
-	CreateInfo.pStages = ShaderStages;
+	CreateInfo.stageCount = static_cast<uint32_t>(ShaderStages.size());
+	CreateInfo.pStages = ShaderStages.data();
 
-	std::map<uint32_t, vk::DescriptorSetLayoutBinding> DescriptorBindingsMap;
+	//Keyed by set, then binding
+	std::map<std::pair<uint32_t, uint32_t>, vk::DescriptorSetLayoutBinding> DescriptorBindingsMap;
 	DescriptorBindingsReflection.clear();
 	
-	//Lambda for building up list of descriptors using its ReflectionModule and ShaderStage
-	auto AddDescriptorBindingsFromShaderStage = [&] (const SpvReflectShaderModule* ShaderReflectionModule, const vk::ShaderStageFlagBits ShaderStage)
+	//Lambda for building up list of descriptors using its reflection and ShaderStage
+	auto AddDescriptorBindingsFromShaderStage = [&] (const ShaderReflection& Reflection, const vk::ShaderStageFlagBits ShaderStage)
 	{
-		uint32_t DescriptorBindingCount = 0;
-		SPV_REFLECT_ASSERT(spvReflectEnumerateDescriptorBindings(ShaderReflectionModule, &DescriptorBindingCount, nullptr));
-
-		std::vector<SpvReflectDescriptorBinding*> ReflectionDescriptorBindings(DescriptorBindingCount);
-		
-		if (DescriptorBindingCount > 0)
+		for (const ShaderDescriptorBinding& ReflectionDescriptorBinding : Reflection.DescriptorBindings)
 		{
-			SPV_REFLECT_ASSERT(spvReflectEnumerateDescriptorBindings(ShaderReflectionModule, &DescriptorBindingCount, ReflectionDescriptorBindings.data()));
-
-			//Sort by binding so we can easily check if the binding has already been added by a previous shader stage
-			std::sort(std::begin(ReflectionDescriptorBindings), std::end(ReflectionDescriptorBindings),
-			[](const SpvReflectDescriptorBinding* a, const SpvReflectDescriptorBinding* b) 
+			const std::pair<uint32_t, uint32_t> SetAndBinding(ReflectionDescriptorBinding.Set, ReflectionDescriptorBinding.Binding);
+			auto ExistingBinding = DescriptorBindingsMap.find(SetAndBinding);
+			if (ExistingBinding != DescriptorBindingsMap.end())
 			{
-				return a->binding < b->binding; 
-			});
-
-			for (auto& ReflectionDescriptorBinding : ReflectionDescriptorBindings)
+				//If this binding already exists (from a previous shader stage), append this ShaderStages flag to it
+				ExistingBinding->second.stageFlags |= ShaderStage;
+			}
+			else //Otherwise a new binding needs to be added
 			{
-					auto& ExistingBinding = DescriptorBindingsMap.find(ReflectionDescriptorBinding->binding);
-					if (ExistingBinding != DescriptorBindingsMap.end())
-					{
-						//If this binding already exists (from a previous shader stage), append this ShaderStages flag to it
-						ExistingBinding->second.stageFlags |= ShaderStage;
-					}
-					else //Otherwise a new binding needs to be added
-					{
-						vk::DescriptorSetLayoutBinding DescriptorBinding = {0};
-						DescriptorBinding.binding = ReflectionDescriptorBinding->binding;
-						DescriptorBinding.descriptorType = (vk::DescriptorType)ReflectionDescriptorBinding->descriptor_type;
-						DescriptorBinding.descriptorCount = 1; //TODO:
-						DescriptorBinding.stageFlags = ShaderStage;
-
-						DescriptorBindingsMap.emplace(DescriptorBinding.binding, DescriptorBinding);
-
-						//Also store our reflection data, keyed by binding name
-						DescriptorBindingsReflection.emplace(std::string(ReflectionDescriptorBinding->name), *ReflectionDescriptorBinding);
-					}
+				vk::DescriptorSetLayoutBinding DescriptorBinding = {0};
+				DescriptorBinding.binding = ReflectionDescriptorBinding.Binding;
+				DescriptorBinding.descriptorType = (vk::DescriptorType)ReflectionDescriptorBinding.DescriptorType;
+				DescriptorBinding.descriptorCount = ReflectionDescriptorBinding.Count;
+				DescriptorBinding.stageFlags = ShaderStage;
+
+				DescriptorBindingsMap.emplace(SetAndBinding, DescriptorBinding);
+
+				//Also store our reflection data, keyed by binding name
+				DescriptorBindingsReflection.emplace(ReflectionDescriptorBinding.Name, ReflectionDescriptorBinding);
 			}
 		}
 	};
 
-	AddDescriptorBindingsFromShaderStage(&VertexShaderReflection,   vk::ShaderStageFlagBits::eVertex);
-	AddDescriptorBindingsFromShaderStage(&FragmentShaderReflection, vk::ShaderStageFlagBits::eFragment);
+	AddDescriptorBindingsFromShaderStage(*VertexReflection,   vk::ShaderStageFlagBits::eVertex);
+	AddDescriptorBindingsFromShaderStage(*FragmentReflection, vk::ShaderStageFlagBits::eFragment);
 	//TODO: Ability to optionally add additonal Shader Stages
 
+	//A single range for all stages: a stage may only appear in one range and pushConstants has to name every stage
+	//whose range overlaps the updated bytes, so one range lets render items push any part of it
+	PushConstantRange = vk::PushConstantRange();
+	uint32_t PushConstantEnd = 0;
+	auto AddPushConstantsFromShaderStage = [&] (const ShaderReflection& Reflection, const vk::ShaderStageFlagBits ShaderStage)
+	{
+		for (const ShaderPushConstantRange& Range : Reflection.PushConstantRanges)
+		{
+			PushConstantRange.offset = PushConstantRange.stageFlags ? std::min(PushConstantRange.offset, Range.Offset) : Range.Offset;
+			PushConstantRange.stageFlags |= ShaderStage;
+			PushConstantEnd = std::max(PushConstantEnd, Range.Offset + Range.Size);
+		}
+	};
+
+	AddPushConstantsFromShaderStage(*VertexReflection,   vk::ShaderStageFlagBits::eVertex);
+	AddPushConstantsFromShaderStage(*FragmentReflection, vk::ShaderStageFlagBits::eFragment);
+	PushConstantRange.size = PushConstantEnd - PushConstantRange.offset;
+
+	const uint32_t MaxPushConstantsSize = VulkanContext::Get()->GetPhysicalDevice().getProperties().limits.maxPushConstantsSize;
+	if (PushConstantEnd > MaxPushConstantsSize)
+	{
+		std::cout << DebugName << " uses " << PushConstantEnd << " bytes of push constants, the device supports " << MaxPushConstantsSize << std::endl;
+		throw std::runtime_error("push constants of " + DebugName + " exceed maxPushConstantsSize");
+	}
+
+	//One binding list per set (GLSL layout(set = N), see EDescriptorSet), sets skipped by the shaders stay empty
 	DescriptorBindings.clear();
 	for (auto& Element : DescriptorBindingsMap)
 	{
-		DescriptorBindings.push_back(std::move(Element.second));
+		const uint32_t Set = Element.first.first;
+		if (Set >= DescriptorBindings.size())
+		{
+			DescriptorBindings.resize(Set + 1);
+		}
+		DescriptorBindings[Set].push_back(std::move(Element.second));
+	}
+
+	const uint32_t MaxBoundDescriptorSets = VulkanContext::Get()->GetPhysicalDevice().getProperties().limits.maxBoundDescriptorSets;
+	if (DescriptorBindings.size() > MaxBoundDescriptorSets)
+	{
+		std::cout << DebugName << " uses " << DescriptorBindings.size() << " descriptor sets, the device supports " << MaxBoundDescriptorSets << std::endl;
+		throw std::runtime_error("descriptor sets of " + DebugName + " exceed maxBoundDescriptorSets");
 	}
 
-	vk::DescriptorSetLayoutCreateInfo DescriptorLayoutCreateInfo;
-	DescriptorLayoutCreateInfo.bindingCount = static_cast<uint32_t>(DescriptorBindings.size());
-	DescriptorLayoutCreateInfo.pBindings = DescriptorBindings.data();
+	//Set 3 is the bindless table (see Bindless.glsl), its layout comes from VulkanBindlessTextures
+	VulkanContext::Get()->GetBindlessTextures().ApplyToPipelineBindings(DescriptorBindings, DebugName);
 
-	/** build our descriptor set layout from the above descriptor set reflection data */
-	DescriptorSetLayout = VulkanContext::Get()->GetDevice().createDescriptorSetLayoutUnique(DescriptorLayoutCreateInfo);
+	//Layouts are shared with every pipeline that defines the same bindings and push constants, which keeps their
+	//descriptor sets compatible. They live as long as the context, rebuilds don't need to release them
+	std::vector<vk::PushConstantRange> PushConstantRanges;
+	if (PushConstantRange.size > 0)
+	{
+		PushConstantRanges.push_back(PushConstantRange);
+	}
 
-	PipelineLayoutCreateInfo.setLayoutCount = 1;
-	PipelineLayoutCreateInfo.pSetLayouts = &(DescriptorSetLayout.get());
+	VulkanLayoutCache& LayoutCache = VulkanContext::Get()->GetLayoutCache();
+	DescriptorSetLayouts.clear();
+	for (const std::vector<vk::DescriptorSetLayoutBinding>& SetBindings : DescriptorBindings)
+	{
+		DescriptorSetLayouts.push_back(LayoutCache.GetDescriptorSetLayout(SetBindings));
+	}
+	PipelineLayout = LayoutCache.GetPipelineLayout(DescriptorBindings, PushConstantRanges);
+
+	//Sets render items write get an update template, the bindless table is written through VulkanBindlessTextures
+	UpdateTemplates.assign(DescriptorBindings.size(), nullptr);
+	for (uint32_t Set = 0; Set < DescriptorBindings.size(); ++Set)
+	{
+		if (HasDescriptorSet(Set) && Set != DescriptorSetBindless)
+		{
+			UpdateTemplates[Set] = &LayoutCache.GetDescriptorUpdateTemplate(DescriptorBindings[Set]);
+		}
+	}
 
 	//Fixed function create infos (these member structs can be set before running "Build Pipeline")
 	CreateInfo.pVertexInputState = &VertexInput;
@@ -209,47 +430,49 @@ void VulkanGraphicsPipeline::BuildPipeline(VulkanRenderPass& RenderPass, const s
 	CreateInfo.pDynamicState = (DynamicStates.size() > 0) ? &DynamicState : nullptr;
 
 	//Pipeline Layout
-	PipelineLayout = VulkanContext::Get()->GetDevice().createPipelineLayoutUnique(PipelineLayoutCreateInfo);
-	CreateInfo.layout = PipelineLayout.get();
+	CreateInfo.layout = PipelineLayout;
 	
 	//Render pass hookup
 	CreateInfo.renderPass = RenderPass.GetHandle();
 	CreateInfo.subpass = 0;
 	
-	GraphicsPipeline = VulkanContext::Get()->GetDevice().createGraphicsPipelineUnique(vk::PipelineCache(), CreateInfo);
-
-	//Done with shader modules
-	VulkanContext::Get()->GetDevice().destroyShaderModule(VertModule);
-	VulkanContext::Get()->GetDevice().destroyShaderModule(FragModule);
-
-	spvReflectDestroyShaderModule(&VertexShaderReflection);
-	spvReflectDestroyShaderModule(&FragmentShaderReflection);
+	//Identical pipelines (same state, SpirV, layout definition and compatible render pass) are only created once
+	ShaderHashes = {
+		HashBytes(VertexSpirV.data(), VertexSpirV.size() * sizeof(unsigned int)),
+		HashBytes(FragmentSpirV.data(), FragmentSpirV.size() * sizeof(unsigned int))
+	};
+	LayoutHash = VulkanPipelineCache::HashPipelineLayout(DescriptorBindings, PushConstantRanges);
+	RenderPassHash = VulkanContext::Get()->GetRenderPassCache().GetCompatibilityHash(CreateInfo.renderPass);
 }
 
-DescriptorData VulkanGraphicsPipeline::AllocateDescriptorSets(uint32_t NumSets)
+DescriptorData VulkanGraphicsPipeline::AllocateDescriptorSets(uint32_t NumSets, uint32_t Set)
 {
+	assert(HasDescriptorSet(Set));
+
 	DescriptorData NewDescriptorData;
 
-	NewDescriptorData.Pool = CreateDescriptorPool(NumSets);
+	NewDescriptorData.Pool = CreateDescriptorPool(NumSets, Set);
+
+	std::vector<vk::DescriptorSetLayout> SetLayouts(NumSets, DescriptorSetLayouts[Set]);
 
 	vk::DescriptorSetAllocateInfo DescriptorSetAllocInfo;
 	DescriptorSetAllocInfo.descriptorPool = NewDescriptorData.Pool.get();
 	DescriptorSetAllocInfo.descriptorSetCount = NumSets;
-	DescriptorSetAllocInfo.pSetLayouts = &(DescriptorSetLayout.get());
+	DescriptorSetAllocInfo.pSetLayouts = SetLayouts.data();
 
 	NewDescriptorData.Sets = VulkanContext::Get()->GetDevice().allocateDescriptorSetsUnique(DescriptorSetAllocInfo);
 
 	return NewDescriptorData;
 }
 
-vk::UniqueDescriptorPool VulkanGraphicsPipeline::CreateDescriptorPool(uint32_t MaxSets)
+vk::UniqueDescriptorPool VulkanGraphicsPipeline::CreateDescriptorPool(uint32_t MaxSets, uint32_t Set)
 {
 	std::vector<vk::DescriptorPoolSize> PoolSizes = {};
-	for (auto& DescriptorBinding : DescriptorBindings)
+	for (auto& DescriptorBinding : GetDescriptorBindings(Set))
 	{
 		vk::DescriptorPoolSize PoolSize;
 		PoolSize.type = DescriptorBinding.descriptorType;
-		PoolSize.descriptorCount = DescriptorBinding.descriptorCount;
+		PoolSize.descriptorCount = DescriptorBinding.descriptorCount * MaxSets;
 		PoolSizes.push_back(PoolSize);
 	}
 
@@ -262,6 +485,64 @@ vk::UniqueDescriptorPool VulkanGraphicsPipeline::CreateDescriptorPool(uint32_t M
 	return VulkanContext::Get()->GetDevice().createDescriptorPoolUnique(PoolCreateInfo);
 }
 
+const std::vector<vk::DescriptorSetLayoutBinding>& VulkanGraphicsPipeline::GetDescriptorBindings(uint32_t Set) const
+{
+	static const std::vector<vk::DescriptorSetLayoutBinding> NoBindings;
+	return (Set < DescriptorBindings.size()) ? DescriptorBindings[Set] : NoBindings;
+}
+
+void VulkanGraphicsPipeline::FillDescriptorSlots(uint32_t Set, const std::map<std::string, vk::DescriptorImageInfo>& Images, const std::map<std::string, vk::DescriptorBufferInfo>& Buffers, std::vector<DescriptorUpdateSlot>& Slots) const
+{
+	const DescriptorUpdateTemplate* Template = GetUpdateTemplate(Set);
+	assert(Template != nullptr);
+
+	//Keeps the capacity, refilling an item's slots doesn't allocate
+	Slots.assign(Template->SlotCount, DescriptorUpdateSlot());
+
+	//Resources are matched to bindings by name, the ones belonging to other sets are skipped
+	auto FindSlot = [&](const std::string& Name) -> DescriptorUpdateSlot*
+	{
+		auto BindingReflection = DescriptorBindingsReflection.find(Name);
+		if (BindingReflection == DescriptorBindingsReflection.end() || BindingReflection->second.Set != Set)
+		{
+			return nullptr;
+		}
+
+		const uint32_t Slot = Template->GetFirstSlot(BindingReflection->second.Binding);
+		return Slot != DescriptorUpdateTemplate::NoSlot ? &Slots[Slot] : nullptr;
+	};
+
+	for (auto& Image : Images)
+	{
+		if (DescriptorUpdateSlot* Slot = FindSlot(Image.first))
+		{
+			Slot->Image = Image.second;
+		}
+	}
+	for (auto& Buffer : Buffers)
+	{
+		if (DescriptorUpdateSlot* Slot = FindSlot(Buffer.first))
+		{
+			Slot->Buffer = Buffer.second;
+		}
+	}
+}
+
+void VulkanGraphicsPipeline::UpdateDescriptorSet(vk::DescriptorSet DescriptorSet, uint32_t Set, const std::vector<DescriptorUpdateSlot>& Slots) const
+{
+	const DescriptorUpdateTemplate* Template = GetUpdateTemplate(Set);
+	assert(Template != nullptr && Slots.size() == Template->SlotCount);
+
+	VulkanContext::Get()->GetLayoutCache().UpdateDescriptorSet(DescriptorSet, *Template, Slots.data());
+}
+
+void VulkanGraphicsPipeline::WriteDescriptorSet(vk::DescriptorSet DescriptorSet, uint32_t Set, const std::map<std::string, vk::DescriptorImageInfo>& Images, const std::map<std::string, vk::DescriptorBufferInfo>& Buffers) const
+{
+	std::vector<DescriptorUpdateSlot> Slots;
+	FillDescriptorSlots(Set, Images, Buffers, Slots);
+	UpdateDescriptorSet(DescriptorSet, Set, Slots);
+}
+
 std::vector<char> VulkanGraphicsPipeline::LoadShaderFromFile(const std::string& filename)
 {
 	std::ifstream file(filename, std::ios::ate | std::ios::binary);
@@ -3,8 +3,24 @@
 #include <vulkan/vulkan.hpp>
 #include <vector>
 #include <map>
-
-class std::string;
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <atomic>
+
+#include "../Jobs/JobSystem.h"
+#include "../GLSL/ShaderReflection.h"
+#include "VulkanLayoutCache.h"
+
+//Descriptor sets by how often they change, matching GLSL layout(set = N) in shaders:
+//frame globals (camera) are bound once per frame, materials when they change, objects per draw
+enum EDescriptorSet : uint32_t
+{
+	DescriptorSetFrame = 0,
+	DescriptorSetMaterial = 1,
+	DescriptorSetObject = 2,
+	DescriptorSetBindless = 3 //VulkanBindlessTextures, bound once per command buffer like the frame set
+};
 
 struct DescriptorData
 {
@@ -12,6 +28,19 @@ struct DescriptorData
 	std::vector<vk::UniqueDescriptorSet> Sets;
 };
 
+//Specialization info of one shader stage, kept alive until the pipeline is created
+struct ShaderSpecialization
+{
+	std::vector<vk::SpecializationMapEntry> MapEntries;
+	std::vector<uint8_t> Data;
+	vk::SpecializationInfo Info;
+
+	//Fills this with the values given for constants the module declares (by name or constant_id as a string), in
+	//the types it declares them with. Unknown names are reported and skipped, a constant given both by name and
+	//by constant_id gets one entry (the name wins)
+	void Setup(const ShaderReflection& Reflection, const std::map<std::string, SpecializationValue>& Values, const std::string& DebugName);
+};
+
 class VulkanGraphicsPipeline
 {
 public:
@@ -20,17 +49,68 @@ public:
 	~VulkanGraphicsPipeline();
 	
 	void BuildPipeline(class VulkanRenderPass& RenderPass,const std::vector<unsigned int>& VertexSpirV, const std::vector<unsigned int>& FragmentSpirV);
-	vk::Pipeline GetHandle() { return GraphicsPipeline.get(); }
-	vk::PipelineLayout GetLayout() { return PipelineLayout.get(); }
 
-	//Creates a descriptor pool and allocates descriptor sets for the entirety of this Pipeline's descriptor bindings
-	DescriptorData AllocateDescriptorSets(uint32_t NumSets);
-	//Create a descriptor pool used to allocate up to MaxSets descriptor sets
-	vk::UniqueDescriptorPool CreateDescriptorPool(uint32_t MaxSets);
+	//Batched building: BeginBuild reflects the shaders and sets up layouts and the create info of each pipeline,
+	//BuildPipelines then creates all of them at once. A pipeline whose ParentIndices entry names an earlier one
+	//in the batch is created as its derivative (empty ParentIndices: no derivatives)
+	void BeginBuild(class VulkanRenderPass& RenderPass, const std::vector<unsigned int>& VertexSpirV, const std::vector<unsigned int>& FragmentSpirV);
+	static void BuildPipelines(const std::vector<VulkanGraphicsPipeline*>& Pipelines, const std::vector<int32_t>& ParentIndices = {});
+
+	//Like BuildPipeline, but the driver compile runs on a job system worker. Reflection and layouts are still
+	//set up on the calling thread, GetHandle is null until the compile finishes
+	void BuildPipelineAsync(class VulkanRenderPass& RenderPass, const std::vector<unsigned int>& VertexSpirV, const std::vector<unsigned int>& FragmentSpirV);
+
+	//False while an async build is compiling
+	bool IsReady() const { return !bCompiling.load(std::memory_order_acquire); }
+
+	//True once after an async build finished or failed, command buffers recorded while it compiled need re-recording
+	bool PollCompiled();
+
+	//Why the last async build failed, empty if it succeeded. Only valid while IsReady. A failed build keeps
+	//drawing with the previous pipeline if the layout didn't change, with none (or the fallback) otherwise
+	const std::string& GetCompileError() const { return CompileError; }
+
+	//Drawn with instead while this pipeline compiles, draws are skipped without one. Its pipeline layout has to
+	//be defined identically, draws still bind descriptor sets allocated from this pipeline
+	void SetFallback(VulkanGraphicsPipeline* InFallback) { Fallback = InFallback; }
+	VulkanGraphicsPipeline* GetFallback() { return Fallback; }
+
+	vk::Pipeline GetHandle() { return (IsReady() && GraphicsPipeline) ? *GraphicsPipeline : vk::Pipeline(); }
+	vk::PipelineLayout GetLayout() { return PipelineLayout; }
+
+	bool HasDynamicState(vk::DynamicState State) const { return std::find(DynamicStates.begin(), DynamicStates.end(), State) != DynamicStates.end(); }
+
+	//Viewport or scissor aren't dynamic (e.g. turned off in a pipeline's JSON), the pipeline has to be rebuilt whenever
+	//the extent of its render pass changes
+	bool BakesExtent() const { return !HasDynamicState(vk::DynamicState::eViewport) || !HasDynamicState(vk::DynamicState::eScissor); }
+
+	//Creates a descriptor pool and allocates NumSets descriptor sets for the bindings of set Set
+	DescriptorData AllocateDescriptorSets(uint32_t NumSets, uint32_t Set = DescriptorSetFrame);
+	//Create a descriptor pool used to allocate up to MaxSets descriptor sets of set Set
+	vk::UniqueDescriptorPool CreateDescriptorPool(uint32_t MaxSets, uint32_t Set = DescriptorSetFrame);
+
+	//Writes the resources whose names match bindings of set Set into DescriptorSet, the others are skipped
+	void WriteDescriptorSet(vk::DescriptorSet DescriptorSet, uint32_t Set, const std::map<std::string, vk::DescriptorImageInfo>& Images, const std::map<std::string, vk::DescriptorBufferInfo>& Buffers) const;
+
+	//Same in two steps, for callers that keep Slots around (render items): resources laid out as the update
+	//template of Set reads them, then written with a single template update
+	void FillDescriptorSlots(uint32_t Set, const std::map<std::string, vk::DescriptorImageInfo>& Images, const std::map<std::string, vk::DescriptorBufferInfo>& Buffers, std::vector<DescriptorUpdateSlot>& Slots) const;
+	void UpdateDescriptorSet(vk::DescriptorSet DescriptorSet, uint32_t Set, const std::vector<DescriptorUpdateSlot>& Slots) const;
+
+	//Shared through VulkanLayoutCache, null for sets without bindings and the bindless set
+	const DescriptorUpdateTemplate* GetUpdateTemplate(uint32_t Set) const { return Set < UpdateTemplates.size() ? UpdateTemplates[Set] : nullptr; }
+
+	//Sets are numbered up to the highest one the shaders use, those in between may have no bindings
+	uint32_t GetDescriptorSetCount() const { return static_cast<uint32_t>(DescriptorBindings.size()); }
+	bool HasDescriptorSet(uint32_t Set) const { return Set < DescriptorBindings.size() && !DescriptorBindings[Set].empty(); }
+	const std::vector<vk::DescriptorSetLayout>& GetDescriptorSetLayouts() const { return DescriptorSetLayouts; }
 
 	//TODO: Store all of this in one data structure
-	std::vector<vk::DescriptorSetLayoutBinding>& GetDescriptorBindings() { return DescriptorBindings; }
-	std::map<std::string, struct SpvReflectDescriptorBinding>& GetDescriptorReflection() { return DescriptorBindingsReflection; }
+	const std::vector<vk::DescriptorSetLayoutBinding>& GetDescriptorBindings(uint32_t Set) const;
+	std::map<std::string, ShaderDescriptorBinding>& GetDescriptorReflection() { return DescriptorBindingsReflection; }
+
+	//Push constant blocks of every stage merged into one range, size 0 if the shaders declare none
+	const vk::PushConstantRange& GetPushConstantRange() const { return PushConstantRange; }
 
 public: //Shader Stage Functions
 
@@ -49,6 +129,7 @@ public://Fixed Function Pipeline State
 
 	vk::PipelineTessellationStateCreateInfo Tessellation;
 	
+	//Only baked in if viewport/scissor are removed from DynamicStates, the render pass sets them otherwise
 	vk::PipelineViewportStateCreateInfo ViewportState;
 	vk::Viewport Viewport;
 	vk::Rect2D Scissor;
@@ -62,18 +143,48 @@ public://Fixed Function Pipeline State
 	vk::PipelineColorBlendStateCreateInfo ColorBlending;
 	vk::PipelineColorBlendAttachmentState ColorBlendAttachment;
 
+	//Viewport and scissor by default, so a resize doesn't require rebuilding the pipeline
 	vk::PipelineDynamicStateCreateInfo DynamicState;
 	std::vector<vk::DynamicState> DynamicStates;
 
-	vk::UniqueDescriptorSetLayout DescriptorSetLayout;
+	//Per set, shared through VulkanLayoutCache
+	std::vector<vk::DescriptorSetLayout> DescriptorSetLayouts;
+	std::vector<const DescriptorUpdateTemplate*> UpdateTemplates;
+
+	std::vector<std::vector<vk::DescriptorSetLayoutBinding>> DescriptorBindings;
+	std::map<std::string, ShaderDescriptorBinding> DescriptorBindingsReflection;
+
+	vk::PushConstantRange PushConstantRange;
+	vk::PipelineLayout PipelineLayout;
 
-	std::vector<vk::DescriptorSetLayoutBinding> DescriptorBindings;
-	std::map<std::string, struct SpvReflectDescriptorBinding> DescriptorBindingsReflection;
+	//Specialization constant values per stage, by name or by constant_id as a string (for modules stripped of
+	//names). Types come from reflection, constants left out keep the default the shader declares
+	std::map<vk::ShaderStageFlagBits, std::map<std::string, SpecializationValue>> SpecializationConstants;
 
-	vk::PipelineLayoutCreateInfo PipelineLayoutCreateInfo;
-	vk::UniquePipelineLayout PipelineLayout;
+	//Shown in VulkanPipelineCache::PrintStats
+	std::string DebugName;
 
 protected: //Internal Pipeline Member variables
 
-	vk::UniquePipeline GraphicsPipeline;
+	//Shared with every other pipeline built from identical state (see VulkanPipelineCache)
+	std::shared_ptr<vk::Pipeline> GraphicsPipeline;
+	vk::PipelineLayout GraphicsPipelineLayout; //The layout GraphicsPipeline was created with
+
+	//Between BeginBuild and BuildPipelines
+	vk::GraphicsPipelineCreateInfo CreateInfo;
+	std::vector<vk::PipelineShaderStageCreateInfo> ShaderStages;
+	std::vector<vk::ShaderModule> ShaderModules;
+	std::vector<ShaderSpecialization> Specializations;
+	std::vector<vk::PipelineColorBlendAttachmentState> BlendStates;
+	std::vector<uint64_t> ShaderHashes;
+	uint64_t LayoutHash = 0;
+	uint64_t RenderPassHash = 0;
+
+	//Async building. Only pipelines that were built async wait on CompileCounter, so the others never start the job system
+	bool bBuiltAsync = false;
+	JobCounter CompileCounter;
+	std::atomic<bool> bCompiling{false};
+	std::string CompileError; //Written by the compile job before it clears bCompiling
+	bool bCompilePending = false;
+	VulkanGraphicsPipeline* Fallback = nullptr;
 };
\ No newline at end of file
@@ -5,15 +5,33 @@
 #include "VulkanContext.h"
 #include "VulkanBuffer.h"
 #include "VulkanCommandBuffer.h"
+#include "KTX2File.h"
+#include "../IO/AsyncFileReader.h"
+#include "../Jobs/JobSystem.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 #include <iostream>
+#include <algorithm>
+#include <exception>
+
+static bool IsKTX2File(const std::string& filename)
+{
+    const size_t pos = filename.rfind('.');
+    return pos != std::string::npos && filename.compare(pos, std::string::npos, ".ktx2") == 0;
+}
 
 VulkanImage::VulkanImage(std::string& filename)
 {
-    LoadImageFromFile(filename);
+    if (IsKTX2File(filename))
+    {
+        LoadKTX2FromFile(filename);
+    }
+    else
+    {
+        LoadImageFromFile(filename);
+    }
 }
 
 VulkanImage::VulkanImage(uint32_t Width, uint32_t Height, vk::Format Format, vk::ImageTiling Tiling,
@@ -60,8 +78,259 @@ void VulkanImage::LoadImageFromFile(std::string& filename)
     TransitionImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
 }
 
+std::vector<std::unique_ptr<VulkanImage>> VulkanImage::LoadImagesFromFiles(const std::vector<std::string>& Filenames)
+{
+    struct DecodeSlice
+    {
+        int Width = 0, Height = 0;
+        vk::DeviceSize Offset = 0;
+
+        //Encoded file, kept until its decode job has run
+        AlignedBuffer File;
+        const uint8_t* Data = nullptr;
+        size_t Size = 0;
+    };
+
+    std::vector<std::unique_ptr<VulkanImage>> Images;
+    if (Filenames.empty())
+    {
+        return Images;
+    }
+
+    std::vector<DecodeSlice> Slices(Filenames.size());
+    std::vector<std::exception_ptr> Errors(Filenames.size());
+
+    JobSystem* Jobs = JobSystem::Get();
+    JobCounter DecodeCounter;
+
+    //Decode jobs write into the locals above, so every way out of this function has to wait for the ones already scheduled
+    struct DecodeWaitGuard
+    {
+        JobSystem* Jobs;
+        JobCounter& Counter;
+
+        ~DecodeWaitGuard()
+        {
+            try
+            {
+                Jobs->Wait(Counter);
+            }
+            catch (const std::exception&)
+            {
+                //Decode errors are reported through Errors
+            }
+        }
+    } WaitForDecodes{ Jobs, DecodeCounter };
+
+    //Every file is read asynchronously in one batch, completions only parse the header so the staging
+    //buffer can be sized and sliced before anything is decoded
+    {
+        AsyncFileReader Reader;
+        for (size_t i = 0; i < Filenames.size(); ++i)
+        {
+            Reader.Read(Filenames[i], [&, i](AsyncReadResult& Result)
+            {
+                int Channels;
+                DecodeSlice& Slice = Slices[i];
+                if (!Result.bSucceeded || !stbi_info_from_memory(Result.Data, static_cast<int>(Result.Size), &Slice.Width, &Slice.Height, &Channels))
+                {
+                    std::cout << "Failed to load image data: " << Filenames[i] << std::endl;
+                    Errors[i] = std::make_exception_ptr(std::runtime_error("failed to load texture image: " + Filenames[i]));
+                    return;
+                }
+
+                Slice.File = std::move(Result.Buffer);
+                Slice.Data = Result.Data;
+                Slice.Size = Result.Size;
+            });
+        }
+        Reader.WaitAll();
+    }
+
+    for (std::exception_ptr& Error : Errors)
+    {
+        if (Error)
+        {
+            std::rethrow_exception(Error);
+        }
+    }
+
+    vk::DeviceSize StagingSize = 0;
+    for (DecodeSlice& Slice : Slices)
+    {
+        //16 byte alignment satisfies copyBufferToImage for any 4 byte texel format
+        Slice.Offset = (StagingSize + 15) & ~vk::DeviceSize(15);
+        StagingSize = Slice.Offset + vk::DeviceSize(Slice.Width) * Slice.Height * 4;
+    }
+
+    vk::UniqueBuffer StagingBuffer;
+    vk::UniqueDeviceMemory StagingMemory;
+
+    VulkanBufferUtils::CreateBuffer(StagingSize, vk::BufferUsageFlagBits::eTransferSrc, 
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, 
+        StagingBuffer, StagingMemory);
+
+    vk::Device Device = VulkanContext::Get()->GetDevice();
+    uint8_t* MappedMemory = static_cast<uint8_t*>(Device.mapMemory(StagingMemory.get(), 0, StagingSize));
+
+    //NOTE: stb_image always returns its own allocation, so each job copies the decoded pixels into its slice
+    //      right away; the copies run in parallel and no decoded image outlives its job
+    for (size_t i = 0; i < Slices.size(); ++i)
+    {
+        Jobs->Schedule([&, i]()
+        {
+            DecodeSlice& Slice = Slices[i];
+            int texWidth, texHeight, texChannels;
+            stbi_uc* PixelData = stbi_load_from_memory(Slice.Data, static_cast<int>(Slice.Size), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+
+            if (!PixelData || texWidth != Slice.Width || texHeight != Slice.Height)
+            {
+                stbi_image_free(PixelData);
+                Errors[i] = std::make_exception_ptr(std::runtime_error("failed to load texture image: " + Filenames[i]));
+            }
+            else
+            {
+                memcpy(MappedMemory + Slice.Offset, PixelData, size_t(texWidth) * texHeight * 4);
+                stbi_image_free(PixelData);
+            }
+
+            Slice.File = AlignedBuffer();
+        }, &DecodeCounter);
+    }
+    Jobs->Wait(DecodeCounter);
+
+    Device.unmapMemory(StagingMemory.get());
+
+    for (std::exception_ptr& Error : Errors)
+    {
+        if (Error)
+        {
+            std::rethrow_exception(Error);
+        }
+    }
+
+    //Record every upload into one command buffer
+    VulkanCommandBuffer CommandBuffer;
+    CommandBuffer.Begin(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+
+    for (size_t i = 0; i < Filenames.size(); ++i)
+    {
+        std::unique_ptr<VulkanImage> Image(new VulkanImage());
+        Image->CreateImage(Slices[i].Width, Slices[i].Height, vk::Format::eR8G8B8A8Unorm, vk::ImageTiling::eOptimal,
+            vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+        vk::BufferImageCopy CopyRegion;
+        CopyRegion.bufferOffset = Slices[i].Offset;
+        CopyRegion.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+        CopyRegion.imageSubresource.mipLevel = 0;
+        CopyRegion.imageSubresource.baseArrayLayer = 0;
+        CopyRegion.imageSubresource.layerCount = 1;
+        CopyRegion.imageOffset = {0,0,0};
+        CopyRegion.imageExtent = {static_cast<uint32_t>(Slices[i].Width), static_cast<uint32_t>(Slices[i].Height), 1};
+
+        Image->TransitionImageLayout(CommandBuffer, vk::ImageLayout::eTransferDstOptimal);
+        Image->CopyBufferToImage(CommandBuffer, StagingBuffer.get(), std::vector<vk::BufferImageCopy>{CopyRegion});
+        Image->TransitionImageLayout(CommandBuffer, vk::ImageLayout::eShaderReadOnlyOptimal);
+
+        Images.push_back(std::move(Image));
+    }
+
+    CommandBuffer.End();
+    CommandBuffer.SubmitWaitIdle();
+
+    return Images;
+}
+
+void VulkanImage::LoadKTX2FromFile(std::string& filename)
+{
+    KTX2File File;
+    File.Open(filename);
+    UploadKTX2(File, filename);
+}
+
+void VulkanImage::LoadKTX2FromMemory(const uint8_t* Data, size_t Size, const std::string& DebugName)
+{
+    KTX2File File;
+    File.Open(Data, Size, DebugName);
+    UploadKTX2(File, DebugName);
+}
+
+void VulkanImage::UploadKTX2(const KTX2File& File, const std::string& filename)
+{
+    vk::FormatProperties FormatProperties = VulkanContext::Get()->GetPhysicalDevice().getFormatProperties(File.GetFormat());
+    if (!(FormatProperties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage))
+    {
+        std::cout << "Unsupported KTX2 format: " << vk::to_string(File.GetFormat()) << std::endl;
+        throw std::runtime_error("KTX2 format not supported by device: " + filename);
+    }
+
+    //KTX2 stores levels back to back, each already aligned for copyBufferToImage,
+    //so the whole level range is copied into staging with a single memcpy
+    uint64_t RangeBegin, RangeEnd;
+    File.GetLevelRange(0, RangeBegin, RangeEnd);
+    const vk::DeviceSize StagingSize = RangeEnd - RangeBegin;
+
+    vk::UniqueBuffer StagingBuffer;
+    vk::UniqueDeviceMemory StagingMemory;
+
+    VulkanBufferUtils::CreateBuffer(StagingSize, vk::BufferUsageFlagBits::eTransferSrc, 
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, 
+        StagingBuffer, StagingMemory);
+
+    vk::Device Device = VulkanContext::Get()->GetDevice();
+
+    void* MappedMemory = Device.mapMemory(StagingMemory.get(), 0, StagingSize);
+        memcpy(MappedMemory, File.GetData() + RangeBegin, static_cast<size_t>(StagingSize));
+    Device.unmapMemory(StagingMemory.get());
+
+    VulkanCommandBuffer CommandBuffer;
+    CommandBuffer.Begin(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+    CreateFromKTX2(CommandBuffer, File, 0, StagingBuffer.get());
+    CommandBuffer.End();
+    CommandBuffer.SubmitWaitIdle();
+}
+
+void VulkanImage::CreateFromKTX2(VulkanCommandBuffer& CommandBuffer, const KTX2File& File, uint32_t BaseMip, vk::Buffer StagingBuffer)
+{
+    uint64_t RangeBegin, RangeEnd;
+    File.GetLevelRange(BaseMip, RangeBegin, RangeEnd);
+
+    const uint32_t Width = std::max(File.GetWidth() >> BaseMip, 1u);
+    const uint32_t Height = std::max(File.GetHeight() >> BaseMip, 1u);
+
+    //Cube faces are stored as array layers (layer * 6 + face), which matches the order KTX2 stores them in
+    const uint32_t LayerCount = File.GetLayerCount() * File.GetFaceCount();
+    vk::ImageCreateFlags Flags = File.IsCubemap() ? vk::ImageCreateFlagBits::eCubeCompatible : vk::ImageCreateFlags();
+
+    CreateImage(Width, Height, File.GetFormat(), vk::ImageTiling::eOptimal,
+        vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal,
+        File.GetLevelCount() - BaseMip, LayerCount, Flags);
+
+    //One region per mip level, each covering every layer and face of that level
+    std::vector<vk::BufferImageCopy> Regions;
+    for (uint32_t Level = BaseMip; Level < File.GetLevelCount(); ++Level)
+    {
+        vk::BufferImageCopy Region;
+        Region.bufferOffset = File.GetLevel(Level).ByteOffset - RangeBegin;
+        Region.bufferRowLength = 0;
+        Region.bufferImageHeight = 0;
+        Region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+        Region.imageSubresource.mipLevel = Level - BaseMip;
+        Region.imageSubresource.baseArrayLayer = 0;
+        Region.imageSubresource.layerCount = LayerCount;
+        Region.imageOffset = {0,0,0};
+        Region.imageExtent = {std::max(File.GetWidth() >> Level, 1u), std::max(File.GetHeight() >> Level, 1u), 1};
+        Regions.push_back(Region);
+    }
+
+    TransitionImageLayout(CommandBuffer, vk::ImageLayout::eTransferDstOptimal);
+    CopyBufferToImage(CommandBuffer, StagingBuffer, Regions);
+    TransitionImageLayout(CommandBuffer, vk::ImageLayout::eShaderReadOnlyOptimal);
+}
+
 void VulkanImage::CreateImage(uint32_t Width, uint32_t Height, vk::Format Format, vk::ImageTiling Tiling,
-                                vk::ImageUsageFlags Usage, vk::MemoryPropertyFlags MemoryProperties)
+                                vk::ImageUsageFlags Usage, vk::MemoryPropertyFlags MemoryProperties,
+                                uint32_t InMipLevels, uint32_t InArrayLayers, vk::ImageCreateFlags Flags)
 {
     vk::Device Device = VulkanContext::Get()->GetDevice();
 
@@ -70,8 +339,9 @@ void VulkanImage::CreateImage(uint32_t Width, uint32_t Height, vk::Format Format
     ImageCreateInfo.extent.width = Width;
     ImageCreateInfo.extent.height = Height;
     ImageCreateInfo.extent.depth = 1;
-    ImageCreateInfo.mipLevels = 1;
-    ImageCreateInfo.arrayLayers = 1;
+    ImageCreateInfo.mipLevels = InMipLevels;
+    ImageCreateInfo.arrayLayers = InArrayLayers;
+    ImageCreateInfo.flags = Flags;
     ImageCreateInfo.format = Format;
     ImageCreateInfo.tiling = Tiling;
     ImageCreateInfo.initialLayout = vk::ImageLayout::eUndefined;
@@ -81,6 +351,17 @@ void VulkanImage::CreateImage(uint32_t Width, uint32_t Height, vk::Format Format
     
     ImageLayout = ImageCreateInfo.initialLayout;
     ImageFormat = Format;
+    MipLevels = InMipLevels;
+    ArrayLayers = InArrayLayers;
+
+    if (Flags & vk::ImageCreateFlagBits::eCubeCompatible)
+    {
+        ViewType = (InArrayLayers > 6) ? vk::ImageViewType::eCubeArray : vk::ImageViewType::eCube;
+    }
+    else
+    {
+        ViewType = (InArrayLayers > 1) ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D;
+    }
     Image = Device.createImageUnique(ImageCreateInfo, nullptr); 
     
     vk::MemoryRequirements MemoryRequirements = Device.getImageMemoryRequirements(Image.get());
@@ -96,7 +377,13 @@ void VulkanImage::TransitionImageLayout(vk::ImageLayout TargetLayout)
 {
     VulkanCommandBuffer CommandBuffer;
     CommandBuffer.Begin(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+    TransitionImageLayout(CommandBuffer, TargetLayout);
+    CommandBuffer.End();
+    CommandBuffer.SubmitWaitIdle();
+}
 
+void VulkanImage::TransitionImageLayout(VulkanCommandBuffer& CommandBuffer, vk::ImageLayout TargetLayout)
+{
     vk::ImageMemoryBarrier Barrier;
     Barrier.oldLayout = ImageLayout;
     Barrier.newLayout = TargetLayout;
@@ -105,9 +392,9 @@ void VulkanImage::TransitionImageLayout(vk::ImageLayout TargetLayout)
     Barrier.image = Image.get();
     Barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
     Barrier.subresourceRange.baseMipLevel = 0;
-    Barrier.subresourceRange.levelCount = 1;
+    Barrier.subresourceRange.levelCount = MipLevels;
     Barrier.subresourceRange.baseArrayLayer = 0;
-    Barrier.subresourceRange.layerCount = 1;
+    Barrier.subresourceRange.layerCount = ArrayLayers;
     
     vk::PipelineStageFlags SrcStage;
     vk::PipelineStageFlags DstStage;
@@ -134,16 +421,11 @@ void VulkanImage::TransitionImageLayout(vk::ImageLayout TargetLayout)
     vk::DependencyFlags DependencyFlags;
     CommandBuffer().pipelineBarrier(SrcStage, DstStage, DependencyFlags, nullptr, nullptr, vk::ArrayProxy<const vk::ImageMemoryBarrier>(Barrier));
 
-    CommandBuffer.End();
-    CommandBuffer.SubmitWaitIdle();
-
     ImageLayout = TargetLayout;
 }
 
 void VulkanImage::CopyBufferToImage(vk::Buffer Buffer, uint32_t width, uint32_t height)
 {
-    VulkanCommandBuffer CommandBuffer;
-    CommandBuffer.Begin(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
     vk::BufferImageCopy CopyRegion;
     CopyRegion.bufferOffset = 0;
     CopyRegion.bufferRowLength = 0;
@@ -154,12 +436,20 @@ void VulkanImage::CopyBufferToImage(vk::Buffer Buffer, uint32_t width, uint32_t
     CopyRegion.imageSubresource.layerCount = 1;
     CopyRegion.imageOffset = {0,0,0};
     CopyRegion.imageExtent = {width, height, 1};
-    CommandBuffer().copyBufferToImage(Buffer, Image.get(), vk::ImageLayout::eTransferDstOptimal, 1, &CopyRegion);
+
+    VulkanCommandBuffer CommandBuffer;
+    CommandBuffer.Begin(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+    CopyBufferToImage(CommandBuffer, Buffer, std::vector<vk::BufferImageCopy>{CopyRegion});
     CommandBuffer.End();
     CommandBuffer.SubmitWaitIdle();
 }
 
-vk::ImageView VulkanImage::GetImageView()
+void VulkanImage::CopyBufferToImage(VulkanCommandBuffer& CommandBuffer, vk::Buffer Buffer, const std::vector<vk::BufferImageCopy>& Regions)
+{
+    CommandBuffer().copyBufferToImage(Buffer, Image.get(), vk::ImageLayout::eTransferDstOptimal, static_cast<uint32_t>(Regions.size()), Regions.data());
+}
+
+vk::ImageView& VulkanImage::GetImageView()
 {
     if (!bImageViewBuilt)
     {
@@ -173,13 +463,13 @@ void VulkanImage::CreateImageView()
 {
     vk::ImageViewCreateInfo ViewInfo;
     ViewInfo.image = Image.get();
-    ViewInfo.viewType = vk::ImageViewType::e2D;
+    ViewInfo.viewType = ViewType;
     ViewInfo.format = ImageFormat;
     ViewInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
     ViewInfo.subresourceRange.baseMipLevel = 0;
-    ViewInfo.subresourceRange.levelCount = 1;
+    ViewInfo.subresourceRange.levelCount = MipLevels;
     ViewInfo.subresourceRange.baseArrayLayer = 0;
-    ViewInfo.subresourceRange.layerCount = 1;
+    ViewInfo.subresourceRange.layerCount = ArrayLayers;
 
     vk::Device Device = VulkanContext::Get()->GetDevice();
     ImageView = Device.createImageViewUnique(ViewInfo);
@@ -212,7 +502,7 @@ void VulkanImage::CreateSampler()
     SamplerInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
     SamplerInfo.mipLodBias = 0.0f;
     SamplerInfo.minLod = 0.0f;
-    SamplerInfo.maxLod = 0.0f;
+    SamplerInfo.maxLod = static_cast<float>(MipLevels);
 
     vk::Device Device = VulkanContext::Get()->GetDevice();
     ImageSampler = Device.createSamplerUnique(SamplerInfo);
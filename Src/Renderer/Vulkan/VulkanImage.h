@@ -1,11 +1,16 @@
 #pragma once
 
 #include <vulkan/vulkan.hpp>
+#include <vector>
+#include <memory>
+#include <string>
 
 class VulkanImage
 {
 public:
-    //Load in a texture from file
+    //Empty image, filled in later by CreateImage or CreateFromKTX2
+    VulkanImage() {}
+    //Load in a texture from file (.ktx2 files are uploaded directly, anything else goes through stb_image)
     VulkanImage(class std::string& filename);
     //Creates a general purpose image and doesn't fill it with data
     VulkanImage(uint32_t Width, uint32_t Height, vk::Format Format, vk::ImageTiling Tiling,
@@ -13,15 +18,33 @@ public:
     
     void LoadImageFromFile(class std::string& filename);
 
+    //Reads all files with one batch of async reads and sizes one staging buffer from their headers, then decodes them
+    //on worker threads straight into their slices and uploads every image with a single command buffer submission
+    static std::vector<std::unique_ptr<VulkanImage>> LoadImagesFromFiles(const std::vector<std::string>& Filenames);
+
+    //Maps a KTX2 container and copies its mip levels, array layers and cube faces straight into staging
+    void LoadKTX2FromFile(class std::string& filename);
+    //Same as above for a container that is already in memory (e.g. read from the cooked asset archive)
+    void LoadKTX2FromMemory(const uint8_t* Data, size_t Size, const std::string& DebugName);
+
+    //Creates an image holding mips [BaseMip, LevelCount) of File and records their upload into CommandBuffer.
+    //StagingBuffer must hold File's level range for BaseMip (KTX2File::GetLevelRange) starting at offset 0
+    void CreateFromKTX2(class VulkanCommandBuffer& CommandBuffer, const class KTX2File& File, uint32_t BaseMip, vk::Buffer StagingBuffer);
+
     void CreateImage(uint32_t Width, uint32_t Height, vk::Format Format, vk::ImageTiling Tiling,
-                            vk::ImageUsageFlags Usage, vk::MemoryPropertyFlags MemoryProperties);
+                            vk::ImageUsageFlags Usage, vk::MemoryPropertyFlags MemoryProperties,
+                            uint32_t InMipLevels = 1, uint32_t InArrayLayers = 1, vk::ImageCreateFlags Flags = vk::ImageCreateFlags());
 
     void TransitionImageLayout(vk::ImageLayout TargetLayout);
+    //Records the transition into an existing command buffer instead of submitting its own
+    void TransitionImageLayout(class VulkanCommandBuffer& CommandBuffer, vk::ImageLayout TargetLayout);
 
     void CopyBufferToImage(vk::Buffer Buffer, uint32_t width, uint32_t height);
+    //Copies any number of regions (mip levels, layers) with a single copyBufferToImage
+    void CopyBufferToImage(class VulkanCommandBuffer& CommandBuffer, vk::Buffer Buffer, const std::vector<vk::BufferImageCopy>& Regions);
 
     //Optional Image View
-    vk::ImageView GetImageView();
+    vk::ImageView& GetImageView();
     void CreateImageView();
 
     //Optional Sampler
@@ -33,14 +56,22 @@ public:
     void CreateDescriptorInfo();
 
     vk::Format GetFormat() { return ImageFormat; }
+    uint32_t GetMipLevels() { return MipLevels; }
+    uint32_t GetArrayLayers() { return ArrayLayers; }
 
 protected:
 
+    void UploadKTX2(const class KTX2File& File, const std::string& filename);
+
     vk::UniqueImage Image;
     vk::Format ImageFormat;
     vk::ImageLayout ImageLayout;
     vk::UniqueDeviceMemory ImageMemory;
 
+    uint32_t MipLevels = 1;
+    uint32_t ArrayLayers = 1; //Includes cube faces
+    vk::ImageViewType ViewType = vk::ImageViewType::e2D;
+
     //Optional Image View
     vk::UniqueImageView ImageView;
     bool bImageViewBuilt = false;
@@ -52,4 +83,4 @@ protected:
     //Optional Descritor Info
     vk::DescriptorImageInfo DescriptorImageInfo;
     bool bDescriptorInfoBuilt = false;
-};
\ No newline at end of file
+};
@@ -0,0 +1,271 @@
+#include "VulkanLayoutCache.h"
+
+#include "VulkanContext.h"
+#include "VulkanPipelineCache.h"
+
+#include <algorithm>
+#include <iostream>
+#include <cassert>
+
+namespace
+{
+	//Binding order doesn't change the layout
+	void SortBindings(std::vector<vk::DescriptorSetLayoutBinding>& Bindings)
+	{
+		std::sort(Bindings.begin(), Bindings.end(), [](const vk::DescriptorSetLayoutBinding& A, const vk::DescriptorSetLayoutBinding& B)
+		{
+			return A.binding < B.binding;
+		});
+	}
+}
+
+vk::DescriptorSetLayout VulkanLayoutCache::GetDescriptorSetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& Bindings)
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	return GetDescriptorSetLayoutLocked(Bindings);
+}
+
+vk::DescriptorSetLayout VulkanLayoutCache::CreateDescriptorSetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& Bindings, const std::vector<vk::DescriptorBindingFlagsEXT>& BindingFlags, vk::DescriptorSetLayoutCreateFlags CreateFlags)
+{
+	assert(Bindings.size() == BindingFlags.size());
+
+	//Flags aren't part of the key: the binding definition alone picks this layout for reflected pipelines
+	std::vector<vk::DescriptorSetLayoutBinding> SortedBindings = Bindings;
+	SortBindings(SortedBindings);
+	const HashKey Key = VulkanPipelineCache::GetPipelineLayoutKey({ SortedBindings }, {});
+
+	std::lock_guard<std::mutex> Lock(Mutex);
+
+	if (DescriptorSetLayouts.count(Key))
+	{
+		std::cout << "Descriptor set layout with flags created after an identical one without them" << std::endl;
+		throw std::runtime_error("descriptor set layout already exists in the layout cache");
+	}
+
+	vk::DescriptorSetLayoutBindingFlagsCreateInfoEXT BindingFlagsInfo;
+	BindingFlagsInfo.bindingCount = static_cast<uint32_t>(BindingFlags.size());
+	BindingFlagsInfo.pBindingFlags = BindingFlags.data();
+
+	vk::DescriptorSetLayoutCreateInfo CreateInfo;
+	CreateInfo.pNext = &BindingFlagsInfo;
+	CreateInfo.flags = CreateFlags;
+	CreateInfo.bindingCount = static_cast<uint32_t>(Bindings.size());
+	CreateInfo.pBindings = Bindings.data();
+
+	vk::UniqueDescriptorSetLayout& Created = DescriptorSetLayouts[Key];
+	Created = VulkanContext::Get()->GetDevice().createDescriptorSetLayoutUnique(CreateInfo);
+	return Created.get();
+}
+
+vk::PipelineLayout VulkanLayoutCache::GetPipelineLayout(const std::vector<std::vector<vk::DescriptorSetLayoutBinding>>& SetLayouts, const std::vector<vk::PushConstantRange>& PushConstantRanges)
+{
+	std::vector<std::vector<vk::DescriptorSetLayoutBinding>> SortedSetLayouts = SetLayouts;
+	for (std::vector<vk::DescriptorSetLayoutBinding>& Bindings : SortedSetLayouts)
+	{
+		SortBindings(Bindings);
+	}
+	const HashKey Key = VulkanPipelineCache::GetPipelineLayoutKey(SortedSetLayouts, PushConstantRanges);
+
+	std::lock_guard<std::mutex> Lock(Mutex);
+
+	auto Found = PipelineLayouts.find(Key);
+	if (Found != PipelineLayouts.end())
+	{
+		return Found->second.get();
+	}
+
+	std::vector<vk::DescriptorSetLayout> SetLayoutHandles;
+	for (const std::vector<vk::DescriptorSetLayoutBinding>& Bindings : SortedSetLayouts)
+	{
+		SetLayoutHandles.push_back(GetDescriptorSetLayoutLocked(Bindings));
+	}
+
+	vk::PipelineLayoutCreateInfo CreateInfo;
+	CreateInfo.setLayoutCount = static_cast<uint32_t>(SetLayoutHandles.size());
+	CreateInfo.pSetLayouts = SetLayoutHandles.data();
+	CreateInfo.pushConstantRangeCount = static_cast<uint32_t>(PushConstantRanges.size());
+	CreateInfo.pPushConstantRanges = PushConstantRanges.data();
+
+	vk::UniquePipelineLayout& Created = PipelineLayouts[Key];
+	Created = VulkanContext::Get()->GetDevice().createPipelineLayoutUnique(CreateInfo);
+	return Created.get();
+}
+
+uint32_t DescriptorUpdateTemplate::GetFirstSlot(uint32_t Binding) const
+{
+	for (size_t i = 0; i < Bindings.size(); ++i)
+	{
+		if (Bindings[i].binding == Binding)
+		{
+			return FirstSlots[i];
+		}
+	}
+	return NoSlot;
+}
+
+const DescriptorUpdateTemplate& VulkanLayoutCache::GetDescriptorUpdateTemplate(const std::vector<vk::DescriptorSetLayoutBinding>& Bindings)
+{
+	std::vector<vk::DescriptorSetLayoutBinding> SortedBindings = Bindings;
+	SortBindings(SortedBindings);
+	const HashKey Key = VulkanPipelineCache::GetPipelineLayoutKey({ SortedBindings }, {});
+
+	std::lock_guard<std::mutex> Lock(Mutex);
+
+	auto Found = UpdateTemplates.find(Key);
+	if (Found != UpdateTemplates.end())
+	{
+		return *Found->second;
+	}
+
+	std::unique_ptr<DescriptorUpdateTemplate> Template(new DescriptorUpdateTemplate());
+	Template->Bindings = SortedBindings;
+
+	std::vector<VkDescriptorUpdateTemplateEntryKHR> Entries;
+	for (const vk::DescriptorSetLayoutBinding& Binding : SortedBindings)
+	{
+		VkDescriptorUpdateTemplateEntryKHR Entry = {};
+		Entry.dstBinding = Binding.binding;
+		Entry.dstArrayElement = 0;
+		Entry.descriptorCount = Binding.descriptorCount;
+		Entry.descriptorType = static_cast<VkDescriptorType>(Binding.descriptorType);
+		Entry.offset = Template->SlotCount * sizeof(DescriptorUpdateSlot);
+		Entry.stride = sizeof(DescriptorUpdateSlot);
+		Entries.push_back(Entry);
+
+		Template->FirstSlots.push_back(Template->SlotCount);
+		Template->SlotCount += Binding.descriptorCount;
+	}
+
+	VulkanContext* Context = VulkanContext::Get();
+	if (Context->SupportsUpdateTemplates() && !CreateUpdateTemplate)
+	{
+		VkDevice Device = (VkDevice)Context->GetDevice();
+		CreateUpdateTemplate = (PFN_vkCreateDescriptorUpdateTemplateKHR) vkGetDeviceProcAddr(Device, "vkCreateDescriptorUpdateTemplateKHR");
+		DestroyUpdateTemplate = (PFN_vkDestroyDescriptorUpdateTemplateKHR) vkGetDeviceProcAddr(Device, "vkDestroyDescriptorUpdateTemplateKHR");
+		UpdateWithTemplate = (PFN_vkUpdateDescriptorSetWithTemplateKHR) vkGetDeviceProcAddr(Device, "vkUpdateDescriptorSetWithTemplateKHR");
+	}
+
+	if (CreateUpdateTemplate && !Entries.empty())
+	{
+		VkDescriptorUpdateTemplateCreateInfoKHR CreateInfo = {};
+		CreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO_KHR;
+		CreateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(Entries.size());
+		CreateInfo.pDescriptorUpdateEntries = Entries.data();
+		CreateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET_KHR;
+		CreateInfo.descriptorSetLayout = (VkDescriptorSetLayout)GetDescriptorSetLayoutLocked(SortedBindings);
+
+		if (CreateUpdateTemplate((VkDevice)Context->GetDevice(), &CreateInfo, nullptr, &Template->Handle) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create descriptor update template");
+		}
+	}
+
+	DescriptorUpdateTemplate& Created = *Template;
+	UpdateTemplates[Key] = std::move(Template);
+	return Created;
+}
+
+void VulkanLayoutCache::UpdateDescriptorSet(vk::DescriptorSet DescriptorSet, const DescriptorUpdateTemplate& Template, const DescriptorUpdateSlot* Slots)
+{
+	auto IsSet = [&](vk::DescriptorType Type, const DescriptorUpdateSlot& Slot)
+	{
+		switch (Type)
+		{
+		case vk::DescriptorType::eUniformBuffer:
+		case vk::DescriptorType::eStorageBuffer:
+		case vk::DescriptorType::eUniformBufferDynamic:
+		case vk::DescriptorType::eStorageBufferDynamic:
+			return Slot.Buffer.buffer != VK_NULL_HANDLE;
+		case vk::DescriptorType::eUniformTexelBuffer:
+		case vk::DescriptorType::eStorageTexelBuffer:
+			return Slot.TexelBufferView != VK_NULL_HANDLE;
+		default:
+			return Slot.Image.imageView != VK_NULL_HANDLE || Slot.Image.sampler != VK_NULL_HANDLE;
+		}
+	};
+
+	bool bAllSet = true;
+	for (size_t i = 0; i < Template.Bindings.size() && bAllSet; ++i)
+	{
+		for (uint32_t Element = 0; Element < Template.Bindings[i].descriptorCount; ++Element)
+		{
+			bAllSet = bAllSet && IsSet(Template.Bindings[i].descriptorType, Slots[Template.FirstSlots[i] + Element]);
+		}
+	}
+
+	if (bAllSet && Template.Handle != VK_NULL_HANDLE)
+	{
+		UpdateWithTemplate((VkDevice)VulkanContext::Get()->GetDevice(), (VkDescriptorSet)DescriptorSet, Template.Handle, Slots);
+		return;
+	}
+
+	//Slots are as large as the biggest member, consecutive elements of a binding line up as an info array
+	static_assert(sizeof(DescriptorUpdateSlot) == sizeof(VkDescriptorImageInfo) && sizeof(DescriptorUpdateSlot) == sizeof(VkDescriptorBufferInfo), "slots have to alias info arrays");
+
+	std::vector<vk::WriteDescriptorSet> DescriptorWrites;
+	for (size_t i = 0; i < Template.Bindings.size(); ++i)
+	{
+		const vk::DescriptorSetLayoutBinding& Binding = Template.Bindings[i];
+		for (uint32_t Element = 0; Element < Binding.descriptorCount; ++Element)
+		{
+			const DescriptorUpdateSlot& Slot = Slots[Template.FirstSlots[i] + Element];
+			if (!IsSet(Binding.descriptorType, Slot))
+			{
+				continue;
+			}
+
+			vk::WriteDescriptorSet Write;
+			Write.dstSet = DescriptorSet;
+			Write.dstBinding = Binding.binding;
+			Write.dstArrayElement = Element;
+			Write.descriptorType = Binding.descriptorType;
+			Write.descriptorCount = 1;
+			Write.pImageInfo = reinterpret_cast<const vk::DescriptorImageInfo*>(&Slot.Image);
+			Write.pBufferInfo = reinterpret_cast<const vk::DescriptorBufferInfo*>(&Slot.Buffer);
+			Write.pTexelBufferView = reinterpret_cast<const vk::BufferView*>(&Slot.TexelBufferView);
+			DescriptorWrites.push_back(Write);
+		}
+	}
+
+	VulkanContext::Get()->GetDevice().updateDescriptorSets(DescriptorWrites, 0);
+}
+
+void VulkanLayoutCache::Clear()
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	for (auto& Template : UpdateTemplates)
+	{
+		if (Template.second->Handle != VK_NULL_HANDLE)
+		{
+			DestroyUpdateTemplate((VkDevice)VulkanContext::Get()->GetDevice(), Template.second->Handle, nullptr);
+		}
+	}
+	UpdateTemplates.clear();
+	PipelineLayouts.clear();
+	DescriptorSetLayouts.clear();
+}
+
+vk::DescriptorSetLayout VulkanLayoutCache::GetDescriptorSetLayoutLocked(std::vector<vk::DescriptorSetLayoutBinding> Bindings)
+{
+	SortBindings(Bindings);
+	const HashKey Key = VulkanPipelineCache::GetPipelineLayoutKey({ Bindings }, {});
+
+	auto Found = DescriptorSetLayouts.find(Key);
+	if (Found != DescriptorSetLayouts.end())
+	{
+		return Found->second.get();
+	}
+
+	for (const vk::DescriptorSetLayoutBinding& Binding : Bindings)
+	{
+		assert(Binding.pImmutableSamplers == nullptr);
+	}
+
+	vk::DescriptorSetLayoutCreateInfo CreateInfo;
+	CreateInfo.bindingCount = static_cast<uint32_t>(Bindings.size());
+	CreateInfo.pBindings = Bindings.data();
+
+	vk::UniqueDescriptorSetLayout& Created = DescriptorSetLayouts[Key];
+	Created = VulkanContext::Get()->GetDevice().createDescriptorSetLayoutUnique(CreateInfo);
+	return Created.get();
+}
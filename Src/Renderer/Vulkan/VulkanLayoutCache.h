@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+#include "../Core/Hash.h"
+
+//One descriptor's worth of the data a descriptor update template reads, slots are laid out binding by binding
+//(in binding order) with one slot per array element. Unused members stay zero, which marks the slot as unset
+union DescriptorUpdateSlot
+{
+	VkDescriptorImageInfo Image;
+	VkDescriptorBufferInfo Buffer;
+	VkBufferView TexelBufferView;
+};
+
+//Update template of a descriptor set layout (VK_KHR_descriptor_update_template)
+struct DescriptorUpdateTemplate
+{
+	//Null if the device doesn't support update templates, updates then fall back to descriptor writes
+	VkDescriptorUpdateTemplateKHR Handle = VK_NULL_HANDLE;
+
+	//Sorted by binding, FirstSlots[i] is the slot of Bindings[i]'s first array element
+	std::vector<vk::DescriptorSetLayoutBinding> Bindings;
+	std::vector<uint32_t> FirstSlots;
+	uint32_t SlotCount = 0;
+
+	//Slot of Binding's first element, NoSlot if the layout doesn't have it
+	uint32_t GetFirstSlot(uint32_t Binding) const;
+
+	static const uint32_t NoSlot = 0xffffffff;
+};
+
+//Shares descriptor set layouts and pipeline layouts between every pipeline that defines them identically
+//
+//Pipelines built from the same shader interface end up with the same layout handles, which keeps them compatible:
+//descriptor sets bound under one stay bound when a draw switches to the next (see "Pipeline Layout Compatibility"
+//in the Vulkan spec). Layouts are looked up by their whole definition (VulkanPipelineCache::GetPipelineLayoutKey),
+//so a hash collision can't hand out another one, and live until Clear. Thread safe.
+class VulkanLayoutCache
+{
+public:
+
+	//Bindings in any order. Immutable samplers aren't supported
+	vk::DescriptorSetLayout GetDescriptorSetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& Bindings);
+
+	//Creates the layout of Bindings with per binding flags (VK_EXT_descriptor_indexing) and layout CreateFlags.
+	//Pipelines reflecting the same bindings get this layout from the two functions above and below, so it has to be
+	//created before them (see VulkanBindlessTextures)
+	vk::DescriptorSetLayout CreateDescriptorSetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& Bindings, const std::vector<vk::DescriptorBindingFlagsEXT>& BindingFlags, vk::DescriptorSetLayoutCreateFlags CreateFlags);
+
+	//One binding list per set, indexed by set number (empty lists for unused sets in between)
+	vk::PipelineLayout GetPipelineLayout(const std::vector<std::vector<vk::DescriptorSetLayoutBinding>>& SetLayouts, const std::vector<vk::PushConstantRange>& PushConstantRanges);
+
+	//Template for the layout of Bindings, created with it. Lives until Clear
+	const DescriptorUpdateTemplate& GetDescriptorUpdateTemplate(const std::vector<vk::DescriptorSetLayoutBinding>& Bindings);
+
+	//Writes Slots (Template.SlotCount of them) into DescriptorSet with a single vkUpdateDescriptorSetWithTemplate.
+	//Sets with unset slots, or devices without update templates, get descriptor writes of the set slots instead
+	void UpdateDescriptorSet(vk::DescriptorSet DescriptorSet, const DescriptorUpdateTemplate& Template, const DescriptorUpdateSlot* Slots);
+
+	//Device idle: destroys every layout
+	void Clear();
+
+protected:
+
+	vk::DescriptorSetLayout GetDescriptorSetLayoutLocked(std::vector<vk::DescriptorSetLayoutBinding> Bindings);
+
+	std::mutex Mutex;
+
+	std::unordered_map<HashKey, vk::UniqueDescriptorSetLayout, HashKey::Hasher> DescriptorSetLayouts;
+	std::unordered_map<HashKey, vk::UniquePipelineLayout, HashKey::Hasher> PipelineLayouts;
+
+	//Pointers stay valid while the map grows
+	std::unordered_map<HashKey, std::unique_ptr<DescriptorUpdateTemplate>, HashKey::Hasher> UpdateTemplates;
+
+	//Loaded with the first template
+	PFN_vkCreateDescriptorUpdateTemplateKHR CreateUpdateTemplate = nullptr;
+	PFN_vkDestroyDescriptorUpdateTemplateKHR DestroyUpdateTemplate = nullptr;
+	PFN_vkUpdateDescriptorSetWithTemplateKHR UpdateWithTemplate = nullptr;
+};
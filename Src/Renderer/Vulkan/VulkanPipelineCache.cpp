@@ -0,0 +1,588 @@
+#include "VulkanPipelineCache.h"
+
+#include "VulkanContext.h"
+#include "../Core/Hash.h"
+
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cassert>
+
+namespace
+{
+	//Widened so enums, flags and sizes of any width land in the key the same way
+	template<typename T>
+	void AddValue(HashKey& Key, T Value)
+	{
+		Key.Add(static_cast<uint64_t>(Value));
+	}
+
+	void AddViewportState(HashKey& Key, const vk::PipelineViewportStateCreateInfo& State, bool bDynamicViewport, bool bDynamicScissor)
+	{
+		AddValue(Key, State.viewportCount);
+		AddValue(Key, State.scissorCount);
+
+		//Ignored by the driver when dynamic
+		if (!bDynamicViewport && State.pViewports)
+		{
+			for (uint32_t i = 0; i < State.viewportCount; ++i)
+			{
+				const vk::Viewport& Viewport = State.pViewports[i];
+				Key.Add(Viewport.x);
+				Key.Add(Viewport.y);
+				Key.Add(Viewport.width);
+				Key.Add(Viewport.height);
+				Key.Add(Viewport.minDepth);
+				Key.Add(Viewport.maxDepth);
+			}
+		}
+		if (!bDynamicScissor && State.pScissors)
+		{
+			for (uint32_t i = 0; i < State.scissorCount; ++i)
+			{
+				const vk::Rect2D& Scissor = State.pScissors[i];
+				AddValue(Key, Scissor.offset.x);
+				AddValue(Key, Scissor.offset.y);
+				AddValue(Key, Scissor.extent.width);
+				AddValue(Key, Scissor.extent.height);
+			}
+		}
+	}
+}
+
+void VulkanPipelineCache::Load(const std::string& Filename)
+{
+	CacheFilename = Filename;
+	RenderThread = std::this_thread::get_id();
+
+	std::vector<uint8_t> InitialData;
+	std::ifstream File(Filename, std::ios::ate | std::ios::binary);
+	if (File.is_open())
+	{
+		InitialData.resize(static_cast<size_t>(File.tellg()));
+		File.seekg(0);
+		File.read(reinterpret_cast<char*>(InitialData.data()), InitialData.size());
+	}
+
+	//Header: length, version, vendor id, device id, pipeline cache uuid. Data from another driver would just be
+	//ignored by most, but isn't guaranteed to be
+	vk::PhysicalDeviceProperties Properties = VulkanContext::Get()->GetPhysicalDevice().getProperties();
+	const size_t HeaderSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+	if (InitialData.size() >= HeaderSize)
+	{
+		uint32_t Header[4];
+		memcpy(Header, InitialData.data(), sizeof(Header));
+
+		if (Header[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || Header[2] != Properties.vendorID || Header[3] != Properties.deviceID
+			|| memcmp(InitialData.data() + sizeof(Header), Properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+		{
+			std::cout << "Discarding pipeline cache from another device or driver: " << Filename << std::endl;
+			InitialData.clear();
+		}
+	}
+	else
+	{
+		InitialData.clear();
+	}
+
+	vk::PipelineCacheCreateInfo CreateInfo;
+	CreateInfo.initialDataSize = InitialData.size();
+	CreateInfo.pInitialData = InitialData.data();
+
+	DriverCache = VulkanContext::Get()->GetDevice().createPipelineCacheUnique(CreateInfo);
+}
+
+void VulkanPipelineCache::Save()
+{
+	if (!DriverCache || CacheFilename.empty())
+	{
+		return;
+	}
+
+	std::vector<uint8_t> Data = VulkanContext::Get()->GetDevice().getPipelineCacheData(DriverCache.get());
+
+	std::ofstream File(CacheFilename, std::ios::binary | std::ios::trunc);
+	if (!File.is_open())
+	{
+		std::cout << "Failed to write pipeline cache: " << CacheFilename << std::endl;
+		return;
+	}
+	File.write(reinterpret_cast<const char*>(Data.data()), Data.size());
+}
+
+void VulkanPipelineCache::Clear()
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	Pipelines.clear();
+	DriverCache.reset();
+}
+
+SharedPipeline VulkanPipelineCache::MakeShared(vk::Pipeline Pipeline)
+{
+	return SharedPipeline(new vk::Pipeline(Pipeline), [](vk::Pipeline* Released)
+	{
+		//Command buffers of frames in flight may still bind it
+		const vk::Pipeline Handle = *Released;
+		VulkanContext::Get()->GetDeletionQueue().Defer([Handle]()
+		{
+			VulkanContext::Get()->GetDevice().destroyPipeline(Handle);
+		});
+		delete Released;
+	});
+}
+
+SharedPipeline VulkanPipelineCache::GetGraphicsPipeline(const vk::GraphicsPipelineCreateInfo& CreateInfo, const std::vector<uint64_t>& ShaderHashes, uint64_t LayoutHash, const std::string& DebugName)
+{
+	GraphicsPipelineRequest Request;
+	Request.CreateInfo = &CreateInfo;
+	Request.ShaderHashes = ShaderHashes;
+	Request.LayoutHash = LayoutHash;
+	Request.RenderPassHash = VulkanContext::Get()->GetRenderPassCache().GetCompatibilityHash(CreateInfo.renderPass);
+	Request.DebugName = DebugName;
+
+	return GetGraphicsPipelines({ Request }).front();
+}
+
+std::vector<SharedPipeline> VulkanPipelineCache::GetGraphicsPipelines(const std::vector<GraphicsPipelineRequest>& Requests)
+{
+	std::vector<SharedPipeline> Result(Requests.size());
+	std::vector<HashKey> Keys(Requests.size());
+
+	//Requests that missed, each created once even if requested several times in this batch
+	std::vector<vk::GraphicsPipelineCreateInfo> MissInfos;
+	std::vector<size_t> MissRequests;
+	std::vector<int32_t> MissIndices(Requests.size(), -1);
+	std::unordered_map<HashKey, int32_t, HashKey::Hasher> MissesByKey;
+
+	std::unique_lock<std::mutex> Lock(Mutex);
+
+	for (size_t i = 0; i < Requests.size(); ++i)
+	{
+		const GraphicsPipelineRequest& Request = Requests[i];
+		assert(Request.ParentIndex < static_cast<int32_t>(i));
+
+		//Derivation doesn't change what gets rendered, so it isn't part of the hash
+		vk::GraphicsPipelineCreateInfo CreateInfo = *Request.CreateInfo;
+		CreateInfo.flags &= ~(vk::PipelineCreateFlagBits::eAllowDerivatives | vk::PipelineCreateFlagBits::eDerivative);
+		CreateInfo.basePipelineHandle = nullptr;
+		CreateInfo.basePipelineIndex = -1;
+
+		Keys[i] = GetGraphicsPipelineKey(CreateInfo, Request.ShaderHashes, Request.LayoutHash, Request.RenderPassHash);
+		++Stats[Keys[i].GetHash()].Requests;
+
+		auto Found = Pipelines.find(Keys[i]);
+		if (Found != Pipelines.end())
+		{
+			Result[i] = Found->second.Pipeline.lock();
+			if (Result[i])
+			{
+				continue;
+			}
+		}
+
+		auto PendingMiss = MissesByKey.find(Keys[i]);
+		if (PendingMiss != MissesByKey.end())
+		{
+			MissIndices[i] = PendingMiss->second;
+			continue;
+		}
+
+		MissIndices[i] = static_cast<int32_t>(MissInfos.size());
+		MissesByKey[Keys[i]] = MissIndices[i];
+		MissInfos.push_back(CreateInfo);
+		MissRequests.push_back(i);
+	}
+
+	//Link derivatives to their parents: by index when the parent is created in this batch, by handle if it
+	//already existed (and was created allowing derivatives)
+	for (size_t i = 0; i < Requests.size(); ++i)
+	{
+		const int32_t ParentIndex = Requests[i].ParentIndex;
+		if (ParentIndex < 0 || MissIndices[i] < 0 || MissRequests[MissIndices[i]] != i)
+		{
+			continue;
+		}
+
+		vk::GraphicsPipelineCreateInfo& CreateInfo = MissInfos[MissIndices[i]];
+		if (MissIndices[ParentIndex] >= 0)
+		{
+			MissInfos[MissIndices[ParentIndex]].flags |= vk::PipelineCreateFlagBits::eAllowDerivatives;
+			CreateInfo.flags |= vk::PipelineCreateFlagBits::eDerivative;
+			CreateInfo.basePipelineIndex = MissIndices[ParentIndex];
+		}
+		else if (Pipelines[Keys[ParentIndex]].bAllowsDerivatives)
+		{
+			CreateInfo.flags |= vk::PipelineCreateFlagBits::eDerivative;
+			CreateInfo.basePipelineHandle = *Result[ParentIndex];
+		}
+	}
+
+	if (!MissInfos.empty())
+	{
+		//The driver cache is internally synchronized, other threads can look up or create pipelines meanwhile
+		Lock.unlock();
+
+		const auto StartTime = std::chrono::steady_clock::now();
+		std::vector<vk::Pipeline> NewPipelines = VulkanContext::Get()->GetDevice().createGraphicsPipelines(DriverCache.get(), MissInfos);
+		const double ElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - StartTime).count();
+
+		std::vector<std::string> DebugNames;
+		for (size_t RequestIndex : MissRequests)
+		{
+			DebugNames.push_back(Requests[RequestIndex].DebugName);
+		}
+		ReportStall(ElapsedMs, DebugNames);
+
+		Lock.lock();
+
+		//The driver doesn't say how the time split between pipelines of one call
+		const double ElapsedMsEach = ElapsedMs / MissInfos.size();
+
+		std::vector<SharedPipeline> Created;
+		for (size_t Miss = 0; Miss < NewPipelines.size(); ++Miss)
+		{
+			const size_t RequestIndex = MissRequests[Miss];
+			const uint64_t Hash = Keys[RequestIndex].GetHash();
+
+			PipelineStats& PipelineStat = Stats[Hash];
+			PipelineStat.Hash = Hash;
+			PipelineStat.DebugName = Requests[RequestIndex].DebugName;
+			PipelineStat.CreateMilliseconds += ElapsedMsEach;
+
+			//Another thread may have created the same pipeline while unlocked, share theirs and drop ours
+			CachedPipeline& Cached = Pipelines[Keys[RequestIndex]];
+			SharedPipeline Existing = Cached.Pipeline.lock();
+			Created.push_back(MakeShared(NewPipelines[Miss]));
+			if (Existing)
+			{
+				Created.back() = Existing;
+				continue;
+			}
+
+			Cached.Pipeline = Created.back();
+			Cached.bAllowsDerivatives = static_cast<bool>(MissInfos[Miss].flags & vk::PipelineCreateFlagBits::eAllowDerivatives);
+		}
+
+		for (size_t i = 0; i < Requests.size(); ++i)
+		{
+			if (!Result[i])
+			{
+				Result[i] = Created[MissIndices[i]];
+			}
+		}
+	}
+
+	//Drop entries whose pipelines have all been released
+	for (auto It = Pipelines.begin(); It != Pipelines.end();)
+	{
+		It = It->second.Pipeline.expired() ? Pipelines.erase(It) : std::next(It);
+	}
+
+	return Result;
+}
+
+SharedPipeline VulkanPipelineCache::GetComputePipeline(const vk::ComputePipelineCreateInfo& CreateInfo, uint64_t ShaderHash, uint64_t LayoutHash, const std::string& DebugName)
+{
+	//Compute pipelines aren't created as derivatives, their flags are hashed as they are
+	const HashKey Key = GetComputePipelineKey(CreateInfo, ShaderHash, LayoutHash);
+	const uint64_t Hash = Key.GetHash();
+
+	std::unique_lock<std::mutex> Lock(Mutex);
+	++Stats[Hash].Requests;
+
+	auto Found = Pipelines.find(Key);
+	if (Found != Pipelines.end())
+	{
+		if (SharedPipeline Existing = Found->second.Pipeline.lock())
+		{
+			return Existing;
+		}
+	}
+
+	Lock.unlock();
+
+	const auto StartTime = std::chrono::steady_clock::now();
+	vk::Pipeline NewPipeline = VulkanContext::Get()->GetDevice().createComputePipeline(DriverCache.get(), CreateInfo);
+	const double ElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - StartTime).count();
+	ReportStall(ElapsedMs, { DebugName });
+
+	Lock.lock();
+
+	PipelineStats& PipelineStat = Stats[Hash];
+	PipelineStat.Hash = Hash;
+	PipelineStat.DebugName = DebugName;
+	PipelineStat.CreateMilliseconds += ElapsedMs;
+
+	//Another thread may have created the same pipeline while unlocked, share theirs and drop ours
+	SharedPipeline Created = MakeShared(NewPipeline);
+	CachedPipeline& Cached = Pipelines[Key];
+	if (SharedPipeline Existing = Cached.Pipeline.lock())
+	{
+		return Existing;
+	}
+	Cached.Pipeline = Created;
+	return Created;
+}
+
+void VulkanPipelineCache::ReportStall(double ElapsedMs, const std::vector<std::string>& DebugNames) const
+{
+	//Compiling on first use mid-session shows up as a frame time spike, those pipelines should be built
+	//ahead of time or with VulkanGraphicsPipeline::BuildPipelineAsync
+	if (ElapsedMs < StallWarningMilliseconds || std::this_thread::get_id() != RenderThread || VulkanContext::Get()->GetFrameIndex() == 0)
+	{
+		return;
+	}
+
+	std::cout << "Warning: frame " << VulkanContext::Get()->GetFrameIndex() << " stalled " << std::fixed << std::setprecision(2) << ElapsedMs
+		<< " ms compiling " << DebugNames.size() << " pipeline(s) on first use:";
+	for (const std::string& DebugName : DebugNames)
+	{
+		std::cout << " " << (DebugName.empty() ? "(unnamed)" : DebugName);
+	}
+	std::cout << std::endl;
+}
+
+HashKey VulkanPipelineCache::GetGraphicsPipelineKey(const vk::GraphicsPipelineCreateInfo& CreateInfo, const std::vector<uint64_t>& ShaderHashes, uint64_t LayoutHash, uint64_t RenderPassHash)
+{
+	assert(ShaderHashes.size() == CreateInfo.stageCount);
+
+	HashKey Key;
+	Key.AddString("graphics");
+	AddValue(Key, static_cast<VkPipelineCreateFlags>(CreateInfo.flags));
+
+	//Shader stages
+	AddValue(Key, CreateInfo.stageCount);
+	for (uint32_t i = 0; i < CreateInfo.stageCount; ++i)
+	{
+		const vk::PipelineShaderStageCreateInfo& Stage = CreateInfo.pStages[i];
+		AddValue(Key, static_cast<VkShaderStageFlags>(Stage.stage));
+		Key.Add(ShaderHashes[i]);
+		Key.AddString(Stage.pName);
+
+		if (Stage.pSpecializationInfo)
+		{
+			const vk::SpecializationInfo& Specialization = *Stage.pSpecializationInfo;
+			for (uint32_t Entry = 0; Entry < Specialization.mapEntryCount; ++Entry)
+			{
+				AddValue(Key, Specialization.pMapEntries[Entry].constantID);
+				AddValue(Key, Specialization.pMapEntries[Entry].offset);
+				AddValue(Key, Specialization.pMapEntries[Entry].size);
+			}
+			AddValue(Key, Specialization.dataSize);
+			Key.AddBytes(Specialization.pData, Specialization.dataSize);
+		}
+	}
+
+	//Vertex input
+	if (const vk::PipelineVertexInputStateCreateInfo* VertexInput = CreateInfo.pVertexInputState)
+	{
+		for (uint32_t i = 0; i < VertexInput->vertexBindingDescriptionCount; ++i)
+		{
+			const vk::VertexInputBindingDescription& Binding = VertexInput->pVertexBindingDescriptions[i];
+			AddValue(Key, Binding.binding);
+			AddValue(Key, Binding.stride);
+			AddValue(Key, Binding.inputRate);
+		}
+		for (uint32_t i = 0; i < VertexInput->vertexAttributeDescriptionCount; ++i)
+		{
+			const vk::VertexInputAttributeDescription& Attribute = VertexInput->pVertexAttributeDescriptions[i];
+			AddValue(Key, Attribute.location);
+			AddValue(Key, Attribute.binding);
+			AddValue(Key, Attribute.format);
+			AddValue(Key, Attribute.offset);
+		}
+	}
+
+	if (const vk::PipelineInputAssemblyStateCreateInfo* InputAssembly = CreateInfo.pInputAssemblyState)
+	{
+		AddValue(Key, InputAssembly->topology);
+		AddValue(Key, InputAssembly->primitiveRestartEnable);
+	}
+
+	if (const vk::PipelineTessellationStateCreateInfo* Tessellation = CreateInfo.pTessellationState)
+	{
+		AddValue(Key, Tessellation->patchControlPoints);
+	}
+
+	//Dynamic states, also decide whether the baked viewport and scissor matter
+	bool bDynamicViewport = false;
+	bool bDynamicScissor = false;
+	if (const vk::PipelineDynamicStateCreateInfo* DynamicState = CreateInfo.pDynamicState)
+	{
+		for (uint32_t i = 0; i < DynamicState->dynamicStateCount; ++i)
+		{
+			AddValue(Key, DynamicState->pDynamicStates[i]);
+			bDynamicViewport |= (DynamicState->pDynamicStates[i] == vk::DynamicState::eViewport);
+			bDynamicScissor |= (DynamicState->pDynamicStates[i] == vk::DynamicState::eScissor);
+		}
+	}
+
+	if (CreateInfo.pViewportState)
+	{
+		AddViewportState(Key, *CreateInfo.pViewportState, bDynamicViewport, bDynamicScissor);
+	}
+
+	if (const vk::PipelineRasterizationStateCreateInfo* Rasterizer = CreateInfo.pRasterizationState)
+	{
+		AddValue(Key, Rasterizer->depthClampEnable);
+		AddValue(Key, Rasterizer->rasterizerDiscardEnable);
+		AddValue(Key, Rasterizer->polygonMode);
+		AddValue(Key, static_cast<VkCullModeFlags>(Rasterizer->cullMode));
+		AddValue(Key, Rasterizer->frontFace);
+		AddValue(Key, Rasterizer->depthBiasEnable);
+		Key.Add(Rasterizer->depthBiasConstantFactor);
+		Key.Add(Rasterizer->depthBiasClamp);
+		Key.Add(Rasterizer->depthBiasSlopeFactor);
+		Key.Add(Rasterizer->lineWidth);
+	}
+
+	if (const vk::PipelineMultisampleStateCreateInfo* Multisampling = CreateInfo.pMultisampleState)
+	{
+		AddValue(Key, Multisampling->rasterizationSamples);
+		AddValue(Key, Multisampling->sampleShadingEnable);
+		Key.Add(Multisampling->minSampleShading);
+		if (Multisampling->pSampleMask)
+		{
+			const uint32_t MaskWords = (static_cast<uint32_t>(Multisampling->rasterizationSamples) + 31) / 32;
+			Key.AddBytes(Multisampling->pSampleMask, MaskWords * sizeof(vk::SampleMask));
+		}
+		AddValue(Key, Multisampling->alphaToCoverageEnable);
+		AddValue(Key, Multisampling->alphaToOneEnable);
+	}
+
+	if (const vk::PipelineDepthStencilStateCreateInfo* DepthStencil = CreateInfo.pDepthStencilState)
+	{
+		AddValue(Key, DepthStencil->depthTestEnable);
+		AddValue(Key, DepthStencil->depthWriteEnable);
+		AddValue(Key, DepthStencil->depthCompareOp);
+		AddValue(Key, DepthStencil->depthBoundsTestEnable);
+		AddValue(Key, DepthStencil->stencilTestEnable);
+		Key.Add(DepthStencil->front);
+		Key.Add(DepthStencil->back);
+		Key.Add(DepthStencil->minDepthBounds);
+		Key.Add(DepthStencil->maxDepthBounds);
+	}
+
+	if (const vk::PipelineColorBlendStateCreateInfo* ColorBlending = CreateInfo.pColorBlendState)
+	{
+		AddValue(Key, ColorBlending->logicOpEnable);
+		AddValue(Key, ColorBlending->logicOp);
+		AddValue(Key, ColorBlending->attachmentCount);
+		for (uint32_t i = 0; i < ColorBlending->attachmentCount; ++i)
+		{
+			Key.Add(ColorBlending->pAttachments[i]);
+		}
+		for (float BlendConstant : ColorBlending->blendConstants)
+		{
+			Key.Add(BlendConstant);
+		}
+	}
+
+	//Render pass by definition rather than handle, compatible render passes can share pipelines. Layouts come
+	//from VulkanLayoutCache, which hands out one handle per definition
+	Key.Add(LayoutHash);
+	Key.Add(static_cast<VkPipelineLayout>(CreateInfo.layout));
+	Key.Add(RenderPassHash);
+	AddValue(Key, CreateInfo.subpass);
+
+	return Key;
+}
+
+HashKey VulkanPipelineCache::GetComputePipelineKey(const vk::ComputePipelineCreateInfo& CreateInfo, uint64_t ShaderHash, uint64_t LayoutHash)
+{
+	//Tagged like graphics keys, a compute pipeline can never match a graphics one of similar state
+	HashKey Key;
+	Key.AddString("compute");
+	AddValue(Key, static_cast<VkPipelineCreateFlags>(CreateInfo.flags));
+	Key.Add(ShaderHash);
+	Key.AddString(CreateInfo.stage.pName);
+
+	if (const vk::SpecializationInfo* Specialization = CreateInfo.stage.pSpecializationInfo)
+	{
+		for (uint32_t Entry = 0; Entry < Specialization->mapEntryCount; ++Entry)
+		{
+			AddValue(Key, Specialization->pMapEntries[Entry].constantID);
+			AddValue(Key, Specialization->pMapEntries[Entry].offset);
+			AddValue(Key, Specialization->pMapEntries[Entry].size);
+		}
+		AddValue(Key, Specialization->dataSize);
+		Key.AddBytes(Specialization->pData, Specialization->dataSize);
+	}
+
+	Key.Add(LayoutHash);
+	Key.Add(static_cast<VkPipelineLayout>(CreateInfo.layout));
+	return Key;
+}
+
+HashKey VulkanPipelineCache::GetPipelineLayoutKey(const std::vector<std::vector<vk::DescriptorSetLayoutBinding>>& SetLayouts, const std::vector<vk::PushConstantRange>& PushConstantRanges)
+{
+	HashKey Key;
+	AddValue(Key, SetLayouts.size());
+	for (const std::vector<vk::DescriptorSetLayoutBinding>& SetLayout : SetLayouts)
+	{
+		AddValue(Key, SetLayout.size());
+		for (const vk::DescriptorSetLayoutBinding& Binding : SetLayout)
+		{
+			AddValue(Key, Binding.binding);
+			AddValue(Key, Binding.descriptorType);
+			AddValue(Key, Binding.descriptorCount);
+			AddValue(Key, static_cast<VkShaderStageFlags>(Binding.stageFlags));
+		}
+	}
+	for (const vk::PushConstantRange& Range : PushConstantRanges)
+	{
+		AddValue(Key, static_cast<VkShaderStageFlags>(Range.stageFlags));
+		AddValue(Key, Range.offset);
+		AddValue(Key, Range.size);
+	}
+	return Key;
+}
+
+uint64_t VulkanPipelineCache::HashGraphicsPipeline(const vk::GraphicsPipelineCreateInfo& CreateInfo, const std::vector<uint64_t>& ShaderHashes, uint64_t LayoutHash, uint64_t RenderPassHash)
+{
+	return GetGraphicsPipelineKey(CreateInfo, ShaderHashes, LayoutHash, RenderPassHash).GetHash();
+}
+
+uint64_t VulkanPipelineCache::HashComputePipeline(const vk::ComputePipelineCreateInfo& CreateInfo, uint64_t ShaderHash, uint64_t LayoutHash)
+{
+	return GetComputePipelineKey(CreateInfo, ShaderHash, LayoutHash).GetHash();
+}
+
+uint64_t VulkanPipelineCache::HashPipelineLayout(const std::vector<std::vector<vk::DescriptorSetLayoutBinding>>& SetLayouts, const std::vector<vk::PushConstantRange>& PushConstantRanges)
+{
+	return GetPipelineLayoutKey(SetLayouts, PushConstantRanges).GetHash();
+}
+
+std::unordered_map<uint64_t, VulkanPipelineCache::PipelineStats> VulkanPipelineCache::GetStats() const
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	return Stats;
+}
+
+void VulkanPipelineCache::PrintStats(size_t MaxCount)
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+
+	std::vector<const PipelineStats*> Sorted;
+	double TotalMilliseconds = 0.0;
+	for (const auto& Entry : Stats)
+	{
+		Sorted.push_back(&Entry.second);
+		TotalMilliseconds += Entry.second.CreateMilliseconds;
+	}
+
+	std::sort(Sorted.begin(), Sorted.end(), [](const PipelineStats* A, const PipelineStats* B)
+	{
+		return A->CreateMilliseconds > B->CreateMilliseconds;
+	});
+
+	std::cout << "Pipelines: " << Stats.size() << " unique, " << std::fixed << std::setprecision(2) << TotalMilliseconds << " ms creating" << std::endl;
+	for (size_t i = 0; i < Sorted.size() && i < MaxCount; ++i)
+	{
+		std::cout << "  " << std::setw(9) << Sorted[i]->CreateMilliseconds << " ms  " << std::setw(4) << Sorted[i]->Requests << " requests  "
+			<< std::hex << std::setw(16) << std::setfill('0') << Sorted[i]->Hash << std::dec << std::setfill(' ') << "  " << Sorted[i]->DebugName << std::endl;
+	}
+}
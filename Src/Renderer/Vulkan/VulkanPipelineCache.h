@@ -0,0 +1,119 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <vector>
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+
+#include "../Core/Hash.h"
+
+//Pipeline shared by every VulkanGraphicsPipeline (or VulkanComputePipeline) built with identical state, released to
+//the deletion queue once the last of them lets go of it
+typedef std::shared_ptr<vk::Pipeline> SharedPipeline;
+
+//One pipeline of a batch passed to VulkanPipelineCache::GetGraphicsPipelines
+struct GraphicsPipelineRequest
+{
+	const vk::GraphicsPipelineCreateInfo* CreateInfo = nullptr;
+	std::vector<uint64_t> ShaderHashes;
+	uint64_t LayoutHash = 0;
+	uint64_t RenderPassHash = 0; //VulkanRenderPassCache::GetCompatibilityHash of CreateInfo->renderPass
+	std::string DebugName;
+
+	//Index of an earlier request this one is created as a derivative of, -1 for none. Derivation flags and base
+	//pipeline fields of CreateInfo are ignored, the cache sets them
+	int32_t ParentIndex = -1;
+};
+
+//Deduplicates graphics and compute pipelines by their full create info
+//
+//Everything in the create info goes into the key by value: fixed function state, dynamic states, shader stages (through
+//hashes of their SpirV, modules are recreated every build), the pipeline layout (through a hash of its set layouts
+//and push constants, plus its handle) and the render pass (through its compatibility hash, see VulkanRenderPassCache).
+//Pipelines are looked up by the whole key, a collision of its 64 bit hash can't hand out the wrong pipeline.
+//Pipelines that miss are compiled through a vk::PipelineCache that can be persisted to disk between runs.
+//
+//Thread safe: pipelines can be requested from job system workers, all of them share the driver cache.
+class VulkanPipelineCache
+{
+public:
+
+	//Creates the driver cache, seeded from Filename if it holds data from this device and driver.
+	//Called from the render thread, pipeline compiles stalling it mid-session get logged
+	void Load(const std::string& Filename);
+
+	//Writes the driver cache back to the file passed to Load
+	void Save();
+
+	//Device idle: drops the driver cache (pipelines still referenced are unaffected)
+	void Clear();
+
+	vk::PipelineCache GetHandle() { return DriverCache.get(); }
+
+	//ShaderHashes holds one hash per entry of CreateInfo.pStages (e.g. HashBytes of its SpirV), LayoutHash
+	//identifies the definition of CreateInfo.layout. DebugName only shows up in PrintStats
+	SharedPipeline GetGraphicsPipeline(const vk::GraphicsPipelineCreateInfo& CreateInfo, const std::vector<uint64_t>& ShaderHashes, uint64_t LayoutHash, const std::string& DebugName = "");
+
+	//Same for a batch: every pipeline that misses is created in a single createGraphicsPipelines call, which lets
+	//the driver share work between derivatives and their parents. Returns one pipeline per request
+	std::vector<SharedPipeline> GetGraphicsPipelines(const std::vector<GraphicsPipelineRequest>& Requests);
+
+	//Compute pipelines share the cache (and the stats), ShaderHash identifies the SpirV of CreateInfo.stage
+	SharedPipeline GetComputePipeline(const vk::ComputePipelineCreateInfo& CreateInfo, uint64_t ShaderHash, uint64_t LayoutHash, const std::string& DebugName = "");
+
+	//Keys the cache compares, the Hash functions below hash them
+	static HashKey GetGraphicsPipelineKey(const vk::GraphicsPipelineCreateInfo& CreateInfo, const std::vector<uint64_t>& ShaderHashes, uint64_t LayoutHash, uint64_t RenderPassHash);
+	static HashKey GetComputePipelineKey(const vk::ComputePipelineCreateInfo& CreateInfo, uint64_t ShaderHash, uint64_t LayoutHash);
+	static HashKey GetPipelineLayoutKey(const std::vector<std::vector<vk::DescriptorSetLayoutBinding>>& SetLayouts, const std::vector<vk::PushConstantRange>& PushConstantRanges);
+
+	static uint64_t HashGraphicsPipeline(const vk::GraphicsPipelineCreateInfo& CreateInfo, const std::vector<uint64_t>& ShaderHashes, uint64_t LayoutHash, uint64_t RenderPassHash);
+
+	static uint64_t HashComputePipeline(const vk::ComputePipelineCreateInfo& CreateInfo, uint64_t ShaderHash, uint64_t LayoutHash);
+
+	//Hash of a pipeline layout's definition, identically defined layouts are interchangeable
+	static uint64_t HashPipelineLayout(const std::vector<std::vector<vk::DescriptorSetLayoutBinding>>& SetLayouts, const std::vector<vk::PushConstantRange>& PushConstantRanges);
+
+	struct PipelineStats
+	{
+		std::string DebugName;
+		uint64_t Hash = 0;
+		double CreateMilliseconds = 0.0; //Time spent in createGraphicsPipelines/createComputePipelines
+		uint32_t Requests = 0;           //Includes the one that created it
+	};
+
+	//Every pipeline created this run, including ones since released
+	std::unordered_map<uint64_t, PipelineStats> GetStats() const;
+
+	//Prints pipelines by creation time, slowest first, to find the permutations that dominate load time
+	void PrintStats(size_t MaxCount = 20);
+
+	//Render thread compiles at least this long are logged as frame time spikes
+	double StallWarningMilliseconds = 1.0;
+
+protected:
+
+	static SharedPipeline MakeShared(vk::Pipeline Pipeline);
+
+	//Logs compiles on the render thread after the first frame, they show up as frame time spikes
+	void ReportStall(double ElapsedMs, const std::vector<std::string>& DebugNames) const;
+
+	vk::UniquePipelineCache DriverCache;
+	std::string CacheFilename;
+	std::thread::id RenderThread;
+
+	//Guards Pipelines and Stats. Stats are by hash, only for display
+	mutable std::mutex Mutex;
+
+	struct CachedPipeline
+	{
+		std::weak_ptr<vk::Pipeline> Pipeline;
+		bool bAllowsDerivatives = false;
+	};
+
+	std::unordered_map<HashKey, CachedPipeline, HashKey::Hasher> Pipelines;
+	std::unordered_map<uint64_t, PipelineStats> Stats;
+};
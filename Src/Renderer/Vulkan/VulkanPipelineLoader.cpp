@@ -0,0 +1,390 @@
+#include "VulkanPipelineLoader.h"
+
+#include "VulkanGraphicsPipeline.h"
+
+#include <map>
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+
+namespace
+{
+	//Bools are accepted as json bools or "true"/"false" strings
+	void ReadBool(const nlohmann::json& Object, const char* Key, vk::Bool32& Value)
+	{
+		auto Found = Object.find(Key);
+		if (Found == Object.end())
+		{
+			return;
+		}
+
+		if (Found->is_boolean())
+		{
+			Value = Found->get<bool>() ? VK_TRUE : VK_FALSE;
+		}
+		else if (Found->is_string())
+		{
+			Value = (Found->get<std::string>() == "true") ? VK_TRUE : VK_FALSE;
+		}
+	}
+
+	template<typename T>
+	void ReadNumber(const nlohmann::json& Object, const char* Key, T& Value)
+	{
+		auto Found = Object.find(Key);
+		if (Found != Object.end() && Found->is_number())
+		{
+			Value = Found->get<T>();
+		}
+	}
+
+	template<typename T>
+	void ReadEnum(const nlohmann::json& Object, const char* Key, const std::map<std::string, T>& Names, T& Value)
+	{
+		auto Found = Object.find(Key);
+		if (Found == Object.end())
+		{
+			return;
+		}
+
+		auto Name = Names.find(Found->is_string() ? Found->get<std::string>() : std::string());
+		if (Name == Names.end())
+		{
+			std::cout << "Warning: unknown pipeline " << Key << " " << Found->dump() << ", keeping default" << std::endl;
+			return;
+		}
+		Value = Name->second;
+	}
+
+	const std::map<std::string, vk::PrimitiveTopology> Topologies = {
+		{ "point_list", vk::PrimitiveTopology::ePointList },
+		{ "line_list", vk::PrimitiveTopology::eLineList },
+		{ "line_strip", vk::PrimitiveTopology::eLineStrip },
+		{ "triangle_list", vk::PrimitiveTopology::eTriangleList },
+		{ "triangle_strip", vk::PrimitiveTopology::eTriangleStrip },
+		{ "triangle_fan", vk::PrimitiveTopology::eTriangleFan },
+		{ "patch_list", vk::PrimitiveTopology::ePatchList },
+	};
+
+	const std::map<std::string, vk::PolygonMode> PolygonModes = {
+		{ "fill", vk::PolygonMode::eFill },
+		{ "line", vk::PolygonMode::eLine },
+		{ "point", vk::PolygonMode::ePoint },
+	};
+
+	const std::map<std::string, vk::CullModeFlags> CullModes = {
+		{ "none", vk::CullModeFlagBits::eNone },
+		{ "front", vk::CullModeFlagBits::eFront },
+		{ "back", vk::CullModeFlagBits::eBack },
+		{ "front_and_back", vk::CullModeFlagBits::eFrontAndBack },
+	};
+
+	const std::map<std::string, vk::FrontFace> FrontFaces = {
+		{ "counter_clockwise", vk::FrontFace::eCounterClockwise },
+		{ "clockwise", vk::FrontFace::eClockwise },
+	};
+
+	const std::map<std::string, vk::CompareOp> CompareOps = {
+		{ "never", vk::CompareOp::eNever },
+		{ "less", vk::CompareOp::eLess },
+		{ "equal", vk::CompareOp::eEqual },
+		{ "less_or_equal", vk::CompareOp::eLessOrEqual },
+		{ "greater", vk::CompareOp::eGreater },
+		{ "not_equal", vk::CompareOp::eNotEqual },
+		{ "greater_or_equal", vk::CompareOp::eGreaterOrEqual },
+		{ "always", vk::CompareOp::eAlways },
+	};
+
+	const std::map<std::string, vk::BlendFactor> BlendFactors = {
+		{ "zero", vk::BlendFactor::eZero },
+		{ "one", vk::BlendFactor::eOne },
+		{ "src_color", vk::BlendFactor::eSrcColor },
+		{ "one_minus_src_color", vk::BlendFactor::eOneMinusSrcColor },
+		{ "dst_color", vk::BlendFactor::eDstColor },
+		{ "one_minus_dst_color", vk::BlendFactor::eOneMinusDstColor },
+		{ "src_alpha", vk::BlendFactor::eSrcAlpha },
+		{ "one_minus_src_alpha", vk::BlendFactor::eOneMinusSrcAlpha },
+		{ "dst_alpha", vk::BlendFactor::eDstAlpha },
+		{ "one_minus_dst_alpha", vk::BlendFactor::eOneMinusDstAlpha },
+	};
+
+	const std::map<std::string, vk::BlendOp> BlendOps = {
+		{ "add", vk::BlendOp::eAdd },
+		{ "subtract", vk::BlendOp::eSubtract },
+		{ "reverse_subtract", vk::BlendOp::eReverseSubtract },
+		{ "min", vk::BlendOp::eMin },
+		{ "max", vk::BlendOp::eMax },
+	};
+
+	const std::map<std::string, vk::DynamicState> DynamicStateNames = {
+		{ "viewport", vk::DynamicState::eViewport },
+		{ "scissor", vk::DynamicState::eScissor },
+		{ "line_width", vk::DynamicState::eLineWidth },
+		{ "depth_bias", vk::DynamicState::eDepthBias },
+		{ "blend_constants", vk::DynamicState::eBlendConstants },
+		{ "depth_bounds", vk::DynamicState::eDepthBounds },
+		{ "stencil_compare_mask", vk::DynamicState::eStencilCompareMask },
+		{ "stencil_write_mask", vk::DynamicState::eStencilWriteMask },
+		{ "stencil_reference", vk::DynamicState::eStencilReference },
+	};
+
+	void AddDynamicState(std::vector<vk::DynamicState>& DynamicStates, const std::string& Name, bool bEnabled)
+	{
+		auto Found = DynamicStateNames.find(Name);
+		if (Found == DynamicStateNames.end())
+		{
+			std::cout << "Warning: unknown dynamic state " << Name << std::endl;
+			return;
+		}
+
+		DynamicStates.erase(std::remove(DynamicStates.begin(), DynamicStates.end(), Found->second), DynamicStates.end());
+		if (bEnabled)
+		{
+			DynamicStates.push_back(Found->second);
+		}
+	}
+}
+
+VulkanPipelineLoader::VulkanPipelineLoader(AssetReadFunction InReadAsset, ShaderCompileFunction InCompileShader)
+	: ReadAsset(std::move(InReadAsset)), CompileShader(std::move(InCompileShader))
+{
+}
+
+std::vector<std::unique_ptr<VulkanGraphicsPipeline>> VulkanPipelineLoader::LoadPipelines(const std::vector<std::string>& Names, VulkanRenderPass& RenderPass)
+{
+	std::vector<nlohmann::json> Descriptions(Names.size());
+	for (size_t i = 0; i < Names.size(); ++i)
+	{
+		std::vector<std::string> Bases;
+		std::string Error;
+		if (!LoadPipelineDescription(Names[i], ReadAsset, Descriptions[i], Bases, Error))
+		{
+			std::cout << "Failed to load pipeline: " << Error << std::endl;
+			throw std::runtime_error("Failed to load pipeline: " + Error);
+		}
+	}
+
+	//A pipeline derives from its base only if the base is part of this batch
+	std::vector<int32_t> Parents(Names.size(), -1);
+	for (size_t i = 0; i < Names.size(); ++i)
+	{
+		if (Descriptions[i].count("derived_from"))
+		{
+			auto Parent = std::find(Names.begin(), Names.end(), Descriptions[i]["derived_from"].get<std::string>());
+			Parents[i] = (Parent != Names.end()) ? static_cast<int32_t>(Parent - Names.begin()) : -1;
+		}
+	}
+
+	//Parents have to come before their derivatives in the batch (base_pipeline chains can't loop, the
+	//description loader rejects cycles)
+	std::vector<size_t> BuildOrder;
+	std::vector<int32_t> BuildPositions(Names.size(), -1);
+	std::function<void(size_t)> AddToBuild = [&](size_t Index)
+	{
+		if (BuildPositions[Index] >= 0)
+		{
+			return;
+		}
+		if (Parents[Index] >= 0)
+		{
+			AddToBuild(Parents[Index]);
+		}
+		BuildPositions[Index] = static_cast<int32_t>(BuildOrder.size());
+		BuildOrder.push_back(Index);
+	};
+	for (size_t i = 0; i < Names.size(); ++i)
+	{
+		AddToBuild(i);
+	}
+
+	std::vector<std::unique_ptr<VulkanGraphicsPipeline>> Pipelines(Names.size());
+	std::vector<VulkanGraphicsPipeline*> Batch;
+	std::vector<int32_t> BatchParents;
+	for (size_t Index : BuildOrder)
+	{
+		const nlohmann::json& Description = Descriptions[Index]["pipeline"];
+
+		Pipelines[Index].reset(new VulkanGraphicsPipeline());
+		VulkanGraphicsPipeline& Pipeline = *Pipelines[Index];
+		Pipeline.DebugName = Names[Index];
+		ApplyDescription(Description, Pipeline);
+
+		auto VertexShader = Description.find("vertex_shader");
+		auto FragmentShader = Description.find("fragment_shader");
+		if (VertexShader == Description.end() || FragmentShader == Description.end() || !VertexShader->is_string() || !FragmentShader->is_string())
+		{
+			std::cout << "Pipeline " << Names[Index] << " is missing its shaders" << std::endl;
+			throw std::runtime_error("Pipeline is missing its shaders: " + Names[Index]);
+		}
+
+		Pipeline.BeginBuild(RenderPass, LoadShader(VertexShader->get<std::string>()), LoadShader(FragmentShader->get<std::string>()));
+
+		Batch.push_back(&Pipeline);
+		BatchParents.push_back((Parents[Index] >= 0) ? BuildPositions[Parents[Index]] : -1);
+	}
+
+	VulkanGraphicsPipeline::BuildPipelines(Batch, BatchParents);
+
+	return Pipelines;
+}
+
+void VulkanPipelineLoader::ApplyDescription(const nlohmann::json& Description, VulkanGraphicsPipeline& Pipeline)
+{
+	static const nlohmann::json Empty = nlohmann::json::object();
+	auto Section = [&](const char* Name) -> const nlohmann::json&
+	{
+		auto Found = Description.find(Name);
+		return (Found != Description.end() && Found->is_object()) ? *Found : Empty;
+	};
+
+	const nlohmann::json& InputAssembly = Section("input_assembly");
+	ReadEnum(InputAssembly, "topology", Topologies, Pipeline.InputAssembly.topology);
+	ReadBool(InputAssembly, "primitive_restart", Pipeline.InputAssembly.primitiveRestartEnable);
+
+	ReadNumber(Section("tessellation"), "patch_control_points", Pipeline.Tessellation.patchControlPoints);
+
+	const nlohmann::json& Viewport = Section("viewport");
+	ReadNumber(Viewport, "min_depth", Pipeline.Viewport.minDepth);
+	ReadNumber(Viewport, "max_depth", Pipeline.Viewport.maxDepth);
+
+	const nlohmann::json& Rasterization = Section("rasterization");
+	ReadBool(Rasterization, "depth_clamp_enable", Pipeline.Rasterizer.depthClampEnable);
+	ReadBool(Rasterization, "rasterizer_discard_enable", Pipeline.Rasterizer.rasterizerDiscardEnable);
+	ReadEnum(Rasterization, "polygon_mode", PolygonModes, Pipeline.Rasterizer.polygonMode);
+	ReadEnum(Rasterization, "cull_mode", CullModes, Pipeline.Rasterizer.cullMode);
+	ReadEnum(Rasterization, "front_face", FrontFaces, Pipeline.Rasterizer.frontFace);
+	ReadBool(Rasterization, "depth_bias_enable", Pipeline.Rasterizer.depthBiasEnable);
+	ReadNumber(Rasterization, "depth_bias_factor", Pipeline.Rasterizer.depthBiasConstantFactor);
+	ReadNumber(Rasterization, "depth_bias_clamp", Pipeline.Rasterizer.depthBiasClamp);
+	ReadNumber(Rasterization, "depth_bias_slope", Pipeline.Rasterizer.depthBiasSlopeFactor);
+	ReadNumber(Rasterization, "line_width", Pipeline.Rasterizer.lineWidth);
+
+	const nlohmann::json& Multisample = Section("multisample");
+	uint32_t Samples = static_cast<uint32_t>(Pipeline.Multisampling.rasterizationSamples);
+	ReadNumber(Multisample, "samples", Samples);
+	Pipeline.Multisampling.rasterizationSamples = static_cast<vk::SampleCountFlagBits>(Samples);
+	ReadBool(Multisample, "sample_shading_enable", Pipeline.Multisampling.sampleShadingEnable);
+	ReadNumber(Multisample, "min_sample_shading", Pipeline.Multisampling.minSampleShading);
+	ReadBool(Multisample, "alpha_to_coverage_enable", Pipeline.Multisampling.alphaToCoverageEnable);
+	ReadBool(Multisample, "alpha_to_one_enable", Pipeline.Multisampling.alphaToOneEnable);
+
+	const nlohmann::json& DepthStencil = Section("depth_stencil");
+	ReadBool(DepthStencil, "depth_test_enable", Pipeline.DepthStencil.depthTestEnable);
+	ReadBool(DepthStencil, "depth_write_enable", Pipeline.DepthStencil.depthWriteEnable);
+	ReadEnum(DepthStencil, "depth_compare_op", CompareOps, Pipeline.DepthStencil.depthCompareOp);
+	ReadBool(DepthStencil, "depth_bounds_test_enable", Pipeline.DepthStencil.depthBoundsTestEnable);
+	ReadBool(DepthStencil, "stencil_test_enable", Pipeline.DepthStencil.stencilTestEnable);
+	ReadNumber(DepthStencil, "min_depth_bounds", Pipeline.DepthStencil.minDepthBounds);
+	ReadNumber(DepthStencil, "max_depth_bounds", Pipeline.DepthStencil.maxDepthBounds);
+
+	//Applies to every color attachment
+	const nlohmann::json& ColorBlend = Section("color_blend");
+	vk::PipelineColorBlendAttachmentState& Attachment = Pipeline.ColorBlendAttachment;
+	ReadBool(ColorBlend, "blend_enable", Attachment.blendEnable);
+	ReadEnum(ColorBlend, "src_color_factor", BlendFactors, Attachment.srcColorBlendFactor);
+	ReadEnum(ColorBlend, "dst_color_factor", BlendFactors, Attachment.dstColorBlendFactor);
+	ReadEnum(ColorBlend, "color_op", BlendOps, Attachment.colorBlendOp);
+	ReadEnum(ColorBlend, "src_alpha_factor", BlendFactors, Attachment.srcAlphaBlendFactor);
+	ReadEnum(ColorBlend, "dst_alpha_factor", BlendFactors, Attachment.dstAlphaBlendFactor);
+	ReadEnum(ColorBlend, "alpha_op", BlendOps, Attachment.alphaBlendOp);
+	if (ColorBlend.count("write_mask") && ColorBlend["write_mask"].is_string())
+	{
+		//"rgba", any subset
+		const std::string WriteMask = ColorBlend["write_mask"].get<std::string>();
+		Attachment.colorWriteMask = vk::ColorComponentFlags();
+		if (WriteMask.find('r') != std::string::npos) Attachment.colorWriteMask |= vk::ColorComponentFlagBits::eR;
+		if (WriteMask.find('g') != std::string::npos) Attachment.colorWriteMask |= vk::ColorComponentFlagBits::eG;
+		if (WriteMask.find('b') != std::string::npos) Attachment.colorWriteMask |= vk::ColorComponentFlagBits::eB;
+		if (WriteMask.find('a') != std::string::npos) Attachment.colorWriteMask |= vk::ColorComponentFlagBits::eA;
+	}
+	if (ColorBlend.count("blend_constants") && ColorBlend["blend_constants"].is_array())
+	{
+		const nlohmann::json& Constants = ColorBlend["blend_constants"];
+		for (size_t i = 0; i < Constants.size() && i < 4; ++i)
+		{
+			Pipeline.ColorBlending.blendConstants[i] = Constants[i].get<float>();
+		}
+	}
+
+	//{"vertex": {"bUseFog": true}, "fragment": {"LightCount": 4}}, by name or constant_id
+	const nlohmann::json& Specialization = Section("specialization");
+	const std::pair<const char*, vk::ShaderStageFlagBits> Stages[] = {
+		{ "vertex", vk::ShaderStageFlagBits::eVertex },
+		{ "fragment", vk::ShaderStageFlagBits::eFragment },
+	};
+	for (const auto& Stage : Stages)
+	{
+		auto Constants = Specialization.find(Stage.first);
+		if (Constants == Specialization.end() || !Constants->is_object())
+		{
+			continue;
+		}
+
+		for (auto Constant = Constants->begin(); Constant != Constants->end(); ++Constant)
+		{
+			//Integers are kept as integers, 64 bit constants don't fit a double
+			std::map<std::string, SpecializationValue>& Values = Pipeline.SpecializationConstants[Stage.second];
+			if (Constant->is_boolean())
+			{
+				Values[Constant.key()] = SpecializationValue(Constant->get<bool>());
+			}
+			else if (Constant->is_number_unsigned())
+			{
+				Values[Constant.key()] = SpecializationValue(Constant->get<uint64_t>());
+			}
+			else if (Constant->is_number_integer())
+			{
+				Values[Constant.key()] = SpecializationValue(Constant->get<int64_t>());
+			}
+			else if (Constant->is_number())
+			{
+				Values[Constant.key()] = SpecializationValue(Constant->get<double>());
+			}
+		}
+	}
+
+	//Either ["viewport", "scissor"] (replaces the defaults) or {"line_width": true, "scissor": false} (edits them)
+	auto DynamicStates = Description.find("dynamic_states");
+	if (DynamicStates != Description.end())
+	{
+		if (DynamicStates->is_array())
+		{
+			Pipeline.DynamicStates.clear();
+			for (const nlohmann::json& State : *DynamicStates)
+			{
+				AddDynamicState(Pipeline.DynamicStates, State.get<std::string>(), true);
+			}
+		}
+		else if (DynamicStates->is_object())
+		{
+			for (auto State = DynamicStates->begin(); State != DynamicStates->end(); ++State)
+			{
+				vk::Bool32 bEnabled = VK_FALSE;
+				ReadBool(*DynamicStates, State.key().c_str(), bEnabled);
+				AddDynamicState(Pipeline.DynamicStates, State.key(), bEnabled == VK_TRUE);
+			}
+		}
+	}
+}
+
+std::vector<unsigned int> VulkanPipelineLoader::LoadShader(const std::string& Name)
+{
+	const std::string AssetName = "shaders/" + Name;
+
+	const bool bSpirV = Name.size() >= 4 && Name.compare(Name.size() - 4, 4, ".spv") == 0;
+	if (!bSpirV)
+	{
+		return CompileShader(AssetName);
+	}
+
+	std::vector<uint8_t> Data;
+	if (!ReadAsset(AssetName, Data))
+	{
+		std::cout << "Failed to open shader: " << AssetName << std::endl;
+		throw std::runtime_error("Failed to open shader: " + AssetName);
+	}
+
+	std::vector<unsigned int> SpirV(Data.size() / sizeof(unsigned int));
+	memcpy(SpirV.data(), Data.data(), SpirV.size() * sizeof(unsigned int));
+	return SpirV;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <json/json.hpp>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include "../Core/PipelineDescription.h"
+
+class VulkanGraphicsPipeline;
+class VulkanRenderPass;
+
+//Builds VulkanGraphicsPipelines from pipeline descriptions (see PipelineDescription.h)
+//
+//  VulkanPipelineLoader Loader(ReadAsset, CompileShader);
+//  auto Pipelines = Loader.LoadPipelines({"pipelines/BasePipeline.json", "pipelines/TestPipeline.json"}, RenderPass);
+//
+//Every pipeline of a LoadPipelines call is created in one batch. A pipeline whose base_pipeline is loaded in the
+//same batch is created as a derivative of it, others are created on their own (their base's values still apply).
+class VulkanPipelineLoader
+{
+public:
+
+	//Compiles a shader source (by asset name) to SpirV
+	typedef std::function<std::vector<unsigned int>(const std::string& Name)> ShaderCompileFunction;
+
+	VulkanPipelineLoader(AssetReadFunction ReadAsset, ShaderCompileFunction CompileShader);
+
+	//Returns one pipeline per name, in the same order. Throws if a description or shader can't be loaded
+	std::vector<std::unique_ptr<VulkanGraphicsPipeline>> LoadPipelines(const std::vector<std::string>& Names, VulkanRenderPass& RenderPass);
+
+	//Applies the fixed function state of a "pipeline" object, state it doesn't mention keeps its current value
+	static void ApplyDescription(const nlohmann::json& Description, VulkanGraphicsPipeline& Pipeline);
+
+protected:
+
+	//Shaders are named relative to the "shaders" asset directory, .spv files are loaded as is
+	std::vector<unsigned int> LoadShader(const std::string& Name);
+
+	AssetReadFunction ReadAsset;
+	ShaderCompileFunction CompileShader;
+};
@@ -4,9 +4,61 @@
 #include "VulkanBuffer.h"
 #include "VulkanCommandBuffer.h"
 #include "VulkanGraphicsPipeline.h"
-#include "spirv_reflect.h"
 
 #include <map>
+#include <cassert>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+//Descriptor sets bound while recording one command buffer. Sets are only rebound when they change, or when a
+//pipeline switch makes them incompatible (pipelines sharing layouts through VulkanLayoutCache keep theirs)
+struct DescriptorBindState
+{
+    //Bound once by the recorder for every pipeline using set 0, render items then skip their own
+    vk::DescriptorSet FrameDescriptorSet;
+
+    vk::PipelineLayout Layout;
+    std::vector<vk::DescriptorSetLayout> SetLayouts;
+    vk::PushConstantRange PushConstantRange;
+    std::vector<vk::DescriptorSet> Sets;
+
+    //Call after binding Pipeline, forgets the sets its layout isn't compatible with
+    void SetPipeline(VulkanGraphicsPipeline& Pipeline)
+    {
+        const std::vector<vk::DescriptorSetLayout>& NewSetLayouts = Pipeline.GetDescriptorSetLayouts();
+
+        //Sets stay bound up to the first set layout that differs, as long as push constant ranges match
+        size_t Compatible = 0;
+        if (PushConstantRange == Pipeline.GetPushConstantRange())
+        {
+            while (Compatible < SetLayouts.size() && Compatible < NewSetLayouts.size() && SetLayouts[Compatible] == NewSetLayouts[Compatible])
+            {
+                ++Compatible;
+            }
+        }
+
+        Sets.resize(std::min(Sets.size(), Compatible));
+        Sets.resize(NewSetLayouts.size());
+
+        Layout = Pipeline.GetLayout();
+        SetLayouts = NewSetLayouts;
+        PushConstantRange = Pipeline.GetPushConstantRange();
+    }
+
+    void Bind(VulkanCommandBuffer& CommandBuffer, uint32_t Set, vk::DescriptorSet DescriptorSet)
+    {
+        assert(Set < Sets.size());
+        if (Sets[Set] == DescriptorSet)
+        {
+            return;
+        }
+
+        CommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eGraphics, Layout, Set, 1, &DescriptorSet, 0, nullptr);
+        Sets[Set] = DescriptorSet;
+    }
+};
 
 //Represents a Renderable Entity (static/skinned meshes, full-screen quad, sprites)
 class VulkanRenderItem
@@ -18,96 +70,120 @@ public:
         IndexCount(NumIndices)
     {}
 
+    //Takes buffers whose contents were already uploaded (see VulkanAssetLoader::LoadMesh)
+    VulkanRenderItem(VulkanBuffer&& InVertexBuffer, VulkanBuffer&& InIndexBuffer, uint32_t NumIndices) :
+        VertexBuffer(std::move(InVertexBuffer)),
+        IndexBuffer(std::move(InIndexBuffer)),
+        IndexCount(NumIndices)
+    {}
+
     //Takes in a command buffer and adds the necessary binds and draw calls for this render item
-    void AddCommands(VulkanCommandBuffer& CommandBuffer, VulkanGraphicsPipeline* Pipeline)
+    //BindState must have been told about the pipeline bound for it (see DescriptorBindState::SetPipeline)
+    void AddCommands(VulkanCommandBuffer& CommandBuffer, VulkanGraphicsPipeline* Pipeline, DescriptorBindState& BindState)
     {
         assert(Pipeline != nullptr);
 
         vk::Buffer VertexBuffers[] = {VertexBuffer.GetHandle()};
         vk::DeviceSize Offsets[] = {0};
 
-        //Create Descriptor Set for this pipeline if we don't yet have one for this render item
-        auto& FoundDescriptorData = PipelineDescriptors.find(Pipeline);
-        if (FoundDescriptorData == PipelineDescriptors.end())
-        {
-            //TODO: Potential race condition when building up Command buffers in parallel
-            FoundDescriptorData = PipelineDescriptors.emplace(Pipeline, Pipeline->AllocateDescriptorSets(1)).first;
-            
-            //TODO: Need way to update descriptor set / fill it with meaningful data (currently hard coded for testing)
-            auto& DescriptorSet = FoundDescriptorData->second.Sets[0].get();
-            UpdateDescriptorSet(DescriptorSet, *Pipeline);
-        }
-        auto& DescriptorSet = FoundDescriptorData->second.Sets[0].get();
-
-        //[1] Bind Descriptor Set
-        CommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eGraphics, Pipeline->GetLayout(), 0, 1, &DescriptorSet, 0, nullptr);
-        //[2] Bind Vertex Buffer
-        CommandBuffer().bindVertexBuffers(0, 1, VertexBuffers, Offsets);
-        //[3] Bind Index Buffer
-        CommandBuffer().bindIndexBuffer(IndexBuffer.GetHandle(), 0, vk::IndexType::eUint32);
-        //[4] DrawIndexed
-        CommandBuffer().drawIndexed(IndexCount, 1, 0, 0, 0);
-    }
-
-    void UpdateDescriptorSet(vk::DescriptorSet& DescriptorSet, VulkanGraphicsPipeline& Pipeline)
-    {
-        //TODO: Use name to key into binding using pipeline's descriptor info
-        auto& BindingReflectionMap = Pipeline.GetDescriptorReflection();
-
-        std::vector<vk::WriteDescriptorSet> DescriptorWrites;
-        for (auto& ImageResource : ImageResources)
+        //[1] Bind this item's descriptor sets (material, object, and frame data if the recorder has none), each
+        //created for this pipeline the first time it's drawn with it. The bindless table is bound by the recorder
+        std::map<uint32_t, ItemDescriptorSet>& SetsForPipeline = PipelineDescriptors[Pipeline];
+        for (uint32_t Set = 0; Set < Pipeline->GetDescriptorSetCount(); ++Set)
         {
-            //Find Pipeline Descriptor Binding by name
-            auto& BindingReflection = BindingReflectionMap.find(ImageResource.first);
-            if (BindingReflection != BindingReflectionMap.end())
+            if (!Pipeline->HasDescriptorSet(Set) || Set == DescriptorSetBindless || (Set == DescriptorSetFrame && BindState.FrameDescriptorSet))
             {
-                vk::WriteDescriptorSet ImageWrite;          
-                ImageWrite.dstSet = DescriptorSet;
-                ImageWrite.dstBinding = BindingReflection->second.binding;
-                ImageWrite.dstArrayElement = 0;
-                ImageWrite.descriptorType = vk::DescriptorType::eCombinedImageSampler;
-                ImageWrite.descriptorCount = 1;
-                ImageWrite.pImageInfo = &ImageResource.second;
-                DescriptorWrites.push_back(std::move(ImageWrite));
+                continue;
             }
-        }
 
-        for (auto& BufferResource : BufferResources)
-        {
-            //Find Pipeline Descriptor Binding
-            auto& BindingReflection = BindingReflectionMap.find(BufferResource.first);
-            if (BindingReflection != BindingReflectionMap.end())
+            auto FoundDescriptorData = SetsForPipeline.find(Set);
+            if (FoundDescriptorData == SetsForPipeline.end())
             {
-                vk::WriteDescriptorSet BufferWrite;
-                BufferWrite.dstSet = DescriptorSet;
-                BufferWrite.dstBinding = BindingReflection->second.binding;
-                BufferWrite.dstArrayElement = 0;
-                BufferWrite.descriptorType = vk::DescriptorType::eUniformBuffer;
-                BufferWrite.descriptorCount = 1;
-                BufferWrite.pBufferInfo = &BufferResource.second;
-                DescriptorWrites.push_back(std::move(BufferWrite));
+                //TODO: Potential race condition when building up Command buffers in parallel
+                FoundDescriptorData = SetsForPipeline.emplace(Set, ItemDescriptorSet()).first;
+                ItemDescriptorSet& NewSet = FoundDescriptorData->second;
+                NewSet.Descriptors = Pipeline->AllocateDescriptorSets(1, Set);
+                Pipeline->FillDescriptorSlots(Set, ImageResources, BufferResources, NewSet.Slots);
+                Pipeline->UpdateDescriptorSet(NewSet.Descriptors.Sets[0].get(), Set, NewSet.Slots);
             }
+            BindState.Bind(CommandBuffer, Set, FoundDescriptorData->second.Descriptors.Sets[0].get());
         }
 
-        VulkanContext::Get()->GetDevice().updateDescriptorSets(DescriptorWrites, 0);
+        //[2] Push per-draw data, only the bytes the pipeline's shaders declare
+        const vk::PushConstantRange& PushConstantRange = Pipeline->GetPushConstantRange();
+        if (PushConstantRange.size > 0 && PushConstantData.size() > PushConstantRange.offset)
+        {
+            const uint32_t PushSize = std::min(PushConstantRange.size, static_cast<uint32_t>(PushConstantData.size()) - PushConstantRange.offset);
+            CommandBuffer().pushConstants(Pipeline->GetLayout(), PushConstantRange.stageFlags, PushConstantRange.offset, PushSize, PushConstantData.data() + PushConstantRange.offset);
+        }
+        //[3] Bind Vertex Buffer
+        CommandBuffer().bindVertexBuffers(0, 1, VertexBuffers, Offsets);
+        //[4] Bind Index Buffer
+        CommandBuffer().bindIndexBuffer(IndexBuffer.GetHandle(), 0, vk::IndexType::eUint32);
+        //[5] DrawIndexed
+        CommandBuffer().drawIndexed(IndexCount, 1, 0, 0, 0);
     }
 
     VulkanBuffer VertexBuffer;
     VulkanBuffer IndexBuffer;
     uint32_t     IndexCount;
 
-    std::map<VulkanGraphicsPipeline*, DescriptorData> PipelineDescriptors;
+    //A descriptor set of this item, with the resources laid out for the pipeline's update template
+    struct ItemDescriptorSet
+    {
+        DescriptorData Descriptors;
+        std::vector<DescriptorUpdateSlot> Slots;
+    };
+
+    //Per pipeline, by set
+    std::map<VulkanGraphicsPipeline*, std::map<uint32_t, ItemDescriptorSet>> PipelineDescriptors;
 
     void AddImageResource(const char* Name, vk::DescriptorImageInfo DescriptorImageInfo) 
     {
         ImageResources.emplace(Name, DescriptorImageInfo);
     }
 
+    //Replaces an image resource and rewrites every descriptor set already allocated for this item
+    //Command buffers that bound those sets have to be re-recorded afterwards
+    void SetImageResource(const char* Name, vk::DescriptorImageInfo DescriptorImageInfo)
+    {
+        ImageResources[Name] = DescriptorImageInfo;
+
+        for (auto& PipelineDescriptor : PipelineDescriptors)
+        {
+            for (auto& SetDescriptor : PipelineDescriptor.second)
+            {
+                //Slots are refilled in place, one template update per set
+                ItemDescriptorSet& ItemSet = SetDescriptor.second;
+                PipelineDescriptor.first->FillDescriptorSlots(SetDescriptor.first, ImageResources, BufferResources, ItemSet.Slots);
+                PipelineDescriptor.first->UpdateDescriptorSet(ItemSet.Descriptors.Sets[0].get(), SetDescriptor.first, ItemSet.Slots);
+            }
+        }
+    }
+
     void AddBufferResource(const char* Name, vk::DescriptorBufferInfo DescriptorBufferInfo)
     {
         BufferResources.emplace(Name, DescriptorBufferInfo);
     }
 
+    //Per-draw data (object index, model matrix...) written at Offset of the shaders' push_constant block.
+    //Avoids a uniform write and descriptor set per object. Pushed when command buffers are recorded, so
+    //changing it needs a re-record like any other resource
+    template<typename T>
+    void SetPushConstants(const T& Data, uint32_t Offset = 0)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "push constants are copied byte for byte");
+
+        //Push sizes have to be a multiple of 4
+        const size_t RequiredSize = (Offset + sizeof(T) + 3) & ~size_t(3);
+        if (PushConstantData.size() < RequiredSize)
+        {
+            PushConstantData.resize(RequiredSize, 0);
+        }
+        memcpy(PushConstantData.data() + Offset, &Data, sizeof(T));
+    }
+
     std::map<std::string, vk::DescriptorImageInfo>  ImageResources;
     std::map<std::string, vk::DescriptorBufferInfo> BufferResources;
+    std::vector<uint8_t> PushConstantData;
 };
\ No newline at end of file
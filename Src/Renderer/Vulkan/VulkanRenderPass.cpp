@@ -2,6 +2,8 @@
 
 #include "VulkanContext.h"
 #include "VulkanSwapchain.h"
+#include "VulkanRenderPassCache.h"
+#include "VulkanGPUScene.h"
 #include <functional>
 #include <iostream>
 
@@ -10,21 +12,19 @@ VulkanRenderPass::VulkanRenderPass() : CommandBuffer(true /* bSecondary */)
 
 }
 
-void VulkanRenderPass::BuildRenderPass(std::vector<VulkanRenderTarget*> RenderTargets, VulkanRenderTarget* DepthTarget, uint32_t Width, uint32_t Height, uint32_t BackbufferCount)
+bool VulkanRenderPass::BuildRenderPass(std::vector<VulkanRenderTarget*> RenderTargets, VulkanRenderTarget* DepthTarget, uint32_t Width, uint32_t Height, uint32_t BackbufferCount)
 {
 	//Used by Pipeline to determine number of color blends attachments to add
 	ColorAttachmentCount = (uint32_t)RenderTargets.size();
 
 	//Note: Attachment Descriptions = Prototype, Framebuffer = Actual references
-	std::vector<vk::AttachmentDescription> AttachmentDescriptions;
-	std::vector<vk::AttachmentReference> ColorAttachmentReferences;
-	vk::AttachmentReference DepthAttachmentReference;
+	RenderPassSignature Signature;
 
 	std::vector<std::vector<vk::ImageView>> FramebufferImageViewsPerBackbuffer(BackbufferCount);
 
-	if (DepthTarget != nullptr)
+	bHasDepthTarget = (DepthTarget != nullptr);
+	if (bHasDepthTarget)
 	{
-		bHasDepthTarget = true;
 		RenderTargets.push_back(DepthTarget);
 	}
 
@@ -41,15 +41,16 @@ void VulkanRenderPass::BuildRenderPass(std::vector<VulkanRenderTarget*> RenderTa
 
 		if (RenderTarget == DepthTarget)
 		{
-			DepthAttachmentReference.attachment = i;
-			DepthAttachmentReference.layout = RenderTarget->UsageLayout;
+			Signature.bHasDepth = true;
+			Signature.DepthReference.attachment = i;
+			Signature.DepthReference.layout = RenderTarget->UsageLayout;
 		}
 		else
 		{
 			vk::AttachmentReference AttachmentReference;
 			AttachmentReference.attachment = i;
 			AttachmentReference.layout = RenderTarget->UsageLayout;
-			ColorAttachmentReferences.push_back(std::move(AttachmentReference));
+			Signature.ColorReferences.push_back(std::move(AttachmentReference));
 		}
 
 		vk::AttachmentDescription AttachmentDescription;
@@ -60,7 +61,7 @@ void VulkanRenderPass::BuildRenderPass(std::vector<VulkanRenderTarget*> RenderTa
 		AttachmentDescription.initialLayout = RenderTarget->InitialLayout;
 		AttachmentDescription.finalLayout = RenderTarget->FinalLayout;
 
-		AttachmentDescriptions.push_back(std::move(AttachmentDescription));
+		Signature.Attachments.push_back(std::move(AttachmentDescription));
 
 		//Add each image view of the render target (1 per backbuffer) to its corresponding framebuffer image view array
 		for (size_t i = 0; i < RenderTarget->ImageViews.size(); ++i)
@@ -70,67 +71,87 @@ void VulkanRenderPass::BuildRenderPass(std::vector<VulkanRenderTarget*> RenderTa
 		}
 	}
 
-	//Our subpass
-	vk::SubpassDescription Subpass;
-	Subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
-	Subpass.colorAttachmentCount = (uint32_t)ColorAttachmentReferences.size();
-	Subpass.pColorAttachments = ColorAttachmentReferences.data();
-	Subpass.pDepthStencilAttachment = &DepthAttachmentReference;
-
-
-	//The Renderpass itself
-	vk::RenderPassCreateInfo CreateInfo;
-	CreateInfo.attachmentCount = static_cast<uint32_t>(AttachmentDescriptions.size());
-	CreateInfo.pAttachments = AttachmentDescriptions.data();
-	CreateInfo.subpassCount = 1;
-	CreateInfo.pSubpasses = &Subpass;
-
-/*
-//TODO: Generic way to handle subpass dependencies
-	//Subpass Dependency
-	vk::SubpassDependency Dependency;
-	Dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	Dependency.dstSubpass = 0; //Currently only have the one subpass
-	Dependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-	Dependency.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-	Dependency.dstAccessMask = vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite;
-
-	CreateInfo.dependencyCount = 1;
-	CreateInfo.pDependencies = &Dependency;
-*/	
-
-	RenderPass = VulkanContext::Get()->GetDevice().createRenderPassUnique(CreateInfo);
+	//TODO: Generic way to handle subpass dependencies (they would become part of the signature)
+
+	//Render passes and framebuffers are shared with every other pass using the same attachments,
+	//a resize only creates new framebuffers since image views and extent changed
+	VulkanRenderPassCache& Cache = VulkanContext::Get()->GetRenderPassCache();
+
+	const uint64_t PreviousCompatibilityHash = RenderPass ? Cache.GetCompatibilityHash(RenderPass) : 0;
+	RenderPass = Cache.GetRenderPass(Signature);
+
 	Extent.width = Width;
 	Extent.height = Height;
 
 	Framebuffers.clear();
-
 	for (std::vector<vk::ImageView>& FrameBufferImageViews : FramebufferImageViewsPerBackbuffer)
 	{
-		vk::FramebufferCreateInfo FramebufferCreateInfo;
-		FramebufferCreateInfo.renderPass = GetHandle();
-		FramebufferCreateInfo.attachmentCount = static_cast<uint32_t>(FrameBufferImageViews.size());
-		FramebufferCreateInfo.pAttachments = FrameBufferImageViews.data();
-		FramebufferCreateInfo.width = Width;
-		FramebufferCreateInfo.height = Height;
-		FramebufferCreateInfo.layers = 1;
-
-		Framebuffers.push_back(VulkanContext::Get()->GetDevice().createFramebufferUnique(FramebufferCreateInfo));
+		Framebuffers.push_back(Cache.GetFramebuffer(RenderPass, FrameBufferImageViews, Width, Height));
 	}
+
+	return Cache.GetCompatibilityHash(RenderPass) != PreviousCompatibilityHash;
 }
 
 #include <iostream>
 
-void VulkanRenderPass::BuildCommandBuffer(std::vector<std::pair<VulkanRenderItem*, VulkanGraphicsPipeline*>> ItemsToRender)
+void VulkanRenderPass::BuildCommandBuffer(std::vector<std::pair<VulkanRenderItem*, VulkanGraphicsPipeline*>> ItemsToRender, vk::DescriptorSet FrameDescriptorSet, VulkanGPUScene* Scene)
 {
-	// Sort Input array of pairs by pipeline pointer address
-	//TODO: Sort by pipeline
-	std::sort(std::begin(ItemsToRender), std::end(ItemsToRender));
+	//Group items by pipeline, fewer pipeline binds and descriptor set rebinds
+	std::sort(std::begin(ItemsToRender), std::end(ItemsToRender), [](const std::pair<VulkanRenderItem*, VulkanGraphicsPipeline*>& A, const std::pair<VulkanRenderItem*, VulkanGraphicsPipeline*>& B)
+	{
+		return std::make_pair(A.second, A.first) < std::make_pair(B.second, B.first);
+	});
+
+	//Covers the whole render area, flipping or sub-rects are up to pipelines with static viewports
+	vk::Viewport Viewport(0.0f, 0.0f, (float) Extent.width, (float) Extent.height, 0.0f, 1.0f);
+	vk::Rect2D Scissor(vk::Offset2D(0, 0), Extent);
 
 	vk::CommandBufferUsageFlags UsageFlags = vk::CommandBufferUsageFlagBits::eRenderPassContinue | vk::CommandBufferUsageFlagBits::eSimultaneousUse; 
 	CommandBuffer.BeginSecondary(UsageFlags, GetHandle());
 
-	VulkanGraphicsPipeline* CurrentPipeline = nullptr;
+	//Compared by handle, pipelines built from identical state share one (see VulkanPipelineCache)
+	vk::Pipeline CurrentPipeline;
+	DescriptorBindState BindState;
+	BindState.FrameDescriptorSet = FrameDescriptorSet;
+	const vk::DescriptorSet BindlessDescriptorSet = VulkanContext::Get()->GetBindlessTextures().GetDescriptorSet();
+
+	//Returns the pipeline bound for draws using Pipeline, null if they have to be skipped
+	auto BindPipeline = [&](VulkanGraphicsPipeline* Pipeline) -> VulkanGraphicsPipeline*
+	{
+		//Pipelines still compiling draw with their fallback, or not at all
+		VulkanGraphicsPipeline* BoundPipeline = Pipeline->IsReady() ? Pipeline : Pipeline->GetFallback();
+		if (BoundPipeline == nullptr || !BoundPipeline->GetHandle()) return nullptr;
+
+		if (BoundPipeline->GetHandle() != CurrentPipeline)
+		{
+			CurrentPipeline = BoundPipeline->GetHandle();
+			CommandBuffer().bindPipeline(vk::PipelineBindPoint::eGraphics, BoundPipeline->GetHandle());
+
+			//Secondary command buffers don't inherit dynamic state, and binding a pipeline with static state overwrites it
+			if (BoundPipeline->HasDynamicState(vk::DynamicState::eViewport))
+			{
+				CommandBuffer().setViewport(0, 1, &Viewport);
+			}
+			if (BoundPipeline->HasDynamicState(vk::DynamicState::eScissor))
+			{
+				CommandBuffer().setScissor(0, 1, &Scissor);
+			}
+
+			//Only rebinds the frame set if the new layout disturbed it
+			BindState.SetPipeline(*BoundPipeline);
+			if (FrameDescriptorSet && BoundPipeline->HasDescriptorSet(DescriptorSetFrame))
+			{
+				BindState.Bind(CommandBuffer, DescriptorSetFrame, FrameDescriptorSet);
+			}
+			if (BoundPipeline->HasDescriptorSet(DescriptorSetBindless))
+			{
+				BindState.Bind(CommandBuffer, DescriptorSetBindless, BindlessDescriptorSet);
+			}
+		}
+
+		return BoundPipeline;
+	};
+
 	for (auto& ItemAndPipeline : ItemsToRender)
 	{
 		VulkanRenderItem* RenderItem = ItemAndPipeline.first;
@@ -138,15 +159,25 @@ void VulkanRenderPass::BuildCommandBuffer(std::vector<std::pair<VulkanRenderItem
 
 		if (RenderItem == nullptr || Pipeline == nullptr) continue;
 
-		if (Pipeline != CurrentPipeline)
-		{
-			CurrentPipeline = Pipeline;
-			CommandBuffer().bindPipeline(vk::PipelineBindPoint::eGraphics, Pipeline->GetHandle());
-		}
+		VulkanGraphicsPipeline* BoundPipeline = BindPipeline(Pipeline);
+		if (BoundPipeline == nullptr) continue;
 
-		RenderItem->AddCommands(CommandBuffer, Pipeline);
+		//Descriptor sets are allocated against the layout of the pipeline actually bound
+		RenderItem->AddCommands(CommandBuffer, BoundPipeline, BindState);
 	}	 
 
+	//GPU built draws: one indirect draw per pipeline, however many objects it has
+	if (Scene != nullptr)
+	{
+		for (const VulkanGPUScene::DrawBucket& Bucket : Scene->GetBuckets())
+		{
+			VulkanGraphicsPipeline* BoundPipeline = BindPipeline(Bucket.Pipeline);
+			if (BoundPipeline == nullptr) continue;
+
+			Scene->AddDrawCommands(CommandBuffer, Bucket, BoundPipeline, BindState);
+		}
+	}
+
 	CommandBuffer.End();
 }
 
@@ -154,7 +185,7 @@ void VulkanRenderPass::RecordCommands(VulkanCommandBuffer& CommandBuffer, size_t
 {
 	vk::RenderPassBeginInfo BeginInfo;
 	BeginInfo.renderPass = GetHandle();
-	BeginInfo.framebuffer = GetFramebuffers()[FrameIndex].get();
+	BeginInfo.framebuffer = GetFramebuffers()[FrameIndex];
 	BeginInfo.renderArea.offset = {0,0};
 	BeginInfo.renderArea.extent = Extent;	
 	BeginInfo.clearValueCount = static_cast<uint32_t>(ClearValues.size());
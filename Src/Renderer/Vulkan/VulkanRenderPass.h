@@ -29,15 +29,21 @@ public:
 
 	VulkanRenderPass();
 	
-	vk::RenderPass GetHandle() {return RenderPass.get();}
+	vk::RenderPass GetHandle() {return RenderPass;}
 
-	std::vector<vk::UniqueFramebuffer>& GetFramebuffers() { return Framebuffers; }
+	std::vector<vk::Framebuffer>& GetFramebuffers() { return Framebuffers; }
 
 	//Used by frame graph to build this render target
-	void BuildRenderPass(std::vector<VulkanRenderTarget*> RenderTargets, VulkanRenderTarget* DepthTarget, uint32_t Width, uint32_t Height, uint32_t BackbufferCount);
+	//The render pass and framebuffers come from the VulkanRenderPassCache. Returns true if the new render pass
+	//isn't compatible with the previous one, pipelines built against it must then be rebuilt. Pipelines that bake in
+	//the extent (VulkanGraphicsPipeline::BakesExtent) have to be rebuilt after every resize regardless
+	bool BuildRenderPass(std::vector<VulkanRenderTarget*> RenderTargets, VulkanRenderTarget* DepthTarget, uint32_t Width, uint32_t Height, uint32_t BackbufferCount);
 
 	//Builds a secondary command buffer for this render pass
-	void BuildCommandBuffer(std::vector<std::pair<VulkanRenderItem*, VulkanGraphicsPipeline*>> ItemsToRender);
+	//FrameDescriptorSet (if given) is bound as set 0 (DescriptorSetFrame) for every pipeline using it, render items
+	//only bind their material and object sets. Objects of Scene (if given) are drawn after them with GPU built
+	//commands, whose compute pass has to be recorded before this render pass (VulkanGPUScene::RecordBuildCommands)
+	void BuildCommandBuffer(std::vector<std::pair<VulkanRenderItem*, VulkanGraphicsPipeline*>> ItemsToRender, vk::DescriptorSet FrameDescriptorSet = nullptr, class VulkanGPUScene* Scene = nullptr);
 	VulkanCommandBuffer& GetCommandBuffer() { return CommandBuffer; }
 
 	//Adds commands to command buffer
@@ -49,9 +55,10 @@ public:
 
 protected:
 
-	vk::UniqueRenderPass RenderPass;
+	//Owned by the VulkanRenderPassCache
+	vk::RenderPass RenderPass;
 
-	std::vector<vk::UniqueFramebuffer> Framebuffers;
+	std::vector<vk::Framebuffer> Framebuffers;
 
 	/** Secondary command buffer that orchestrates pipeline binds and render calls */
 	VulkanCommandBuffer CommandBuffer;
@@ -0,0 +1,158 @@
+#include "VulkanRenderPassCache.h"
+
+#include "VulkanContext.h"
+#include "../Core/Hash.h"
+
+#include <algorithm>
+
+namespace
+{
+	void HashReference(uint64_t& Hash, const vk::AttachmentReference& Reference)
+	{
+		HashCombine(Hash, Reference.attachment);
+		HashCombine(Hash, static_cast<uint64_t>(Reference.layout));
+	}
+}
+
+bool RenderPassSignature::operator==(const RenderPassSignature& Other) const
+{
+	return Attachments == Other.Attachments && ColorReferences == Other.ColorReferences
+		&& bHasDepth == Other.bHasDepth && (!bHasDepth || DepthReference == Other.DepthReference);
+}
+
+uint64_t RenderPassSignature::Hash() const
+{
+	uint64_t Hash = CompatibilityHash();
+	for (const vk::AttachmentDescription& Attachment : Attachments)
+	{
+		HashCombine(Hash, static_cast<uint64_t>(Attachment.loadOp));
+		HashCombine(Hash, static_cast<uint64_t>(Attachment.storeOp));
+		HashCombine(Hash, static_cast<uint64_t>(Attachment.stencilLoadOp));
+		HashCombine(Hash, static_cast<uint64_t>(Attachment.stencilStoreOp));
+		HashCombine(Hash, static_cast<uint64_t>(Attachment.initialLayout));
+		HashCombine(Hash, static_cast<uint64_t>(Attachment.finalLayout));
+	}
+	for (const vk::AttachmentReference& Reference : ColorReferences)
+	{
+		HashCombine(Hash, static_cast<uint64_t>(Reference.layout));
+	}
+	if (bHasDepth)
+	{
+		HashCombine(Hash, static_cast<uint64_t>(DepthReference.layout));
+	}
+	return Hash;
+}
+
+uint64_t RenderPassSignature::CompatibilityHash() const
+{
+	uint64_t Hash = 0;
+	HashCombine(Hash, Attachments.size());
+	for (const vk::AttachmentDescription& Attachment : Attachments)
+	{
+		HashCombine(Hash, static_cast<uint64_t>(Attachment.format));
+		HashCombine(Hash, static_cast<uint64_t>(Attachment.samples));
+	}
+	HashCombine(Hash, ColorReferences.size());
+	for (const vk::AttachmentReference& Reference : ColorReferences)
+	{
+		HashCombine(Hash, Reference.attachment);
+	}
+	HashCombine(Hash, bHasDepth ? DepthReference.attachment : VK_ATTACHMENT_UNUSED);
+	return Hash;
+}
+
+size_t VulkanRenderPassCache::FramebufferKeyHasher::operator()(const FramebufferKey& Key) const
+{
+	uint64_t Hash = 0;
+	HashCombine(Hash, reinterpret_cast<uint64_t>(static_cast<VkRenderPass>(Key.RenderPass)));
+	for (vk::ImageView Attachment : Key.Attachments)
+	{
+		HashCombine(Hash, reinterpret_cast<uint64_t>(static_cast<VkImageView>(Attachment)));
+	}
+	HashCombine(Hash, Key.Width);
+	HashCombine(Hash, Key.Height);
+	return static_cast<size_t>(Hash);
+}
+
+vk::RenderPass VulkanRenderPassCache::GetRenderPass(const RenderPassSignature& Signature)
+{
+	auto Found = RenderPasses.find(Signature);
+	if (Found != RenderPasses.end())
+	{
+		return Found->second.RenderPass.get();
+	}
+
+	vk::SubpassDescription Subpass;
+	Subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+	Subpass.colorAttachmentCount = static_cast<uint32_t>(Signature.ColorReferences.size());
+	Subpass.pColorAttachments = Signature.ColorReferences.data();
+	Subpass.pDepthStencilAttachment = Signature.bHasDepth ? &Signature.DepthReference : nullptr;
+
+	vk::RenderPassCreateInfo CreateInfo;
+	CreateInfo.attachmentCount = static_cast<uint32_t>(Signature.Attachments.size());
+	CreateInfo.pAttachments = Signature.Attachments.data();
+	CreateInfo.subpassCount = 1;
+	CreateInfo.pSubpasses = &Subpass;
+
+	CachedRenderPass NewRenderPass;
+	NewRenderPass.RenderPass = VulkanContext::Get()->GetDevice().createRenderPassUnique(CreateInfo);
+	NewRenderPass.CompatibilityHash = Signature.CompatibilityHash();
+
+	const vk::RenderPass Handle = NewRenderPass.RenderPass.get();
+	CompatibilityHashes[Handle] = NewRenderPass.CompatibilityHash;
+	RenderPasses.emplace(Signature, std::move(NewRenderPass));
+	return Handle;
+}
+
+uint64_t VulkanRenderPassCache::GetCompatibilityHash(vk::RenderPass RenderPass)
+{
+	auto Found = CompatibilityHashes.find(RenderPass);
+	return (Found != CompatibilityHashes.end()) ? Found->second : 0;
+}
+
+vk::Framebuffer VulkanRenderPassCache::GetFramebuffer(vk::RenderPass RenderPass, const std::vector<vk::ImageView>& Attachments, uint32_t Width, uint32_t Height)
+{
+	FramebufferKey Key{ RenderPass, Attachments, Width, Height };
+
+	auto Found = Framebuffers.find(Key);
+	if (Found != Framebuffers.end())
+	{
+		return Found->second.get();
+	}
+
+	vk::FramebufferCreateInfo CreateInfo;
+	CreateInfo.renderPass = RenderPass;
+	CreateInfo.attachmentCount = static_cast<uint32_t>(Attachments.size());
+	CreateInfo.pAttachments = Attachments.data();
+	CreateInfo.width = Width;
+	CreateInfo.height = Height;
+	CreateInfo.layers = 1;
+
+	vk::UniqueFramebuffer Framebuffer = VulkanContext::Get()->GetDevice().createFramebufferUnique(CreateInfo);
+	const vk::Framebuffer Handle = Framebuffer.get();
+	Framebuffers.emplace(std::move(Key), std::move(Framebuffer));
+	return Handle;
+}
+
+void VulkanRenderPassCache::ReleaseImageView(vk::ImageView ImageView)
+{
+	for (auto It = Framebuffers.begin(); It != Framebuffers.end();)
+	{
+		if (std::find(It->first.Attachments.begin(), It->first.Attachments.end(), ImageView) != It->first.Attachments.end())
+		{
+			VulkanContext::Get()->GetDeletionQueue().Release(std::move(It->second));
+			It = Framebuffers.erase(It);
+		}
+		else
+		{
+			++It;
+		}
+	}
+}
+
+void VulkanRenderPassCache::Clear()
+{
+	Framebuffers.clear();
+	CompatibilityHashes.clear();
+	RenderPasses.clear();
+}
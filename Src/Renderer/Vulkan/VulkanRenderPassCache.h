@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+//Single subpass render pass layout: every attachment plus how the subpass references it
+struct RenderPassSignature
+{
+	std::vector<vk::AttachmentDescription> Attachments;
+	std::vector<vk::AttachmentReference> ColorReferences;
+	bool bHasDepth = false;
+	vk::AttachmentReference DepthReference;
+
+	bool operator==(const RenderPassSignature& Other) const;
+
+	//Formats, ops, layouts and sample counts
+	uint64_t Hash() const;
+
+	//Only what render pass compatibility depends on (formats, sample counts and references, not ops or layouts),
+	//pipelines built against a render pass can be used with any other that has the same compatibility hash
+	uint64_t CompatibilityHash() const;
+};
+
+//Shares render passes and framebuffers between everything that asks for the same ones
+//Render passes live until Clear, framebuffers until one of their image views is released (see ReleaseImageView)
+class VulkanRenderPassCache
+{
+public:
+
+	vk::RenderPass GetRenderPass(const RenderPassSignature& Signature);
+
+	//Compatibility hash of a render pass returned by GetRenderPass
+	uint64_t GetCompatibilityHash(vk::RenderPass RenderPass);
+
+	vk::Framebuffer GetFramebuffer(vk::RenderPass RenderPass, const std::vector<vk::ImageView>& Attachments, uint32_t Width, uint32_t Height);
+
+	//Must be called before an image view used as an attachment is destroyed or released, its handle may be reused
+	//by a new view afterwards. Framebuffers referencing it go to the deletion queue
+	void ReleaseImageView(vk::ImageView ImageView);
+
+	//Device idle: destroys everything
+	void Clear();
+
+protected:
+
+	struct SignatureHasher
+	{
+		size_t operator()(const RenderPassSignature& Signature) const { return static_cast<size_t>(Signature.Hash()); }
+	};
+
+	struct CachedRenderPass
+	{
+		vk::UniqueRenderPass RenderPass;
+		uint64_t CompatibilityHash;
+	};
+
+	struct FramebufferKey
+	{
+		vk::RenderPass RenderPass;
+		std::vector<vk::ImageView> Attachments;
+		uint32_t Width;
+		uint32_t Height;
+
+		bool operator==(const FramebufferKey& Other) const
+		{
+			return RenderPass == Other.RenderPass && Attachments == Other.Attachments && Width == Other.Width && Height == Other.Height;
+		}
+	};
+
+	struct FramebufferKeyHasher
+	{
+		size_t operator()(const FramebufferKey& Key) const;
+	};
+
+	std::unordered_map<RenderPassSignature, CachedRenderPass, SignatureHasher> RenderPasses;
+	std::unordered_map<VkRenderPass, uint64_t> CompatibilityHashes;
+
+	std::unordered_map<FramebufferKey, vk::UniqueFramebuffer, FramebufferKeyHasher> Framebuffers;
+};
@@ -54,7 +54,14 @@ void VulkanSwapchain::CreateSwapchain()
 	CreateInfo.compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque;
 	CreateInfo.presentMode = PresentMode;
 
-	Swapchain = VulkanContext::Get()->GetDevice().createSwapchainKHRUnique(CreateInfo);
+	vk::UniqueSwapchainKHR NewSwapchain = VulkanContext::Get()->GetDevice().createSwapchainKHRUnique(CreateInfo);
+
+	//The old swapchain is retired by the create above, but frames in flight may still present from it
+	if (Swapchain)
+	{
+		VulkanContext::Get()->GetDeletionQueue().Release(std::move(Swapchain));
+	}
+	Swapchain = std::move(NewSwapchain);
 	SwapchainImages = VulkanContext::Get()->GetDevice().getSwapchainImagesKHR(Swapchain.get());
 }
 
@@ -114,6 +121,12 @@ vk::PresentModeKHR VulkanSwapchain::ChooseSwapchainPresentMode()
 
 void VulkanSwapchain::CreateImageViews()
 {
+	//Released one by one: clear keeps the vector's storage, render targets point at its elements
+	for (vk::UniqueImageView& ImageView : SwapchainImageViews)
+	{
+		VulkanContext::Get()->GetRenderPassCache().ReleaseImageView(ImageView.get());
+		VulkanContext::Get()->GetDeletionQueue().Release(std::move(ImageView));
+	}
 	SwapchainImageViews.clear();
 
 	for (size_t i=0; i < SwapchainImages.size(); ++i)
@@ -153,6 +166,17 @@ void VulkanSwapchain::CreateDepthBuffer()
 	
 	bool HasStencil = (DepthFormat == vk::Format::eD32SfloatS8Uint) || (DepthFormat == vk::Format::eD24UnormS8Uint);
 
+	//View before image before memory
+	if (DepthBuffer)
+	{
+		VulkanContext::Get()->GetRenderPassCache().ReleaseImageView(DepthBufferView.get());
+
+		VulkanDeletionQueue& DeletionQueue = VulkanContext::Get()->GetDeletionQueue();
+		DeletionQueue.Release(std::move(DepthBufferView));
+		DeletionQueue.Release(std::move(DepthBuffer));
+		DeletionQueue.Release(std::move(DepthBufferMemory));
+	}
+
 	//TODO: Port to using helper function created in VulkanImage
 	vk::ImageCreateInfo ImageInfo;
 	ImageInfo.imageType = vk::ImageType::e2D;
@@ -0,0 +1,313 @@
+#include "VulkanTextureStreamer.h"
+
+#include "VulkanContext.h"
+#include "VulkanBuffer.h"
+#include "VulkanCommandBuffer.h"
+
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+#include <limits>
+
+VulkanTextureStreamer::VulkanTextureStreamer(vk::DeviceSize InBudgetBytes) : BudgetBytes(InBudgetBytes)
+{
+	StreamingThread = std::thread(&VulkanTextureStreamer::StreamingThreadMain, this);
+}
+
+VulkanTextureStreamer::~VulkanTextureStreamer()
+{
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		bShuttingDown = true;
+	}
+	WakeCondition.notify_all();
+	StreamingThread.join();
+
+	vk::Device Device = VulkanContext::Get()->GetDevice();
+	for (PendingUpload& Upload : PendingUploads)
+	{
+		vk::Fence Fence = Upload.Fence.get();
+		Device.waitForFences(1, &Fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+		Device.freeCommandBuffers(VulkanContext::Get()->GetCommandPool(), 1, &Upload.CommandBuffer);
+	}
+}
+
+StreamedTextureHandle VulkanTextureStreamer::Register(const std::string& Filename, ResidencyCallback OnResidencyChanged)
+{
+	std::unique_ptr<StreamedTexture> Texture(new StreamedTexture());
+	Texture->File.Open(Filename);
+	Texture->OnResidencyChanged = OnResidencyChanged;
+
+	const uint32_t LevelCount = Texture->File.GetLevelCount();
+	const uint32_t MaxDimension = std::max(Texture->File.GetWidth(), Texture->File.GetHeight());
+
+	Texture->TailMip = LevelCount - 1;
+	for (uint32_t Level = 0; Level < LevelCount; ++Level)
+	{
+		if ((MaxDimension >> Level) <= TailSize)
+		{
+			Texture->TailMip = Level;
+			break;
+		}
+	}
+	Texture->ResidentMip = Texture->TailMip;
+	Texture->TargetMip = Texture->TailMip;
+
+	//The tail is small, upload it right away so the texture is usable this frame
+	StreamRequest TailRequest;
+	TailRequest.File = &Texture->File;
+	TailRequest.BaseMip = Texture->TailMip;
+	FillStaging(TailRequest);
+
+	Texture->Image.reset(new VulkanImage());
+
+	VulkanCommandBuffer CommandBuffer;
+	CommandBuffer.Begin(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+	Texture->Image->CreateFromKTX2(CommandBuffer, Texture->File, Texture->TailMip, TailRequest.StagingBuffer.get());
+	CommandBuffer.End();
+	CommandBuffer.SubmitWaitIdle();
+
+	vk::CommandBuffer CommandBufferHandle = CommandBuffer.GetHandle();
+	VulkanContext::Get()->GetDevice().freeCommandBuffers(VulkanContext::Get()->GetCommandPool(), 1, &CommandBufferHandle);
+
+	Textures.push_back(std::move(Texture));
+	return static_cast<StreamedTextureHandle>(Textures.size() - 1);
+}
+
+void VulkanTextureStreamer::SetScreenCoverage(StreamedTextureHandle Handle, float ProjectedPixels)
+{
+	Textures[Handle]->ProjectedPixels = ProjectedPixels;
+}
+
+float VulkanTextureStreamer::ComputeProjectedPixels(const glm::vec3& Center, float Radius, const glm::vec3& CameraPosition, float FovY, float ViewportHeight)
+{
+	const float Distance = glm::length(Center - CameraPosition);
+
+	//Camera is inside the bounds, the texture may fill the screen
+	if (Distance <= Radius)
+	{
+		return ViewportHeight;
+	}
+
+	return (Radius / (Distance * std::tan(FovY * 0.5f))) * ViewportHeight;
+}
+
+bool VulkanTextureStreamer::Update()
+{
+	const bool bResidencyChanged = RetireCompletedUploads();
+	SubmitStagedRequests();
+	ChooseTargetMips();
+	QueueRequests();
+	return bResidencyChanged;
+}
+
+vk::DeviceSize VulkanTextureStreamer::GetResidentBytes() const
+{
+	vk::DeviceSize ResidentBytes = 0;
+	for (const auto& Texture : Textures)
+	{
+		ResidentBytes += Texture->File.GetLevelChainSize(Texture->ResidentMip);
+	}
+	return ResidentBytes;
+}
+
+uint32_t VulkanTextureStreamer::ComputeDesiredMip(const StreamedTexture& Texture) const
+{
+	if (Texture.ProjectedPixels <= 1.0f)
+	{
+		return Texture.TailMip;
+	}
+
+	//One texel per pixel: every halving of on-screen size drops a mip
+	const float MaxDimension = (float) std::max(Texture.File.GetWidth(), Texture.File.GetHeight());
+	const float Mip = std::floor(std::log2(MaxDimension / Texture.ProjectedPixels));
+
+	return (Mip <= 0.0f) ? 0 : std::min(static_cast<uint32_t>(Mip), Texture.TailMip);
+}
+
+void VulkanTextureStreamer::ChooseTargetMips()
+{
+	std::vector<StreamedTexture*> ByPriority;
+	for (auto& Texture : Textures)
+	{
+		ByPriority.push_back(Texture.get());
+	}
+
+	std::sort(std::begin(ByPriority), std::end(ByPriority),
+	[](const StreamedTexture* a, const StreamedTexture* b)
+	{
+		return a->ProjectedPixels > b->ProjectedPixels;
+	});
+
+	vk::DeviceSize UsedBytes = 0;
+	for (StreamedTexture* Texture : ByPriority)
+	{
+		uint32_t TargetMip = ComputeDesiredMip(*Texture);
+		while (TargetMip < Texture->TailMip && UsedBytes + Texture->File.GetLevelChainSize(TargetMip) > BudgetBytes)
+		{
+			++TargetMip;
+		}
+
+		Texture->TargetMip = TargetMip;
+		UsedBytes += Texture->File.GetLevelChainSize(TargetMip);
+	}
+}
+
+void VulkanTextureStreamer::QueueRequests()
+{
+	std::vector<std::unique_ptr<StreamRequest>> NewRequests;
+
+	for (size_t i = 0; i < Textures.size(); ++i)
+	{
+		StreamedTexture& Texture = *Textures[i];
+		if (Texture.bRequestPending || Texture.TargetMip == Texture.ResidentMip)
+		{
+			continue;
+		}
+
+		std::unique_ptr<StreamRequest> Request(new StreamRequest());
+		Request->Handle = static_cast<StreamedTextureHandle>(i);
+		Request->File = &Texture.File;
+		Request->BaseMip = Texture.TargetMip;
+		Request->Priority = Texture.ProjectedPixels;
+		NewRequests.push_back(std::move(Request));
+
+		Texture.bRequestPending = true;
+	}
+
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+
+		//Coverage changes every frame, keep queued priorities current
+		for (auto& Request : QueuedRequests)
+		{
+			Request->Priority = Textures[Request->Handle]->ProjectedPixels;
+		}
+
+		for (auto& Request : NewRequests)
+		{
+			QueuedRequests.push_back(std::move(Request));
+		}
+	}
+
+	if (!NewRequests.empty())
+	{
+		WakeCondition.notify_one();
+	}
+}
+
+void VulkanTextureStreamer::SubmitStagedRequests()
+{
+	std::vector<std::unique_ptr<StreamRequest>> Staged;
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		Staged.swap(StagedRequests);
+	}
+
+	vk::Device Device = VulkanContext::Get()->GetDevice();
+
+	for (auto& Request : Staged)
+	{
+		PendingUpload Upload;
+		Upload.Image.reset(new VulkanImage());
+
+		VulkanCommandBuffer CommandBuffer;
+		CommandBuffer.Begin(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+		Upload.Image->CreateFromKTX2(CommandBuffer, *Request->File, Request->BaseMip, Request->StagingBuffer.get());
+		CommandBuffer.End();
+
+		Upload.Fence = Device.createFenceUnique(vk::FenceCreateInfo());
+		CommandBuffer.Submit(Upload.Fence.get());
+
+		Upload.CommandBuffer = CommandBuffer.GetHandle();
+		Upload.Request = std::move(Request);
+		PendingUploads.push_back(std::move(Upload));
+	}
+}
+
+bool VulkanTextureStreamer::RetireCompletedUploads()
+{
+	vk::Device Device = VulkanContext::Get()->GetDevice();
+	bool bResidencyChanged = false;
+
+	for (auto It = PendingUploads.begin(); It != PendingUploads.end();)
+	{
+		if (Device.getFenceStatus(It->Fence.get()) != vk::Result::eSuccess)
+		{
+			++It;
+			continue;
+		}
+
+		StreamedTexture& Texture = *Textures[It->Request->Handle];
+
+		//Frames in flight may still sample the old image
+		if (Texture.Image)
+		{
+			VulkanContext::Get()->GetDeletionQueue().Release(std::move(Texture.Image));
+		}
+		Texture.Image = std::move(It->Image);
+		Texture.ResidentMip = It->Request->BaseMip;
+		Texture.bRequestPending = false;
+
+		Device.freeCommandBuffers(VulkanContext::Get()->GetCommandPool(), 1, &It->CommandBuffer);
+
+		if (Texture.OnResidencyChanged)
+		{
+			Texture.OnResidencyChanged(Texture.Image->GetDescriptorInfo());
+		}
+
+		bResidencyChanged = true;
+		It = PendingUploads.erase(It);
+	}
+
+	return bResidencyChanged;
+}
+
+void VulkanTextureStreamer::FillStaging(StreamRequest& Request)
+{
+	uint64_t RangeBegin, RangeEnd;
+	Request.File->GetLevelRange(Request.BaseMip, RangeBegin, RangeEnd);
+	const vk::DeviceSize StagingSize = RangeEnd - RangeBegin;
+
+	VulkanBufferUtils::CreateBuffer(StagingSize, vk::BufferUsageFlagBits::eTransferSrc, 
+		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, 
+		Request.StagingBuffer, Request.StagingMemory);
+
+	vk::Device Device = VulkanContext::Get()->GetDevice();
+
+	//Reading the mapping is where the actual disk I/O happens
+	void* MappedMemory = Device.mapMemory(Request.StagingMemory.get(), 0, StagingSize);
+		memcpy(MappedMemory, Request.File->GetData() + RangeBegin, static_cast<size_t>(StagingSize));
+	Device.unmapMemory(Request.StagingMemory.get());
+}
+
+void VulkanTextureStreamer::StreamingThreadMain()
+{
+	for (;;)
+	{
+		std::unique_ptr<StreamRequest> Request;
+		{
+			std::unique_lock<std::mutex> Lock(Mutex);
+			WakeCondition.wait(Lock, [this] { return bShuttingDown || !QueuedRequests.empty(); });
+
+			if (bShuttingDown)
+			{
+				return;
+			}
+
+			auto Highest = std::max_element(std::begin(QueuedRequests), std::end(QueuedRequests),
+			[](const std::unique_ptr<StreamRequest>& a, const std::unique_ptr<StreamRequest>& b)
+			{
+				return a->Priority < b->Priority;
+			});
+
+			Request = std::move(*Highest);
+			QueuedRequests.erase(Highest);
+		}
+
+		FillStaging(*Request);
+
+		std::lock_guard<std::mutex> Lock(Mutex);
+		StagedRequests.push_back(std::move(Request));
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "KTX2File.h"
+#include "VulkanImage.h"
+
+typedef uint32_t StreamedTextureHandle;
+
+//Streams the mip levels of KTX2 textures in the background
+//The mip tail is loaded as soon as a texture is registered, higher mips are streamed in order of
+//projected screen coverage and dropped again (lowest coverage first) when the VRAM budget is exceeded
+class VulkanTextureStreamer
+{
+public:
+
+	//Called on the main thread from Update whenever a texture's resident mip chain changes
+	typedef std::function<void(const vk::DescriptorImageInfo&)> ResidencyCallback;
+
+	VulkanTextureStreamer(vk::DeviceSize InBudgetBytes = 256ull * 1024 * 1024);
+	~VulkanTextureStreamer();
+
+	//Maps the file and synchronously uploads its mip tail, higher mips follow once coverage is known
+	StreamedTextureHandle Register(const std::string& Filename, ResidencyCallback OnResidencyChanged = nullptr);
+
+	//Size of the texture on screen in pixels, drives both mip selection and streaming priority
+	void SetScreenCoverage(StreamedTextureHandle Handle, float ProjectedPixels);
+
+	//Projected diameter in pixels of a bounding sphere seen from CameraPosition
+	static float ComputeProjectedPixels(const glm::vec3& Center, float Radius, const glm::vec3& CameraPosition, float FovY, float ViewportHeight);
+
+	//Main thread, once per frame. Never blocks on I/O or the GPU.
+	//Returns true if any descriptor changed, in which case command buffers binding it must be re-recorded
+	bool Update();
+
+	vk::DescriptorImageInfo& GetDescriptorInfo(StreamedTextureHandle Handle) { return Textures[Handle]->Image->GetDescriptorInfo(); }
+	uint32_t GetResidentMip(StreamedTextureHandle Handle) { return Textures[Handle]->ResidentMip; }
+
+	void SetBudget(vk::DeviceSize InBudgetBytes) { BudgetBytes = InBudgetBytes; }
+	vk::DeviceSize GetBudget() const { return BudgetBytes; }
+	vk::DeviceSize GetResidentBytes() const;
+
+	//Mips at most this many pixels wide form the tail that's always resident
+	static const uint32_t TailSize = 64;
+
+protected:
+
+	struct StreamedTexture
+	{
+		KTX2File File;
+		std::unique_ptr<VulkanImage> Image;
+		ResidencyCallback OnResidencyChanged;
+
+		uint32_t TailMip = 0;      //Least detailed mip we ever drop down to
+		uint32_t ResidentMip = 0;  //Most detailed mip currently on the GPU
+		uint32_t TargetMip = 0;    //Mip chosen by coverage and budget
+		bool bRequestPending = false;
+		float ProjectedPixels = 0.0f;
+	};
+
+	//One residency change, its staging buffer is filled on the streaming thread
+	struct StreamRequest
+	{
+		StreamedTextureHandle Handle;
+		const KTX2File* File;
+		uint32_t BaseMip;
+		float Priority;
+
+		vk::UniqueBuffer StagingBuffer;
+		vk::UniqueDeviceMemory StagingMemory;
+	};
+
+	//Upload in flight on the GPU, swapped in once its fence signals
+	struct PendingUpload
+	{
+		std::unique_ptr<StreamRequest> Request;
+		std::unique_ptr<VulkanImage> Image;
+		vk::CommandBuffer CommandBuffer;
+		vk::UniqueFence Fence;
+	};
+
+	uint32_t ComputeDesiredMip(const StreamedTexture& Texture) const;
+
+	//Highest-coverage textures get their desired mip first, the rest degrade until they fit the budget
+	void ChooseTargetMips();
+	void QueueRequests();
+	void SubmitStagedRequests();
+	bool RetireCompletedUploads();
+
+	static void FillStaging(StreamRequest& Request);
+	void StreamingThreadMain();
+
+	std::vector<std::unique_ptr<StreamedTexture>> Textures;
+	std::vector<PendingUpload> PendingUploads;
+
+	vk::DeviceSize BudgetBytes;
+
+	//Shared with the streaming thread
+	std::mutex Mutex;
+	std::condition_variable WakeCondition;
+	std::vector<std::unique_ptr<StreamRequest>> QueuedRequests;
+	std::vector<std::unique_ptr<StreamRequest>> StagedRequests;
+	bool bShuttingDown = false;
+
+	std::thread StreamingThread;
+};
@@ -3,6 +3,7 @@
 #include <string>
 #include <iostream>
 #include <algorithm>
+#include <cstring>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -17,6 +18,12 @@
 #include "Renderer/Vulkan/VulkanUniform.h"
 #include "Renderer/Vulkan/VulkanImage.h"
 #include "Renderer/Vulkan/VulkanRenderItem.hpp"
+#include "Renderer/Vulkan/VulkanGPUScene.h"
+#include "Renderer/Vulkan/VulkanAssetLoader.h"
+#include "Renderer/Vulkan/VulkanPipelineLoader.h"
+#include "Renderer/IO/AssetHotReloader.h"
+#include "Renderer/IO/AssetArchive.h"
+#include "Renderer/IO/MappedFile.h"
 #include <GLFW\glfw3.h>
 
 #define TINYOBJLOADER_IMPLEMENTATION
@@ -25,8 +32,9 @@
 #define VULKAN_HPP_NO_EXCEPTIONS
 
 #include "Renderer/GLSL/ShaderCompiler.hpp"
+#include "Renderer/GLSL/ShaderReflection.h"
 
-VulkanRenderItem LoadModel(std::string& FilePath)
+void LoadModelGeometry(const std::string& FilePath, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
 {
 	tinyobj::attrib_t attrib;
     std::vector<tinyobj::shape_t> shapes;
@@ -37,9 +45,6 @@ VulkanRenderItem LoadModel(std::string& FilePath)
         throw std::runtime_error(err);
     }
 
-	std::vector<Vertex> vertices;
-	std::vector<uint32_t> indices;
-
 	for (const auto& shape : shapes) 
 	{
 		for (const auto& index : shape.mesh.indices) 
@@ -63,6 +68,13 @@ VulkanRenderItem LoadModel(std::string& FilePath)
 			indices.push_back((uint32_t)indices.size());
 		}
 	}
+}
+
+VulkanRenderItem LoadModel(std::string& FilePath)
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	LoadModelGeometry(FilePath, vertices, indices);
 
 	VulkanRenderItem NewRenderItem((void*) vertices.data(), sizeof(vertices[0]) * vertices.size(),
 								  (void*) indices.data(), sizeof(indices[0]) * indices.size(), static_cast<uint32_t>(indices.size()));
@@ -70,6 +82,19 @@ VulkanRenderItem LoadModel(std::string& FilePath)
 	return NewRenderItem;
 }
 
+//Texture and mesh load concurrently: both reads go out together and their uploads overlap
+//Paths are archive relative, Loader reads them from the cooked archive
+Task<void> LoadCookedScene(VulkanAssetLoader& Loader, std::unique_ptr<VulkanImage>& OutImage, std::unique_ptr<VulkanRenderItem>& OutModel)
+{
+	Task<std::unique_ptr<VulkanImage>> TextureLoad = Loader.LoadTexture("textures/test.ktx2");
+	Task<std::unique_ptr<VulkanRenderItem>> ModelLoad = Loader.LoadMesh("models/Torus.smesh");
+
+	co_await WhenAll(TextureLoad, ModelLoad);
+
+	OutImage = co_await TextureLoad;
+	OutModel = co_await ModelLoad;
+}
+
 void HandleInput(GLFWwindow* window, const float& deltaSeconds, const float& MouseDeltaX, const float& MouseDeltaY, glm::vec3& CameraPosition, glm::vec3& Target)
 {
 	const float MoveSpeed = 3.0f * deltaSeconds;
@@ -131,8 +156,30 @@ void HandleInput(GLFWwindow* window, const float& deltaSeconds, const float& Mou
 
 int main(int, char**)
 {
-	auto VertSpv = CompileGLSL(ASSET_DIR + std::string("/shaders/shader.vert"));
-	auto FragSpv = CompileGLSL(ASSET_DIR + std::string("/shaders/shader.frag"));
+	//Prefer assets cooked by ScalpelCook, otherwise everything is compiled/decoded from ASSET_DIR
+	AssetArchive CookedAssets;
+	const bool bUseCookedAssets = CookedAssets.Open(COOKED_ASSET_DIR + std::string("/Assets.pak"));
+	std::vector<uint8_t> CookedData;
+
+	auto LoadShader = [&](const std::string& Name) -> std::vector<unsigned int>
+	{
+		if (bUseCookedAssets && CookedAssets.Read(Name + ".spv", CookedData))
+		{
+			std::vector<unsigned int> SpirV(CookedData.size() / sizeof(unsigned int));
+			memcpy(SpirV.data(), CookedData.data(), SpirV.size() * sizeof(unsigned int));
+
+			//Pipelines take their reflection from the cooked blob instead of parsing the SpirV
+			if (CookedAssets.Read(Name + ".refl", CookedData))
+			{
+				ShaderReflection::AddCooked(SpirV, CookedData.data(), CookedData.size());
+			}
+			return SpirV;
+		}
+		return CompileGLSL(ASSET_DIR + std::string("/") + Name);
+	};
+
+	auto VertSpv = LoadShader("shaders/shader.vert");
+	auto FragSpv = LoadShader("shaders/shader.frag");
 
 	// Setup window
 	auto error_callback = [] (int error, const char* description)
@@ -153,6 +200,7 @@ int main(int, char**)
 
 	VulkanContext* Context = VulkanContext::Get();
 	Context->Startup(window);
+	Context->GetPipelineCache().Load(PIPELINE_CACHE_FILE);
 	
 	//Scope block for implicit destruction of unique vulkan objects
 	{
@@ -194,8 +242,28 @@ int main(int, char**)
 		VulkanRenderPass RenderPass;
 		RenderPass.BuildRenderPass(ColorTargets, &DepthTarget, Context->GetSwapchain().GetExtent().width, Context->GetSwapchain().GetExtent().height, (uint32_t)Context->GetSwapchain().GetImageViews().size());
 
+		//Cooked content is streamed in through the asset loader, source assets go through the blocking loaders
+		VulkanAssetLoader AssetLoader;
+		std::unique_ptr<VulkanImage> CookedImage;
+		std::unique_ptr<VulkanRenderItem> CookedModel;
+		if (bUseCookedAssets)
+		{
+			AssetLoader.SetArchive(&CookedAssets);
+			try
+			{
+				AssetLoader.Wait(LoadCookedScene(AssetLoader, CookedImage, CookedModel));
+			}
+			catch (const std::exception& Exception)
+			{
+				//Stale or partial cook, fall back to the source assets
+				std::cout << "Failed to load cooked scene (" << Exception.what() << "), loading source assets" << std::endl;
+				CookedImage.reset();
+				CookedModel.reset();
+			}
+		}
+
 		std::string ImageName(ASSET_DIR + std::string("/textures/test.png"));
-		VulkanImage Image(ImageName);
+		VulkanImage Image = CookedImage ? std::move(*CookedImage) : VulkanImage(ImageName);
 		vk::ImageView ImageView = Image.GetImageView();
 		vk::Sampler ImageSampler = Image.GetSampler();
 
@@ -208,17 +276,17 @@ int main(int, char**)
 		VulkanUniform UniformBuffer(sizeof(UniformBufferObject));
 
 		std::string ModelPath(ASSET_DIR + std::string("/models/Torus.obj"));
-		VulkanRenderItem TestVulkanRenderItem = LoadModel(ModelPath);
+		VulkanRenderItem TestVulkanRenderItem = CookedModel ? std::move(*CookedModel) : LoadModel(ModelPath);
 
 		//Reference some resources in our render item
-		TestVulkanRenderItem.AddBufferResource("MVP", UniformBuffer.GetDescriptorInfo());
 		TestVulkanRenderItem.AddImageResource("texSampler", Image.GetDescriptorInfo());
 		
 		glm::vec3 CameraPosition(0.0f, 2.0f, 2.0f);
 		glm::vec3 Target(0,0,0);
 		const glm::vec3 UpVector(0,0,1);
 
-		auto UpdateUniformData = [&] (VulkanUniform& Uniform, const float& deltaSeconds)
+		//Returns the view projection, for culling
+		auto UpdateUniformData = [&] (VulkanUniform& Uniform, const float& deltaSeconds) -> glm::mat4
 		{
 			static float TotalTime = 0.0f;
 			TotalTime += deltaSeconds;
@@ -230,17 +298,84 @@ int main(int, char**)
 			Ubo.proj[1][1] *= -1;
 
 			Uniform.UpdateUniformData(&Ubo, sizeof(UniformBufferObject));
+			return Ubo.proj * Ubo.view;
+		};
+
+		//Pipeline state comes from Assets/pipelines (flattened into .pipeline files when cooked). TestPipeline is loaded
+		//together with its base so it's created as a derivative of it
+		auto ReadAsset = [&](const std::string& Name, std::vector<uint8_t>& OutData) -> bool
+		{
+			if (bUseCookedAssets && CookedAssets.Read(Name, OutData))
+			{
+				return true;
+			}
+
+			MappedFile File;
+			if (!File.Open(ASSET_DIR + std::string("/") + Name))
+			{
+				return false;
+			}
+			OutData.assign(File.GetData(), File.GetData() + File.GetSize());
+			return true;
 		};
 
-		//TODO: Pipeline derivation (faster creation, faster binding) (can derive parts of the create info)		
-		VulkanGraphicsPipeline Pipeline;
+		const std::string PipelineExtension = (bUseCookedAssets && CookedAssets.Find("pipelines/TestPipeline.pipeline")) ? ".pipeline" : ".json";
+		VulkanPipelineLoader PipelineLoader(ReadAsset, LoadShader);
+		std::vector<std::unique_ptr<VulkanGraphicsPipeline>> LoadedPipelines = PipelineLoader.LoadPipelines(
+			{ "pipelines/BasePipeline" + PipelineExtension, "pipelines/TestPipeline" + PipelineExtension }, RenderPass);
+		VulkanGraphicsPipeline& Pipeline = *LoadedPipelines[1];
 
-		Pipeline.InputAssembly.topology = vk::PrimitiveTopology::eTriangleList;
+		//Camera data lives in the frame set (set 0), bound once per command buffer instead of per render item
+		DescriptorData FrameDescriptors;
+		auto AllocateFrameDescriptors = [&]()
+		{
+			Context->GetDeletionQueue().Release(std::move(FrameDescriptors));
+			FrameDescriptors = Pipeline.AllocateDescriptorSets(1, DescriptorSetFrame);
+			Pipeline.WriteDescriptorSet(FrameDescriptors.Sets[0].get(), DescriptorSetFrame, {}, { { "MVP", UniformBuffer.GetDescriptorInfo() } });
+		};
+		AllocateFrameDescriptors();
 
-		Pipeline.DepthStencil.depthTestEnable = VK_TRUE;
-		Pipeline.DepthStencil.depthWriteEnable = VK_TRUE;
+		//GPU driven path: a grid of toruses below the test model, drawn with GPU built indirect draws and textured
+		//through the bindless table. Shares the frame set, GPUScene.vert declares the same MVP block
+		const uint32_t SceneGridSize = 10;
+		auto GetSceneTransform = [&](uint32_t Object, float Time)
+		{
+			const glm::vec3 Position((Object % SceneGridSize) * 3.0f - 13.5f, (Object / SceneGridSize) * 3.0f - 13.5f, -3.0f);
+			return glm::rotate(glm::translate(glm::mat4(1.0f), Position), Time * glm::radians(10.0f + Object), glm::vec3(0.0f, 0.0f, 1.0f));
+		};
 
-		Pipeline.BuildPipeline(RenderPass, VertSpv, FragSpv);
+		std::unique_ptr<VulkanGPUScene> GPUScene;
+		VulkanGraphicsPipeline ScenePipeline;
+		std::vector<unsigned int> SceneVertSpv;
+		std::vector<unsigned int> SceneFragSpv;
+		uint32_t SceneTexture = VulkanBindlessTextures::InvalidIndex;
+		if (Context->GetBindlessTextures().IsEnabled() && Context->GetEnabledFeatures().drawIndirectFirstInstance)
+		{
+			SceneVertSpv = LoadShader("shaders/GPUScene.vert");
+			SceneFragSpv = LoadShader("shaders/GPUScene.frag");
+			ScenePipeline.DebugName = "GPUScene";
+			ScenePipeline.BuildPipeline(RenderPass, SceneVertSpv, SceneFragSpv);
+
+			GPUScene.reset(new VulkanGPUScene());
+			GPUScene->Create(LoadShader("shaders/BuildDrawCommands.comp"), SceneGridSize * SceneGridSize);
+
+			std::vector<Vertex> TorusVertices;
+			std::vector<uint32_t> TorusIndices;
+			LoadModelGeometry(ModelPath, TorusVertices, TorusIndices);
+			const uint32_t Torus = GPUScene->AddMesh(TorusVertices, TorusIndices);
+			GPUScene->UploadGeometry();
+
+			SceneTexture = Context->GetBindlessTextures().RegisterTexture(Image.GetImageView());
+			const uint32_t SceneSampler = Context->GetBindlessTextures().RegisterSampler(Image.GetSampler());
+			for (uint32_t i = 0; i < SceneGridSize * SceneGridSize; ++i)
+			{
+				GPUScene->AddObject(Torus, &ScenePipeline, GetSceneTransform(i, 0.0f), SceneTexture, SceneSampler);
+			}
+		}
+		else
+		{
+			std::cout << "Bindless textures or drawIndirectFirstInstance not supported, skipping the GPU scene" << std::endl;
+		}
 		/* ... End Pipeline Setup ... */
 
 		std::vector<VulkanCommandBuffer> CommandBuffers;
@@ -255,7 +390,7 @@ int main(int, char**)
 		//Wrapped in lambda for window resize below
 		auto BuildPrimaryCommandBuffers = [&]()
 		{
-			RenderPass.BuildCommandBuffer(VulkanRenderItems);
+			RenderPass.BuildCommandBuffer(VulkanRenderItems, FrameDescriptors.Sets[0].get(), GPUScene.get());
 
 			for (size_t i = 0; i < CommandBuffers.size(); ++i)
 			{
@@ -265,6 +400,12 @@ int main(int, char**)
 				//TODO: Iterate over all renderpasses (sorted based on Frame Graph and call function to handle them (see below))
 				//TODO: The above will also need to handle barriers between certain renderpasses when necessary
 
+				//Culls and writes the draw commands the render pass reads, has to be outside of it
+				if (GPUScene)
+				{
+					GPUScene->RecordBuildCommands(CommandBuffer);
+				}
+
 				RenderPass.RecordCommands(CommandBuffer, i);
 
 				CommandBuffer.End();
@@ -273,6 +414,45 @@ int main(int, char**)
 
 		BuildPrimaryCommandBuffers();
 
+		//Hot Reload: shader changes rebuild the pipelines using them, textures and meshes are re-uploaded in place
+		AssetHotReloader HotReloader(ASSET_DIR);
+		bool bPipelineDirty = false;
+
+		HotReloader.WatchShader(ASSET_DIR + std::string("/shaders/shader.vert"), [&](const std::vector<unsigned int>& SpirV)
+		{
+			VertSpv = SpirV;
+			bPipelineDirty = true;
+		});
+
+		HotReloader.WatchShader(ASSET_DIR + std::string("/shaders/shader.frag"), [&](const std::vector<unsigned int>& SpirV)
+		{
+			FragSpv = SpirV;
+			bPipelineDirty = true;
+		});
+
+		HotReloader.WatchFile(ImageName, [&]()
+		{
+			Context->GetDeletionQueue().Release(std::move(Image));
+			Image = VulkanImage(ImageName);
+			TestVulkanRenderItem.SetImageResource("texSampler", Image.GetDescriptorInfo());
+
+			//The bindless set is update-after-bind, recorded command buffers pick up the new view without a re-record
+			if (SceneTexture != VulkanBindlessTextures::InvalidIndex)
+			{
+				Context->GetBindlessTextures().UpdateTexture(SceneTexture, Image.GetImageView());
+			}
+		});
+
+		HotReloader.WatchFile(ModelPath, [&]()
+		{
+			VulkanRenderItem ReloadedItem = LoadModel(ModelPath);
+			Context->GetDeletionQueue().Release(std::move(TestVulkanRenderItem.VertexBuffer));
+			Context->GetDeletionQueue().Release(std::move(TestVulkanRenderItem.IndexBuffer));
+			TestVulkanRenderItem.VertexBuffer = std::move(ReloadedItem.VertexBuffer);
+			TestVulkanRenderItem.IndexBuffer = std::move(ReloadedItem.IndexBuffer);
+			TestVulkanRenderItem.IndexCount = ReloadedItem.IndexCount;
+		});
+
 		vk::UniqueSemaphore ImageAvailableSemaphore = Context->GetDevice().createSemaphoreUnique(vk::SemaphoreCreateInfo());
 		vk::UniqueSemaphore RenderFinishedSemaphore = Context->GetDevice().createSemaphoreUnique(vk::SemaphoreCreateInfo());
 
@@ -281,6 +461,7 @@ int main(int, char**)
 
 		double LastTime = 0.0;
 		float deltaSeconds = 0.0;
+		float SceneTime = 0.0f;
 		
 		double LastMouseX, LastMouseY;
 		glfwGetCursorPos(window, &LastMouseX, &LastMouseY);
@@ -317,16 +498,55 @@ int main(int, char**)
 				continue;
 			}
 
-			UpdateUniformData(UniformBuffer, deltaSeconds);
+			//Waits for the previous frame, after which its uniform data and command buffers can be overwritten
+			Context->BeginFrame();
 
-			auto HandleResize = [&]()
+			const glm::mat4 ViewProjection = UpdateUniformData(UniformBuffer, deltaSeconds);
+
+			if (GPUScene)
+			{
+				//Moving objects only writes the mapped object buffer, the recorded commands stay valid
+				SceneTime += deltaSeconds;
+				for (uint32_t i = 0; i < GPUScene->GetObjectCount(); ++i)
+				{
+					GPUScene->SetTransform(i, GetSceneTransform(i, SceneTime));
+				}
+				GPUScene->Update(ViewProjection);
+			}
+
+			AssetLoader.Update();
+
+			if (HotReloader.Poll())
+			{
+				if (bPipelineDirty)
+				{
+					//Descriptor sets were allocated against the old layout, the new shaders may bind differently
+					Context->GetDeletionQueue().Release(std::move(TestVulkanRenderItem.PipelineDescriptors));
+					TestVulkanRenderItem.PipelineDescriptors.clear();
+
+					//Compiles in the background, draws using it are skipped until it's done (see PollCompiled below)
+					Pipeline.BuildPipelineAsync(RenderPass, VertSpv, FragSpv);
+					AllocateFrameDescriptors();
+					bPipelineDirty = false;
+				}
+
+				BuildPrimaryCommandBuffers();
+			}
+
+			if (Pipeline.PollCompiled())
 			{
-				Context->GetDevice().waitIdle();
+				BuildPrimaryCommandBuffers();
+			}
 
+			//Everything replaced here goes through the deletion queue, no need to idle the device
+			auto HandleResize = [&]()
+			{
 				Context->GetSwapchain().Build();
 
 				//TODO: This is what needs to be done after a resize for a rendertarget
 				{
+					Context->GetRenderPassCache().ReleaseImageView(RenderTargetImage.GetImageView());
+					Context->GetDeletionQueue().Release(std::move(RenderTargetImage));
 					RenderTargetImage = VulkanImage(Context->GetSwapchain().GetExtent().width, Context->GetSwapchain().GetExtent().height, vk::Format::eR8G8B8A8Unorm, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eColorAttachment, vk::MemoryPropertyFlagBits::eDeviceLocal);
 					TestRenderTarget.ImageViews.clear();
 					for (auto& UniqueImageView : Context->GetSwapchain().GetImageViews())
@@ -335,9 +555,19 @@ int main(int, char**)
 					}
 				}
 				
-				RenderPass.BuildRenderPass(ColorTargets, &DepthTarget, Context->GetSwapchain().GetExtent().width, Context->GetSwapchain().GetExtent().height, (uint32_t)Context->GetSwapchain().GetImageViews().size());
-
-				Pipeline.BuildPipeline(RenderPass, VertSpv, FragSpv);
+				//With dynamic viewport and scissor the pipeline only needs rebuilding if the swapchain format changed,
+				//a pipeline description can turn them off though and bake in the old extent
+				const bool bRenderPassChanged = RenderPass.BuildRenderPass(ColorTargets, &DepthTarget, Context->GetSwapchain().GetExtent().width, Context->GetSwapchain().GetExtent().height, (uint32_t)Context->GetSwapchain().GetImageViews().size());
+				if (bRenderPassChanged || Pipeline.BakesExtent())
+				{
+					Pipeline.BuildPipeline(RenderPass, VertSpv, FragSpv);
+					AllocateFrameDescriptors();
+				}
+				if (GPUScene && (bRenderPassChanged || ScenePipeline.BakesExtent()))
+				{
+					ScenePipeline.BuildPipeline(RenderPass, SceneVertSpv, SceneFragSpv);
+					GPUScene->ReleaseDescriptors();
+				}
 
 				BuildPrimaryCommandBuffers();
 			};
@@ -376,7 +606,7 @@ int main(int, char**)
 			SubmitInfo.signalSemaphoreCount = 1;
 			SubmitInfo.pSignalSemaphores = SignalSemaphores;
 
-			Context->GetGraphicsQueue().submit(1, &SubmitInfo, vk::Fence());
+			Context->GetGraphicsQueue().submit(1, &SubmitInfo, Context->ResetFrameFence());
 
 			vk::PresentInfoKHR PresentInfo;
 			PresentInfo.waitSemaphoreCount = 1;
@@ -388,11 +618,10 @@ int main(int, char**)
 			PresentInfo.pImageIndices = &ImageIndex;
 
 			vk::Result Result = Context->GetPresentQueue().presentKHR(PresentInfo);
-		
-			Context->GetPresentQueue().waitIdle();
 		}
 		
 		Context->GetDevice().waitIdle();
+		Context->GetPipelineCache().PrintStats();
 	}
 	
 	// Cleanup